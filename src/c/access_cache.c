@@ -0,0 +1,458 @@
+#include "access_cache.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <ovarray.h>
+#include <ovhashmap.h>
+#include <ovthreads.h>
+
+#include "file.h"
+
+enum {
+  batch_min_files = 8,         ///< Files sharing a folder before the folder is enumerated instead
+  batch_entries_per_file = 16, ///< Folder entries read per file before the rest are checked one by one
+  prune_min_entries = 1024,    ///< Entry count that triggers dropping expired entries
+};
+
+struct entry {
+  wchar_t *key; ///< Case-folded path
+  size_t key_bytes;
+  uint64_t expires_at;
+  bool accessible;
+  bool pending; ///< Waiting for a folder enumeration to report it
+};
+
+struct gcmz_access_cache {
+  mtx_t mtx;
+  struct ov_hashmap *entries;
+  wchar_t *buffer; ///< Case-folded form of the path being looked up
+  uint64_t ttl_ms;
+  size_t prune_at;
+};
+
+struct pending_file {
+  wchar_t const *path;
+  size_t dir_len;
+};
+
+static void get_key_from_entry(void const *const item, void const **const key, size_t *const key_bytes) {
+  struct entry const *const e = (struct entry const *)item;
+  *key = e->key;
+  *key_bytes = e->key_bytes;
+}
+
+/**
+ * @brief Store the case-folded form of a path in the lookup buffer
+ */
+static bool fold_to_buffer(struct gcmz_access_cache *const c,
+                           wchar_t const *const path,
+                           size_t const len,
+                           struct ov_error *const err) {
+  if (!OV_ARRAY_GROW(&c->buffer, len + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  memcpy(c->buffer, path, len * sizeof(wchar_t));
+  c->buffer[len] = L'\0';
+  if (len) {
+    CharUpperBuffW(c->buffer, (DWORD)len);
+  }
+  return true;
+}
+
+static struct entry const *find_buffer(struct gcmz_access_cache *const c, size_t const len) {
+  return (struct entry const *)OV_HASHMAP_GET(c->entries,
+                                              &((struct entry const){
+                                                  .key = c->buffer,
+                                                  .key_bytes = len * sizeof(wchar_t),
+                                              }));
+}
+
+/**
+ * @brief Rebuild the map without expired entries once it has grown large
+ */
+static void prune(struct gcmz_access_cache *const c, uint64_t const now) {
+  if (OV_HASHMAP_COUNT(c->entries) < c->prune_at) {
+    return;
+  }
+  struct ov_hashmap *live = OV_HASHMAP_CREATE_DYNAMIC(sizeof(struct entry), c->prune_at, get_key_from_entry);
+  if (!live) {
+    return;
+  }
+  struct entry *e = NULL;
+  for (size_t i = 0; OV_HASHMAP_ITER(c->entries, &i, &e);) {
+    if (e->expires_at > now && OV_HASHMAP_SET(live, e)) {
+      continue;
+    }
+    OV_ARRAY_DESTROY(&e->key);
+  }
+  OV_HASHMAP_DESTROY(&c->entries);
+  c->entries = live;
+  size_t const count = OV_HASHMAP_COUNT(live);
+  c->prune_at = count * 2 > prune_min_entries ? count * 2 : prune_min_entries;
+}
+
+/**
+ * @brief Record the result for the path in the lookup buffer
+ */
+static bool store_buffer(struct gcmz_access_cache *const c,
+                         size_t const len,
+                         bool const accessible,
+                         bool const pending,
+                         uint64_t const expires_at,
+                         struct ov_error *const err) {
+  struct entry const *const found = find_buffer(c, len);
+  struct entry e = {
+      .key = found ? found->key : NULL,
+      .key_bytes = len * sizeof(wchar_t),
+      .expires_at = expires_at,
+      .accessible = accessible,
+      .pending = pending,
+  };
+  if (!e.key) {
+    if (!OV_ARRAY_GROW(&e.key, len + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      return false;
+    }
+    memcpy(e.key, c->buffer, (len + 1) * sizeof(wchar_t));
+  }
+  if (!OV_HASHMAP_SET(c->entries, &e)) {
+    if (!found) {
+      OV_ARRAY_DESTROY(&e.key);
+    }
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  return true;
+}
+
+static bool stat_path(wchar_t const *const path, bool *const accessible, struct ov_error *const err) {
+  DWORD const attrs = GetFileAttributesW(path);
+  if (attrs == INVALID_FILE_ATTRIBUTES) {
+    HRESULT const hr = HRESULT_FROM_WIN32(GetLastError());
+    if (hr != HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) && hr != HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      return false;
+    }
+  }
+  *accessible = (attrs != INVALID_FILE_ATTRIBUTES) && !(attrs & FILE_ATTRIBUTE_DIRECTORY);
+  return true;
+}
+
+bool gcmz_access_cache_create(struct gcmz_access_cache **const cache,
+                              uint32_t const ttl_ms,
+                              struct ov_error *const err) {
+  if (!cache || *cache) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  struct gcmz_access_cache *c = NULL;
+  bool mtx_created = false;
+  bool result = false;
+
+  if (!OV_REALLOC(&c, 1, sizeof(*c))) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  *c = (struct gcmz_access_cache){
+      .ttl_ms = ttl_ms,
+      .prune_at = prune_min_entries,
+  };
+  if (mtx_init(&c->mtx, mtx_plain) != thrd_success) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    goto cleanup;
+  }
+  mtx_created = true;
+  c->entries = OV_HASHMAP_CREATE_DYNAMIC(sizeof(struct entry), 64, get_key_from_entry);
+  if (!c->entries) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  *cache = c;
+  c = NULL;
+  result = true;
+
+cleanup:
+  if (c) {
+    if (mtx_created) {
+      mtx_destroy(&c->mtx);
+    }
+    OV_FREE(&c);
+  }
+  return result;
+}
+
+void gcmz_access_cache_destroy(struct gcmz_access_cache **const cache) {
+  if (!cache || !*cache) {
+    return;
+  }
+  struct gcmz_access_cache *const c = *cache;
+  if (c->entries) {
+    struct entry *e = NULL;
+    for (size_t i = 0; OV_HASHMAP_ITER(c->entries, &i, &e);) {
+      OV_ARRAY_DESTROY(&e->key);
+    }
+    OV_HASHMAP_DESTROY(&c->entries);
+  }
+  if (c->buffer) {
+    OV_ARRAY_DESTROY(&c->buffer);
+  }
+  mtx_destroy(&c->mtx);
+  OV_FREE(cache);
+}
+
+ov_tribool gcmz_access_cache_check(struct gcmz_access_cache *const cache,
+                                   wchar_t const *const path,
+                                   struct ov_error *const err) {
+  if (!cache || !path) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return ov_indeterminate;
+  }
+  if (mtx_lock(&cache->mtx) != thrd_success) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    return ov_indeterminate;
+  }
+
+  size_t const len = wcslen(path);
+  uint64_t const now = GetTickCount64();
+  ov_tribool result = ov_indeterminate;
+
+  if (!fold_to_buffer(cache, path, len, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  {
+    struct entry const *const e = find_buffer(cache, len);
+    if (e && !e->pending && e->expires_at > now) {
+      result = e->accessible ? ov_true : ov_false;
+      goto cleanup;
+    }
+  }
+  {
+    bool accessible = false;
+    if (!stat_path(path, &accessible, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    prune(cache, now);
+    if (!store_buffer(cache, len, accessible, false, now + cache->ttl_ms, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    result = accessible ? ov_true : ov_false;
+  }
+
+cleanup:
+  mtx_unlock(&cache->mtx);
+  return result;
+}
+
+static int compare_pending_dir(void const *const a, void const *const b) {
+  struct pending_file const *const pa = (struct pending_file const *)a;
+  struct pending_file const *const pb = (struct pending_file const *)b;
+  return CompareStringOrdinal(pa->path, (int)pa->dir_len, pb->path, (int)pb->dir_len, TRUE) - CSTR_EQUAL;
+}
+
+/**
+ * @brief Resolve files sharing a folder with a single enumeration of the folder
+ *
+ * Files the listing does not name under the same spelling, such as short names, are checked one by one.
+ * So are files the listing has not reached after batch_entries_per_file entries per file,
+ * which keeps a few files from a huge folder from paying for the whole folder.
+ */
+static bool enumerate_folder(struct gcmz_access_cache *const c,
+                             struct pending_file const *const files,
+                             size_t const n,
+                             uint64_t const now,
+                             struct ov_error *const err) {
+  size_t const dir_len = files[0].dir_len;
+  uint64_t const expires_at = now + c->ttl_ms;
+  wchar_t *pattern = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  bool result = false;
+
+  // Mark the files so that the listing can recognize them
+  for (size_t i = 0; i < n; ++i) {
+    size_t const len = wcslen(files[i].path);
+    if (!fold_to_buffer(c, files[i].path, len, err) || !store_buffer(c, len, false, true, expires_at, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+  }
+
+  if (!OV_ARRAY_GROW(&pattern, dir_len + 3)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  memcpy(pattern, files[0].path, dir_len * sizeof(wchar_t));
+  pattern[dir_len] = L'\\';
+  pattern[dir_len + 1] = L'*';
+  pattern[dir_len + 2] = L'\0';
+
+  {
+    WIN32_FIND_DATAW fd;
+    size_t const max_entries = n * batch_entries_per_file;
+    size_t entries = 0;
+    size_t resolved = 0;
+    h = FindFirstFileExW(pattern, FindExInfoBasic, &fd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (h != INVALID_HANDLE_VALUE) {
+      do {
+        size_t const name_len = wcslen(fd.cFileName);
+        size_t const len = dir_len + 1 + name_len;
+        if (!OV_ARRAY_GROW(&c->buffer, len + 1)) {
+          OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+          goto cleanup;
+        }
+        memcpy(c->buffer, files[0].path, dir_len * sizeof(wchar_t));
+        c->buffer[dir_len] = L'\\';
+        memcpy(c->buffer + dir_len + 1, fd.cFileName, (name_len + 1) * sizeof(wchar_t));
+        CharUpperBuffW(c->buffer, (DWORD)len);
+        struct entry const *const e = find_buffer(c, len);
+        if (e && e->pending) {
+          bool const accessible = !(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+          if (!store_buffer(c, len, accessible, false, expires_at, err)) {
+            OV_ERROR_ADD_TRACE(err);
+            goto cleanup;
+          }
+          ++resolved;
+        }
+      } while (resolved < n && ++entries < max_entries && FindNextFileW(h, &fd));
+    }
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    size_t const len = wcslen(files[i].path);
+    if (!fold_to_buffer(c, files[i].path, len, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    struct entry const *const e = find_buffer(c, len);
+    if (!e || !e->pending) {
+      continue;
+    }
+    bool accessible = false;
+    struct ov_error stat_err = {0};
+    if (!stat_path(files[i].path, &accessible, &stat_err)) {
+      // Left pending, gcmz_access_cache_check reports it
+      OV_ERROR_DESTROY(&stat_err);
+      continue;
+    }
+    if (!store_buffer(c, len, accessible, false, expires_at, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+  }
+  result = true;
+
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    FindClose(h);
+  }
+  if (pattern) {
+    OV_ARRAY_DESTROY(&pattern);
+  }
+  return result;
+}
+
+bool gcmz_access_cache_prefetch(struct gcmz_access_cache *const cache,
+                                struct gcmz_file_list const *const file_list,
+                                struct ov_error *const err) {
+  if (!cache || !file_list) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  if (mtx_lock(&cache->mtx) != thrd_success) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    return false;
+  }
+
+  struct pending_file *pending = NULL;
+  uint64_t const now = GetTickCount64();
+  bool result = false;
+
+  prune(cache, now);
+  {
+    size_t const file_count = gcmz_file_list_count(file_list);
+    for (size_t i = 0; i < file_count; i++) {
+      struct gcmz_file const *const file = gcmz_file_list_get(file_list, i);
+      if (!file || !file->path) {
+        continue;
+      }
+      size_t const len = wcslen(file->path);
+      if (!fold_to_buffer(cache, file->path, len, err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+      struct entry const *const e = find_buffer(cache, len);
+      if (e && !e->pending && e->expires_at > now) {
+        continue;
+      }
+      wchar_t const *const backslash = wcsrchr(file->path, L'\\');
+      wchar_t const *const slash = wcsrchr(file->path, L'/');
+      wchar_t const *const sep = backslash > slash ? backslash : slash;
+      if (!sep) {
+        continue;
+      }
+      size_t const n = OV_ARRAY_LENGTH(pending);
+      if (!OV_ARRAY_GROW(&pending, n + 1)) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      pending[n] = (struct pending_file){
+          .path = file->path,
+          .dir_len = (size_t)(sep - file->path),
+      };
+      OV_ARRAY_SET_LENGTH(pending, n + 1);
+    }
+  }
+
+  {
+    size_t const n = OV_ARRAY_LENGTH(pending);
+    if (n >= batch_min_files) {
+      qsort(pending, n, sizeof(struct pending_file), compare_pending_dir);
+    }
+    // Folders with only a few of the files are cheaper to check file by file later
+    for (size_t begin = 0, end = 0; n >= batch_min_files && begin < n; begin = end) {
+      end = begin + 1;
+      while (end < n && compare_pending_dir(&pending[begin], &pending[end]) == 0) {
+        ++end;
+      }
+      if (end - begin >= batch_min_files && !enumerate_folder(cache, pending + begin, end - begin, now, err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+    }
+  }
+  result = true;
+
+cleanup:
+  mtx_unlock(&cache->mtx);
+  if (pending) {
+    OV_ARRAY_DESTROY(&pending);
+  }
+  return result;
+}
+
+void gcmz_access_cache_invalidate(struct gcmz_access_cache *const cache, wchar_t const *const path) {
+  if (!cache || !path) {
+    return;
+  }
+  if (mtx_lock(&cache->mtx) != thrd_success) {
+    return;
+  }
+  size_t const len = wcslen(path);
+  struct ov_error err = {0};
+  if (fold_to_buffer(cache, path, len, &err)) {
+    struct entry const *const e = find_buffer(cache, len);
+    if (e && !store_buffer(cache, len, e->accessible, false, 0, &err)) {
+      OV_ERROR_DESTROY(&err);
+    }
+  } else {
+    OV_ERROR_DESTROY(&err);
+  }
+  mtx_unlock(&cache->mtx);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct gcmz_file_list;
+
+/**
+ * @brief Cache of file accessibility checks
+ *
+ * Remembers whether paths exist as files for a short time, so that the same files are not checked again
+ * on every drag gesture. Keys are compared case-insensitively like the file system does.
+ * All functions are thread-safe.
+ */
+struct gcmz_access_cache;
+
+/**
+ * @brief Create an accessibility cache
+ *
+ * @param cache [out] Pointer to store the created cache
+ * @param ttl_ms How long a result stays valid in milliseconds
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool
+gcmz_access_cache_create(struct gcmz_access_cache **const cache, uint32_t const ttl_ms, struct ov_error *const err);
+
+/**
+ * @brief Destroy an accessibility cache
+ *
+ * @param cache Pointer to the cache, set to NULL on return
+ */
+void gcmz_access_cache_destroy(struct gcmz_access_cache **const cache);
+
+/**
+ * @brief Check whether a path is an accessible file
+ *
+ * Directories and missing paths are not accessible.
+ *
+ * @param cache Cache to use
+ * @param path Path to check
+ * @param err [out] Error information on failure
+ * @return ov_true if accessible, ov_false if not, ov_indeterminate on error
+ */
+NODISCARD ov_tribool gcmz_access_cache_check(struct gcmz_access_cache *const cache,
+                                             wchar_t const *const path,
+                                             struct ov_error *const err);
+
+/**
+ * @brief Check the files of a list ahead of time
+ *
+ * Folders holding many of the files are enumerated once instead of checking each file separately.
+ * Files that could not be resolved this way are left for gcmz_access_cache_check.
+ *
+ * @param cache Cache to fill
+ * @param file_list Files to check
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_access_cache_prefetch(struct gcmz_access_cache *const cache,
+                                          struct gcmz_file_list const *const file_list,
+                                          struct ov_error *const err);
+
+/**
+ * @brief Forget the result of a path
+ *
+ * Call this when a file is known to have been created or removed.
+ *
+ * @param cache Cache to update, can be NULL
+ * @param path Path to forget
+ */
+void gcmz_access_cache_invalidate(struct gcmz_access_cache *const cache, wchar_t const *const path);
@@ -0,0 +1,239 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <ovtest.h>
+
+#include <ovarray.h>
+#include <ovprintf.h>
+
+#include "access_cache.h"
+#include "file.h"
+#include "temp.h"
+
+static bool create_test_file(wchar_t const *const file_path) {
+  HANDLE h = CreateFileW(file_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  CloseHandle(h);
+  return true;
+}
+
+static void test_check(void) {
+  struct gcmz_access_cache *cache = NULL;
+  wchar_t *path = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_access_cache_create(&cache, 60000, &err), &err)) {
+    return;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_create_directory(&err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_build_path(&path, L"test_access_cache.txt", &err), &err)) {
+    goto cleanup;
+  }
+
+  TEST_CASE("missing file");
+  {
+    TEST_CHECK(gcmz_access_cache_check(cache, path, &err) == ov_false);
+    // Still cached as missing after the file appears
+    TEST_CHECK(create_test_file(path));
+    TEST_CHECK(gcmz_access_cache_check(cache, path, &err) == ov_false);
+    gcmz_access_cache_invalidate(cache, path);
+    TEST_CHECK(gcmz_access_cache_check(cache, path, &err) == ov_true);
+  }
+
+  TEST_CASE("case-insensitive");
+  {
+    DeleteFileW(path);
+    CharLowerBuffW(path, (DWORD)wcslen(path));
+    TEST_CHECK(gcmz_access_cache_check(cache, path, &err) == ov_true);
+    gcmz_access_cache_invalidate(cache, path);
+    CharUpperBuffW(path, (DWORD)wcslen(path));
+    TEST_CHECK(gcmz_access_cache_check(cache, path, &err) == ov_false);
+  }
+
+  TEST_CASE("directory");
+  {
+    TEST_CHECK(gcmz_access_cache_check(cache, L"C:\\Windows", &err) == ov_false);
+  }
+
+  TEST_CASE("invalid arguments");
+  {
+    TEST_FAILED_WITH(gcmz_access_cache_check(cache, NULL, &err) == ov_indeterminate,
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+  }
+
+cleanup:
+  if (path) {
+    OV_ARRAY_DESTROY(&path);
+  }
+  gcmz_temp_remove_directory();
+  gcmz_access_cache_destroy(&cache);
+}
+
+static void test_ttl(void) {
+  struct gcmz_access_cache *cache = NULL;
+  wchar_t *path = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_access_cache_create(&cache, 50, &err), &err)) {
+    return;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_create_directory(&err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_build_path(&path, L"test_access_cache_ttl.txt", &err), &err)) {
+    goto cleanup;
+  }
+
+  TEST_CHECK(gcmz_access_cache_check(cache, path, &err) == ov_false);
+  TEST_CHECK(create_test_file(path));
+  Sleep(100);
+  TEST_CHECK(gcmz_access_cache_check(cache, path, &err) == ov_true);
+
+cleanup:
+  if (path) {
+    DeleteFileW(path);
+    OV_ARRAY_DESTROY(&path);
+  }
+  gcmz_temp_remove_directory();
+  gcmz_access_cache_destroy(&cache);
+}
+
+static void test_prefetch(void) {
+  enum { file_count = 32 };
+  struct gcmz_access_cache *cache = NULL;
+  struct gcmz_file_list *list = NULL;
+  wchar_t *path = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_access_cache_create(&cache, 60000, &err), &err)) {
+    return;
+  }
+  list = gcmz_file_list_create(&err);
+  if (!TEST_SUCCEEDED(list != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_create_directory(&err), &err)) {
+    goto cleanup;
+  }
+
+  // Even files exist, odd files do not
+  for (int i = 0; i < file_count; ++i) {
+    wchar_t name[64];
+    ov_snprintf_wchar(name, 64, NULL, L"test_prefetch_%02d.png", i);
+    if (!TEST_SUCCEEDED(gcmz_temp_build_path(&path, name, &err), &err)) {
+      goto cleanup;
+    }
+    if (i % 2 == 0) {
+      TEST_CHECK(create_test_file(path));
+    }
+    if (!TEST_SUCCEEDED(gcmz_file_list_add(list, path, NULL, &err), &err)) {
+      goto cleanup;
+    }
+    OV_ARRAY_DESTROY(&path);
+  }
+  if (!TEST_SUCCEEDED(gcmz_access_cache_prefetch(cache, list, &err), &err)) {
+    goto cleanup;
+  }
+
+  // Results come from the cache, so removing the files does not change them
+  for (int i = 0; i < file_count; ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(list, (size_t)i);
+    DeleteFileW(file->path);
+  }
+  for (int i = 0; i < file_count; ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(list, (size_t)i);
+    TEST_CHECK(gcmz_access_cache_check(cache, file->path, &err) == (i % 2 == 0 ? ov_true : ov_false));
+    TEST_MSG("index %d", i);
+  }
+
+cleanup:
+  if (path) {
+    OV_ARRAY_DESTROY(&path);
+  }
+  gcmz_file_list_destroy(&list);
+  gcmz_temp_remove_directory();
+  gcmz_access_cache_destroy(&cache);
+}
+
+static void test_prefetch_large_folder(void) {
+  enum {
+    file_count = 8,
+    filler_count = 300,
+  };
+  struct gcmz_access_cache *cache = NULL;
+  struct gcmz_file_list *list = NULL;
+  wchar_t *path = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_access_cache_create(&cache, 60000, &err), &err)) {
+    return;
+  }
+  list = gcmz_file_list_create(&err);
+  if (!TEST_SUCCEEDED(list != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_create_directory(&err), &err)) {
+    goto cleanup;
+  }
+
+  // Unrelated files listed ahead of the dropped ones use up the enumeration budget
+  for (int i = 0; i < filler_count; ++i) {
+    wchar_t name[64];
+    ov_snprintf_wchar(name, 64, NULL, L"a_filler_%03d.txt", i);
+    if (!TEST_SUCCEEDED(gcmz_temp_build_path(&path, name, &err), &err)) {
+      goto cleanup;
+    }
+    TEST_CHECK(create_test_file(path));
+    OV_ARRAY_DESTROY(&path);
+  }
+  for (int i = 0; i < file_count; ++i) {
+    wchar_t name[64];
+    ov_snprintf_wchar(name, 64, NULL, L"test_prefetch_large_%02d.png", i);
+    if (!TEST_SUCCEEDED(gcmz_temp_build_path(&path, name, &err), &err)) {
+      goto cleanup;
+    }
+    if (i % 2 == 0) {
+      TEST_CHECK(create_test_file(path));
+    }
+    if (!TEST_SUCCEEDED(gcmz_file_list_add(list, path, NULL, &err), &err)) {
+      goto cleanup;
+    }
+    OV_ARRAY_DESTROY(&path);
+  }
+  if (!TEST_SUCCEEDED(gcmz_access_cache_prefetch(cache, list, &err), &err)) {
+    goto cleanup;
+  }
+
+  // Files the enumeration gave up on are still resolved one by one
+  for (int i = 0; i < file_count; ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(list, (size_t)i);
+    DeleteFileW(file->path);
+  }
+  for (int i = 0; i < file_count; ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(list, (size_t)i);
+    TEST_CHECK(gcmz_access_cache_check(cache, file->path, &err) == (i % 2 == 0 ? ov_true : ov_false));
+    TEST_MSG("index %d", i);
+  }
+
+cleanup:
+  if (path) {
+    OV_ARRAY_DESTROY(&path);
+  }
+  gcmz_file_list_destroy(&list);
+  gcmz_temp_remove_directory();
+  gcmz_access_cache_destroy(&cache);
+}
+
+TEST_LIST = {
+    {"check", test_check},
+    {"ttl", test_ttl},
+    {"prefetch", test_prefetch},
+    {"prefetch_large_folder", test_prefetch_large_folder},
+    {NULL, NULL},
+};
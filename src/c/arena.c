@@ -0,0 +1,132 @@
+#include "arena.h"
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <string.h>
+#include <wchar.h>
+
+enum {
+  default_chunk_size = 16 * 1024,
+};
+
+struct chunk {
+  struct chunk *next;
+  size_t capacity;
+  size_t used;
+};
+
+enum {
+  chunk_header_size = (sizeof(struct chunk) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1),
+};
+
+struct gcmz_arena {
+  struct chunk *current; ///< Chunk allocations are served from, newest first
+  struct chunk *first;   ///< Oldest chunk, kept on reset
+  size_t chunk_size;
+  struct gcmz_arena_stats stats;
+};
+
+static inline uint8_t *chunk_data(struct chunk *const c) { return (uint8_t *)c + chunk_header_size; }
+
+static inline size_t align_up(size_t const v, size_t const align) { return (v + align - 1) & ~(align - 1); }
+
+bool gcmz_arena_create(struct gcmz_arena **const arena, size_t const chunk_size, struct ov_error *const err) {
+  if (!arena || *arena) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  struct gcmz_arena *a = NULL;
+  if (!OV_REALLOC(&a, 1, sizeof(*a))) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  *a = (struct gcmz_arena){
+      .chunk_size = chunk_size ? chunk_size : default_chunk_size,
+  };
+  *arena = a;
+  return true;
+}
+
+void gcmz_arena_destroy(struct gcmz_arena **const arena) {
+  if (!arena || !*arena) {
+    return;
+  }
+  struct chunk *c = (*arena)->current;
+  while (c) {
+    struct chunk *next = c->next;
+    OV_FREE(&c);
+    c = next;
+  }
+  OV_FREE(arena);
+}
+
+void *gcmz_arena_alloc(struct gcmz_arena *const arena,
+                       size_t const size,
+                       size_t const align,
+                       struct ov_error *const err) {
+  if (!arena || !align || (align & (align - 1)) || align > alignof(max_align_t)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return NULL;
+  }
+  struct chunk *c = arena->current;
+  size_t offset = c ? align_up(c->used, align) : 0;
+  if (!c || offset > c->capacity || c->capacity - offset < size) {
+    size_t const capacity = size > arena->chunk_size ? size : arena->chunk_size;
+    struct chunk *n = NULL;
+    if (!OV_REALLOC(&n, 1, chunk_header_size + capacity)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      return NULL;
+    }
+    *n = (struct chunk){
+        .next = c,
+        .capacity = capacity,
+    };
+    if (!arena->first) {
+      arena->first = n;
+    }
+    arena->current = n;
+    arena->stats.heap_allocations++;
+    c = n;
+    offset = 0;
+  }
+  c->used = offset + size;
+  arena->stats.allocations++;
+  arena->stats.bytes += size;
+  return chunk_data(c) + offset;
+}
+
+wchar_t *gcmz_arena_wcsdup(struct gcmz_arena *const arena, wchar_t const *const src, struct ov_error *const err) {
+  if (!src) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return NULL;
+  }
+  size_t const bytes = (wcslen(src) + 1) * sizeof(wchar_t);
+  wchar_t *const dest = (wchar_t *)gcmz_arena_alloc(arena, bytes, alignof(wchar_t), err);
+  if (!dest) {
+    OV_ERROR_ADD_TRACE(err);
+    return NULL;
+  }
+  memcpy(dest, src, bytes);
+  return dest;
+}
+
+void gcmz_arena_reset(struct gcmz_arena *const arena) {
+  if (!arena || !arena->first) {
+    return;
+  }
+  struct chunk *c = arena->current;
+  while (c != arena->first) {
+    struct chunk *next = c->next;
+    OV_FREE(&c);
+    c = next;
+  }
+  arena->first->used = 0;
+  arena->current = arena->first;
+}
+
+void gcmz_arena_get_stats(struct gcmz_arena const *const arena, struct gcmz_arena_stats *const stats) {
+  if (!stats) {
+    return;
+  }
+  *stats = arena ? arena->stats : (struct gcmz_arena_stats){0};
+}
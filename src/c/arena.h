@@ -0,0 +1,86 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief Bump allocator for objects that share a lifetime
+ *
+ * Memory is carved out of large chunks and is only released all at once with gcmz_arena_reset or
+ * gcmz_arena_destroy, so a burst of small allocations costs a few heap allocations instead of one each.
+ * Not thread-safe; callers must serialize access.
+ */
+struct gcmz_arena;
+
+/**
+ * @brief Allocation counters of an arena
+ *
+ * Counters accumulate from creation and are not cleared by gcmz_arena_reset.
+ */
+struct gcmz_arena_stats {
+  size_t allocations;      ///< Number of allocations served from the arena
+  size_t bytes;            ///< Total bytes requested by those allocations
+  size_t heap_allocations; ///< Number of chunks allocated from the heap to serve them
+};
+
+/**
+ * @brief Create an arena
+ *
+ * No memory is reserved until the first allocation.
+ *
+ * @param arena [out] Pointer to store the created arena
+ * @param chunk_size Size of each chunk in bytes, 0 for the default. Larger requests get a chunk of their own.
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_arena_create(struct gcmz_arena **const arena, size_t const chunk_size, struct ov_error *const err);
+
+/**
+ * @brief Destroy an arena and free all memory allocated from it
+ *
+ * @param arena Pointer to the arena, set to NULL on return
+ */
+void gcmz_arena_destroy(struct gcmz_arena **const arena);
+
+/**
+ * @brief Allocate memory from the arena
+ *
+ * The memory is uninitialized and stays valid until the arena is reset or destroyed.
+ *
+ * @param arena Arena to allocate from
+ * @param size Size in bytes
+ * @param align Alignment in bytes, must be a power of two no larger than alignof(max_align_t)
+ * @param err [out] Error information on failure
+ * @return Allocated memory, NULL on failure
+ */
+void *gcmz_arena_alloc(struct gcmz_arena *const arena,
+                       size_t const size,
+                       size_t const align,
+                       struct ov_error *const err);
+
+/**
+ * @brief Copy a wide string into the arena
+ *
+ * @param arena Arena to allocate from
+ * @param src Null-terminated string to copy
+ * @param err [out] Error information on failure
+ * @return Copied string, NULL on failure
+ */
+wchar_t *gcmz_arena_wcsdup(struct gcmz_arena *const arena, wchar_t const *const src, struct ov_error *const err);
+
+/**
+ * @brief Release everything allocated from the arena at once
+ *
+ * The first chunk is kept for reuse, so an arena that is reset after every use
+ * reaches a steady state without heap allocations.
+ *
+ * @param arena Arena to reset, can be NULL
+ */
+void gcmz_arena_reset(struct gcmz_arena *const arena);
+
+/**
+ * @brief Get the allocation counters of an arena
+ *
+ * @param arena Arena to query, can be NULL (all counters are 0)
+ * @param stats [out] Counters
+ */
+void gcmz_arena_get_stats(struct gcmz_arena const *const arena, struct gcmz_arena_stats *const stats);
@@ -0,0 +1,79 @@
+#include <ovtest.h>
+
+#include "arena.h"
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+static void test_alloc(void) {
+  struct gcmz_arena *arena = NULL;
+  struct gcmz_arena_stats stats = {0};
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_arena_create(&arena, 256, &err), &err)) {
+    return;
+  }
+
+  TEST_CASE("alignment");
+  {
+    void *const a = gcmz_arena_alloc(arena, 3, 1, &err);
+    double *const b = (double *)gcmz_arena_alloc(arena, sizeof(double), alignof(double), &err);
+    TEST_CHECK(a != NULL);
+    if (TEST_CHECK(b != NULL)) {
+      TEST_CHECK((uintptr_t)b % alignof(double) == 0);
+      *b = 1.0;
+    }
+    TEST_FAILED_WITH(gcmz_arena_alloc(arena, 8, 3, &err) != NULL,
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+  }
+
+  TEST_CASE("strings");
+  {
+    wchar_t *const s = gcmz_arena_wcsdup(arena, L"C:\\test\\image.png", &err);
+    if (TEST_SUCCEEDED(s != NULL, &err)) {
+      TEST_CHECK(wcscmp(s, L"C:\\test\\image.png") == 0);
+    }
+  }
+
+  TEST_CASE("chunks");
+  {
+    gcmz_arena_get_stats(arena, &stats);
+    TEST_CHECK(stats.allocations == 3);
+    TEST_CHECK(stats.heap_allocations == 1);
+
+    // Larger than a chunk, served from a dedicated one
+    void *const big = gcmz_arena_alloc(arena, 1024, 1, &err);
+    TEST_CHECK(big != NULL);
+    for (int i = 0; i < 64; ++i) {
+      TEST_CHECK(gcmz_arena_alloc(arena, 16, 16, &err) != NULL);
+    }
+    gcmz_arena_get_stats(arena, &stats);
+    TEST_CHECK(stats.allocations == 3 + 1 + 64);
+    TEST_CHECK(stats.heap_allocations > 2);
+    TEST_CHECK(stats.heap_allocations < 64);
+  }
+
+  TEST_CASE("reset reuses the first chunk");
+  {
+    gcmz_arena_reset(arena);
+    struct gcmz_arena_stats before = {0};
+    gcmz_arena_get_stats(arena, &before);
+    for (int i = 0; i < 8; ++i) {
+      TEST_CHECK(gcmz_arena_alloc(arena, 16, 16, &err) != NULL);
+    }
+    gcmz_arena_get_stats(arena, &stats);
+    TEST_CHECK(stats.heap_allocations == before.heap_allocations);
+  }
+
+  gcmz_arena_destroy(&arena);
+  TEST_CHECK(arena == NULL);
+}
+
+TEST_LIST = {
+    {"alloc", test_alloc},
+    {NULL, NULL},
+};
@@ -0,0 +1,458 @@
+#include "codec.h"
+
+#include <string.h>
+
+#include <ovarray.h>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+#include "codec_sjis_table.h"
+
+enum {
+  replacement_char = 0xfffd,
+  sjis_replacement_char = 0x30fb, // Default character of MultiByteToWideChar(932)
+  sjis_pair_count = sizeof(g_unicode_to_sjis) / sizeof(g_unicode_to_sjis[0]),
+  max_sequence_len = 4,
+};
+
+static inline int sjis_lead_index(uint8_t const b) { return b <= 0x9f ? b - 0x81 : b - 0xe0 + 0x1f; }
+
+static inline int sjis_trail_index(uint8_t const b) {
+  if (b >= 0x40 && b <= 0x7e) {
+    return b - 0x40;
+  }
+  if (b >= 0x80 && b <= 0xfc) {
+    return b - 0x80 + 0x3f;
+  }
+  return -1;
+}
+
+/**
+ * @brief Length of the leading run of ASCII bytes
+ */
+static size_t ascii_prefix_length(uint8_t const *const p, size_t const n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= n; i += 16) {
+    int const mask = _mm_movemask_epi8(_mm_loadu_si128((__m128i const *)(void const *)(p + i)));
+    if (mask) {
+      return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+  }
+#endif
+  while (i < n && p[i] < 0x80) {
+    ++i;
+  }
+  return i;
+}
+
+/**
+ * @brief Decode one character
+ *
+ * @return Number of bytes consumed, or 0 if more input is needed to decide
+ */
+static size_t decode_one(struct gcmz_codec *const c,
+                         uint8_t const *const p,
+                         size_t const n,
+                         bool const flush,
+                         uint32_t *const cp) {
+  switch (c->src) {
+  case gcmz_codec_encoding_sjis: {
+    uint8_t const b = p[0];
+    if (b < 0x80) {
+      *cp = b;
+      return 1;
+    }
+    if (b >= 0xa1 && b <= 0xdf) {
+      *cp = 0xff61 + (uint32_t)(b - 0xa1);
+      return 1;
+    }
+    // Single bytes that Windows maps for round-tripping
+    if (b == 0x80) {
+      *cp = 0x80;
+      return 1;
+    }
+    if (b == 0xa0) {
+      *cp = 0xf8f0;
+      return 1;
+    }
+    if (b >= 0xfd) {
+      *cp = 0xf8f1 + (uint32_t)(b - 0xfd);
+      return 1;
+    }
+    if (n < 2) {
+      if (!flush) {
+        return 0;
+      }
+      *cp = sjis_replacement_char;
+      ++c->replaced;
+      return 1;
+    }
+    int const trail = sjis_trail_index(p[1]);
+    if (trail < 0) {
+      // Keep the trail byte, it may be a valid character by itself
+      *cp = sjis_replacement_char;
+      ++c->replaced;
+      return 1;
+    }
+    uint16_t const u = g_sjis_to_unicode[sjis_lead_index(b)][trail];
+    if (!u) {
+      *cp = sjis_replacement_char;
+      ++c->replaced;
+    } else {
+      *cp = u;
+    }
+    return 2;
+  }
+  case gcmz_codec_encoding_utf8: {
+    uint8_t const b = p[0];
+    if (b < 0x80) {
+      *cp = b;
+      return 1;
+    }
+    size_t len;
+    uint32_t v;
+    uint32_t min;
+    if (b >= 0xc2 && b <= 0xdf) {
+      len = 2;
+      v = b & 0x1f;
+      min = 0x80;
+    } else if (b >= 0xe0 && b <= 0xef) {
+      len = 3;
+      v = b & 0x0f;
+      min = 0x800;
+    } else if (b >= 0xf0 && b <= 0xf4) {
+      len = 4;
+      v = b & 0x07;
+      min = 0x10000;
+    } else {
+      *cp = replacement_char;
+      ++c->replaced;
+      return 1;
+    }
+    for (size_t i = 1; i < len; ++i) {
+      if (i >= n) {
+        if (!flush) {
+          return 0;
+        }
+        *cp = replacement_char;
+        ++c->replaced;
+        return i;
+      }
+      if ((p[i] & 0xc0) != 0x80) {
+        *cp = replacement_char;
+        ++c->replaced;
+        return i;
+      }
+      v = (v << 6) | (p[i] & 0x3f);
+    }
+    if (v < min || v > 0x10ffff || (v >= 0xd800 && v <= 0xdfff)) {
+      *cp = replacement_char;
+      ++c->replaced;
+      return len;
+    }
+    *cp = v;
+    return len;
+  }
+  case gcmz_codec_encoding_utf16le:
+  case gcmz_codec_encoding_utf16be: {
+    bool const be = c->src == gcmz_codec_encoding_utf16be;
+    if (n < 2) {
+      if (!flush) {
+        return 0;
+      }
+      // Odd trailing byte
+      *cp = replacement_char;
+      ++c->replaced;
+      return 1;
+    }
+    uint32_t const u = be ? (uint32_t)((p[0] << 8) | p[1]) : (uint32_t)(p[0] | (p[1] << 8));
+    if (u < 0xd800 || u > 0xdfff) {
+      *cp = u;
+      return 2;
+    }
+    if (u <= 0xdbff) {
+      if (n < 4) {
+        if (!flush) {
+          return 0;
+        }
+      } else {
+        uint32_t const u2 = be ? (uint32_t)((p[2] << 8) | p[3]) : (uint32_t)(p[2] | (p[3] << 8));
+        if (u2 >= 0xdc00 && u2 <= 0xdfff) {
+          *cp = 0x10000 + ((u - 0xd800) << 10) + (u2 - 0xdc00);
+          return 4;
+        }
+      }
+    }
+    *cp = replacement_char;
+    ++c->replaced;
+    return 2;
+  }
+  }
+  *cp = replacement_char;
+  ++c->replaced;
+  return 1;
+}
+
+static uint16_t unicode_to_sjis(uint32_t const u) {
+  if (u > 0xffff) {
+    return 0;
+  }
+  size_t lo = 0;
+  size_t hi = sjis_pair_count;
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    uint16_t const v = g_unicode_to_sjis[mid].unicode;
+    if (u == v) {
+      return g_unicode_to_sjis[mid].sjis;
+    }
+    if (u < v) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Encode one character into out
+ *
+ * @return Pointer past the written bytes
+ */
+static uint8_t *encode_one(struct gcmz_codec *const c, uint32_t const cp, uint8_t *out) {
+  switch (c->dest) {
+  case gcmz_codec_encoding_sjis:
+    if (cp < 0x80) {
+      *out++ = (uint8_t)cp;
+    } else if (cp >= 0xff61 && cp <= 0xff9f) {
+      *out++ = (uint8_t)(0xa1 + (cp - 0xff61));
+    } else if (cp == 0x80) {
+      *out++ = 0x80;
+    } else if (cp == 0xf8f0) {
+      *out++ = 0xa0;
+    } else if (cp >= 0xf8f1 && cp <= 0xf8f3) {
+      *out++ = (uint8_t)(0xfd + (cp - 0xf8f1));
+    } else {
+      uint16_t const s = unicode_to_sjis(cp);
+      if (s) {
+        *out++ = (uint8_t)(s >> 8);
+        *out++ = (uint8_t)(s & 0xff);
+      } else {
+        *out++ = '?';
+        ++c->replaced;
+      }
+    }
+    return out;
+  case gcmz_codec_encoding_utf8:
+    if (cp < 0x80) {
+      *out++ = (uint8_t)cp;
+    } else if (cp < 0x800) {
+      *out++ = (uint8_t)(0xc0 | (cp >> 6));
+      *out++ = (uint8_t)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      *out++ = (uint8_t)(0xe0 | (cp >> 12));
+      *out++ = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+      *out++ = (uint8_t)(0x80 | (cp & 0x3f));
+    } else {
+      *out++ = (uint8_t)(0xf0 | (cp >> 18));
+      *out++ = (uint8_t)(0x80 | ((cp >> 12) & 0x3f));
+      *out++ = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+      *out++ = (uint8_t)(0x80 | (cp & 0x3f));
+    }
+    return out;
+  case gcmz_codec_encoding_utf16le:
+  case gcmz_codec_encoding_utf16be: {
+    bool const be = c->dest == gcmz_codec_encoding_utf16be;
+    uint32_t units[2];
+    size_t count = 1;
+    if (cp < 0x10000) {
+      units[0] = cp;
+    } else {
+      units[0] = 0xd800 + ((cp - 0x10000) >> 10);
+      units[1] = 0xdc00 + ((cp - 0x10000) & 0x3ff);
+      count = 2;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      uint8_t const hi = (uint8_t)(units[i] >> 8);
+      uint8_t const lo = (uint8_t)(units[i] & 0xff);
+      *out++ = be ? hi : lo;
+      *out++ = be ? lo : hi;
+    }
+    return out;
+  }
+  }
+  return out;
+}
+
+/**
+ * @brief Write a run of ASCII bytes in the destination encoding
+ */
+static uint8_t *encode_ascii(struct gcmz_codec const *const c, uint8_t const *const p, size_t const n, uint8_t *out) {
+  switch (c->dest) {
+  case gcmz_codec_encoding_sjis:
+  case gcmz_codec_encoding_utf8:
+    memcpy(out, p, n);
+    return out + n;
+  case gcmz_codec_encoding_utf16le:
+  case gcmz_codec_encoding_utf16be: {
+    bool const be = c->dest == gcmz_codec_encoding_utf16be;
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128i const zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+      __m128i const v = _mm_loadu_si128((__m128i const *)(void const *)(p + i));
+      __m128i const lo = be ? _mm_unpacklo_epi8(zero, v) : _mm_unpacklo_epi8(v, zero);
+      __m128i const hi = be ? _mm_unpackhi_epi8(zero, v) : _mm_unpackhi_epi8(v, zero);
+      _mm_storeu_si128((__m128i *)(void *)out, lo);
+      _mm_storeu_si128((__m128i *)(void *)(out + 16), hi);
+      out += 32;
+    }
+#endif
+    for (; i < n; ++i) {
+      *out++ = be ? 0 : p[i];
+      *out++ = be ? p[i] : 0;
+    }
+    return out;
+  }
+  }
+  return out;
+}
+
+/**
+ * @brief Worst-case number of output bytes per input byte
+ */
+static size_t max_output_per_byte(struct gcmz_codec const *const c) {
+  if (c->dest == gcmz_codec_encoding_sjis) {
+    return 1;
+  }
+  if (c->src == gcmz_codec_encoding_sjis && c->dest == gcmz_codec_encoding_utf8) {
+    // Half-width katakana and replaced bytes take 3 bytes in UTF-8
+    return 3;
+  }
+  return 2;
+}
+
+void gcmz_codec_init(struct gcmz_codec *const c,
+                     enum gcmz_codec_encoding const src,
+                     enum gcmz_codec_encoding const dest) {
+  *c = (struct gcmz_codec){
+      .src = src,
+      .dest = dest,
+  };
+}
+
+bool gcmz_codec_transcode(struct gcmz_codec *const c,
+                          void const *const src,
+                          size_t const src_len,
+                          bool const flush,
+                          char **const dest,
+                          struct ov_error *const err) {
+  if (!c || (!src && src_len) || !dest) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  uint8_t const *p = (uint8_t const *)src;
+  size_t n = src_len;
+  size_t const len = OV_ARRAY_LENGTH(*dest);
+  bool const same = c->src == c->dest;
+  // Reserve the worst case once so that the loops below never have to check capacity
+  size_t const capacity = same ? n : (n + c->pending_len + max_sequence_len) * max_output_per_byte(c);
+  if (!OV_ARRAY_GROW(dest, len + capacity + 2)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  uint8_t *out = (uint8_t *)*dest + len;
+
+  if (same) {
+    if (n) {
+      memcpy(out, p, n);
+    }
+    out += n;
+    goto done;
+  }
+
+  if (c->pending_len) {
+    // Complete the sequence left over from the previous chunk
+    uint8_t tmp[max_sequence_len * 2];
+    size_t const pending_len = c->pending_len;
+    size_t const take = n < sizeof(tmp) - pending_len ? n : sizeof(tmp) - pending_len;
+    memcpy(tmp, c->pending, pending_len);
+    memcpy(tmp + pending_len, p, take);
+    size_t const tmp_len = pending_len + take;
+    bool const tmp_flush = flush && take == n;
+    size_t used = 0;
+    while (used < pending_len) {
+      uint32_t cp;
+      size_t const k = decode_one(c, tmp + used, tmp_len - used, tmp_flush, &cp);
+      if (!k) {
+        // Still incomplete, every input byte is in tmp
+        memmove(c->pending, tmp + used, tmp_len - used);
+        c->pending_len = tmp_len - used;
+        goto done;
+      }
+      out = encode_one(c, cp, out);
+      used += k;
+    }
+    c->pending_len = 0;
+    p += used - pending_len;
+    n -= used - pending_len;
+  }
+
+  {
+    bool const ascii_compatible = c->src == gcmz_codec_encoding_sjis || c->src == gcmz_codec_encoding_utf8;
+    size_t i = 0;
+    while (i < n) {
+      if (ascii_compatible && p[i] < 0x80) {
+        size_t const run = ascii_prefix_length(p + i, n - i);
+        out = encode_ascii(c, p + i, run, out);
+        i += run;
+        continue;
+      }
+      uint32_t cp;
+      size_t const k = decode_one(c, p + i, n - i, flush, &cp);
+      if (!k) {
+        memcpy(c->pending, p + i, n - i);
+        c->pending_len = n - i;
+        break;
+      }
+      out = encode_one(c, cp, out);
+      i += k;
+    }
+  }
+
+done:
+  {
+    size_t const new_len = (size_t)(out - (uint8_t *)*dest);
+    out[0] = 0;
+    out[1] = 0;
+    OV_ARRAY_SET_LENGTH(*dest, new_len);
+  }
+  return true;
+}
+
+bool gcmz_codec_convert(void const *const src,
+                        size_t const src_len,
+                        enum gcmz_codec_encoding const src_encoding,
+                        enum gcmz_codec_encoding const dest_encoding,
+                        char **const dest,
+                        size_t *const replaced,
+                        struct ov_error *const err) {
+  if (!dest) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  struct gcmz_codec c;
+  gcmz_codec_init(&c, src_encoding, dest_encoding);
+  if (!gcmz_codec_transcode(&c, src, src_len, true, dest, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  if (replaced) {
+    *replaced = c.replaced;
+  }
+  return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief Encodings supported by the built-in codec
+ */
+enum gcmz_codec_encoding {
+  gcmz_codec_encoding_sjis,    ///< Shift_JIS (Windows code page 932)
+  gcmz_codec_encoding_utf8,    ///< UTF-8
+  gcmz_codec_encoding_utf16le, ///< UTF-16 little endian
+  gcmz_codec_encoding_utf16be, ///< UTF-16 big endian
+};
+
+/**
+ * @brief Streaming transcoder state
+ *
+ * Initialize with gcmz_codec_init. Multi-byte sequences split across chunks are
+ * carried over to the next call of gcmz_codec_transcode.
+ */
+struct gcmz_codec {
+  enum gcmz_codec_encoding src;
+  enum gcmz_codec_encoding dest;
+  uint8_t pending[4];
+  size_t pending_len;
+  size_t replaced; ///< Number of invalid or unmappable sequences replaced so far
+};
+
+/**
+ * @brief Initialize transcoder state
+ *
+ * @param c Transcoder state to initialize
+ * @param src Source encoding
+ * @param dest Destination encoding
+ */
+void gcmz_codec_init(struct gcmz_codec *const c,
+                     enum gcmz_codec_encoding const src,
+                     enum gcmz_codec_encoding const dest);
+
+/**
+ * @brief Transcode a chunk of input and append the result to dest
+ *
+ * Invalid input is replaced with U+FFFD (U+30FB for Shift_JIS) and characters that cannot be
+ * represented in Shift_JIS become '?'. Best-fit mappings are not applied.
+ * Each replacement increments c->replaced.
+ * When src and dest are the same encoding, the input is copied as-is.
+ *
+ * @param c Transcoder state
+ * @param src Input bytes (may contain NUL)
+ * @param src_len Length of input in bytes
+ * @param flush true if this is the last chunk; incomplete sequences at the end are replaced
+ * @param dest [in,out] Output buffer (OV_ARRAY), always followed by two NUL bytes not counted in its length
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_codec_transcode(struct gcmz_codec *const c,
+                                    void const *const src,
+                                    size_t const src_len,
+                                    bool const flush,
+                                    char **const dest,
+                                    struct ov_error *const err);
+
+/**
+ * @brief Transcode a whole buffer
+ *
+ * @param src Input bytes (may contain NUL)
+ * @param src_len Length of input in bytes
+ * @param src_encoding Source encoding
+ * @param dest_encoding Destination encoding
+ * @param dest [out] Output buffer (OV_ARRAY, caller must OV_ARRAY_DESTROY), followed by two NUL bytes
+ * @param replaced [out] Number of replaced sequences (can be NULL)
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_codec_convert(void const *const src,
+                                  size_t const src_len,
+                                  enum gcmz_codec_encoding const src_encoding,
+                                  enum gcmz_codec_encoding const dest_encoding,
+                                  char **const dest,
+                                  size_t *const replaced,
+                                  struct ov_error *const err);
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Generate codec_sjis_table.h (CP932 <-> Unicode tables used by codec.c).
+
+Usage: python3 codec_sjis_table.py > codec_sjis_table.h
+
+Decoding follows Python's cp932 codec, which matches MultiByteToWideChar(932).
+Where several CP932 codes decode to the same character, encoding picks the one
+WideCharToMultiByte(932) produces: JIS X 0208 rows, then NEC row 13,
+then IBM extensions (FA-FC), then NEC-selected IBM extensions (ED-EE).
+Best-fit mappings are not included.
+"""
+
+LEADS = list(range(0x81, 0xA0)) + list(range(0xE0, 0xFD))
+TRAILS = list(range(0x40, 0x7F)) + list(range(0x80, 0xFD))
+
+
+def priority(code):
+    lead = code >> 8
+    if lead == 0x87:
+        return 1
+    if 0xFA <= lead <= 0xFC:
+        return 2
+    if 0xED <= lead <= 0xEE:
+        return 3
+    return 0
+
+
+def main():
+    decode = []
+    encode = {}
+    for lead in LEADS:
+        row = []
+        for trail in TRAILS:
+            code = (lead << 8) | trail
+            try:
+                u = ord(bytes([lead, trail]).decode("cp932"))
+            except UnicodeDecodeError:
+                u = 0
+            row.append(u)
+            if u and (u not in encode or priority(code) < priority(encode[u])):
+                encode[u] = code
+        decode.append(row)
+
+    out = []
+    out.append("// Generated by codec_sjis_table.py. Do not edit.")
+    out.append("#pragma once")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append("// clang-format off")
+    out.append("")
+    out.append("// [lead index][trail index] -> UTF-16 code unit, 0 if undefined")
+    out.append("static uint16_t const g_sjis_to_unicode[%d][%d] = {" % (len(LEADS), len(TRAILS)))
+    for lead, row in zip(LEADS, decode):
+        out.append("  { // 0x%02X" % lead)
+        for i in range(0, len(row), 12):
+            out.append("    " + " ".join("0x%04X," % v for v in row[i : i + 12]))
+        out.append("  },")
+    out.append("};")
+    out.append("")
+    pairs = sorted(encode.items())
+    out.append("// Sorted by unicode")
+    out.append("static struct sjis_pair {")
+    out.append("  uint16_t unicode;")
+    out.append("  uint16_t sjis;")
+    out.append("} const g_unicode_to_sjis[%d] = {" % len(pairs))
+    for i in range(0, len(pairs), 6):
+        out.append("  " + " ".join("{0x%04X, 0x%04X}," % p for p in pairs[i : i + 6]))
+    out.append("};")
+    out.append("")
+    out.append("// clang-format on")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,233 @@
+#include <ovtest.h>
+
+#include <string.h>
+
+#include <ovarray.h>
+#include <ovprintf.h>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "codec.h"
+
+// "Aあ漢ｱ\~ⅰ①" in each encoding
+static char const sample_utf8[] = "A\xe3\x81\x82\xe6\xbc\xa2\xef\xbd\xb1\\~\xe2\x85\xb0\xe2\x91\xa0";
+static char const sample_sjis[] = "A\x82\xa0\x8a\xbf\xb1\\~\xfa\x40\x87\x40";
+static char const sample_utf16le[] = "A\0\x42\x30\x22\x6f\x71\xff\\\0~\0\x70\x21\x60\x24";
+static char const sample_utf16be[] = "\0A\x30\x42\x6f\x22\xff\x71\0\\\0~\x21\x70\x24\x60";
+
+static struct sample {
+  enum gcmz_codec_encoding encoding;
+  char const *data;
+  size_t len;
+} const samples[] = {
+    {gcmz_codec_encoding_utf8, sample_utf8, sizeof(sample_utf8) - 1},
+    {gcmz_codec_encoding_sjis, sample_sjis, sizeof(sample_sjis) - 1},
+    {gcmz_codec_encoding_utf16le, sample_utf16le, sizeof(sample_utf16le) - 1},
+    {gcmz_codec_encoding_utf16be, sample_utf16be, sizeof(sample_utf16be) - 1},
+};
+
+static void check_bytes(char const *const got, size_t const got_len, char const *const want, size_t const want_len) {
+  TEST_CHECK(got_len == want_len && memcmp(got, want, want_len) == 0);
+  TEST_MSG("want %zu bytes, got %zu bytes", want_len, got_len);
+}
+
+static void test_convert(void) {
+  size_t const n = sizeof(samples) / sizeof(samples[0]);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      char name[64];
+      ov_snprintf_char(name, sizeof(name), NULL, "%zu -> %zu", i, j);
+      TEST_CASE(name);
+      char *dest = NULL;
+      size_t replaced = 0;
+      struct ov_error err = {0};
+      if (TEST_SUCCEEDED(gcmz_codec_convert(samples[i].data,
+                                            samples[i].len,
+                                            samples[i].encoding,
+                                            samples[j].encoding,
+                                            &dest,
+                                            &replaced,
+                                            &err),
+                         &err)) {
+        check_bytes(dest, OV_ARRAY_LENGTH(dest), samples[j].data, samples[j].len);
+        TEST_CHECK(replaced == 0);
+        TEST_CHECK(dest[OV_ARRAY_LENGTH(dest)] == 0 && dest[OV_ARRAY_LENGTH(dest) + 1] == 0);
+      }
+      if (dest) {
+        OV_ARRAY_DESTROY(&dest);
+      }
+    }
+  }
+}
+
+static void test_embedded_nul(void) {
+  static char const src[] = "a\0\x82\xa0\0b";
+  static char const want[] = "a\0\xe3\x81\x82\0b";
+  char *dest = NULL;
+  struct ov_error err = {0};
+  if (TEST_SUCCEEDED(gcmz_codec_convert(
+                         src, sizeof(src) - 1, gcmz_codec_encoding_sjis, gcmz_codec_encoding_utf8, &dest, NULL, &err),
+                     &err)) {
+    check_bytes(dest, OV_ARRAY_LENGTH(dest), want, sizeof(want) - 1);
+  }
+  if (dest) {
+    OV_ARRAY_DESTROY(&dest);
+  }
+}
+
+static void test_streaming(void) {
+  size_t const n = sizeof(samples) / sizeof(samples[0]);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      // Split the input at every position and feed it one or two bytes at a time
+      for (size_t split = 0; split <= samples[i].len; ++split) {
+        char name[64];
+        ov_snprintf_char(name, sizeof(name), NULL, "%zu -> %zu split at %zu", i, j, split);
+        TEST_CASE(name);
+        struct gcmz_codec c;
+        gcmz_codec_init(&c, samples[i].encoding, samples[j].encoding);
+        char *dest = NULL;
+        struct ov_error err = {0};
+        bool ok = TEST_SUCCEEDED(gcmz_codec_transcode(&c, samples[i].data, split, false, &dest, &err), &err);
+        for (size_t pos = split; ok && pos < samples[i].len; pos += 2) {
+          size_t const chunk = samples[i].len - pos < 2 ? samples[i].len - pos : 2;
+          ok = TEST_SUCCEEDED(gcmz_codec_transcode(&c, samples[i].data + pos, chunk, false, &dest, &err), &err);
+        }
+        if (ok && TEST_SUCCEEDED(gcmz_codec_transcode(&c, NULL, 0, true, &dest, &err), &err)) {
+          check_bytes(dest, OV_ARRAY_LENGTH(dest), samples[j].data, samples[j].len);
+          TEST_CHECK(c.replaced == 0);
+        }
+        if (dest) {
+          OV_ARRAY_DESTROY(&dest);
+        }
+      }
+    }
+  }
+}
+
+static void test_invalid(void) {
+  static struct {
+    char const *name;
+    enum gcmz_codec_encoding src;
+    enum gcmz_codec_encoding dest;
+    char const *input;
+    size_t input_len;
+    char const *want;
+    size_t want_len;
+    size_t replaced;
+  } const cases[] = {
+      {"sjis lead at end", gcmz_codec_encoding_sjis, gcmz_codec_encoding_utf8, "a\x82", 2, "a\xe3\x83\xbb", 4, 1},
+      {"sjis bad trail", gcmz_codec_encoding_sjis, gcmz_codec_encoding_utf8, "\x82 a", 3, "\xe3\x83\xbb a", 5, 1},
+      {"utf8 stray byte", gcmz_codec_encoding_utf8, gcmz_codec_encoding_utf16le, "\x80", 1, "\xfd\xff", 2, 1},
+      {"utf8 overlong", gcmz_codec_encoding_utf8, gcmz_codec_encoding_utf16le, "\xe0\x80\xaf", 3, "\xfd\xff", 2, 1},
+      {"utf8 truncated", gcmz_codec_encoding_utf8, gcmz_codec_encoding_utf16le, "\xe3\x81", 2, "\xfd\xff", 2, 1},
+      {"utf16 lone surrogate", gcmz_codec_encoding_utf16le, gcmz_codec_encoding_utf8, "\x00\xd8" "a\0", 4,
+       "\xef\xbf\xbd" "a", 4, 1},
+      {"utf16 odd length", gcmz_codec_encoding_utf16le, gcmz_codec_encoding_utf8, "a\0b", 3, "a\xef\xbf\xbd", 4, 1},
+      {"unmappable to sjis", gcmz_codec_encoding_utf8, gcmz_codec_encoding_sjis, "\xc2\xa5\xf0\x9f\x98\x80", 6, "??", 2,
+       2},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    TEST_CASE(cases[i].name);
+    char *dest = NULL;
+    size_t replaced = 0;
+    struct ov_error err = {0};
+    if (TEST_SUCCEEDED(gcmz_codec_convert(
+                           cases[i].input, cases[i].input_len, cases[i].src, cases[i].dest, &dest, &replaced, &err),
+                       &err)) {
+      check_bytes(dest, OV_ARRAY_LENGTH(dest), cases[i].want, cases[i].want_len);
+      TEST_CHECK(replaced == cases[i].replaced);
+      TEST_MSG("want %zu replacements, got %zu", cases[i].replaced, replaced);
+    }
+    if (dest) {
+      OV_ARRAY_DESTROY(&dest);
+    }
+  }
+}
+
+static void test_compare_win32_decode(void) {
+  // Every single byte and every lead/trail combination
+  for (unsigned code = 0; code < 0x10000; ++code) {
+    unsigned char const lead = (unsigned char)(code >> 8);
+    unsigned char const trail = (unsigned char)(code & 0xff);
+    bool const single = code < 0x100;
+    if (!single && !((lead >= 0x81 && lead <= 0x9f) || (lead >= 0xe0 && lead <= 0xfc))) {
+      continue;
+    }
+    char const src[2] = {(char)(single ? trail : lead), (char)trail};
+    int const src_len = single ? 1 : 2;
+    if (single && ((trail >= 0x81 && trail <= 0x9f) || (trail >= 0xe0 && trail <= 0xfc))) {
+      continue;
+    }
+
+    char *dest = NULL;
+    size_t replaced = 0;
+    struct ov_error err = {0};
+    if (!TEST_SUCCEEDED(gcmz_codec_convert(src,
+                                           (size_t)src_len,
+                                           gcmz_codec_encoding_sjis,
+                                           gcmz_codec_encoding_utf16le,
+                                           &dest,
+                                           &replaced,
+                                           &err),
+                        &err)) {
+      return;
+    }
+    if (!replaced) {
+      wchar_t want[4];
+      int const want_len = MultiByteToWideChar(932, 0, src, src_len, want, 4);
+      bool const same = want_len > 0 && OV_ARRAY_LENGTH(dest) == (size_t)want_len * sizeof(wchar_t) &&
+                        memcmp(dest, want, OV_ARRAY_LENGTH(dest)) == 0;
+      if (!TEST_CHECK(same)) {
+        TEST_MSG("mismatch at 0x%04x", code);
+        OV_ARRAY_DESTROY(&dest);
+        return;
+      }
+    }
+    OV_ARRAY_DESTROY(&dest);
+  }
+}
+
+static void test_compare_win32_encode(void) {
+  for (unsigned u = 1; u < 0x10000; ++u) {
+    if (u >= 0xd800 && u <= 0xdfff) {
+      continue;
+    }
+    wchar_t const src = (wchar_t)u;
+    char *dest = NULL;
+    size_t replaced = 0;
+    struct ov_error err = {0};
+    if (!TEST_SUCCEEDED(gcmz_codec_convert(&src,
+                                           sizeof(src),
+                                           gcmz_codec_encoding_utf16le,
+                                           gcmz_codec_encoding_sjis,
+                                           &dest,
+                                           &replaced,
+                                           &err),
+                        &err)) {
+      return;
+    }
+    char want[4];
+    BOOL used_default = FALSE;
+    int const want_len = WideCharToMultiByte(932, WC_NO_BEST_FIT_CHARS, &src, 1, want, 4, NULL, &used_default);
+    bool const same = used_default ? replaced == 1
+                                   : (replaced == 0 && want_len > 0 && OV_ARRAY_LENGTH(dest) == (size_t)want_len &&
+                                      memcmp(dest, want, (size_t)want_len) == 0);
+    OV_ARRAY_DESTROY(&dest);
+    if (!TEST_CHECK(same)) {
+      TEST_MSG("mismatch at U+%04X", u);
+      return;
+    }
+  }
+}
+
+TEST_LIST = {
+    {"convert", test_convert},
+    {"embedded_nul", test_embedded_nul},
+    {"streaming", test_streaming},
+    {"invalid", test_invalid},
+    {"compare_win32_decode", test_compare_win32_decode},
+    {"compare_win32_encode", test_compare_win32_encode},
+    {NULL, NULL},
+};
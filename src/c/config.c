@@ -24,6 +24,11 @@ struct gcmz_config {
   bool allow_create_directories;
   bool external_api;
   bool show_debug_menu;
+  bool expand_directories;
+  NATIVE_CHAR *expand_extensions;
+  bool downscale_images;
+  bool bitmaps_as_bmp;
+  bool collapse_sequences;
   gcmz_project_path_provider_fn project_path_getter;
   void *userdata;
 };
@@ -144,6 +149,10 @@ cleanup:
   return result;
 }
 
+static NATIVE_CHAR const g_default_expand_extensions[] =
+    NSTR(".png;.jpg;.jpeg;.bmp;.gif;.tga;.tif;.tiff;.webp;")
+    NSTR(".mp4;.mov;.avi;.mkv;.webm;.wav;.mp3;.flac;.ogg;.m4a;.aac;.object");
+
 struct gcmz_config *gcmz_config_create(struct gcmz_config_options const *const options, struct ov_error *const err) {
   struct gcmz_config *cfg = NULL;
   struct gcmz_config *result = NULL;
@@ -167,6 +176,11 @@ struct gcmz_config *gcmz_config_create(struct gcmz_config_options const *const o
     }
   }
 
+  if (!gcmz_config_set_expand_extensions(cfg, g_default_expand_extensions, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+
   result = cfg;
   cfg = NULL;
 
@@ -438,6 +452,9 @@ void gcmz_config_destroy(struct gcmz_config **const config) {
     }
     OV_ARRAY_DESTROY(&cfg->save_paths);
   }
+  if (cfg->expand_extensions) {
+    OV_ARRAY_DESTROY(&cfg->expand_extensions);
+  }
 
   OV_FREE(config);
 }
@@ -482,6 +499,11 @@ static char const g_json_key_processing_mode[] = "processing_mode";
 static char const g_json_key_allow_create_directories[] = "allow_create_directories";
 static char const g_json_key_external_api[] = "external_api";
 static char const g_json_key_show_debug_menu[] = "show_debug_menu";
+static char const g_json_key_expand_directories[] = "expand_directories";
+static char const g_json_key_expand_extensions[] = "expand_extensions";
+static char const g_json_key_downscale_images[] = "downscale_images";
+static char const g_json_key_bitmaps_as_bmp[] = "bitmaps_as_bmp";
+static char const g_json_key_collapse_sequences[] = "collapse_sequences";
 static char const g_json_key_save_paths[] = "save_paths";
 
 static bool load_save_paths_from_json(struct gcmz_config *const config,
@@ -568,6 +590,7 @@ bool gcmz_config_load(struct gcmz_config *const config, struct ov_error *const e
   }
 
   NATIVE_CHAR *config_path = NULL;
+  NATIVE_CHAR *extensions = NULL;
   struct ovl_source *source = NULL;
   char *json_str = NULL;
   yyjson_doc *doc = NULL;
@@ -645,6 +668,45 @@ bool gcmz_config_load(struct gcmz_config *const config, struct ov_error *const e
       config->show_debug_menu = yyjson_get_bool(show_debug_menu_val);
     }
 
+    yyjson_val *expand_directories_val = yyjson_obj_get(root, g_json_key_expand_directories);
+    if (expand_directories_val && yyjson_is_bool(expand_directories_val)) {
+      config->expand_directories = yyjson_get_bool(expand_directories_val);
+    }
+
+    yyjson_val *downscale_images_val = yyjson_obj_get(root, g_json_key_downscale_images);
+    if (downscale_images_val && yyjson_is_bool(downscale_images_val)) {
+      config->downscale_images = yyjson_get_bool(downscale_images_val);
+    }
+
+    yyjson_val *bitmaps_as_bmp_val = yyjson_obj_get(root, g_json_key_bitmaps_as_bmp);
+    if (bitmaps_as_bmp_val && yyjson_is_bool(bitmaps_as_bmp_val)) {
+      config->bitmaps_as_bmp = yyjson_get_bool(bitmaps_as_bmp_val);
+    }
+
+    yyjson_val *collapse_sequences_val = yyjson_obj_get(root, g_json_key_collapse_sequences);
+    if (collapse_sequences_val && yyjson_is_bool(collapse_sequences_val)) {
+      config->collapse_sequences = yyjson_get_bool(collapse_sequences_val);
+    }
+
+    yyjson_val *expand_extensions_val = yyjson_obj_get(root, g_json_key_expand_extensions);
+    if (expand_extensions_val && yyjson_is_str(expand_extensions_val)) {
+      char const *const utf8 = yyjson_get_str(expand_extensions_val);
+      size_t const utf8_len = strlen(utf8);
+      size_t const wchar_len = ov_utf8_to_wchar_len(utf8, utf8_len);
+      if (!OV_ARRAY_GROW(&extensions, wchar_len + 1)) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      extensions[0] = NSTR('\0');
+      if (wchar_len) {
+        ov_utf8_to_wchar(utf8, utf8_len, extensions, wchar_len + 1, NULL);
+      }
+      if (!gcmz_config_set_expand_extensions(config, extensions, err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+    }
+
     yyjson_val *save_paths_array = yyjson_obj_get(root, g_json_key_save_paths);
     if (save_paths_array) {
       if (yyjson_is_arr(save_paths_array)) {
@@ -668,6 +730,9 @@ cleanup:
   if (json_str) {
     OV_ARRAY_DESTROY(&json_str);
   }
+  if (extensions) {
+    OV_ARRAY_DESTROY(&extensions);
+  }
   if (config_path) {
     OV_ARRAY_DESTROY(&config_path);
   }
@@ -708,6 +773,23 @@ bool gcmz_config_save(struct gcmz_config const *const config, struct ov_error *c
     yyjson_mut_obj_add_bool(doc, root, g_json_key_allow_create_directories, config->allow_create_directories);
     yyjson_mut_obj_add_bool(doc, root, g_json_key_external_api, config->external_api);
     yyjson_mut_obj_add_bool(doc, root, g_json_key_show_debug_menu, config->show_debug_menu);
+    yyjson_mut_obj_add_bool(doc, root, g_json_key_expand_directories, config->expand_directories);
+    {
+      size_t const len = STRLEN(config->expand_extensions);
+      size_t const utf8_len = ov_wchar_to_utf8_len(config->expand_extensions, len);
+      if (!OV_ARRAY_GROW(&path_utf8, utf8_len + 1)) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      path_utf8[0] = '\0';
+      if (utf8_len) {
+        ov_wchar_to_utf8(config->expand_extensions, len, path_utf8, utf8_len + 1, NULL);
+      }
+      yyjson_mut_obj_add_strcpy(doc, root, g_json_key_expand_extensions, path_utf8);
+    }
+    yyjson_mut_obj_add_bool(doc, root, g_json_key_downscale_images, config->downscale_images);
+    yyjson_mut_obj_add_bool(doc, root, g_json_key_bitmaps_as_bmp, config->bitmaps_as_bmp);
+    yyjson_mut_obj_add_bool(doc, root, g_json_key_collapse_sequences, config->collapse_sequences);
 
     yyjson_mut_val *save_paths_array = yyjson_mut_arr(doc);
     yyjson_mut_obj_add_val(doc, root, g_json_key_save_paths, save_paths_array);
@@ -961,6 +1043,143 @@ bool gcmz_config_set_show_debug_menu(struct gcmz_config *const config,
   return true;
 }
 
+bool gcmz_config_get_expand_directories(struct gcmz_config const *const config,
+                                        bool *const expand_directories,
+                                        struct ov_error *const err) {
+  if (!config || !expand_directories) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  *expand_directories = config->expand_directories;
+  return true;
+}
+
+bool gcmz_config_set_expand_directories(struct gcmz_config *const config,
+                                        bool const expand_directories,
+                                        struct ov_error *const err) {
+  if (!config) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  config->expand_directories = expand_directories;
+  return true;
+}
+
+bool gcmz_config_get_expand_extensions(struct gcmz_config const *const config,
+                                       NATIVE_CHAR **const extensions,
+                                       struct ov_error *const err) {
+  if (!config || !extensions) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  size_t const len = STRLEN(config->expand_extensions);
+  if (!OV_ARRAY_GROW(extensions, len + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  memcpy(*extensions, config->expand_extensions, (len + 1) * sizeof(NATIVE_CHAR));
+  OV_ARRAY_SET_LENGTH(*extensions, len);
+  return true;
+}
+
+bool gcmz_config_set_expand_extensions(struct gcmz_config *const config,
+                                       NATIVE_CHAR const *const extensions,
+                                       struct ov_error *const err) {
+  if (!config || !extensions) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  size_t const len = STRLEN(extensions);
+  NATIVE_CHAR *copy = NULL;
+  if (!OV_ARRAY_GROW(&copy, len + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  memcpy(copy, extensions, (len + 1) * sizeof(NATIVE_CHAR));
+  OV_ARRAY_SET_LENGTH(copy, len);
+  if (config->expand_extensions) {
+    OV_ARRAY_DESTROY(&config->expand_extensions);
+  }
+  config->expand_extensions = copy;
+  return true;
+}
+
+bool gcmz_config_get_downscale_images(struct gcmz_config const *const config,
+                                      bool *const downscale_images,
+                                      struct ov_error *const err) {
+  if (!config || !downscale_images) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  *downscale_images = config->downscale_images;
+  return true;
+}
+
+bool gcmz_config_set_downscale_images(struct gcmz_config *const config,
+                                      bool const downscale_images,
+                                      struct ov_error *const err) {
+  if (!config) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  config->downscale_images = downscale_images;
+  return true;
+}
+
+bool gcmz_config_get_bitmaps_as_bmp(struct gcmz_config const *const config,
+                                    bool *const bitmaps_as_bmp,
+                                    struct ov_error *const err) {
+  if (!config || !bitmaps_as_bmp) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  *bitmaps_as_bmp = config->bitmaps_as_bmp;
+  return true;
+}
+
+bool gcmz_config_set_bitmaps_as_bmp(struct gcmz_config *const config,
+                                    bool const bitmaps_as_bmp,
+                                    struct ov_error *const err) {
+  if (!config) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  config->bitmaps_as_bmp = bitmaps_as_bmp;
+  return true;
+}
+
+bool gcmz_config_get_collapse_sequences(struct gcmz_config const *const config,
+                                        bool *const collapse_sequences,
+                                        struct ov_error *const err) {
+  if (!config || !collapse_sequences) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  *collapse_sequences = config->collapse_sequences;
+  return true;
+}
+
+bool gcmz_config_set_collapse_sequences(struct gcmz_config *const config,
+                                        bool const collapse_sequences,
+                                        struct ov_error *const err) {
+  if (!config) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  config->collapse_sequences = collapse_sequences;
+  return true;
+}
+
 NATIVE_CHAR const *const *gcmz_config_get_save_paths(struct gcmz_config const *const config) {
   if (!config) {
     return NULL;
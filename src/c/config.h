@@ -167,6 +167,126 @@ bool gcmz_config_set_show_debug_menu(struct gcmz_config *const config,
                                      bool const show_debug_menu,
                                      struct ov_error *const err);
 
+/**
+ * @brief Get folder expansion setting
+ *
+ * @param config Configuration structure
+ * @param expand_directories Output setting value
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_get_expand_directories(struct gcmz_config const *const config,
+                                        bool *const expand_directories,
+                                        struct ov_error *const err);
+
+/**
+ * @brief Set folder expansion setting
+ *
+ * @param config Configuration structure
+ * @param expand_directories Whether to replace dropped folders with the files inside
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_set_expand_directories(struct gcmz_config *const config,
+                                        bool const expand_directories,
+                                        struct ov_error *const err);
+
+/**
+ * @brief Get extensions of the files taken from dropped folders
+ *
+ * @param config Configuration structure
+ * @param extensions [out] Semicolon-separated extensions (caller must OV_ARRAY_DESTROY)
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_get_expand_extensions(struct gcmz_config const *const config,
+                                       NATIVE_CHAR **const extensions,
+                                       struct ov_error *const err);
+
+/**
+ * @brief Set extensions of the files taken from dropped folders
+ *
+ * @param config Configuration structure
+ * @param extensions Semicolon-separated extensions such as ".png;.jpg", an empty string takes every file
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_set_expand_extensions(struct gcmz_config *const config,
+                                       NATIVE_CHAR const *const extensions,
+                                       struct ov_error *const err);
+
+/**
+ * @brief Get image downscaling setting
+ *
+ * @param config Configuration structure
+ * @param downscale_images Output setting value
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_get_downscale_images(struct gcmz_config const *const config,
+                                      bool *const downscale_images,
+                                      struct ov_error *const err);
+
+/**
+ * @brief Set image downscaling setting
+ *
+ * @param config Configuration structure
+ * @param downscale_images Whether to shrink generated images larger than the project to fit it
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_set_downscale_images(struct gcmz_config *const config,
+                                      bool const downscale_images,
+                                      struct ov_error *const err);
+
+/**
+ * @brief Get pasted bitmap format setting
+ *
+ * @param config Configuration structure
+ * @param bitmaps_as_bmp Output setting value
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_get_bitmaps_as_bmp(struct gcmz_config const *const config,
+                                    bool *const bitmaps_as_bmp,
+                                    struct ov_error *const err);
+
+/**
+ * @brief Set pasted bitmap format setting
+ *
+ * @param config Configuration structure
+ * @param bitmaps_as_bmp Whether to save bitmap data as BMP instead of encoding it to PNG
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_set_bitmaps_as_bmp(struct gcmz_config *const config,
+                                    bool const bitmaps_as_bmp,
+                                    struct ov_error *const err);
+
+/**
+ * @brief Get image sequence collapsing setting
+ *
+ * @param config Configuration structure
+ * @param collapse_sequences Output setting value
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_get_collapse_sequences(struct gcmz_config const *const config,
+                                        bool *const collapse_sequences,
+                                        struct ov_error *const err);
+
+/**
+ * @brief Set image sequence collapsing setting
+ *
+ * @param config Configuration structure
+ * @param collapse_sequences Whether to drop numbered image sequences as a single sequence object
+ * @param err Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_config_set_collapse_sequences(struct gcmz_config *const config,
+                                        bool const collapse_sequences,
+                                        struct ov_error *const err);
+
 /**
  * @brief Get fallback save path used when no save paths are configured or all fail
  *
@@ -40,6 +40,10 @@ enum {
   id_button_remove_path = 224,
 
   id_check_create_directories = 230,
+  id_check_expand_directories = 231,
+  id_check_downscale_images = 232,
+  id_check_bitmaps_as_bmp = 233,
+  id_check_collapse_sequences = 234,
 
   id_group_external_api = 300,
   id_check_enable_external_api = 301,
@@ -328,6 +332,19 @@ static INT_PTR init_dialog(HWND dialog, struct dialog_data *data) {
   SetWindowTextW(GetDlgItem(dialog, id_button_remove_path), buf);
   ov_snprintf_wchar(buf, sizeof(buf) / sizeof(WCHAR), ph, ph, gettext("&Make directories automatically"));
   SetWindowTextW(GetDlgItem(dialog, id_check_create_directories), buf);
+  ov_snprintf_wchar(buf, sizeof(buf) / sizeof(WCHAR), ph, ph, gettext("E&xpand dropped folders"));
+  SetWindowTextW(GetDlgItem(dialog, id_check_expand_directories), buf);
+  ov_snprintf_wchar(
+      buf, sizeof(buf) / sizeof(WCHAR), ph, ph, gettext("Do&wnscale pasted images larger than the project"));
+  SetWindowTextW(GetDlgItem(dialog, id_check_downscale_images), buf);
+  ov_snprintf_wchar(buf, sizeof(buf) / sizeof(WCHAR), ph, ph, gettext("Save pasted &bitmaps as BMP instead of PNG"));
+  SetWindowTextW(GetDlgItem(dialog, id_check_bitmaps_as_bmp), buf);
+  ov_snprintf_wchar(buf,
+                    sizeof(buf) / sizeof(WCHAR),
+                    ph,
+                    ph,
+                    gettext("Drop numbered &images as one image sequence (not in copy mode)"));
+  SetWindowTextW(GetDlgItem(dialog, id_check_collapse_sequences), buf);
   ov_snprintf_wchar(buf, sizeof(buf) / sizeof(WCHAR), ph, ph, gettext("External API"));
   SetWindowTextW(GetDlgItem(dialog, id_group_external_api), buf);
   ov_snprintf_wchar(buf, sizeof(buf) / sizeof(WCHAR), ph, ph, gettext("&Enable"));
@@ -363,6 +380,46 @@ static INT_PTR init_dialog(HWND dialog, struct dialog_data *data) {
     SendMessageW(h, BM_SETCHECK, allow_create_directories ? BST_CHECKED : BST_UNCHECKED, 0);
   }
 
+  {
+    bool expand_directories;
+    if (!gcmz_config_get_expand_directories(data->config, &expand_directories, &err)) {
+      OV_ERROR_REPORT(&err, NULL);
+      expand_directories = false;
+    }
+    HWND h = GetDlgItem(dialog, id_check_expand_directories);
+    SendMessageW(h, BM_SETCHECK, expand_directories ? BST_CHECKED : BST_UNCHECKED, 0);
+  }
+
+  {
+    bool downscale_images;
+    if (!gcmz_config_get_downscale_images(data->config, &downscale_images, &err)) {
+      OV_ERROR_REPORT(&err, NULL);
+      downscale_images = false;
+    }
+    HWND h = GetDlgItem(dialog, id_check_downscale_images);
+    SendMessageW(h, BM_SETCHECK, downscale_images ? BST_CHECKED : BST_UNCHECKED, 0);
+  }
+
+  {
+    bool bitmaps_as_bmp;
+    if (!gcmz_config_get_bitmaps_as_bmp(data->config, &bitmaps_as_bmp, &err)) {
+      OV_ERROR_REPORT(&err, NULL);
+      bitmaps_as_bmp = false;
+    }
+    HWND h = GetDlgItem(dialog, id_check_bitmaps_as_bmp);
+    SendMessageW(h, BM_SETCHECK, bitmaps_as_bmp ? BST_CHECKED : BST_UNCHECKED, 0);
+  }
+
+  {
+    bool collapse_sequences;
+    if (!gcmz_config_get_collapse_sequences(data->config, &collapse_sequences, &err)) {
+      OV_ERROR_REPORT(&err, NULL);
+      collapse_sequences = false;
+    }
+    HWND h = GetDlgItem(dialog, id_check_collapse_sequences);
+    SendMessageW(h, BM_SETCHECK, collapse_sequences ? BST_CHECKED : BST_UNCHECKED, 0);
+  }
+
   {
     bool external_api;
     if (!gcmz_config_get_external_api(data->config, &external_api, &err)) {
@@ -518,6 +575,10 @@ static int const settings_tab_controls[] = {
     id_button_move_down,
     id_button_remove_path,
     id_check_create_directories,
+    id_check_expand_directories,
+    id_check_downscale_images,
+    id_check_bitmaps_as_bmp,
+    id_check_collapse_sequences,
     id_group_external_api,
     id_check_enable_external_api,
     id_label_external_api_status,
@@ -1049,6 +1110,50 @@ static bool click_ok(HWND dialog, struct dialog_data *data) {
     }
   }
 
+  {
+    // Save folder expansion setting
+    HWND h = GetDlgItem(dialog, id_check_expand_directories);
+    LRESULT const checked = SendMessageW(h, BM_GETCHECK, 0, 0);
+    bool const expand_directories = (checked == BST_CHECKED);
+    if (!gcmz_config_set_expand_directories(data->config, expand_directories, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+  }
+
+  {
+    // Save image downscaling setting
+    HWND h = GetDlgItem(dialog, id_check_downscale_images);
+    LRESULT const checked = SendMessageW(h, BM_GETCHECK, 0, 0);
+    bool const downscale_images = (checked == BST_CHECKED);
+    if (!gcmz_config_set_downscale_images(data->config, downscale_images, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+  }
+
+  {
+    // Save pasted bitmap format setting
+    HWND h = GetDlgItem(dialog, id_check_bitmaps_as_bmp);
+    LRESULT const checked = SendMessageW(h, BM_GETCHECK, 0, 0);
+    bool const bitmaps_as_bmp = (checked == BST_CHECKED);
+    if (!gcmz_config_set_bitmaps_as_bmp(data->config, bitmaps_as_bmp, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+  }
+
+  {
+    // Save image sequence collapsing setting
+    HWND h = GetDlgItem(dialog, id_check_collapse_sequences);
+    LRESULT const checked = SendMessageW(h, BM_GETCHECK, 0, 0);
+    bool const collapse_sequences = (checked == BST_CHECKED);
+    if (!gcmz_config_set_collapse_sequences(data->config, collapse_sequences, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+  }
+
   {
     // Save external API setting
     HWND h = GetDlgItem(dialog, id_check_enable_external_api);
@@ -151,6 +151,178 @@ cleanup:
   gcmz_config_destroy(&config2);
 }
 
+static void test_config_expand_directories_save_load(void) {
+  struct gcmz_config *config1 = NULL;
+  struct gcmz_config *config2 = NULL;
+  NATIVE_CHAR *extensions = NULL;
+  bool expand_directories = false;
+  struct ov_error err = {0};
+
+  config1 = gcmz_config_create(NULL, &err);
+  if (!TEST_SUCCEEDED(config1 != NULL, &err)) {
+    goto cleanup;
+  }
+
+  // Opt-in, with a media list by default
+  if (!TEST_SUCCEEDED(gcmz_config_get_expand_directories(config1, &expand_directories, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(!expand_directories);
+  if (!TEST_SUCCEEDED(gcmz_config_get_expand_extensions(config1, &extensions, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(wcsstr(extensions, L".png") != NULL);
+  OV_ARRAY_DESTROY(&extensions);
+
+  if (!TEST_SUCCEEDED(gcmz_config_set_expand_directories(config1, true, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_set_expand_extensions(config1, L".png;.ogg", &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_save(config1, &err), &err)) {
+    goto cleanup;
+  }
+
+  config2 = gcmz_config_create(NULL, &err);
+  if (!TEST_SUCCEEDED(config2 != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_load(config2, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_get_expand_directories(config2, &expand_directories, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(expand_directories);
+  if (!TEST_SUCCEEDED(gcmz_config_get_expand_extensions(config2, &extensions, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(STRCMP(extensions, L".png;.ogg") == 0);
+  TEST_MSG("Actual: %ls", extensions);
+
+cleanup:
+  if (extensions) {
+    OV_ARRAY_DESTROY(&extensions);
+  }
+  gcmz_config_destroy(&config1);
+  gcmz_config_destroy(&config2);
+}
+
+static void test_config_downscale_images_save_load(void) {
+  struct gcmz_config *config1 = NULL;
+  struct gcmz_config *config2 = NULL;
+  bool downscale_images = true;
+  struct ov_error err = {0};
+
+  config1 = gcmz_config_create(NULL, &err);
+  if (!TEST_SUCCEEDED(config1 != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_get_downscale_images(config1, &downscale_images, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(!downscale_images);
+  if (!TEST_SUCCEEDED(gcmz_config_set_downscale_images(config1, true, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_save(config1, &err), &err)) {
+    goto cleanup;
+  }
+
+  config2 = gcmz_config_create(NULL, &err);
+  if (!TEST_SUCCEEDED(config2 != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_load(config2, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_get_downscale_images(config2, &downscale_images, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(downscale_images);
+
+cleanup:
+  gcmz_config_destroy(&config1);
+  gcmz_config_destroy(&config2);
+}
+
+static void test_config_bitmaps_as_bmp_save_load(void) {
+  struct gcmz_config *config1 = NULL;
+  struct gcmz_config *config2 = NULL;
+  bool bitmaps_as_bmp = true;
+  struct ov_error err = {0};
+
+  config1 = gcmz_config_create(NULL, &err);
+  if (!TEST_SUCCEEDED(config1 != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_get_bitmaps_as_bmp(config1, &bitmaps_as_bmp, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(!bitmaps_as_bmp);
+  if (!TEST_SUCCEEDED(gcmz_config_set_bitmaps_as_bmp(config1, true, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_save(config1, &err), &err)) {
+    goto cleanup;
+  }
+
+  config2 = gcmz_config_create(NULL, &err);
+  if (!TEST_SUCCEEDED(config2 != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_load(config2, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_get_bitmaps_as_bmp(config2, &bitmaps_as_bmp, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(bitmaps_as_bmp);
+
+cleanup:
+  gcmz_config_destroy(&config1);
+  gcmz_config_destroy(&config2);
+}
+
+static void test_config_collapse_sequences_save_load(void) {
+  struct gcmz_config *config1 = NULL;
+  struct gcmz_config *config2 = NULL;
+  bool collapse_sequences = true;
+  struct ov_error err = {0};
+
+  config1 = gcmz_config_create(NULL, &err);
+  if (!TEST_SUCCEEDED(config1 != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_get_collapse_sequences(config1, &collapse_sequences, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(!collapse_sequences);
+  if (!TEST_SUCCEEDED(gcmz_config_set_collapse_sequences(config1, true, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_save(config1, &err), &err)) {
+    goto cleanup;
+  }
+
+  config2 = gcmz_config_create(NULL, &err);
+  if (!TEST_SUCCEEDED(config2 != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_load(config2, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_config_get_collapse_sequences(config2, &collapse_sequences, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(collapse_sequences);
+
+cleanup:
+  gcmz_config_destroy(&config1);
+  gcmz_config_destroy(&config2);
+}
+
 static void test_config_get_save_path_with_save_paths(void) {
   struct gcmz_config *config = NULL;
   wchar_t *save_path = NULL;
@@ -534,6 +706,10 @@ TEST_LIST = {
     {"config_default_values", test_config_default_values},
     {"config_processing_mode_getset", test_config_processing_mode_getset},
     {"config_save_load", test_config_save_load},
+    {"config_expand_directories_save_load", test_config_expand_directories_save_load},
+    {"config_downscale_images_save_load", test_config_downscale_images_save_load},
+    {"config_bitmaps_as_bmp_save_load", test_config_bitmaps_as_bmp_save_load},
+    {"config_collapse_sequences_save_load", test_config_collapse_sequences_save_load},
     {"config_get_save_path_with_save_paths", test_config_get_save_path_with_save_paths},
     {"config_get_save_path_nonexistent_dir_no_create", test_config_get_save_path_nonexistent_dir_no_create},
     {"config_get_save_path_project_based", test_config_get_save_path_project_based},
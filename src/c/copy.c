@@ -13,7 +13,16 @@
 #include <shlobj.h>
 #include <shlwapi.h>
 
-static bool calc_file_hash(wchar_t const *const file_path, uint64_t *const hash, struct ov_error *const err) {
+#include "delayed_cleanup.h"
+
+static bool is_cancelled(long volatile *const cancel) {
+  return cancel && InterlockedCompareExchange(cancel, 0, 0) != 0;
+}
+
+static bool calc_file_hash(wchar_t const *const file_path,
+                           long volatile *const cancel,
+                           uint64_t *const hash,
+                           struct ov_error *const err) {
   if (!file_path || !hash) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return false;
@@ -40,6 +49,10 @@ static bool calc_file_hash(wchar_t const *const file_path, uint64_t *const hash,
     goto cleanup;
   }
   for (;;) {
+    if (is_cancelled(cancel)) {
+      OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(ERROR_CANCELLED));
+      goto cleanup;
+    }
     size_t bytes_read = 0;
     if (!ovl_file_read(file, (uint8_t *)buffer + remainder_count, buffer_size - remainder_count, &bytes_read, err)) {
       OV_ERROR_ADD_TRACE(err);
@@ -320,12 +333,35 @@ cleanup:
   return result;
 }
 
-bool gcmz_copy(wchar_t const *const source_file,
-               enum gcmz_processing_mode processing_mode,
-               gcmz_copy_get_save_path_fn get_save_path,
-               void *userdata,
-               wchar_t **const final_file,
-               struct ov_error *const err) {
+static DWORD CALLBACK copy_progress(LARGE_INTEGER total_size,
+                                    LARGE_INTEGER transferred,
+                                    LARGE_INTEGER stream_size,
+                                    LARGE_INTEGER stream_transferred,
+                                    DWORD stream_number,
+                                    DWORD reason,
+                                    HANDLE source,
+                                    HANDLE dest,
+                                    LPVOID data) {
+  (void)total_size;
+  (void)transferred;
+  (void)stream_size;
+  (void)stream_transferred;
+  (void)stream_number;
+  (void)reason;
+  (void)source;
+  (void)dest;
+  // CopyFileExW deletes the partial destination when cancelled
+  return is_cancelled((long volatile *)data) ? PROGRESS_CANCEL : PROGRESS_CONTINUE;
+}
+
+bool gcmz_copy_hashed(wchar_t const *const source_file,
+                      wchar_t const *const name,
+                      gcmz_copy_get_save_path_fn get_save_path,
+                      void *userdata,
+                      long volatile *const cancel,
+                      wchar_t **const final_file,
+                      bool *const reused,
+                      struct ov_error *const err) {
   if (!source_file || !get_save_path || !final_file) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return false;
@@ -333,31 +369,18 @@ bool gcmz_copy(wchar_t const *const source_file,
 
   wchar_t *hash_filename = NULL;
   wchar_t *save_path = NULL;
+  wchar_t *partial_path = NULL;
   wchar_t *dir_path = NULL;
   uint64_t file_hash;
+  bool is_reused = false;
   bool result = false;
 
   {
-    ov_tribool const needs_copy = is_copy_needed(source_file, processing_mode, err);
-    if (needs_copy == ov_indeterminate) {
+    if (!calc_file_hash(source_file, cancel, &file_hash, err)) {
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
-    if (!needs_copy) {
-      size_t const path_len = wcslen(source_file) + 1;
-      if (!OV_ARRAY_GROW(final_file, path_len)) {
-        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-        goto cleanup;
-      }
-      wcscpy(*final_file, source_file);
-      result = true;
-      goto cleanup;
-    }
-    if (!calc_file_hash(source_file, &file_hash, err)) {
-      OV_ERROR_ADD_TRACE(err);
-      goto cleanup;
-    }
-    if (!generate_hash_filename_from_hash(source_file, file_hash, &hash_filename, err)) {
+    if (!generate_hash_filename_from_hash(name ? name : source_file, file_hash, &hash_filename, err)) {
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
@@ -384,28 +407,56 @@ bool gcmz_copy(wchar_t const *const source_file,
         OV_ERROR_ADD_TRACE(err);
         goto cleanup;
       }
-      if (found) {
-        result = true;
-        goto cleanup;
-      }
-    }
-    if (!CopyFileW(source_file, save_path, FALSE)) {
-      OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
-      goto cleanup;
+      is_reused = found == ov_true;
     }
 
-    // Return the saved path
-    size_t const save_len = wcslen(save_path) + 1;
-    if (!OV_ARRAY_GROW(final_file, save_len)) {
-      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-      goto cleanup;
+    if (!is_reused) {
+      // Copy under a name the hash lookup does not match, so a cancelled or failed copy is never reused
+      size_t const save_len = wcslen(save_path);
+      static wchar_t const partial_suffix[] = L".partial";
+      size_t const partial_len = save_len + sizeof(partial_suffix) / sizeof(wchar_t) - 1;
+      if (!OV_ARRAY_GROW(&partial_path, partial_len + 1)) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      wcscpy(partial_path, save_path);
+      wcscpy(partial_path + save_len, partial_suffix);
+      if (!CopyFileExW(source_file, partial_path, cancel ? copy_progress : NULL, (LPVOID)(uintptr_t)cancel, NULL, 0)) {
+        OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+        DeleteFileW(partial_path);
+        goto cleanup;
+      }
+      if (!MoveFileExW(partial_path, save_path, 0)) {
+        HRESULT const hr = HRESULT_FROM_WIN32(GetLastError());
+        DeleteFileW(partial_path);
+        if (hr != HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS)) {
+          OV_ERROR_SET_HRESULT(err, hr);
+          goto cleanup;
+        }
+        // Another copy of the same content finished first
+        is_reused = true;
+      }
+      if (!OV_ARRAY_GROW(final_file, save_len + 1)) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      wcscpy(*final_file, save_path);
     }
-    wcscpy(*final_file, save_path);
   }
 
+  if (is_reused) {
+    // An abandoned speculative copy may be waiting for deletion, it is in use again now
+    gcmz_delayed_cleanup_unschedule_file(*final_file);
+  }
+  if (reused) {
+    *reused = is_reused;
+  }
   result = true;
 
 cleanup:
+  if (partial_path) {
+    OV_ARRAY_DESTROY(&partial_path);
+  }
   if (hash_filename) {
     OV_ARRAY_DESTROY(&hash_filename);
   }
@@ -417,3 +468,46 @@ cleanup:
   }
   return result;
 }
+
+bool gcmz_copy_is_temporary(wchar_t const *const file_path) { return is_under_temp_directory(file_path); }
+
+bool gcmz_copy(wchar_t const *const source_file,
+               enum gcmz_processing_mode processing_mode,
+               gcmz_copy_get_save_path_fn get_save_path,
+               void *userdata,
+               long volatile *const cancel,
+               wchar_t **const final_file,
+               bool *const created,
+               struct ov_error *const err) {
+  if (!source_file || !get_save_path || !final_file) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  ov_tribool const needs_copy = is_copy_needed(source_file, processing_mode, err);
+  if (needs_copy == ov_indeterminate) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  if (needs_copy) {
+    bool reused = false;
+    if (!gcmz_copy_hashed(source_file, NULL, get_save_path, userdata, cancel, final_file, &reused, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      return false;
+    }
+    if (created) {
+      *created = !reused;
+    }
+    return true;
+  }
+  if (created) {
+    *created = false;
+  }
+  size_t const path_len = wcslen(source_file) + 1;
+  if (!OV_ARRAY_GROW(final_file, path_len)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  wcscpy(*final_file, source_file);
+  return true;
+}
@@ -25,7 +25,9 @@ typedef wchar_t *(*gcmz_copy_get_save_path_fn)(wchar_t const *filename, void *us
  * @param processing_mode Processing mode (auto/direct/copy) determining copy behavior
  * @param get_save_path Callback function to get destination path for file
  * @param userdata User data passed to get_save_path callback
+ * @param cancel Hashing and copying stop when this becomes non-zero (can be NULL)
  * @param final_file [out] Allocated final file path to use (either original or cached copy)
+ * @param created [out] Set to true if final_file is a copy made by this call (can be NULL)
  * @param err [out] Error information on failure
  * @return true on success, false on failure
  */
@@ -33,5 +35,45 @@ NODISCARD bool gcmz_copy(wchar_t const *const source_file,
                          enum gcmz_processing_mode processing_mode,
                          gcmz_copy_get_save_path_fn get_save_path,
                          void *userdata,
+                         long volatile *const cancel,
                          wchar_t **const final_file,
+                         bool *const created,
                          struct ov_error *const err);
+
+/**
+ * @brief Check whether a file is in the temporary directory
+ *
+ * Such files are generated data like clipboard images or browser downloads,
+ * and gcmz_copy always copies them into the save directory.
+ *
+ * @param file_path File path to check
+ * @return true if the file is under the temporary directory
+ */
+bool gcmz_copy_is_temporary(wchar_t const *const file_path);
+
+/**
+ * @brief Copy a file into the save directory under a content-addressed name
+ *
+ * The destination name is "name.<hash>.ext". If a file with the same hash and extension
+ * already exists in the save directory, it is returned instead of copying again and taken off the
+ * delayed cleanup queue. The copy is written under a temporary name first, so an interrupted copy is never reused.
+ * Unlike gcmz_copy, the file is always copied regardless of where it is located.
+ *
+ * @param source_file Source file path to copy
+ * @param name File name used as the base of the hashed name (NULL to use the source file name)
+ * @param get_save_path Callback function to get destination path for file
+ * @param userdata User data passed to get_save_path callback
+ * @param cancel Hashing and copying stop when this becomes non-zero (can be NULL)
+ * @param final_file [out] Allocated path of the saved or reused file
+ * @param reused [out] Set to true if an existing file was reused (can be NULL)
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_copy_hashed(wchar_t const *const source_file,
+                                wchar_t const *const name,
+                                gcmz_copy_get_save_path_fn get_save_path,
+                                void *userdata,
+                                long volatile *const cancel,
+                                wchar_t **const final_file,
+                                bool *const reused,
+                                struct ov_error *const err);
@@ -137,6 +137,10 @@ static void test_copy_needs_determination(void) {
   TEST_CHECK(check_is_copy_needed(users_bin, gcmz_processing_mode_copy, ov_true));
   TEST_CHECK(check_is_copy_needed(users_txt, gcmz_processing_mode_copy, ov_false));
   TEST_CHECK(check_is_copy_needed(temp_object, gcmz_processing_mode_auto, ov_false));
+
+  TEST_CHECK(gcmz_copy_is_temporary(temp_path));
+  TEST_CHECK(!gcmz_copy_is_temporary(program_files_path));
+  TEST_CHECK(!gcmz_copy_is_temporary(users_bin));
 }
 
 static void test_file_management_with_callback(void) {
@@ -156,10 +160,24 @@ static void test_file_management_with_callback(void) {
 
   {
     struct test_save_path_context ctx = {.base_dir = temp_dir};
-    if (!TEST_SUCCEEDED(gcmz_copy(source_file, gcmz_processing_mode_copy, mock_get_save_path, &ctx, &final_file, &err),
-                        &err)) {
+    bool created = false;
+    if (!TEST_SUCCEEDED(
+            gcmz_copy(
+                source_file, gcmz_processing_mode_copy, mock_get_save_path, &ctx, NULL, &final_file, &created, &err),
+            &err)) {
       goto cleanup;
     }
+    TEST_CHECK(created);
+
+    // The same content is found by its hash instead of being copied again
+    wchar_t *again = NULL;
+    if (TEST_SUCCEEDED(
+            gcmz_copy(source_file, gcmz_processing_mode_copy, mock_get_save_path, &ctx, NULL, &again, &created, &err),
+            &err)) {
+      TEST_CHECK(!created);
+      TEST_CHECK(final_file && wcscmp(again, final_file) == 0);
+      OV_ARRAY_DESTROY(&again);
+    }
   }
 
   if (TEST_CHECK(final_file != NULL)) {
@@ -179,9 +197,49 @@ cleanup:
   RemoveDirectoryW(temp_dir);
 }
 
+static void test_file_management_cancelled(void) {
+  wchar_t temp_dir[MAX_PATH];
+  wchar_t *source_file = NULL;
+  wchar_t *final_file = NULL;
+  struct ov_error err = {0};
+
+  GetTempPathW(MAX_PATH, temp_dir);
+  wcscat(temp_dir, L"gcmz_test_cancel_dir");
+  CreateDirectoryW(temp_dir, NULL);
+
+  source_file = create_test_file(L"gcmz_cancel_test.bin", "Content that is never copied", &err);
+  if (!TEST_SUCCEEDED(source_file != NULL, &err)) {
+    goto cleanup;
+  }
+
+  {
+    struct test_save_path_context ctx = {.base_dir = temp_dir};
+    long volatile cancel = 1;
+    TEST_FAILED_WITH(
+        gcmz_copy(source_file, gcmz_processing_mode_copy, mock_get_save_path, &ctx, &cancel, &final_file, NULL, &err),
+        &err,
+        ov_error_type_hresult,
+        HRESULT_FROM_WIN32(ERROR_CANCELLED));
+    TEST_CHECK(final_file == NULL);
+  }
+
+cleanup:
+  if (final_file) {
+    DeleteFileW(final_file);
+    OV_ARRAY_DESTROY(&final_file);
+  }
+  if (source_file) {
+    DeleteFileW(source_file);
+    OV_ARRAY_DESTROY(&source_file);
+  }
+  // Fails if anything was left behind
+  TEST_CHECK(RemoveDirectoryW(temp_dir));
+}
+
 TEST_LIST = {
     {"hash_filename_generation", test_hash_filename_generation},
     {"copy_needs_determination", test_copy_needs_determination},
     {"file_management_with_callback", test_file_management_with_callback},
+    {"file_management_cancelled", test_file_management_cancelled},
     {NULL, NULL},
 };
@@ -24,8 +24,10 @@
 #include "dataobj_stream.h"
 #include "datauri.h"
 #include "file.h"
+#include "png.h"
 #include "sniffer.h"
 #include "temp.h"
+#include "trace.h"
 
 static size_t extract_file_name(wchar_t const *path) {
   if (!path) {
@@ -133,42 +135,23 @@ static NODISCARD bool create_temp_file_from_data(void const *data,
   }
 
   wchar_t *temp_file = NULL;
-  HANDLE hFile = INVALID_HANDLE_VALUE;
   bool result = false;
 
-  if (!gcmz_temp_create_unique_file(filename, &temp_file, err)) {
+  // Repeated drags of the same payload share one file, the reference is dropped by delayed cleanup
+  if (!gcmz_temp_create_file_with_data(filename, data, data_len, &temp_file, err)) {
     OV_ERROR_ADD_TRACE(err);
     goto cleanup;
   }
 
-  hFile = CreateFileW(temp_file, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_TEMPORARY, NULL);
-  if (hFile == INVALID_HANDLE_VALUE) {
-    OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+  if (!gcmz_file_list_add_temporary(files, temp_file, mime_type, err)) {
+    OV_ERROR_ADD_TRACE(err);
     goto cleanup;
   }
-
-  {
-    DWORD bytes_written;
-    BOOL write_result = WriteFile(hFile, data, (DWORD)data_len, &bytes_written, NULL);
-    if (!write_result || bytes_written != data_len) {
-      OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
-      goto cleanup;
-    }
-
-    if (!gcmz_file_list_add_temporary(files, temp_file, mime_type, err)) {
-      OV_ERROR_ADD_TRACE(err);
-      goto cleanup;
-    }
-  }
   result = true;
 
 cleanup:
-  if (hFile != INVALID_HANDLE_VALUE) {
-    CloseHandle(hFile);
-    hFile = INVALID_HANDLE_VALUE;
-  }
   if (temp_file) {
-    if (!result) {
+    if (!result && gcmz_temp_release_file(temp_file)) {
       DeleteFileW(temp_file);
     }
     OV_ARRAY_DESTROY(&temp_file);
@@ -254,7 +237,10 @@ static wchar_t const *detect_mime_type_with_sniffing(void const *data,
   wchar_t const *sniffed_mime = NULL;
   wchar_t const *sniffed_ext = NULL;
   if (data && data_len > 0) {
-    if (gcmz_sniff(data, data_len, &sniffed_mime, &sniffed_ext)) {
+    uint64_t const start = gcmz_trace_now();
+    bool const sniffed = gcmz_sniff(data, data_len, &sniffed_mime, &sniffed_ext);
+    gcmz_trace_record("sniff", start);
+    if (sniffed) {
       if (suggested_extension) {
         *suggested_extension = sniffed_ext;
       }
@@ -479,7 +465,7 @@ cleanup:
     size_t const current_count = gcmz_file_list_count(files);
     for (size_t i = current_count; i > initial_count; --i) {
       struct gcmz_file const *const file = gcmz_file_list_get_mutable(files, i - 1);
-      if (file && file->path && file->temporary) {
+      if (file && file->path && file->temporary && gcmz_temp_release_file(file->path)) {
         DeleteFileW(file->path); // Remove temporary file
       }
     }
@@ -487,14 +473,69 @@ cleanup:
   return result;
 }
 
-static NODISCARD bool
-try_extract_dib_format(IDataObject *const dataobj, struct gcmz_file_list *const files, struct ov_error *const err) {
+/**
+ * @brief Encode 24-bit and 32-bit DIB data to PNG
+ *
+ * Leaves png NULL for layouts the encoder does not handle, such as palettes, compression and unusual masks.
+ * The fourth byte of 32-bit pixels is dropped because CF_DIB carries no reliable alpha.
+ */
+static NODISCARD bool encode_dib_as_png(BITMAPINFOHEADER const *const bih,
+                                        size_t const data_len,
+                                        uint8_t **const png,
+                                        struct ov_error *const err) {
+  static DWORD const bgr_masks[3] = {0x00ff0000, 0x0000ff00, 0x000000ff};
+  size_t offset = bih->biSize + (size_t)bih->biClrUsed * sizeof(RGBQUAD);
+  if (bih->biPlanes != 1 || bih->biWidth <= 0 || bih->biHeight == 0) {
+    return true;
+  }
+  if (bih->biCompression == BI_BITFIELDS) {
+    // Masks follow a BITMAPINFOHEADER and are part of the newer headers
+    DWORD const *masks = (DWORD const *)(void const *)((uint8_t const *)bih + sizeof(BITMAPINFOHEADER));
+    if (bih->biSize == sizeof(BITMAPINFOHEADER)) {
+      offset += sizeof(bgr_masks);
+    }
+    if (bih->biBitCount != 32 || offset < sizeof(BITMAPINFOHEADER) + sizeof(bgr_masks) || offset > data_len ||
+        memcmp(masks, bgr_masks, sizeof(bgr_masks)) != 0) {
+      return true;
+    }
+  } else if (bih->biCompression != BI_RGB || (bih->biBitCount != 24 && bih->biBitCount != 32)) {
+    return true;
+  }
+  uint32_t const width = (uint32_t)bih->biWidth;
+  uint32_t const height = bih->biHeight < 0 ? 0u - (uint32_t)bih->biHeight : (uint32_t)bih->biHeight;
+  size_t const stride = (((size_t)width * bih->biBitCount + 31) / 32) * 4;
+  if (offset > data_len || stride * height > data_len - offset) {
+    return true;
+  }
+  uint8_t const *const pixels = (uint8_t const *)bih + offset;
+  bool const bottom_up = bih->biHeight > 0;
+  if (!gcmz_png_encode(&(struct gcmz_png_image){
+                           .pixels = bottom_up ? pixels + stride * (height - 1) : pixels,
+                           .width = width,
+                           .height = height,
+                           .stride = bottom_up ? -(ptrdiff_t)stride : (ptrdiff_t)stride,
+                           .bytes_per_pixel = bih->biBitCount / 8,
+                       },
+                       0,
+                       png,
+                       err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  return true;
+}
+
+static NODISCARD bool try_extract_dib_format(IDataObject *const dataobj,
+                                             bool const as_bmp,
+                                             struct gcmz_file_list *const files,
+                                             struct ov_error *const err) {
   if (!dataobj || !files) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return false;
   }
 
   uint8_t *bmp = NULL;
+  uint8_t *png = NULL;
   BITMAPINFOHEADER *bih = NULL;
   size_t data_len;
   bool result = false;
@@ -532,6 +573,28 @@ try_extract_dib_format(IDataObject *const dataobj, struct gcmz_file_list *const
       goto cleanup;
     }
 
+    // Screenshots are mostly flat areas, so PNG is a fraction of the BMP size
+    if (!as_bmp) {
+      if (!encode_dib_as_png(bih, data_len, &png, err)) {
+        // The BMP below needs no encoding, so the image is still usable
+#if GCMZ_DEBUG
+        OutputDebugStringW(L"try_extract_dib_format: PNG encoding failed, saving as BMP\n");
+#endif
+        OV_ERROR_DESTROY(err);
+        if (png) {
+          OV_ARRAY_DESTROY(&png);
+        }
+      }
+      if (png) {
+        if (!create_temp_file_from_data(png, OV_ARRAY_LENGTH(png), L"image.png", L"image/png", files, err)) {
+          OV_ERROR_ADD_TRACE(err);
+          goto cleanup;
+        }
+        result = true;
+        goto cleanup;
+      }
+    }
+
     // Create BMP file by adding BITMAPFILEHEADER to DIB data
     size_t const bmp_len = sizeof(BITMAPFILEHEADER) + data_len;
     if (!OV_ARRAY_GROW(&bmp, bmp_len)) {
@@ -565,6 +628,9 @@ try_extract_dib_format(IDataObject *const dataobj, struct gcmz_file_list *const
   result = true;
 
 cleanup:
+  if (png) {
+    OV_ARRAY_DESTROY(&png);
+  }
   if (bmp) {
     OV_ARRAY_DESTROY(&bmp);
   }
@@ -869,6 +935,7 @@ cleanup:
 
 NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
                                                  struct gcmz_file_list *const file_list,
+                                                 struct gcmz_dataobj_options const *const options,
                                                  struct ov_error *const err) {
   if (!dataobj || !file_list) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
@@ -886,7 +953,9 @@ NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
 #if GCMZ_DEBUG
   OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Trying Data URI format\n");
 #endif
+  uint64_t const data_uri_start = gcmz_trace_now();
   bool data_uri_ret = try_extract_data_uri(obj, file_list, err);
+  gcmz_trace_record("probe_data_uri", data_uri_start);
   if (data_uri_ret && gcmz_file_list_count(file_list) > initial_count) {
 #if GCMZ_DEBUG
     OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Data URI format extraction succeeded\n");
@@ -904,7 +973,9 @@ NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
 #if GCMZ_DEBUG
   OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Trying PNG format\n");
 #endif
+  uint64_t const png_start = gcmz_trace_now();
   bool png_ret = try_extract_custom_image_format(obj, L"PNG", L".png", L"image/png", file_list, err);
+  gcmz_trace_record("probe_png", png_start);
   if (png_ret && gcmz_file_list_count(file_list) > initial_count) {
 #if GCMZ_DEBUG
     OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: PNG format extraction succeeded\n");
@@ -922,7 +993,9 @@ NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
 #if GCMZ_DEBUG
   OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Trying JPEG format\n");
 #endif
+  uint64_t const jpeg_start = gcmz_trace_now();
   bool jpeg_ret = try_extract_custom_image_format(obj, L"JPEG", L".jpg", L"image/jpeg", file_list, err);
+  gcmz_trace_record("probe_jpeg", jpeg_start);
   if (jpeg_ret && gcmz_file_list_count(file_list) > initial_count) {
 #if GCMZ_DEBUG
     OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: JPEG format extraction succeeded\n");
@@ -940,7 +1013,9 @@ NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
 #if GCMZ_DEBUG
   OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Trying FileContents format\n");
 #endif
+  uint64_t const file_contents_start = gcmz_trace_now();
   bool file_contents_ret = try_extract_file_contents(obj, file_list, err);
+  gcmz_trace_record("probe_file_contents", file_contents_start);
   if (file_contents_ret && gcmz_file_list_count(file_list) > initial_count) {
 #if GCMZ_DEBUG
     OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: FileContents format extraction succeeded\n");
@@ -958,7 +1033,9 @@ NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
 #if GCMZ_DEBUG
   OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Trying HDROP format\n");
 #endif
+  uint64_t const hdrop_start = gcmz_trace_now();
   bool hdrop_ret = try_extract_hdrop_format(obj, file_list, err);
+  gcmz_trace_record("probe_hdrop", hdrop_start);
   if (hdrop_ret && gcmz_file_list_count(file_list) > initial_count) {
 #if GCMZ_DEBUG
     OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: HDROP format extraction succeeded\n");
@@ -976,7 +1053,9 @@ NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
 #if GCMZ_DEBUG
   OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Trying DIB format\n");
 #endif
-  bool dib_ret = try_extract_dib_format(obj, file_list, err);
+  uint64_t const dib_start = gcmz_trace_now();
+  bool dib_ret = try_extract_dib_format(obj, options ? options->dib_as_bmp : false, file_list, err);
+  gcmz_trace_record("probe_dib", dib_start);
   if (dib_ret && gcmz_file_list_count(file_list) > initial_count) {
 #if GCMZ_DEBUG
     OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: DIB format extraction succeeded\n");
@@ -994,7 +1073,9 @@ NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
 #if GCMZ_DEBUG
   OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Trying plain text fallback\n");
 #endif
+  uint64_t const text_start = gcmz_trace_now();
   bool text_ret = try_extract_plain_text(obj, file_list, err);
+  gcmz_trace_record("probe_plain_text", text_start);
   if (text_ret && gcmz_file_list_count(file_list) > initial_count) {
 #if GCMZ_DEBUG
     OutputDebugStringW(L"gcmz_dataobj_extract_from_dataobj: Plain text fallback succeeded\n");
@@ -4,6 +4,13 @@
 
 struct gcmz_file_list;
 
+/**
+ * @brief Options for extracting files from IDataObject
+ */
+struct gcmz_dataobj_options {
+  bool dib_as_bmp; ///< Save bitmap data as BMP instead of encoding 24-bit and 32-bit bitmaps to PNG
+};
+
 /**
  * @brief Extract files and data from IDataObject
  *
@@ -14,10 +21,12 @@ struct gcmz_file_list;
  * @param dataobj Pointer to IDataObject to extract from. Must not be NULL.
  * @param file_list [out] File list to add extracted files to. Must not be NULL.
  *                        Extracted files are appended to existing entries.
+ * @param options Extraction options, NULL for defaults
  * @param err [out] Pointer to error structure for error information. Can be NULL.
  * @return true on success (files extracted and added to list), false on failure
  *         (check err for error details)
  */
 NODISCARD bool gcmz_dataobj_extract_from_dataobj(void *const dataobj,
                                                  struct gcmz_file_list *const file_list,
+                                                 struct gcmz_dataobj_options const *const options,
                                                  struct ov_error *const err);
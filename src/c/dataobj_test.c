@@ -713,8 +713,8 @@ static void test_try_extract_dib_format_success_24bit(void) {
     return;
   }
 
-  // Test DIB extraction
-  if (!TEST_SUCCEEDED(try_extract_dib_format(&mock->iface, file_list, &err), &err)) {
+  // Test DIB extraction with the BMP option
+  if (!TEST_SUCCEEDED(try_extract_dib_format(&mock->iface, true, file_list, &err), &err)) {
     return;
   }
 
@@ -760,6 +760,49 @@ static void test_try_extract_dib_format_success_24bit(void) {
   OV_FREE(&dib_data);
 }
 
+static void test_try_extract_dib_format_png(void) {
+  static uint8_t const png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  struct gcmz_file_list *file_list = NULL;
+  struct ov_error err = {0};
+  file_list = gcmz_file_list_create(&err);
+  if (!TEST_SUCCEEDED(file_list != NULL, &err)) {
+    return;
+  }
+
+  // 24-bit and 32-bit bitmaps are encoded to PNG, paletted ones stay BMP
+  static int const bit_depths[3] = {24, 32, 8};
+  for (size_t i = 0; i < 3; ++i) {
+    unsigned char *dib_data = NULL;
+    size_t dib_len = 0;
+    create_test_dib_data(&dib_data, &dib_len, bit_depths[i]);
+    struct mock_data_object *mock = create_mock_dataobject(MOCK_FORMAT_DIB, dib_data, dib_len);
+    TEST_ASSERT(mock != NULL);
+    if (TEST_SUCCEEDED(try_extract_dib_format(&mock->iface, false, file_list, &err), &err)) {
+      bool const png = bit_depths[i] != 8;
+      struct gcmz_file const *file = gcmz_file_list_get(file_list, i);
+      TEST_ASSERT(file != NULL);
+      TEST_CHECK(wcscmp(file->mime_type, png ? L"image/png" : L"image/bmp") == 0);
+      TEST_CHECK(wcsstr(file->path, png ? L".png" : L".bmp") != NULL);
+
+      struct ovl_file *ovl_f = NULL;
+      struct ov_error file_err = {0};
+      TEST_ASSERT(ovl_file_open(file->path, &ovl_f, &file_err));
+      uint8_t header[8] = {0};
+      size_t bytes_read = 0;
+      TEST_CHECK(ovl_file_read(ovl_f, header, sizeof(header), &bytes_read, &file_err));
+      TEST_CHECK(bytes_read == sizeof(header));
+      TEST_CHECK((memcmp(header, png_signature, sizeof(png_signature)) == 0) == png);
+      TEST_MSG("bit depth %d", bit_depths[i]);
+      ovl_file_close(ovl_f);
+    }
+    IDataObject_Release(&mock->iface);
+    OV_FREE(&dib_data);
+  }
+
+  cleanup_temporary_files(file_list);
+  gcmz_file_list_destroy(&file_list);
+}
+
 static void test_try_extract_dib_format_no_dib_data(void) {
   struct mock_data_object *mock = create_mock_dataobject(MOCK_FORMAT_NONE, NULL, 0);
   TEST_ASSERT(mock != NULL);
@@ -772,7 +815,8 @@ static void test_try_extract_dib_format_no_dib_data(void) {
   }
 
   // Test DIB extraction when no DIB data is available
-  TEST_FAILED_WITH(try_extract_dib_format(&mock->iface, file_list, &err), &err, ov_error_type_hresult, DV_E_FORMATETC);
+  TEST_FAILED_WITH(
+      try_extract_dib_format(&mock->iface, false, file_list, &err), &err, ov_error_type_hresult, DV_E_FORMATETC);
 
   // Verify no files were created
   TEST_CHECK(gcmz_file_list_count(file_list) == 0);
@@ -791,14 +835,16 @@ static void test_try_extract_dib_format_error_handling(void) {
   }
 
   // Test with NULL dataobj
-  TEST_FAILED_WITH(
-      try_extract_dib_format(NULL, file_list, &err), &err, ov_error_type_generic, ov_error_generic_invalid_argument);
+  TEST_FAILED_WITH(try_extract_dib_format(NULL, false, file_list, &err),
+                   &err,
+                   ov_error_type_generic,
+                   ov_error_generic_invalid_argument);
 
   // Test with invalid data (too small)
   unsigned char invalid_dib[] = {0x01, 0x02, 0x03, 0x04};
   struct mock_data_object *mock_invalid = create_mock_dataobject(MOCK_FORMAT_DIB, invalid_dib, sizeof(invalid_dib));
   TEST_ASSERT(mock_invalid != NULL);
-  TEST_FAILED_WITH(try_extract_dib_format(&mock_invalid->iface, file_list, &err),
+  TEST_FAILED_WITH(try_extract_dib_format(&mock_invalid->iface, false, file_list, &err),
                    &err,
                    ov_error_type_generic,
                    ov_error_generic_invalid_argument);
@@ -813,7 +859,7 @@ static void test_try_extract_dib_format_error_handling(void) {
   invalid_bih.biBitCount = 24;
   struct mock_data_object *mock_header = create_mock_dataobject(MOCK_FORMAT_DIB, &invalid_bih, sizeof(invalid_bih));
   TEST_ASSERT(mock_header != NULL);
-  TEST_FAILED_WITH(try_extract_dib_format(&mock_header->iface, file_list, &err),
+  TEST_FAILED_WITH(try_extract_dib_format(&mock_header->iface, false, file_list, &err),
                    &err,
                    ov_error_type_generic,
                    ov_error_generic_invalid_argument);
@@ -830,7 +876,7 @@ static void test_try_extract_dib_format_error_handling(void) {
   struct mock_data_object *mock_bit =
       create_mock_dataobject(MOCK_FORMAT_DIB, &unsupported_bih, sizeof(unsupported_bih));
   TEST_ASSERT(mock_bit != NULL);
-  TEST_FAILED_WITH(try_extract_dib_format(&mock_bit->iface, file_list, &err),
+  TEST_FAILED_WITH(try_extract_dib_format(&mock_bit->iface, false, file_list, &err),
                    &err,
                    ov_error_type_generic,
                    ov_error_generic_invalid_argument);
@@ -1000,7 +1046,7 @@ static void test_extract_from_dataobj_with_data_uri(void) {
   }
 
   // Test extraction through the main function
-  if (!TEST_SUCCEEDED(gcmz_dataobj_extract_from_dataobj(&mock->iface, file_list, &err), &err)) {
+  if (!TEST_SUCCEEDED(gcmz_dataobj_extract_from_dataobj(&mock->iface, file_list, NULL, &err), &err)) {
     return;
   }
 
@@ -1122,6 +1168,7 @@ TEST_LIST = {
     {"try_extract_png_format_no_png_data", test_try_extract_png_format_no_png_data},
     {"try_extract_png_format_error_handling", test_try_extract_png_format_error_handling},
     {"try_extract_dib_format_success_24bit", test_try_extract_dib_format_success_24bit},
+    {"try_extract_dib_format_png", test_try_extract_dib_format_png},
     {"try_extract_dib_format_no_dib_data", test_try_extract_dib_format_no_dib_data},
     {"try_extract_dib_format_error_handling", test_try_extract_dib_format_error_handling},
     {"try_extract_data_uri_only_success", test_try_extract_data_uri_only_success},
@@ -7,6 +7,7 @@
 #include <ovthreads.h>
 
 #include "file.h"
+#include "temp.h"
 
 enum {
   delay_seconds = 30,
@@ -86,7 +87,10 @@ static void process_queue(struct context *const ctx, uint64_t const delete_thres
     struct entry *const entry = &ctx->queue[ri];
 
     if (entry->schedule_time_seconds <= delete_threshold_seconds) {
-      DeleteFileW(entry->file_path);
+      // Files shared by identical payloads stay until the last reference goes
+      if (gcmz_temp_release_file(entry->file_path)) {
+        DeleteFileW(entry->file_path);
+      }
       entry_destroy(entry);
     } else {
       if (wi != ri) {
@@ -258,6 +262,30 @@ cleanup:
   return result;
 }
 
+static bool context_unschedule_file(struct context *const ctx, wchar_t const *const file_path) {
+  if (mtx_lock(&ctx->queue_mutex) != thrd_success) {
+    return false;
+  }
+  bool found = false;
+  size_t const ln = OV_ARRAY_LENGTH(ctx->queue);
+  size_t wi = 0;
+  for (size_t ri = 0; ri < ln; ++ri) {
+    struct entry *const entry = &ctx->queue[ri];
+    if (_wcsicmp(entry->file_path, file_path) == 0) {
+      entry_destroy(entry);
+      found = true;
+      continue;
+    }
+    if (wi != ri) {
+      ctx->queue[wi] = *entry;
+    }
+    ++wi;
+  }
+  OV_ARRAY_SET_LENGTH(ctx->queue, wi);
+  mtx_unlock(&ctx->queue_mutex);
+  return found;
+}
+
 static NODISCARD bool
 context_schedule_files(struct context *const ctx, struct gcmz_file_list *const files, struct ov_error *const err) {
   if (!ctx || !files) {
@@ -312,6 +340,13 @@ NODISCARD bool gcmz_delayed_cleanup_schedule_file(wchar_t const *const file_path
   return context_schedule_file(g_singleton_context, file_path, err);
 }
 
+bool gcmz_delayed_cleanup_unschedule_file(wchar_t const *const file_path) {
+  if (!g_singleton_context || !file_path) {
+    return false;
+  }
+  return context_unschedule_file(g_singleton_context, file_path);
+}
+
 NODISCARD bool gcmz_delayed_cleanup_schedule_temporary_files(struct gcmz_file_list *const files,
                                                              struct ov_error *const err) {
   if (!g_singleton_context) {
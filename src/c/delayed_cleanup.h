@@ -50,6 +50,19 @@ void gcmz_delayed_cleanup_exit(void);
  */
 NODISCARD bool gcmz_delayed_cleanup_schedule_file(wchar_t const *const file_path, struct ov_error *const err);
 
+/**
+ * @brief Remove a file from the deletion queue
+ *
+ * Used when a file that was scheduled because nobody needed it gets used after all,
+ * such as a managed copy that a later drop finds by its hash.
+ *
+ * @param file_path File path that was passed to gcmz_delayed_cleanup_schedule_file
+ * @return true if the file was in the queue
+ *
+ * @note This function is thread-safe and can be called from any thread.
+ */
+bool gcmz_delayed_cleanup_unschedule_file(wchar_t const *const file_path);
+
 /**
  * @brief Schedule all temporary files in a file list for delayed deletion
  *
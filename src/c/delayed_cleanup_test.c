@@ -66,6 +66,39 @@ cleanup:
   gcmz_temp_remove_directory();
 }
 
+static void test_delayed_cleanup_unschedule_file(void) {
+  struct ov_error err = {0};
+  wchar_t *test_file_path = NULL;
+
+  if (!TEST_SUCCEEDED(gcmz_delayed_cleanup_init(&err), &err)) {
+    return;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_create_directory(&err), &err)) {
+    gcmz_delayed_cleanup_exit();
+    return;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_build_path(&test_file_path, L"test_delayed_unschedule.tmp", &err), &err)) {
+    gcmz_delayed_cleanup_exit();
+    goto cleanup;
+  }
+
+  TEST_CHECK(create_test_file(test_file_path));
+  if (TEST_SUCCEEDED(gcmz_delayed_cleanup_schedule_file(test_file_path, &err), &err)) {
+    TEST_CHECK(gcmz_delayed_cleanup_unschedule_file(test_file_path));
+    TEST_CHECK(!gcmz_delayed_cleanup_unschedule_file(test_file_path));
+  }
+  gcmz_delayed_cleanup_exit();
+  // Exit deletes everything still queued, the unscheduled file survives
+  TEST_CHECK(file_exists(test_file_path));
+  DeleteFileW(test_file_path);
+
+cleanup:
+  if (test_file_path) {
+    OV_ARRAY_DESTROY(&test_file_path);
+  }
+  gcmz_temp_remove_directory();
+}
+
 static void test_delayed_cleanup_schedule_nonexistent_file(void) {
   struct ov_error err = {0};
   if (!TEST_SUCCEEDED(gcmz_delayed_cleanup_init(&err), &err)) {
@@ -179,6 +212,7 @@ static void test_delayed_cleanup_invalid_arguments(void) {
 TEST_LIST = {
     {"test_delayed_cleanup_init_exit", test_delayed_cleanup_init_exit},
     {"test_delayed_cleanup_schedule_file", test_delayed_cleanup_schedule_file},
+    {"test_delayed_cleanup_unschedule_file", test_delayed_cleanup_unschedule_file},
     {"test_delayed_cleanup_schedule_nonexistent_file", test_delayed_cleanup_schedule_nonexistent_file},
     {"test_delayed_cleanup_schedule_temporary_files", test_delayed_cleanup_schedule_temporary_files},
     {"test_delayed_cleanup_invalid_arguments", test_delayed_cleanup_invalid_arguments},
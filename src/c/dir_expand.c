@@ -0,0 +1,611 @@
+#include "dir_expand.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <shlwapi.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ovarray.h>
+#include <ovthreads.h>
+
+#include "file.h"
+
+enum {
+  max_threads = 8,
+  default_max_threads = 4,
+};
+
+struct folder {
+  wchar_t *path;
+  size_t root;
+  size_t depth;
+};
+
+struct found {
+  wchar_t *path;
+  size_t root;
+};
+
+struct gcmz_dir_expand {
+  mtx_t mtx;
+  cnd_t cnd; ///< Signalled when folders are queued and when the walk ends
+  thrd_t threads[max_threads];
+  size_t num_threads;
+  bool mtx_ready;
+  bool cnd_ready;
+
+  wchar_t **roots;       ///< Dropped folders
+  struct folder *queue;  ///< Folders waiting to be enumerated
+  struct found *found;   ///< Files found so far
+  wchar_t *extensions;   ///< Copy of the extension filter, NULL to include every file
+  size_t max_depth;
+  size_t max_files;
+  size_t busy;           ///< Workers enumerating a folder right now
+  LONG volatile cancel;
+  bool done;
+  bool overflow;
+  bool out_of_memory;
+};
+
+static bool match_extension(wchar_t const *const extensions, wchar_t const *const name) {
+  if (!extensions) {
+    return true;
+  }
+  wchar_t const *const ext = wcsrchr(name, L'.');
+  if (!ext) {
+    return false;
+  }
+  size_t const ext_len = wcslen(ext);
+  for (wchar_t const *p = extensions; *p;) {
+    wchar_t const *const sep = wcschr(p, L';');
+    size_t const len = sep ? (size_t)(sep - p) : wcslen(p);
+    // Extensions may be listed with or without the leading dot
+    wchar_t const *const target = p[0] == L'.' ? ext : ext + 1;
+    size_t const target_len = p[0] == L'.' ? ext_len : ext_len - 1;
+    if (len == target_len && len > 0 && _wcsnicmp(p, target, len) == 0) {
+      return true;
+    }
+    p += len + (sep ? 1 : 0);
+  }
+  return false;
+}
+
+static wchar_t *join_path(wchar_t const *const dir, size_t const dir_len, wchar_t const *const name) {
+  size_t const name_len = wcslen(name);
+  bool const has_sep = dir_len > 0 && (dir[dir_len - 1] == L'\\' || dir[dir_len - 1] == L'/');
+  size_t const len = dir_len + (has_sep ? 0 : 1) + name_len;
+  wchar_t *path = NULL;
+  if (!OV_ARRAY_GROW(&path, len + 1)) {
+    return NULL;
+  }
+  memcpy(path, dir, dir_len * sizeof(wchar_t));
+  if (!has_sep) {
+    path[dir_len] = L'\\';
+  }
+  memcpy(path + len - name_len, name, (name_len + 1) * sizeof(wchar_t));
+  OV_ARRAY_SET_LENGTH(path, len);
+  return path;
+}
+
+static void destroy_folders(struct folder *const folders) {
+  size_t const n = OV_ARRAY_LENGTH(folders);
+  for (size_t i = 0; i < n; ++i) {
+    if (folders[i].path) {
+      OV_ARRAY_DESTROY(&folders[i].path);
+    }
+  }
+}
+
+static void destroy_found(struct found *const found) {
+  size_t const n = OV_ARRAY_LENGTH(found);
+  for (size_t i = 0; i < n; ++i) {
+    if (found[i].path) {
+      OV_ARRAY_DESTROY(&found[i].path);
+    }
+  }
+}
+
+static bool append_folder(struct folder **const folders, struct folder const *const f) {
+  size_t const n = OV_ARRAY_LENGTH(*folders);
+  if (!OV_ARRAY_GROW(folders, n + 1)) {
+    return false;
+  }
+  (*folders)[n] = *f;
+  OV_ARRAY_SET_LENGTH(*folders, n + 1);
+  return true;
+}
+
+static bool append_found(struct found **const found, struct found const *const f) {
+  size_t const n = OV_ARRAY_LENGTH(*found);
+  if (!OV_ARRAY_GROW(found, n + 1)) {
+    return false;
+  }
+  (*found)[n] = *f;
+  OV_ARRAY_SET_LENGTH(*found, n + 1);
+  return true;
+}
+
+/**
+ * @brief Enumerate one folder and publish its subfolders and files
+ *
+ * Results are collected locally and published under the lock once per folder.
+ *
+ * @return false if out of memory
+ */
+static bool enumerate_folder(struct gcmz_dir_expand *const e, struct folder const *const folder) {
+  size_t const dir_len = wcslen(folder->path);
+  wchar_t *pattern = NULL;
+  struct folder *subfolders = NULL;
+  struct found *files = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  bool result = false;
+
+  pattern = join_path(folder->path, dir_len, L"*");
+  if (!pattern) {
+    goto cleanup;
+  }
+  WIN32_FIND_DATAW fd;
+  h = FindFirstFileExW(pattern, FindExInfoBasic, &fd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+  if (h == INVALID_HANDLE_VALUE) {
+    // Folders that cannot be read are skipped
+    result = true;
+    goto cleanup;
+  }
+  do {
+    if (InterlockedCompareExchange(&e->cancel, 0, 0)) {
+      break;
+    }
+    if (fd.cFileName[0] == L'.' &&
+        (fd.cFileName[1] == L'\0' || (fd.cFileName[1] == L'.' && fd.cFileName[2] == L'\0'))) {
+      continue;
+    }
+    if (fd.dwFileAttributes & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)) {
+      continue;
+    }
+    bool const is_dir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    if (is_dir) {
+      // Links are not followed so that the walk cannot loop
+      if (folder->depth >= e->max_depth || (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+        continue;
+      }
+    } else if (!match_extension(e->extensions, fd.cFileName)) {
+      continue;
+    }
+    wchar_t *path = join_path(folder->path, dir_len, fd.cFileName);
+    if (!path) {
+      goto cleanup;
+    }
+    bool const ok = is_dir ? append_folder(&subfolders,
+                                           &(struct folder){
+                                               .path = path,
+                                               .root = folder->root,
+                                               .depth = folder->depth + 1,
+                                           })
+                           : append_found(&files, &(struct found){.path = path, .root = folder->root});
+    if (!ok) {
+      OV_ARRAY_DESTROY(&path);
+      goto cleanup;
+    }
+  } while (FindNextFileW(h, &fd));
+
+  mtx_lock(&e->mtx);
+  {
+    size_t const num_subfolders = OV_ARRAY_LENGTH(subfolders);
+    size_t const num_files = OV_ARRAY_LENGTH(files);
+    size_t const queued = OV_ARRAY_LENGTH(e->queue);
+    size_t const total = OV_ARRAY_LENGTH(e->found);
+    if (e->max_files && total + num_files > e->max_files) {
+      e->overflow = true;
+      result = true;
+    } else if (OV_ARRAY_GROW(&e->queue, queued + num_subfolders) && OV_ARRAY_GROW(&e->found, total + num_files)) {
+      if (num_subfolders) {
+        memcpy(e->queue + queued, subfolders, num_subfolders * sizeof(struct folder));
+      }
+      if (num_files) {
+        memcpy(e->found + total, files, num_files * sizeof(struct found));
+      }
+      OV_ARRAY_SET_LENGTH(e->queue, queued + num_subfolders);
+      OV_ARRAY_SET_LENGTH(e->found, total + num_files);
+      OV_ARRAY_SET_LENGTH(subfolders, 0);
+      OV_ARRAY_SET_LENGTH(files, 0);
+      if (num_subfolders) {
+        cnd_broadcast(&e->cnd);
+      }
+      result = true;
+    }
+  }
+  mtx_unlock(&e->mtx);
+
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    FindClose(h);
+  }
+  if (subfolders) {
+    destroy_folders(subfolders);
+    OV_ARRAY_DESTROY(&subfolders);
+  }
+  if (files) {
+    destroy_found(files);
+    OV_ARRAY_DESTROY(&files);
+  }
+  if (pattern) {
+    OV_ARRAY_DESTROY(&pattern);
+  }
+  return result;
+}
+
+static int worker_proc(void *arg) {
+  struct gcmz_dir_expand *const e = (struct gcmz_dir_expand *)arg;
+  mtx_lock(&e->mtx);
+  for (;;) {
+    while (!e->done && OV_ARRAY_LENGTH(e->queue) == 0) {
+      cnd_wait(&e->cnd, &e->mtx);
+    }
+    if (e->done) {
+      break;
+    }
+    size_t const n = OV_ARRAY_LENGTH(e->queue) - 1;
+    struct folder folder = e->queue[n];
+    OV_ARRAY_SET_LENGTH(e->queue, n);
+    ++e->busy;
+    mtx_unlock(&e->mtx);
+
+    bool const ok = enumerate_folder(e, &folder);
+    OV_ARRAY_DESTROY(&folder.path);
+
+    mtx_lock(&e->mtx);
+    --e->busy;
+    if (!ok) {
+      e->out_of_memory = true;
+    }
+    // The walk ends when no folder is queued or being enumerated, or when it cannot go on
+    if ((e->busy == 0 && OV_ARRAY_LENGTH(e->queue) == 0) || e->overflow || e->out_of_memory ||
+        InterlockedCompareExchange(&e->cancel, 0, 0)) {
+      e->done = true;
+      cnd_broadcast(&e->cnd);
+    }
+  }
+  mtx_unlock(&e->mtx);
+  return 0;
+}
+
+static bool is_root(struct gcmz_dir_expand const *const e, wchar_t const *const path, size_t *const index) {
+  size_t const n = OV_ARRAY_LENGTH(e->roots);
+  for (size_t i = 0; i < n; ++i) {
+    if (_wcsicmp(e->roots[i], path) == 0) {
+      if (index) {
+        *index = i;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+static size_t default_thread_count(void) {
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  size_t const n = si.dwNumberOfProcessors;
+  return n < 1 ? 1 : n > default_max_threads ? default_max_threads : n;
+}
+
+void gcmz_dir_expand_destroy(struct gcmz_dir_expand **const expand) {
+  if (!expand || !*expand) {
+    return;
+  }
+  struct gcmz_dir_expand *const e = *expand;
+  gcmz_dir_expand_cancel(e);
+  for (size_t i = 0; i < e->num_threads; ++i) {
+    thrd_join(e->threads[i], NULL);
+  }
+  if (e->cnd_ready) {
+    cnd_destroy(&e->cnd);
+  }
+  if (e->mtx_ready) {
+    mtx_destroy(&e->mtx);
+  }
+  if (e->roots) {
+    size_t const n = OV_ARRAY_LENGTH(e->roots);
+    for (size_t i = 0; i < n; ++i) {
+      OV_ARRAY_DESTROY(&e->roots[i]);
+    }
+    OV_ARRAY_DESTROY(&e->roots);
+  }
+  if (e->queue) {
+    destroy_folders(e->queue);
+    OV_ARRAY_DESTROY(&e->queue);
+  }
+  if (e->found) {
+    destroy_found(e->found);
+    OV_ARRAY_DESTROY(&e->found);
+  }
+  if (e->extensions) {
+    OV_ARRAY_DESTROY(&e->extensions);
+  }
+  OV_FREE(expand);
+}
+
+static bool add_root(struct gcmz_dir_expand *const e, wchar_t const *const path, struct ov_error *const err) {
+  size_t const len = wcslen(path);
+  wchar_t *root = NULL;
+  wchar_t *queued = NULL;
+  bool result = false;
+
+  if (!OV_ARRAY_GROW(&root, len + 1) || !OV_ARRAY_GROW(&queued, len + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  memcpy(root, path, (len + 1) * sizeof(wchar_t));
+  memcpy(queued, path, (len + 1) * sizeof(wchar_t));
+  OV_ARRAY_SET_LENGTH(root, len);
+  OV_ARRAY_SET_LENGTH(queued, len);
+  {
+    size_t const n = OV_ARRAY_LENGTH(e->roots);
+    if (!OV_ARRAY_GROW(&e->roots, n + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    if (!append_folder(&e->queue, &(struct folder){.path = queued, .root = n})) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    queued = NULL;
+    e->roots[n] = root;
+    root = NULL;
+    OV_ARRAY_SET_LENGTH(e->roots, n + 1);
+  }
+  result = true;
+
+cleanup:
+  if (queued) {
+    OV_ARRAY_DESTROY(&queued);
+  }
+  if (root) {
+    OV_ARRAY_DESTROY(&root);
+  }
+  return result;
+}
+
+bool gcmz_dir_expand_start(struct gcmz_dir_expand **const expand,
+                           struct gcmz_file_list const *const file_list,
+                           struct gcmz_dir_expand_options const *const options,
+                           struct ov_error *const err) {
+  if (!expand || *expand || !file_list || !options) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  struct gcmz_dir_expand *e = NULL;
+  bool result = false;
+
+  if (!OV_REALLOC(&e, 1, sizeof(*e))) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  *e = (struct gcmz_dir_expand){
+      .max_depth = options->max_depth,
+      .max_files = options->max_files,
+  };
+
+  {
+    size_t const count = gcmz_file_list_count(file_list);
+    for (size_t i = 0; i < count; ++i) {
+      struct gcmz_file const *const file = gcmz_file_list_get(file_list, i);
+      if (!file || !file->path || file->temporary || is_root(e, file->path, NULL)) {
+        continue;
+      }
+      DWORD const attrs = GetFileAttributesW(file->path);
+      if (attrs == INVALID_FILE_ATTRIBUTES || !(attrs & FILE_ATTRIBUTE_DIRECTORY)) {
+        continue;
+      }
+      if (!add_root(e, file->path, err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+    }
+  }
+  if (OV_ARRAY_LENGTH(e->roots) == 0) {
+    *expand = NULL;
+    result = true;
+    goto cleanup;
+  }
+
+  if (options->extensions) {
+    size_t const len = wcslen(options->extensions);
+    if (!OV_ARRAY_GROW(&e->extensions, len + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    memcpy(e->extensions, options->extensions, (len + 1) * sizeof(wchar_t));
+    OV_ARRAY_SET_LENGTH(e->extensions, len);
+  }
+
+  if (mtx_init(&e->mtx, mtx_plain) != thrd_success) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    goto cleanup;
+  }
+  e->mtx_ready = true;
+  if (cnd_init(&e->cnd) != thrd_success) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    goto cleanup;
+  }
+  e->cnd_ready = true;
+
+  {
+    size_t threads = options->threads ? options->threads : default_thread_count();
+    if (threads > max_threads) {
+      threads = max_threads;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+      if (thrd_create(&e->threads[i], worker_proc, e) != thrd_success) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+        goto cleanup;
+      }
+      ++e->num_threads;
+    }
+  }
+
+  *expand = e;
+  e = NULL;
+  result = true;
+
+cleanup:
+  gcmz_dir_expand_destroy(&e);
+  return result;
+}
+
+ov_tribool gcmz_dir_expand_wait(struct gcmz_dir_expand *const expand,
+                                uint32_t const timeout_ms,
+                                struct ov_error *const err) {
+  if (!expand) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return ov_indeterminate;
+  }
+
+  struct timespec deadline;
+  if (timespec_get(&deadline, TIME_UTC) == 0) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    return ov_indeterminate;
+  }
+  deadline.tv_sec += (time_t)(timeout_ms / 1000);
+  deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec += 1;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  mtx_lock(&expand->mtx);
+  while (!expand->done) {
+    if (cnd_timedwait(&expand->cnd, &expand->mtx, &deadline) == thrd_timedout) {
+      break;
+    }
+  }
+  bool const done = expand->done;
+  bool const overflow = expand->overflow;
+  bool const out_of_memory = expand->out_of_memory;
+  mtx_unlock(&expand->mtx);
+
+  if (!done) {
+    return ov_false;
+  }
+  if (out_of_memory) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return ov_indeterminate;
+  }
+  if (overflow) {
+    OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "too many files in the dropped folders");
+    return ov_indeterminate;
+  }
+  if (InterlockedCompareExchange(&expand->cancel, 0, 0)) {
+    OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "folder expansion was cancelled");
+    return ov_indeterminate;
+  }
+  return ov_true;
+}
+
+void gcmz_dir_expand_cancel(struct gcmz_dir_expand *const expand) {
+  if (!expand) {
+    return;
+  }
+  InterlockedExchange(&expand->cancel, 1);
+  if (!expand->mtx_ready || !expand->cnd_ready) {
+    return;
+  }
+  mtx_lock(&expand->mtx);
+  expand->done = true;
+  cnd_broadcast(&expand->cnd);
+  mtx_unlock(&expand->mtx);
+}
+
+static int compare_found(void const *const a, void const *const b) {
+  struct found const *const fa = (struct found const *)a;
+  struct found const *const fb = (struct found const *)b;
+  if (fa->root != fb->root) {
+    return fa->root < fb->root ? -1 : 1;
+  }
+  return StrCmpLogicalW(fa->path, fb->path);
+}
+
+bool gcmz_dir_expand_apply(struct gcmz_dir_expand *const expand,
+                           struct gcmz_file_list *const file_list,
+                           struct ov_error *const err) {
+  if (!expand || !file_list) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  struct gcmz_file_list *rebuilt = NULL;
+  size_t *first = NULL;
+  bool result = false;
+
+  mtx_lock(&expand->mtx);
+  bool const done = expand->done && !expand->overflow && !expand->out_of_memory;
+  mtx_unlock(&expand->mtx);
+  if (!done || InterlockedCompareExchange(&expand->cancel, 0, 0)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_unexpected);
+    goto cleanup;
+  }
+
+  {
+    // Workers are idle once done, so the results can be used without the lock
+    size_t const num_found = OV_ARRAY_LENGTH(expand->found);
+    size_t const num_roots = OV_ARRAY_LENGTH(expand->roots);
+    qsort(expand->found, num_found, sizeof(struct found), compare_found);
+    if (!OV_ARRAY_GROW(&first, num_roots + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    // first[r]..first[r + 1] is the range of files found under root r
+    for (size_t r = 0, i = 0; r <= num_roots; ++r) {
+      while (i < num_found && expand->found[i].root < r) {
+        ++i;
+      }
+      first[r] = i;
+    }
+
+    rebuilt = gcmz_file_list_create(err);
+    if (!rebuilt) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    size_t const count = gcmz_file_list_count(file_list);
+    for (size_t i = 0; i < count; ++i) {
+      struct gcmz_file const *const file = gcmz_file_list_get(file_list, i);
+      if (!file) {
+        continue;
+      }
+      size_t r = 0;
+      // Folders without any matching file are kept so that the drop still carries them
+      if (file->temporary || !is_root(expand, file->path, &r) || first[r] == first[r + 1]) {
+        bool const ok = file->temporary ? gcmz_file_list_add_temporary(rebuilt, file->path, file->mime_type, err)
+                                        : gcmz_file_list_add(rebuilt, file->path, file->mime_type, err);
+        if (!ok) {
+          OV_ERROR_ADD_TRACE(err);
+          goto cleanup;
+        }
+        continue;
+      }
+      for (size_t j = first[r]; j < first[r + 1]; ++j) {
+        if (!gcmz_file_list_add(rebuilt, expand->found[j].path, NULL, err)) {
+          OV_ERROR_ADD_TRACE(err);
+          goto cleanup;
+        }
+      }
+    }
+  }
+  gcmz_file_list_swap(file_list, rebuilt);
+  result = true;
+
+cleanup:
+  if (rebuilt) {
+    gcmz_file_list_destroy(&rebuilt);
+  }
+  if (first) {
+    OV_ARRAY_DESTROY(&first);
+  }
+  return result;
+}
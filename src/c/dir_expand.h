@@ -0,0 +1,84 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct gcmz_file_list;
+
+/**
+ * @brief Background expansion of dropped folders
+ *
+ * Dropped folders are walked by a small pool of worker threads down to a bounded depth,
+ * so that a large tree neither blocks the caller nor runs unbounded.
+ * Once finished, each folder in a file list can be replaced by the files found under it.
+ * Hidden and system entries are skipped, and links to other folders are not followed.
+ */
+struct gcmz_dir_expand;
+
+/**
+ * @brief Options for folder expansion
+ */
+struct gcmz_dir_expand_options {
+  wchar_t const *extensions; ///< Semicolon-separated extensions such as L".png;.jpg", NULL to include every file
+  size_t max_depth;          ///< Levels of subfolders entered below each dropped folder, 0 for its direct files only
+  size_t max_files;          ///< The expansion fails once more files than this are found, 0 for no limit
+  size_t threads;            ///< Number of worker threads, 0 to choose from the number of processors
+};
+
+/**
+ * @brief Start expanding the folders of a file list
+ *
+ * Only entries that are folders are enumerated, files are left for gcmz_dir_expand_apply to keep as they are.
+ *
+ * @param expand [out] Started expansion, set to NULL if the list holds no folders
+ * @param file_list File list to scan for folders
+ * @param options Expansion options
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_dir_expand_start(struct gcmz_dir_expand **const expand,
+                                     struct gcmz_file_list const *const file_list,
+                                     struct gcmz_dir_expand_options const *const options,
+                                     struct ov_error *const err);
+
+/**
+ * @brief Wait for an expansion to finish
+ *
+ * @param expand Expansion to wait for
+ * @param timeout_ms Maximum time to wait in milliseconds
+ * @param err [out] Error information on failure
+ * @return ov_true if finished, ov_false on timeout, ov_indeterminate if the expansion failed or was cancelled
+ */
+NODISCARD ov_tribool gcmz_dir_expand_wait(struct gcmz_dir_expand *const expand,
+                                          uint32_t const timeout_ms,
+                                          struct ov_error *const err);
+
+/**
+ * @brief Ask the worker threads to stop
+ *
+ * Returns without waiting for the threads. Can be called from any thread.
+ *
+ * @param expand Expansion to cancel, can be NULL
+ */
+void gcmz_dir_expand_cancel(struct gcmz_dir_expand *const expand);
+
+/**
+ * @brief Replace the expanded folders of a file list with the files found
+ *
+ * The files of each folder are sorted by path in the same order as Explorer and take the place of the folder.
+ * Folders that were not part of the expansion or hold no matching file are left as they are.
+ *
+ * @param expand Finished expansion
+ * @param file_list File list to update in place
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_dir_expand_apply(struct gcmz_dir_expand *const expand,
+                                     struct gcmz_file_list *const file_list,
+                                     struct ov_error *const err);
+
+/**
+ * @brief Cancel an expansion and wait for its threads to exit
+ *
+ * @param expand Pointer to the expansion, set to NULL on return
+ */
+void gcmz_dir_expand_destroy(struct gcmz_dir_expand **const expand);
@@ -0,0 +1,166 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <ovtest.h>
+
+#include <ovarray.h>
+#include <ovprintf.h>
+
+#include "dir_expand.h"
+#include "file.h"
+#include "temp.h"
+
+static bool create_test_file(wchar_t const *const root, wchar_t const *const name, DWORD const attrs) {
+  wchar_t path[MAX_PATH];
+  ov_snprintf_wchar(path, MAX_PATH, NULL, L"%ls\\%ls", root, name);
+  HANDLE h = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, attrs, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  CloseHandle(h);
+  return true;
+}
+
+static bool create_test_dir(wchar_t const *const root, wchar_t const *const name) {
+  wchar_t path[MAX_PATH];
+  ov_snprintf_wchar(path, MAX_PATH, NULL, L"%ls\\%ls", root, name);
+  return CreateDirectoryW(path, NULL) != 0;
+}
+
+static bool path_ends_with(struct gcmz_file_list const *const list, size_t const index, wchar_t const *const suffix) {
+  struct gcmz_file const *const file = gcmz_file_list_get(list, index);
+  if (!file) {
+    return false;
+  }
+  size_t const len = wcslen(file->path);
+  size_t const suffix_len = wcslen(suffix);
+  return len >= suffix_len && wcscmp(file->path + len - suffix_len, suffix) == 0;
+}
+
+static bool setup_tree(wchar_t **const root, struct ov_error *const err) {
+  if (!gcmz_temp_create_directory(err) || !gcmz_temp_build_path(root, L"expand_root", err)) {
+    return false;
+  }
+  CreateDirectoryW(*root, NULL);
+  return create_test_file(*root, L"a1.png", FILE_ATTRIBUTE_NORMAL) &&
+         create_test_file(*root, L"a10.png", FILE_ATTRIBUTE_NORMAL) &&
+         create_test_file(*root, L"a2.PNG", FILE_ATTRIBUTE_NORMAL) &&
+         create_test_file(*root, L"notes.txt", FILE_ATTRIBUTE_NORMAL) &&
+         create_test_file(*root, L"hidden.png", FILE_ATTRIBUTE_HIDDEN) && create_test_dir(*root, L"sub") &&
+         create_test_file(*root, L"sub\\b.png", FILE_ATTRIBUTE_NORMAL) && create_test_dir(*root, L"sub\\deeper") &&
+         create_test_file(*root, L"sub\\deeper\\c.png", FILE_ATTRIBUTE_NORMAL) && create_test_dir(*root, L"empty");
+}
+
+static void test_expand(void) {
+  struct gcmz_dir_expand *expand = NULL;
+  struct gcmz_file_list *list = NULL;
+  wchar_t *root = NULL;
+  wchar_t empty[MAX_PATH];
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(setup_tree(&root, &err), &err)) {
+    goto cleanup;
+  }
+  ov_snprintf_wchar(empty, MAX_PATH, NULL, L"%ls\\empty", root);
+  list = gcmz_file_list_create(&err);
+  if (!TEST_SUCCEEDED(list != NULL, &err)) {
+    goto cleanup;
+  }
+
+  TEST_CASE("bounded depth with extension filter");
+  {
+    TEST_CHECK(gcmz_file_list_add(list, L"C:\\not_a_folder.txt", L"text/plain", &err));
+    TEST_CHECK(gcmz_file_list_add(list, root, NULL, &err));
+    TEST_CHECK(gcmz_file_list_add(list, empty, NULL, &err));
+    if (TEST_SUCCEEDED(gcmz_dir_expand_start(&expand,
+                                             list,
+                                             &(struct gcmz_dir_expand_options){
+                                                 .extensions = L".png;jpg",
+                                                 .max_depth = 1,
+                                             },
+                                             &err),
+                       &err) &&
+        TEST_CHECK(expand != NULL) && TEST_CHECK(gcmz_dir_expand_wait(expand, 10000, &err) == ov_true) &&
+        TEST_SUCCEEDED(gcmz_dir_expand_apply(expand, list, &err), &err)) {
+      TEST_CHECK(gcmz_file_list_count(list) == 6);
+      TEST_CHECK(path_ends_with(list, 0, L"C:\\not_a_folder.txt"));
+      TEST_CHECK(path_ends_with(list, 1, L"\\expand_root\\a1.png"));
+      TEST_CHECK(path_ends_with(list, 2, L"\\expand_root\\a2.PNG"));
+      TEST_CHECK(path_ends_with(list, 3, L"\\expand_root\\a10.png"));
+      TEST_CHECK(path_ends_with(list, 4, L"\\expand_root\\sub\\b.png"));
+      // A folder without matching files is kept
+      TEST_CHECK(path_ends_with(list, 5, L"\\expand_root\\empty"));
+    }
+    gcmz_dir_expand_destroy(&expand);
+    gcmz_file_list_clear(list);
+  }
+
+  TEST_CASE("no folders");
+  {
+    TEST_CHECK(gcmz_file_list_add(list, L"C:\\not_a_folder.txt", NULL, &err));
+    TEST_SUCCEEDED(gcmz_dir_expand_start(&expand, list, &(struct gcmz_dir_expand_options){0}, &err), &err);
+    TEST_CHECK(expand == NULL);
+    gcmz_file_list_clear(list);
+  }
+
+  TEST_CASE("too many files");
+  {
+    TEST_CHECK(gcmz_file_list_add(list, root, NULL, &err));
+    if (TEST_SUCCEEDED(gcmz_dir_expand_start(&expand,
+                                             list,
+                                             &(struct gcmz_dir_expand_options){
+                                                 .max_depth = 8,
+                                                 .max_files = 3,
+                                             },
+                                             &err),
+                       &err)) {
+      TEST_FAILED_WITH(gcmz_dir_expand_wait(expand, 10000, &err) == ov_indeterminate,
+                       &err,
+                       ov_error_type_generic,
+                       ov_error_generic_fail);
+    }
+    gcmz_dir_expand_destroy(&expand);
+  }
+
+  TEST_CASE("cancel");
+  {
+    if (TEST_SUCCEEDED(gcmz_dir_expand_start(&expand, list, &(struct gcmz_dir_expand_options){.max_depth = 8}, &err),
+                       &err)) {
+      gcmz_dir_expand_cancel(expand);
+      TEST_FAILED_WITH(gcmz_dir_expand_wait(expand, 10000, &err) == ov_indeterminate,
+                       &err,
+                       ov_error_type_generic,
+                       ov_error_generic_fail);
+      TEST_FAILED_WITH(
+          gcmz_dir_expand_apply(expand, list, &err), &err, ov_error_type_generic, ov_error_generic_unexpected);
+    }
+    gcmz_dir_expand_destroy(&expand);
+  }
+
+  TEST_CASE("invalid arguments");
+  {
+    TEST_FAILED_WITH(gcmz_dir_expand_start(NULL, list, &(struct gcmz_dir_expand_options){0}, &err),
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+    TEST_FAILED_WITH(gcmz_dir_expand_wait(NULL, 0, &err) == ov_indeterminate,
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+  }
+
+cleanup:
+  gcmz_dir_expand_destroy(&expand);
+  if (list) {
+    gcmz_file_list_destroy(&list);
+  }
+  if (root) {
+    OV_ARRAY_DESTROY(&root);
+  }
+  gcmz_temp_remove_directory();
+}
+
+TEST_LIST = {
+    {"expand", test_expand},
+    {NULL, NULL},
+};
@@ -0,0 +1,589 @@
+#include "downscale.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#ifndef COBJMACROS
+#  define COBJMACROS
+#endif
+#ifndef CONST_VTABLE
+#  define CONST_VTABLE
+#endif
+
+#include <ole2.h>
+#include <wincodec.h>
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+#include <ovarray.h>
+#include <ovl/path.h>
+
+#include "temp.h"
+
+enum {
+  weight_bits = 14,
+  weight_one = 1 << weight_bits, ///< Weights of a span add up to this, small enough for _mm_madd_epi16
+};
+
+static float const jpeg_quality = 0.9f;
+
+/**
+ * @brief Source pixels averaged into one destination pixel along an axis
+ */
+struct span {
+  uint32_t first;
+  uint32_t count;
+  size_t weights; ///< Offset of the first weight in the weight array
+};
+
+static bool build_spans(uint32_t const src_len,
+                        uint32_t const dest_len,
+                        struct span **const spans,
+                        int16_t **const weights,
+                        struct ov_error *const err) {
+  size_t const max_count = src_len / dest_len + 2;
+  if (!OV_ARRAY_GROW(spans, dest_len) || !OV_ARRAY_GROW(weights, (size_t)dest_len * max_count)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  // Measured in 1/dest_len of a source pixel, destination pixel j covers [j * src_len, (j + 1) * src_len)
+  // and source pixel i covers [i * dest_len, (i + 1) * dest_len), so every overlap is an exact integer.
+  size_t n = 0;
+  for (uint32_t j = 0; j < dest_len; ++j) {
+    uint64_t const begin = (uint64_t)j * src_len;
+    uint64_t const end = begin + src_len;
+    uint32_t const first = (uint32_t)(begin / dest_len);
+    uint32_t const last = (uint32_t)((end - 1) / dest_len);
+    (*spans)[j] = (struct span){
+        .first = first,
+        .count = last - first + 1,
+        .weights = n,
+    };
+    // Rounding the running total keeps every weight non-negative and the sum exactly weight_one
+    uint64_t prev = 0;
+    for (uint32_t i = first; i <= last; ++i) {
+      uint64_t const edge = (uint64_t)(i + 1) * dest_len;
+      uint64_t const hi = edge < end ? edge : end;
+      uint64_t const total = ((hi - begin) * weight_one + src_len / 2) / src_len;
+      (*weights)[n++] = (int16_t)(total - prev);
+      prev = total;
+    }
+  }
+  return true;
+}
+
+static void resample_row(uint8_t const *const src,
+                         uint8_t *const dest,
+                         uint32_t const dest_width,
+                         struct span const *const spans,
+                         int16_t const *const weights) {
+#if defined(__SSE2__)
+  __m128i const zero = _mm_setzero_si128();
+#endif
+  for (uint32_t x = 0; x < dest_width; ++x) {
+    struct span const *const s = &spans[x];
+    uint8_t const *p = src + (size_t)s->first * 4;
+    int16_t const *const w = weights + s->weights;
+#if defined(__SSE2__)
+    __m128i acc = _mm_set1_epi32(weight_one / 2);
+    for (uint32_t i = 0; i < s->count; ++i, p += 4) {
+      int32_t px;
+      memcpy(&px, p, sizeof(px));
+      __m128i const v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(px), zero), zero);
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(v, _mm_set1_epi32(w[i])));
+    }
+    acc = _mm_srli_epi32(acc, weight_bits);
+    acc = _mm_packs_epi32(acc, acc);
+    int32_t const out = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+    memcpy(dest + (size_t)x * 4, &out, sizeof(out));
+#else
+    uint32_t acc[4] = {weight_one / 2, weight_one / 2, weight_one / 2, weight_one / 2};
+    for (uint32_t i = 0; i < s->count; ++i, p += 4) {
+      for (size_t c = 0; c < 4; ++c) {
+        acc[c] += (uint32_t)w[i] * p[c];
+      }
+    }
+    for (size_t c = 0; c < 4; ++c) {
+      dest[(size_t)x * 4 + c] = (uint8_t)(acc[c] >> weight_bits);
+    }
+#endif
+  }
+}
+
+static void resample_column(uint8_t const *const src,
+                            size_t const src_stride,
+                            uint32_t *const acc,
+                            uint8_t *const dest,
+                            size_t const row_bytes,
+                            struct span const *const s,
+                            int16_t const *const weights) {
+#if defined(__SSE2__)
+  __m128i const zero = _mm_setzero_si128();
+#endif
+  for (size_t n = 0; n < row_bytes; ++n) {
+    acc[n] = weight_one / 2;
+  }
+  for (uint32_t k = 0; k < s->count; ++k) {
+    uint8_t const *const row = src + (size_t)(s->first + k) * src_stride;
+    int16_t const w = weights[s->weights + k];
+    size_t n = 0;
+#if defined(__SSE2__)
+    __m128i const wv = _mm_set1_epi32(w);
+    for (; n + 16 <= row_bytes; n += 16) {
+      __m128i const v = _mm_loadu_si128((__m128i const *)(void const *)(row + n));
+      __m128i const lo = _mm_unpacklo_epi8(v, zero);
+      __m128i const hi = _mm_unpackhi_epi8(v, zero);
+      __m128i *const a = (__m128i *)(void *)(acc + n);
+      _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_madd_epi16(_mm_unpacklo_epi16(lo, zero), wv)));
+      _mm_storeu_si128(a + 1,
+                       _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_madd_epi16(_mm_unpackhi_epi16(lo, zero), wv)));
+      _mm_storeu_si128(a + 2,
+                       _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_madd_epi16(_mm_unpacklo_epi16(hi, zero), wv)));
+      _mm_storeu_si128(a + 3,
+                       _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_madd_epi16(_mm_unpackhi_epi16(hi, zero), wv)));
+    }
+#endif
+    for (; n < row_bytes; ++n) {
+      acc[n] += (uint32_t)w * row[n];
+    }
+  }
+  size_t n = 0;
+#if defined(__SSE2__)
+  for (; n + 16 <= row_bytes; n += 16) {
+    __m128i const *const a = (__m128i const *)(void const *)(acc + n);
+    __m128i const lo = _mm_packs_epi32(_mm_srli_epi32(_mm_loadu_si128(a), weight_bits),
+                                       _mm_srli_epi32(_mm_loadu_si128(a + 1), weight_bits));
+    __m128i const hi = _mm_packs_epi32(_mm_srli_epi32(_mm_loadu_si128(a + 2), weight_bits),
+                                       _mm_srli_epi32(_mm_loadu_si128(a + 3), weight_bits));
+    _mm_storeu_si128((__m128i *)(void *)(dest + n), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; n < row_bytes; ++n) {
+    dest[n] = (uint8_t)(acc[n] >> weight_bits);
+  }
+}
+
+bool gcmz_downscale_fit(uint32_t const width,
+                        uint32_t const height,
+                        uint32_t const max_width,
+                        uint32_t const max_height,
+                        uint32_t *const fitted_width,
+                        uint32_t *const fitted_height) {
+  *fitted_width = width;
+  *fitted_height = height;
+  if (!width || !height || !max_width || !max_height || (width <= max_width && height <= max_height)) {
+    return false;
+  }
+  if ((uint64_t)width * max_height >= (uint64_t)height * max_width) {
+    uint64_t const h = ((uint64_t)height * max_width + width / 2) / width;
+    *fitted_width = max_width;
+    *fitted_height = h ? (uint32_t)h : 1;
+  } else {
+    uint64_t const w = ((uint64_t)width * max_height + height / 2) / height;
+    *fitted_width = w ? (uint32_t)w : 1;
+    *fitted_height = max_height;
+  }
+  return true;
+}
+
+bool gcmz_downscale_bgra(uint8_t const *const src,
+                         uint32_t const src_width,
+                         uint32_t const src_height,
+                         size_t const src_stride,
+                         uint8_t *const dest,
+                         uint32_t const dest_width,
+                         uint32_t const dest_height,
+                         size_t const dest_stride,
+                         struct ov_error *const err) {
+  if (!src || !dest || !dest_width || !dest_height || dest_width > src_width || dest_height > src_height ||
+      src_stride < (size_t)src_width * 4 || dest_stride < (size_t)dest_width * 4) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  struct span *xspans = NULL;
+  struct span *yspans = NULL;
+  int16_t *xweights = NULL;
+  int16_t *yweights = NULL;
+  uint8_t *narrowed = NULL;
+  uint32_t *acc = NULL;
+  size_t const row_bytes = (size_t)dest_width * 4;
+  bool result = false;
+
+  if (!build_spans(src_width, dest_width, &xspans, &xweights, err) ||
+      !build_spans(src_height, dest_height, &yspans, &yweights, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  if (!OV_ARRAY_GROW(&narrowed, row_bytes * src_height) || !OV_ARRAY_GROW(&acc, row_bytes)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  // Rows are narrowed first so that the vertical pass averages short rows
+  for (uint32_t y = 0; y < src_height; ++y) {
+    resample_row(src + (size_t)y * src_stride, narrowed + (size_t)y * row_bytes, dest_width, xspans, xweights);
+  }
+  for (uint32_t y = 0; y < dest_height; ++y) {
+    resample_column(narrowed, row_bytes, acc, dest + (size_t)y * dest_stride, row_bytes, &yspans[y], yweights);
+  }
+  result = true;
+
+cleanup:
+  if (acc) {
+    OV_ARRAY_DESTROY(&acc);
+  }
+  if (narrowed) {
+    OV_ARRAY_DESTROY(&narrowed);
+  }
+  if (yweights) {
+    OV_ARRAY_DESTROY(&yweights);
+  }
+  if (xweights) {
+    OV_ARRAY_DESTROY(&xweights);
+  }
+  if (yspans) {
+    OV_ARRAY_DESTROY(&yspans);
+  }
+  if (xspans) {
+    OV_ARRAY_DESTROY(&xspans);
+  }
+  return result;
+}
+
+// Containers that hold a single still image, animated formats are left alone
+static bool is_supported_container(GUID const *const container) {
+  return IsEqualGUID(container, &GUID_ContainerFormatBmp) || IsEqualGUID(container, &GUID_ContainerFormatPng) ||
+         IsEqualGUID(container, &GUID_ContainerFormatJpeg) || IsEqualGUID(container, &GUID_ContainerFormatTiff);
+}
+
+// Paletted images would come back as 32-bit ones, which are usually larger than the original
+static bool is_indexed_format(GUID const *const format) {
+  return IsEqualGUID(format, &GUID_WICPixelFormat1bppIndexed) || IsEqualGUID(format, &GUID_WICPixelFormat2bppIndexed) ||
+         IsEqualGUID(format, &GUID_WICPixelFormat4bppIndexed) || IsEqualGUID(format, &GUID_WICPixelFormat8bppIndexed);
+}
+
+static bool build_dest_name(wchar_t const *const source_file,
+                            bool const jpeg,
+                            wchar_t **const name,
+                            struct ov_error *const err) {
+  wchar_t const *const filename = ovl_path_extract_file_name(source_file);
+  wchar_t const *const dot = wcsrchr(filename, L'.');
+  wchar_t const *stem = filename;
+  size_t stem_len = dot ? (size_t)(dot - filename) : wcslen(filename);
+  if (!stem_len) {
+    stem = L"image";
+    stem_len = 5;
+  }
+  wchar_t const *const ext = jpeg ? L".jpg" : L".png";
+  if (!OV_ARRAY_GROW(name, stem_len + wcslen(ext) + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  wcsncpy(*name, stem, stem_len);
+  wcscpy(*name + stem_len, ext);
+  return true;
+}
+
+static bool encode(IWICImagingFactory *const factory,
+                   bool const jpeg,
+                   uint8_t *const pixels,
+                   uint32_t const width,
+                   uint32_t const height,
+                   size_t const stride,
+                   wchar_t const *const path,
+                   struct ov_error *const err) {
+  IWICBitmap *bitmap = NULL;
+  IWICStream *stream = NULL;
+  IWICBitmapEncoder *encoder = NULL;
+  IWICBitmapFrameEncode *frame = NULL;
+  IPropertyBag2 *props = NULL;
+  HRESULT hr;
+  bool result = false;
+
+  hr = IWICImagingFactory_CreateBitmapFromMemory(
+      factory, width, height, &GUID_WICPixelFormat32bppPBGRA, (UINT)stride, (UINT)(stride * height), pixels, &bitmap);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  hr = IWICImagingFactory_CreateStream(factory, &stream);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  hr = IWICStream_InitializeFromFilename(stream, path, GENERIC_WRITE);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  hr = IWICImagingFactory_CreateEncoder(
+      factory, jpeg ? &GUID_ContainerFormatJpeg : &GUID_ContainerFormatPng, NULL, &encoder);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  hr = IWICBitmapEncoder_Initialize(encoder, (IStream *)stream, WICBitmapEncoderNoCache);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  hr = IWICBitmapEncoder_CreateNewFrame(encoder, &frame, &props);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  if (jpeg) {
+    static wchar_t image_quality[] = L"ImageQuality";
+    PROPBAG2 option = {0};
+    option.pstrName = image_quality;
+    VARIANT value = {0};
+    value.vt = VT_R4;
+    value.fltVal = jpeg_quality;
+    hr = IPropertyBag2_Write(props, 1, &option, &value);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+  }
+  hr = IWICBitmapFrameEncode_Initialize(frame, props);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  hr = IWICBitmapFrameEncode_SetSize(frame, width, height);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  {
+    // The encoder may pick another format, WriteSource converts to whatever it settles on
+    WICPixelFormatGUID format = jpeg ? GUID_WICPixelFormat24bppBGR : GUID_WICPixelFormat32bppBGRA;
+    hr = IWICBitmapFrameEncode_SetPixelFormat(frame, &format);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+  }
+  hr = IWICBitmapFrameEncode_WriteSource(frame, (IWICBitmapSource *)bitmap, NULL);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  hr = IWICBitmapFrameEncode_Commit(frame);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  hr = IWICBitmapEncoder_Commit(encoder);
+  if (FAILED(hr)) {
+    OV_ERROR_SET_HRESULT(err, hr);
+    goto cleanup;
+  }
+  result = true;
+
+cleanup:
+  if (props) {
+    IPropertyBag2_Release(props);
+  }
+  if (frame) {
+    IWICBitmapFrameEncode_Release(frame);
+  }
+  if (encoder) {
+    IWICBitmapEncoder_Release(encoder);
+  }
+  if (stream) {
+    IWICStream_Release(stream);
+  }
+  if (bitmap) {
+    IWICBitmap_Release(bitmap);
+  }
+  return result;
+}
+
+bool gcmz_downscale_file(wchar_t const *const source_file,
+                         uint32_t const max_width,
+                         uint32_t const max_height,
+                         wchar_t **const dest_file,
+                         struct ov_error *const err) {
+  if (!source_file || !dest_file || !max_width || !max_height) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  bool com_initialized = false;
+  IWICImagingFactory *factory = NULL;
+  IWICBitmapDecoder *decoder = NULL;
+  IWICBitmapFrameDecode *frame = NULL;
+  IWICFormatConverter *converter = NULL;
+  uint8_t *src = NULL;
+  uint8_t *dest = NULL;
+  wchar_t *name = NULL;
+  wchar_t *path = NULL;
+  HRESULT hr;
+  bool result = false;
+
+  {
+    // Worker threads may not have joined an apartment yet, a caller's apartment is used as it is
+    hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (SUCCEEDED(hr)) {
+      com_initialized = true;
+    } else if (hr != RPC_E_CHANGED_MODE) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    hr = CoCreateInstance(
+        &CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, &IID_IWICImagingFactory, (void **)&factory);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    hr = IWICImagingFactory_CreateDecoderFromFilename(
+        factory, source_file, NULL, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder);
+    if (hr == WINCODEC_ERR_COMPONENTNOTFOUND) {
+      result = true;
+      goto cleanup;
+    }
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    GUID container;
+    hr = IWICBitmapDecoder_GetContainerFormat(decoder, &container);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    UINT frames = 0;
+    hr = IWICBitmapDecoder_GetFrameCount(decoder, &frames);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    if (!is_supported_container(&container) || frames != 1) {
+      result = true;
+      goto cleanup;
+    }
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    WICPixelFormatGUID format;
+    hr = IWICBitmapFrameDecode_GetPixelFormat(frame, &format);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    if (is_indexed_format(&format)) {
+      result = true;
+      goto cleanup;
+    }
+    UINT width = 0;
+    UINT height = 0;
+    hr = IWICBitmapFrameDecode_GetSize(frame, &width, &height);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    uint32_t fitted_width = 0;
+    uint32_t fitted_height = 0;
+    if (!gcmz_downscale_fit(width, height, max_width, max_height, &fitted_width, &fitted_height)) {
+      result = true;
+      goto cleanup;
+    }
+    size_t const src_stride = (size_t)width * 4;
+    if (src_stride * height > UINT_MAX) {
+      OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "image is too large to downscale");
+      goto cleanup;
+    }
+
+    // Averaging premultiplied pixels keeps colors of fully transparent pixels from bleeding into edges
+    hr = IWICImagingFactory_CreateFormatConverter(factory, &converter);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    hr = IWICFormatConverter_Initialize(converter,
+                                        (IWICBitmapSource *)frame,
+                                        &GUID_WICPixelFormat32bppPBGRA,
+                                        WICBitmapDitherTypeNone,
+                                        NULL,
+                                        0.0,
+                                        WICBitmapPaletteTypeCustom);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+    if (!OV_ARRAY_GROW(&src, src_stride * height)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    hr = IWICFormatConverter_CopyPixels(converter, NULL, (UINT)src_stride, (UINT)(src_stride * height), src);
+    if (FAILED(hr)) {
+      OV_ERROR_SET_HRESULT(err, hr);
+      goto cleanup;
+    }
+
+    size_t const dest_stride = (size_t)fitted_width * 4;
+    if (!OV_ARRAY_GROW(&dest, dest_stride * fitted_height)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    if (!gcmz_downscale_bgra(src, width, height, src_stride, dest, fitted_width, fitted_height, dest_stride, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+
+    bool const jpeg = IsEqualGUID(&container, &GUID_ContainerFormatJpeg);
+    if (!build_dest_name(source_file, jpeg, &name, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    if (!gcmz_temp_create_unique_file(name, &path, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    if (!encode(factory, jpeg, dest, fitted_width, fitted_height, dest_stride, path, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    *dest_file = path;
+    path = NULL;
+  }
+  result = true;
+
+cleanup:
+  if (path) {
+    DeleteFileW(path);
+    OV_ARRAY_DESTROY(&path);
+  }
+  if (name) {
+    OV_ARRAY_DESTROY(&name);
+  }
+  if (dest) {
+    OV_ARRAY_DESTROY(&dest);
+  }
+  if (src) {
+    OV_ARRAY_DESTROY(&src);
+  }
+  if (converter) {
+    IWICFormatConverter_Release(converter);
+  }
+  if (frame) {
+    IWICBitmapFrameDecode_Release(frame);
+  }
+  if (decoder) {
+    IWICBitmapDecoder_Release(decoder);
+  }
+  if (factory) {
+    IWICImagingFactory_Release(factory);
+  }
+  if (com_initialized) {
+    CoUninitialize();
+  }
+  return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief Fit an image size into a bounding box while keeping its aspect ratio
+ *
+ * @param width Width of the image
+ * @param height Height of the image
+ * @param max_width Width of the bounding box
+ * @param max_height Height of the bounding box
+ * @param fitted_width [out] Width after fitting, the original width if the image already fits
+ * @param fitted_height [out] Height after fitting, the original height if the image already fits
+ * @return true if the image is larger than the bounding box and has to be downscaled
+ */
+bool gcmz_downscale_fit(uint32_t const width,
+                        uint32_t const height,
+                        uint32_t const max_width,
+                        uint32_t const max_height,
+                        uint32_t *const fitted_width,
+                        uint32_t *const fitted_height);
+
+/**
+ * @brief Downscale a 32-bit BGRA image by area averaging
+ *
+ * Every destination pixel is the weighted average of the source pixels it covers,
+ * so the pixels should have premultiplied alpha for transparent edges to stay clean.
+ *
+ * @param src Source pixels
+ * @param src_width Width of the source image
+ * @param src_height Height of the source image
+ * @param src_stride Bytes per source row
+ * @param dest [out] Destination pixels
+ * @param dest_width Width of the destination image, must not exceed src_width
+ * @param dest_height Height of the destination image, must not exceed src_height
+ * @param dest_stride Bytes per destination row
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_downscale_bgra(uint8_t const *const src,
+                                   uint32_t const src_width,
+                                   uint32_t const src_height,
+                                   size_t const src_stride,
+                                   uint8_t *const dest,
+                                   uint32_t const dest_width,
+                                   uint32_t const dest_height,
+                                   size_t const dest_stride,
+                                   struct ov_error *const err);
+
+/**
+ * @brief Write a downscaled copy of an image file that is larger than a bounding box
+ *
+ * The copy is written to the temporary directory, as JPEG for JPEG sources and as PNG otherwise.
+ * Images that already fit, paletted images, animations and files that are not a supported raster image
+ * are left alone.
+ * Can be called from any thread.
+ *
+ * @param source_file Path of the image file
+ * @param max_width Width of the bounding box
+ * @param max_height Height of the bounding box
+ * @param dest_file [out] Path of the downscaled copy (caller must OV_ARRAY_DESTROY),
+ *                  left NULL if the image was left alone
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_downscale_file(wchar_t const *const source_file,
+                                   uint32_t const max_width,
+                                   uint32_t const max_height,
+                                   wchar_t **const dest_file,
+                                   struct ov_error *const err);
@@ -0,0 +1,232 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include <string.h>
+
+#include "downscale.h"
+#include "temp.h"
+
+// bits is 32 for BGRA pixels or 8 for indices into a grayscale palette
+static bool write_bmp(wchar_t const *const path, uint32_t const width, uint32_t const height, WORD const bits) {
+  size_t const stride = (((size_t)width * bits + 31) / 32) * 4;
+  size_t const pixels_size = stride * height;
+  size_t const palette_size = bits == 8 ? sizeof(RGBQUAD) * 256 : 0;
+  BITMAPFILEHEADER const bf = {
+      .bfType = 0x4d42,
+      .bfSize = (DWORD)(sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER) + palette_size + pixels_size),
+      .bfOffBits = (DWORD)(sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER) + palette_size),
+  };
+  BITMAPINFOHEADER const bi = {
+      .biSize = sizeof(BITMAPINFOHEADER),
+      .biWidth = (LONG)width,
+      .biHeight = (LONG)height,
+      .biPlanes = 1,
+      .biBitCount = bits,
+      .biCompression = BI_RGB,
+      .biClrUsed = bits == 8 ? 256 : 0,
+  };
+  RGBQUAD palette[256];
+  for (int i = 0; i < 256; ++i) {
+    palette[i] = (RGBQUAD){.rgbBlue = (BYTE)i, .rgbGreen = (BYTE)i, .rgbRed = (BYTE)i};
+  }
+  uint8_t *pixels = NULL;
+  if (!OV_ARRAY_GROW(&pixels, pixels_size)) {
+    return false;
+  }
+  for (size_t i = 0; i < pixels_size; ++i) {
+    pixels[i] = (uint8_t)(i * 7);
+  }
+  HANDLE h = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  bool ok = h != INVALID_HANDLE_VALUE;
+  if (ok) {
+    DWORD written = 0;
+    ok = WriteFile(h, &bf, sizeof(bf), &written, NULL) && WriteFile(h, &bi, sizeof(bi), &written, NULL) &&
+         (!palette_size || WriteFile(h, palette, (DWORD)palette_size, &written, NULL)) &&
+         WriteFile(h, pixels, (DWORD)pixels_size, &written, NULL);
+    CloseHandle(h);
+  }
+  OV_ARRAY_DESTROY(&pixels);
+  return ok;
+}
+
+static bool has_png_signature(wchar_t const *const path) {
+  static uint8_t const signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  uint8_t buf[8] = {0};
+  HANDLE h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  DWORD read = 0;
+  BOOL const ok = ReadFile(h, buf, sizeof(buf), &read, NULL);
+  CloseHandle(h);
+  return ok && read == sizeof(buf) && memcmp(buf, signature, sizeof(buf)) == 0;
+}
+
+static void test_fit(void) {
+  uint32_t w = 0;
+  uint32_t h = 0;
+
+  TEST_CASE("wide image is bound by width");
+  {
+    TEST_CHECK(gcmz_downscale_fit(7680, 4320, 1920, 1080, &w, &h));
+    TEST_CHECK(w == 1920 && h == 1080);
+    TEST_MSG("got %ux%u", w, h);
+    TEST_CHECK(gcmz_downscale_fit(4000, 1000, 1920, 1080, &w, &h));
+    TEST_CHECK(w == 1920 && h == 480);
+    TEST_MSG("got %ux%u", w, h);
+  }
+
+  TEST_CASE("tall image is bound by height");
+  {
+    TEST_CHECK(gcmz_downscale_fit(1000, 3000, 1920, 1080, &w, &h));
+    TEST_CHECK(w == 360 && h == 1080);
+    TEST_MSG("got %ux%u", w, h);
+  }
+
+  TEST_CASE("image that fits is left alone");
+  {
+    TEST_CHECK(!gcmz_downscale_fit(1920, 1080, 1920, 1080, &w, &h));
+    TEST_CHECK(w == 1920 && h == 1080);
+    TEST_CHECK(!gcmz_downscale_fit(640, 480, 0, 0, &w, &h));
+  }
+
+  TEST_CASE("extreme aspect ratio keeps at least one pixel");
+  {
+    TEST_CHECK(gcmz_downscale_fit(100000, 1, 100, 100, &w, &h));
+    TEST_CHECK(w == 100 && h == 1);
+  }
+}
+
+static void test_bgra(void) {
+  struct ov_error err = {0};
+
+  TEST_CASE("box average");
+  {
+    uint8_t const src[16] = {0, 10, 20, 30, 100, 110, 120, 130, 50, 50, 50, 50, 250, 250, 250, 250};
+    uint8_t dest[4] = {0};
+    if (TEST_SUCCEEDED(gcmz_downscale_bgra(src, 2, 2, 8, dest, 1, 1, 4, &err), &err)) {
+      TEST_CHECK(dest[0] == 100 && dest[1] == 105 && dest[2] == 110 && dest[3] == 115);
+      TEST_MSG("got %d %d %d %d", dest[0], dest[1], dest[2], dest[3]);
+    }
+  }
+
+  TEST_CASE("uniform color is preserved with fractional spans");
+  {
+    enum { sw = 37, sh = 23, dw = 10, dh = 7 };
+    uint8_t src[sw * sh * 4];
+    uint8_t dest[dw * dh * 4];
+    memset(src, 200, sizeof(src));
+    if (TEST_SUCCEEDED(gcmz_downscale_bgra(src, sw, sh, sw * 4, dest, dw, dh, dw * 4, &err), &err)) {
+      bool uniform = true;
+      for (size_t i = 0; i < sizeof(dest); ++i) {
+        uniform = uniform && dest[i] == 200;
+      }
+      TEST_CHECK(uniform);
+    }
+  }
+
+  TEST_CASE("invalid arguments");
+  {
+    uint8_t buf[16] = {0};
+    TEST_FAILED_WITH(gcmz_downscale_bgra(buf, 1, 1, 4, buf, 2, 2, 8, &err),
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+    TEST_FAILED_WITH(gcmz_downscale_bgra(NULL, 2, 2, 8, buf, 1, 1, 4, &err),
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+  }
+}
+
+static void test_file(void) {
+  struct ov_error err = {0};
+  wchar_t *large = NULL;
+  wchar_t *small = NULL;
+  wchar_t *paletted = NULL;
+  wchar_t *text = NULL;
+  wchar_t *dest = NULL;
+
+  if (!TEST_SUCCEEDED(gcmz_temp_create_directory(&err), &err) ||
+      !TEST_SUCCEEDED(gcmz_temp_build_path(&large, L"large.bmp", &err), &err) ||
+      !TEST_SUCCEEDED(gcmz_temp_build_path(&small, L"small.bmp", &err), &err) ||
+      !TEST_SUCCEEDED(gcmz_temp_build_path(&paletted, L"paletted.bmp", &err), &err) ||
+      !TEST_SUCCEEDED(gcmz_temp_build_path(&text, L"note.txt", &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_CHECK(write_bmp(large, 64, 48, 32)) || !TEST_CHECK(write_bmp(small, 16, 16, 32)) ||
+      !TEST_CHECK(write_bmp(paletted, 64, 48, 8))) {
+    goto cleanup;
+  }
+  {
+    HANDLE h = CreateFileW(text, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (!TEST_CHECK(h != INVALID_HANDLE_VALUE)) {
+      goto cleanup;
+    }
+    DWORD written = 0;
+    WriteFile(h, "hello", 5, &written, NULL);
+    CloseHandle(h);
+  }
+
+  TEST_CASE("oversized image is written as png");
+  {
+    if (TEST_SUCCEEDED(gcmz_downscale_file(large, 32, 32, &dest, &err), &err) && TEST_CHECK(dest != NULL)) {
+      size_t const len = wcslen(dest);
+      TEST_CHECK(len > 4 && wcscmp(dest + len - 4, L".png") == 0);
+      TEST_CHECK(has_png_signature(dest));
+      DeleteFileW(dest);
+      OV_ARRAY_DESTROY(&dest);
+    }
+  }
+
+  TEST_CASE("image that fits, paletted image and non-image are left alone");
+  {
+    if (TEST_SUCCEEDED(gcmz_downscale_file(small, 32, 32, &dest, &err), &err)) {
+      TEST_CHECK(dest == NULL);
+    }
+    if (TEST_SUCCEEDED(gcmz_downscale_file(paletted, 32, 32, &dest, &err), &err)) {
+      TEST_CHECK(dest == NULL);
+    }
+    if (TEST_SUCCEEDED(gcmz_downscale_file(text, 32, 32, &dest, &err), &err)) {
+      TEST_CHECK(dest == NULL);
+    }
+  }
+
+  TEST_CASE("invalid arguments");
+  {
+    TEST_FAILED_WITH(gcmz_downscale_file(large, 0, 32, &dest, &err),
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+  }
+
+cleanup:
+  if (dest) {
+    DeleteFileW(dest);
+    OV_ARRAY_DESTROY(&dest);
+  }
+  if (text) {
+    OV_ARRAY_DESTROY(&text);
+  }
+  if (paletted) {
+    OV_ARRAY_DESTROY(&paletted);
+  }
+  if (small) {
+    OV_ARRAY_DESTROY(&small);
+  }
+  if (large) {
+    OV_ARRAY_DESTROY(&large);
+  }
+  gcmz_temp_remove_directory();
+}
+
+TEST_LIST = {
+    {"fit", test_fit},
+    {"bgra", test_bgra},
+    {"file", test_file},
+    {NULL, NULL},
+};
@@ -5,6 +5,7 @@
 #include <ovarray.h>
 #include <ovmo.h>
 #include <ovprintf.h>
+#include <ovthreads.h>
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -22,14 +23,47 @@
 
 #include <commctrl.h>
 
+#include "access_cache.h"
+#include "arena.h"
 #include "datauri.h"
+#include "dir_expand.h"
 #include "error.h"
 #include "file.h"
 #include "logf.h"
+#include "sequence.h"
 #include "temp.h"
+#include "trace.h"
 
 #define GCMZ_DEBUG 0
 
+enum {
+  access_cache_ttl_ms = 5000,
+  sequence_min_frames = 32,
+  expand_max_depth = 8,
+  expand_max_files = 10000,
+  expand_wait_ms = 50, ///< Longest time a drop blocks the UI thread for dropped folders, a few frames
+};
+
+/**
+ * @brief File management started in the background while the cursor hovers
+ *
+ * Hashing and copying large files through file_manage can take long enough to stall the drop,
+ * so it is run speculatively on the files known at drag enter and the drop only collects the results.
+ * Extraction itself stays on the OLE thread because the IDataObject belongs to its apartment.
+ *
+ * Shared by the drag session and the worker thread, whichever lets go last frees it,
+ * so cancelling never waits for a copy in progress.
+ */
+struct speculation {
+  struct gcmz_drop *d;
+  struct gcmz_file_list *sources; ///< Paths to process, owned copy
+  wchar_t **results;              ///< Parallel to sources, NULL where not processed, failed or taken
+  bool *created;                  ///< Parallel to sources, true where the result is a new file
+  HANDLE done;                    ///< Signaled when the worker has finished
+  LONG volatile cancel;
+  LONG volatile refs;
+};
+
 struct wrapped_drop_target {
   IDropTarget drop_target; ///< IDropTarget interface (must be first)
   LONG ref_count;
@@ -41,16 +75,13 @@ struct wrapped_drop_target {
   IDataObject *current_original;               ///< Original IDataObject from drag source
   IDataObject *current_replacement;            ///< Replacement IDataObject with converted files
   struct gcmz_file_list *current_file_list;    ///< Extracted and converted file list
-  struct placeholder_entry *placeholder_cache; ///< Placeholder cache for lazy file creation
   wchar_t *shared_placeholder_path;            ///< Shared placeholder file path
+  struct gcmz_arena *gesture_arena;            ///< Strings of the current drag session, released in one shot
+  struct speculation *speculation;             ///< Background file management of the current drag session
+  struct gcmz_dir_expand *expansion;           ///< Background walk of the folders of the current drag session
   CRITICAL_SECTION cs;                         ///< Window-specific lock for drag state
 };
 
-struct placeholder_entry {
-  wchar_t *path;   ///< Original file path (cache key)
-  bool accessible; ///< Cached file accessibility result
-};
-
 struct gcmz_drop {
   gcmz_drop_dataobj_extract_fn extract;
   gcmz_drop_cleanup_temp_file_fn cleanup;
@@ -59,10 +90,17 @@ struct gcmz_drop {
   gcmz_drop_drag_enter_fn drag_enter;
   gcmz_drop_drop_fn drop;
   gcmz_drop_drag_leave_fn drag_leave;
+  gcmz_drop_expand_directories_fn expand_directories;
+  gcmz_drop_collapse_sequences_fn collapse_sequences;
   void *userdata;
 
+  struct gcmz_access_cache *access_cache; ///< Accessibility of dropped paths, shared across gestures
   struct wrapped_drop_target **wrapped_targets;
   CRITICAL_SECTION targets_cs;
+
+  CRITICAL_SECTION speculations_cs;
+  CONDITION_VARIABLE speculations_finished;
+  size_t speculations; ///< Live speculations, they use the callbacks and have to be gone before destruction
 };
 
 static inline struct wrapped_drop_target *get_impl_from_drop_target(IDropTarget *const This) {
@@ -173,80 +211,125 @@ static void dump_data_object(IDataObject *pDataObj) {
 #endif // GCMZ_DEBUG
 
 /**
- * @brief Check file accessibility with internal cache management
+ * @brief Start walking the folders of a file list in the background
  *
- * This function checks whether a file exists and is accessible, utilizing an internal
- * cache in d to avoid repeated file system queries for the same path. On first access,
- * the result is cached; subsequent calls for the same path return the cached result
- * immediately without performing file system operations.
+ * Errors are reported and leave the folders as they are.
  *
- * @param wdt Wrapped drop target containing the accessibility cache
- * @param path File path to check
- * @param err Error structure for reporting failures
- * @return ov_true if file exists and is accessible,
- *         ov_false if file does not exist or is not a regular file,
- *         ov_indeterminate if an error occurred during the check
+ * @param d Drop context
+ * @param file_list File list holding the dropped folders
+ * @return Started expansion, NULL if disabled, there are no folders or on error
  */
-static ov_tribool is_file_accessible(struct wrapped_drop_target *wdt, wchar_t const *path, struct ov_error *const err) {
-  if (!wdt || !path) {
-    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
-    return ov_indeterminate;
+static struct gcmz_dir_expand *start_expansion(struct gcmz_drop *const d,
+                                               struct gcmz_file_list const *const file_list) {
+  if (!d->expand_directories) {
+    return NULL;
   }
-
-  struct placeholder_entry entry = {0};
-  ov_tribool result = ov_indeterminate;
-
-  // Search cache first
-  if (wdt->placeholder_cache) {
-    size_t const count = OV_ARRAY_LENGTH(wdt->placeholder_cache);
-    for (size_t i = 0; i < count; i++) {
-      if (wdt->placeholder_cache[i].path && wcscmp(wdt->placeholder_cache[i].path, path) == 0) {
-        result = wdt->placeholder_cache[i].accessible ? ov_true : ov_false;
-        goto cleanup;
-      }
-    }
+  struct ov_error err = {0};
+  wchar_t *extensions = NULL;
+  struct gcmz_dir_expand *expansion = NULL;
+  ov_tribool const enabled = d->expand_directories(&extensions, d->userdata, &err);
+  if (enabled == ov_indeterminate) {
+    OV_ERROR_REPORT(&err, NULL);
+  } else if (enabled == ov_true && !gcmz_dir_expand_start(&expansion,
+                                                          file_list,
+                                                          &(struct gcmz_dir_expand_options){
+                                                              .extensions = extensions,
+                                                              .max_depth = expand_max_depth,
+                                                              .max_files = expand_max_files,
+                                                          },
+                                                          &err)) {
+    OV_ERROR_REPORT(&err, NULL);
   }
+  if (extensions) {
+    OV_ARRAY_DESTROY(&extensions);
+  }
+  return expansion;
+}
 
-  {
-    // Cache miss: perform actual file accessibility check using GetFileAttributes
-    DWORD const attrs = GetFileAttributesW(path);
-    if (attrs == INVALID_FILE_ATTRIBUTES) {
-      HRESULT const hr = HRESULT_FROM_WIN32(GetLastError());
-      if (hr != HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) && hr != HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND)) {
-        OV_ERROR_SET_HRESULT(err, hr);
-        goto cleanup;
-      }
-    }
-
-    bool const accessible = (attrs != INVALID_FILE_ATTRIBUTES) && !(attrs & FILE_ATTRIBUTE_DIRECTORY);
-
-    // Add result to cache
-    size_t const path_len = wcslen(path);
-    if (!OV_ARRAY_GROW(&entry.path, path_len + 1)) {
-      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-      goto cleanup;
-    }
-    wcscpy(entry.path, path);
-    entry.accessible = accessible;
-
-    size_t const idx = OV_ARRAY_LENGTH(wdt->placeholder_cache);
-    if (!OV_ARRAY_GROW(&wdt->placeholder_cache, idx + 1)) {
-      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-      goto cleanup;
-    }
-    OV_ARRAY_SET_LENGTH(wdt->placeholder_cache, idx + 1);
-
-    wdt->placeholder_cache[idx] = entry;
-    entry = (struct placeholder_entry){0};
+/**
+ * @brief Check whether the calling thread runs the message loop of a registered window
+ */
+static bool is_ui_thread(struct gcmz_drop *const d) {
+  DWORD const current = GetCurrentThreadId();
+  bool result = false;
+  EnterCriticalSection(&d->targets_cs);
+  size_t const n = OV_ARRAY_LENGTH(d->wrapped_targets);
+  for (size_t i = 0; i < n && !result; ++i) {
+    struct wrapped_drop_target const *const wdt = d->wrapped_targets[i];
+    result = wdt && wdt->main_window && GetWindowThreadProcessId((HWND)wdt->main_window, NULL) == current;
+  }
+  LeaveCriticalSection(&d->targets_cs);
+  return result;
+}
 
-    result = accessible ? ov_true : ov_false;
+/**
+ * @brief Wait for a folder walk and replace the folders of a file list with the files found
+ *
+ * On the UI thread the walk usually has the whole hover since drag enter to finish, so the drop itself
+ * only waits a few frames. When that runs out the walk is cancelled and the folders are left as they are,
+ * because the files of an OLE drop cannot be added to once it has returned.
+ * Other threads wait for the walk to finish, it is bounded by expand_max_depth and expand_max_files.
+ *
+ * @param d Drop context
+ * @param expansion Pointer to the expansion, destroyed and set to NULL on return
+ * @param file_list File list to update in place
+ */
+static void finish_expansion(struct gcmz_drop *const d,
+                             struct gcmz_dir_expand **const expansion,
+                             struct gcmz_file_list *const file_list) {
+  if (!*expansion) {
+    return;
+  }
+  struct ov_error err = {0};
+  uint64_t const start = gcmz_trace_now();
+  uint32_t const wait_ms = is_ui_thread(d) ? expand_wait_ms : INFINITE;
+  ov_tribool const r = gcmz_dir_expand_wait(*expansion, wait_ms, &err);
+  if (r == ov_false) {
+    gcmz_logf_warn(NULL, "%1$hs", "%1$hs", gettext("dropped folders are too large to expand in time"));
+  } else if (r == ov_indeterminate) {
+    gcmz_logf_warn(&err, "%1$hs", "%1$hs", gettext("failed to expand dropped folders"));
+    OV_ERROR_DESTROY(&err);
+  } else if (!gcmz_dir_expand_apply(*expansion, file_list, &err)) {
+    OV_ERROR_REPORT(&err, NULL);
   }
+  gcmz_dir_expand_destroy(expansion);
+  gcmz_trace_record("expand_directories", start);
+}
 
-cleanup:
-  if (entry.path) {
-    OV_ARRAY_DESTROY(&entry.path);
+/**
+ * @brief Replace numbered image sequences in a file list with sequence objects
+ *
+ * Runs after the drop handlers so that scripts still see every frame, and after file management
+ * so that the objects refer to the managed frames. Copies made under hashed names no longer number
+ * like a sequence, so those are left as separate files.
+ * Errors are reported and leave the file list unchanged.
+ *
+ * @param d Drop context
+ * @param file_list File list to process
+ * @return true if any sequence was collapsed
+ */
+static bool collapse_sequences(struct gcmz_drop *const d, struct gcmz_file_list *const file_list) {
+  if (!d->collapse_sequences) {
+    return false;
   }
-  return result;
+  struct ov_error err = {0};
+  ov_tribool const enabled = d->collapse_sequences(d->userdata, &err);
+  if (enabled == ov_indeterminate) {
+    OV_ERROR_REPORT(&err, NULL);
+    return false;
+  }
+  if (enabled == ov_false) {
+    return false;
+  }
+  uint64_t const start = gcmz_trace_now();
+  size_t collapsed = 0;
+  if (!gcmz_sequence_collapse(file_list, sequence_min_frames, &collapsed, &err)) {
+    OV_ERROR_REPORT(&err, NULL);
+  } else if (collapsed) {
+    gcmz_logf_verbose(NULL, "%1$zu", "collapsed %1$zu image sequences into sequence objects", collapsed);
+  }
+  gcmz_trace_record("collapse_sequences", start);
+  return collapsed > 0;
 }
 
 /**
@@ -404,12 +487,19 @@ static struct gcmz_file_list *extract_and_convert_files(struct wrapped_drop_targ
   bool success = false;
 
   {
-    file_list = gcmz_file_list_create(err);
+    if (!wdt->gesture_arena && !gcmz_arena_create(&wdt->gesture_arena, 0, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    file_list = gcmz_file_list_create_with_arena(wdt->gesture_arena, err);
     if (!file_list) {
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
-    if (!d->extract(original_dataobj, file_list, d->userdata, err)) {
+    uint64_t const start = gcmz_trace_now();
+    bool const extracted = d->extract(original_dataobj, file_list, d->userdata, err);
+    gcmz_trace_record("extract", start);
+    if (!extracted) {
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
@@ -477,7 +567,7 @@ static size_t placeholder_path_writer(wchar_t *dest, void *userdata, struct ov_e
       if (!first_pass && ctx->all_accessible) {
         path_to_use = file->path;
       } else {
-        switch (is_file_accessible(wdt, file->path, err)) {
+        switch (gcmz_access_cache_check(wdt->d->access_cache, file->path, err)) {
         case ov_indeterminate:
           OV_ERROR_ADD_TRACE(err);
           goto cleanup;
@@ -528,6 +618,14 @@ static IDataObject *create_dataobj_with_placeholders(
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return NULL;
   }
+  uint64_t const start = gcmz_trace_now();
+  {
+    struct ov_error prefetch_err = {0};
+    if (!gcmz_access_cache_prefetch(wdt->d->access_cache, file_list, &prefetch_err)) {
+      // Not fatal, the remaining files are checked one by one
+      OV_ERROR_REPORT(&prefetch_err, NULL);
+    }
+  }
   IDataObject *result = create_dropfiles_dataobj(x,
                                                  y,
                                                  placeholder_path_writer,
@@ -537,6 +635,7 @@ static IDataObject *create_dataobj_with_placeholders(
                                                      .all_accessible = false,
                                                  },
                                                  err);
+  gcmz_trace_record("create_dataobj_with_placeholders", start);
   if (!result) {
     OV_ERROR_ADD_TRACE(err);
     return NULL;
@@ -560,11 +659,268 @@ static inline uint32_t capture_modifier_keys(void) {
   return modifier_keys;
 }
 
+/**
+ * @brief Drop one reference to a speculation and free it with the last one
+ *
+ * New copies that no drop took are handed to the cleanup callback,
+ * which deletes them later unless a following drop reuses them first.
+ */
+static void speculation_release(struct speculation *s) {
+  if (InterlockedDecrement(&s->refs) > 0) {
+    return;
+  }
+  struct gcmz_drop *const d = s->d;
+  if (s->results) {
+    size_t const n = OV_ARRAY_LENGTH(s->results);
+    for (size_t i = 0; i < n; ++i) {
+      if (!s->results[i]) {
+        continue;
+      }
+      if (s->created[i] && d->cleanup) {
+        struct ov_error err = {0};
+        if (!d->cleanup(s->results[i], d->userdata, &err)) {
+          OV_ERROR_REPORT(&err, NULL);
+        }
+      }
+      OV_ARRAY_DESTROY(&s->results[i]);
+    }
+    OV_ARRAY_DESTROY(&s->results);
+  }
+  if (s->created) {
+    OV_ARRAY_DESTROY(&s->created);
+  }
+  if (s->done) {
+    CloseHandle(s->done);
+  }
+  gcmz_file_list_destroy(&s->sources);
+  OV_FREE(&s);
+
+  EnterCriticalSection(&d->speculations_cs);
+  if (--d->speculations == 0) {
+    WakeAllConditionVariable(&d->speculations_finished);
+  }
+  LeaveCriticalSection(&d->speculations_cs);
+}
+
+static int speculation_thread_proc(void *const userdata) {
+  struct speculation *const s = (struct speculation *)userdata;
+  struct gcmz_drop *const d = s->d;
+  size_t const n = gcmz_file_list_count(s->sources);
+  for (size_t i = 0; i < n && !InterlockedCompareExchange(&s->cancel, 0, 0); ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(s->sources, i);
+    struct ov_error err = {0};
+    uint64_t const start = gcmz_trace_now();
+    bool const ok = d->file_manage(file->path, &s->cancel, &s->results[i], &s->created[i], d->userdata, &err);
+    gcmz_trace_record("file_manage_speculative", start);
+    if (!ok) {
+      // Retried on drop, where the error is reported
+      OV_ERROR_DESTROY(&err);
+      if (s->results[i]) {
+        OV_ARRAY_DESTROY(&s->results[i]);
+      }
+    }
+  }
+  SetEvent(s->done);
+  speculation_release(s);
+  return 0;
+}
+
+/**
+ * @brief Cancel a speculation and let go of it without waiting
+ *
+ * The copy in progress is aborted and the rest are skipped. The worker frees the speculation
+ * when it notices, so this never blocks the UI thread.
+ */
+static void speculation_destroy(struct speculation **const sp) {
+  if (!sp || !*sp) {
+    return;
+  }
+  struct speculation *const s = *sp;
+  *sp = NULL;
+  InterlockedExchange(&s->cancel, 1);
+  speculation_release(s);
+}
+
+/**
+ * @brief Start file management of the files in a list on a worker thread
+ *
+ * Temporary files are skipped because drop extracts them again under new names.
+ *
+ * @param d Drop context
+ * @param file_list Files of the drag session
+ * @param sp [out] Started speculation, NULL if there is nothing to do
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+static NODISCARD bool speculation_start(struct gcmz_drop *const d,
+                                        struct gcmz_file_list const *const file_list,
+                                        struct speculation **const sp,
+                                        struct ov_error *const err) {
+  struct speculation *s = NULL;
+  thrd_t thread;
+  bool result = false;
+
+  if (!OV_REALLOC(&s, 1, sizeof(*s))) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  *s = (struct speculation){
+      .d = d,
+      .refs = 1,
+  };
+  EnterCriticalSection(&d->speculations_cs);
+  ++d->speculations;
+  LeaveCriticalSection(&d->speculations_cs);
+  s->done = CreateEventW(NULL, TRUE, FALSE, NULL);
+  if (!s->done) {
+    OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  s->sources = gcmz_file_list_create(err);
+  if (!s->sources) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  {
+    size_t const file_count = gcmz_file_list_count(file_list);
+    for (size_t i = 0; i < file_count; i++) {
+      struct gcmz_file const *const file = gcmz_file_list_get(file_list, i);
+      if (!file || !file->path || file->temporary) {
+        continue;
+      }
+      if (!gcmz_file_list_add(s->sources, file->path, file->mime_type, err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+    }
+  }
+  {
+    size_t const n = gcmz_file_list_count(s->sources);
+    if (n == 0) {
+      speculation_destroy(&s);
+      *sp = NULL;
+      result = true;
+      goto cleanup;
+    }
+    if (!OV_ARRAY_GROW(&s->results, n) || !OV_ARRAY_GROW(&s->created, n)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    memset(s->results, 0, n * sizeof(wchar_t *));
+    OV_ARRAY_SET_LENGTH(s->results, n);
+    memset(s->created, 0, n * sizeof(bool));
+  }
+  // One reference for the drag session and one for the worker
+  s->refs = 2;
+  if (thrd_create(&thread, speculation_thread_proc, s) != thrd_success) {
+    s->refs = 1;
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    goto cleanup;
+  }
+  thrd_detach(thread);
+  *sp = s;
+  s = NULL;
+  result = true;
+
+cleanup:
+  speculation_destroy(&s);
+  return result;
+}
+
+/**
+ * @brief Take the managed path the speculation produced for a file
+ *
+ * Waits for the worker to finish first. The drop needs these files anyway,
+ * so this takes no longer than processing them on the spot.
+ *
+ * @param s Speculation, can be NULL
+ * @param path Source file path
+ * @param managed_path [out] Managed path, ownership is transferred to the caller
+ * @return true if a result was taken, false if the file has to be processed now
+ */
+static bool speculation_take(struct speculation *const s, wchar_t const *const path, wchar_t **const managed_path) {
+  if (!s) {
+    return false;
+  }
+  WaitForSingleObject(s->done, INFINITE);
+  size_t index = SIZE_MAX;
+  struct ov_error err = {0};
+  if (!gcmz_file_list_find(s->sources, path, &index, &err)) {
+    OV_ERROR_DESTROY(&err);
+    return false;
+  }
+  if (index == SIZE_MAX || !s->results[index]) {
+    return false;
+  }
+  *managed_path = s->results[index];
+  s->results[index] = NULL;
+  return true;
+}
+
+/**
+ * @brief Run file management over a file list and replace the paths with the managed ones
+ *
+ * Errors are reported per file and leave that file as it is.
+ *
+ * @param d Drop context
+ * @param file_list File list to update in place
+ * @param speculation Results prepared while hovering, can be NULL
+ * @param temporary_only Only process temporary files, such as generated sequence objects
+ */
+static void manage_files(struct gcmz_drop *const d,
+                         struct gcmz_file_list *const file_list,
+                         struct speculation *const speculation,
+                         bool const temporary_only) {
+  if (!d->file_manage) {
+    return;
+  }
+  uint64_t const start = gcmz_trace_now();
+  struct ov_error err = {0};
+  size_t const file_count = gcmz_file_list_count(file_list);
+  for (size_t i = 0; i < file_count; i++) {
+    struct gcmz_file *file = gcmz_file_list_get_mutable(file_list, i);
+    if (!file || !file->path || (temporary_only && !file->temporary)) {
+      continue;
+    }
+
+    wchar_t *managed_path = NULL;
+    if (!speculation_take(speculation, file->path, &managed_path) &&
+        !d->file_manage(file->path, NULL, &managed_path, NULL, d->userdata, &err)) {
+      // Report error but continue processing other files
+      OV_ERROR_REPORT(&err, NULL);
+      continue;
+    }
+
+    // If path changed, update the file list
+    if (wcscmp(file->path, managed_path) != 0) {
+      // The managed file may have just been created, and a temporary source is about to go away
+      gcmz_access_cache_invalidate(d->access_cache, managed_path);
+      gcmz_access_cache_invalidate(d->access_cache, file->path);
+      // If the old path was temporary, clean it up before replacing
+      if (file->temporary && d->cleanup) {
+        struct ov_error cleanup_err = {0};
+        if (!d->cleanup(file->path, d->userdata, &cleanup_err)) {
+          OV_ERROR_REPORT(&cleanup_err, NULL);
+        }
+      }
+      if (!gcmz_file_list_set_path(file_list, i, managed_path, &err)) {
+        OV_ERROR_REPORT(&err, NULL);
+      } else {
+        file->temporary = false;
+      }
+    }
+    OV_ARRAY_DESTROY(&managed_path);
+  }
+  gcmz_trace_record("file_manage", start);
+}
+
 static void cleanup_current_entry(struct wrapped_drop_target *const wdt) {
   if (!wdt) {
     return;
   }
   struct gcmz_drop *d = wdt->d;
+  speculation_destroy(&wdt->speculation);
+  gcmz_dir_expand_destroy(&wdt->expansion);
   if (wdt->shared_placeholder_path && d && d->cleanup) {
     struct ov_error err = {0};
     if (!d->cleanup(wdt->shared_placeholder_path, d->userdata, &err)) {
@@ -573,20 +929,28 @@ static void cleanup_current_entry(struct wrapped_drop_target *const wdt) {
     OV_ARRAY_DESTROY(&wdt->shared_placeholder_path);
   }
 
-  if (wdt->placeholder_cache) {
-    size_t const count = OV_ARRAY_LENGTH(wdt->placeholder_cache);
-    for (size_t i = 0; i < count; i++) {
-      struct placeholder_entry *entry = &wdt->placeholder_cache[i];
-      if (entry->path) {
-        OV_ARRAY_DESTROY(&entry->path);
-      }
-    }
-    OV_ARRAY_DESTROY(&wdt->placeholder_cache);
-  }
-
   cleanup_temporary_files_in_list(wdt->d, wdt->current_file_list);
   gcmz_file_list_destroy(&wdt->current_file_list);
 
+  // Everything the drag session allocated from the arena is unreachable now
+#if GCMZ_DEBUG
+  if (wdt->gesture_arena) {
+    struct gcmz_arena_stats stats;
+    gcmz_arena_get_stats(wdt->gesture_arena, &stats);
+    wchar_t debug_msg[256];
+    ov_snprintf_wchar(debug_msg,
+                      256,
+                      NULL,
+                      L"cleanup_current_entry: gesture arena served %zu allocations (%zu bytes) "
+                      L"with %zu heap allocations\n",
+                      stats.allocations,
+                      stats.bytes,
+                      stats.heap_allocations);
+    OutputDebugStringW(debug_msg);
+  }
+#endif
+  gcmz_arena_reset(wdt->gesture_arena);
+
   if (wdt->current_original) {
     IDataObject_Release(wdt->current_original);
     wdt->current_original = NULL;
@@ -645,6 +1009,7 @@ static ULONG STDMETHODCALLTYPE wrapped_drop_target_release(IDropTarget *const Th
     LeaveCriticalSection(&d->targets_cs);
 
     cleanup_current_entry(impl);
+    gcmz_arena_destroy(&impl->gesture_arena);
     DeleteCriticalSection(&impl->cs);
     if (impl->original) {
       IDropTarget_Release(impl->original);
@@ -679,11 +1044,15 @@ static IDataObject *prepare_drag_enter_dataobj(struct wrapped_drop_target *const
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
+    // Walks the folders while the cursor hovers, the drop waits for the result
+    wdt->expansion = start_expansion(d, file_list);
     if (d->drag_enter) {
+      uint64_t const start = gcmz_trace_now();
       if (!d->drag_enter(file_list, grfKeyState, capture_modifier_keys(), false, d->userdata, err)) {
         gcmz_logf_warn(err, "%1$s", gettext("error occurred while executing %1$s script handler"), "drag_enter");
         OV_ERROR_DESTROY(err);
       }
+      gcmz_trace_record("drag_enter_hook", start);
     }
     replacement_dataobj = create_dataobj_with_placeholders(wdt, file_list, pt.x, pt.y, err);
     if (!replacement_dataobj) {
@@ -697,6 +1066,14 @@ static IDataObject *prepare_drag_enter_dataobj(struct wrapped_drop_target *const
     wdt->current_file_list = file_list;
     file_list = NULL;
 
+    if (d->file_manage) {
+      struct ov_error spec_err = {0};
+      if (!speculation_start(d, wdt->current_file_list, &wdt->speculation, &spec_err)) {
+        // Not fatal, drop processes the files itself
+        OV_ERROR_REPORT(&spec_err, NULL);
+      }
+    }
+
     result = replacement_dataobj;
     replacement_dataobj = NULL;
   }
@@ -744,11 +1121,15 @@ static HRESULT STDMETHODCALLTYPE wrapped_drop_target_drag_enter(
   struct ov_error err = {0};
   bool success = false;
 
+  uint64_t const start = gcmz_trace_now();
+  gcmz_trace_begin_gesture();
+
   if (!pDataObj || !pdwEffect) {
     OV_ERROR_SET_GENERIC(&err, ov_error_generic_invalid_argument);
     goto cleanup;
   }
   replacement_dataobj = prepare_drag_enter_dataobj(impl, pDataObj, pt, grfKeyState, &err);
+  gcmz_trace_record("prepare_drag_enter", start);
   if (!replacement_dataobj) {
     if (ov_error_is(&err, ov_error_type_generic, ov_error_generic_not_found)) {
       // No files extracted, proceed with original data object
@@ -767,7 +1148,12 @@ cleanup:
     OV_ERROR_DESTROY(&err);
   }
 
-  hr = IDropTarget_DragEnter(impl->original, data_to_use, grfKeyState, pt, pdwEffect);
+  {
+    uint64_t const forward_start = gcmz_trace_now();
+    hr = IDropTarget_DragEnter(impl->original, data_to_use, grfKeyState, pt, pdwEffect);
+    gcmz_trace_record("forward_drag_enter", forward_start);
+  }
+  gcmz_trace_record("drag_enter", start);
 
 #if GCMZ_DEBUG
   ov_snprintf_wchar(debug_msg,
@@ -875,10 +1261,16 @@ static IDataObject *prepare_drop_dataobj(struct wrapped_drop_target *const wdt,
 
   struct gcmz_file_list *file_list = NULL;
   IDataObject *replacement_dataobj = NULL;
-  wchar_t *managed_path = NULL;
+  struct speculation *speculation = NULL;
+  struct gcmz_dir_expand *expansion = NULL;
   IDataObject *result = NULL;
 
   EnterCriticalSection(&wdt->cs);
+  // Keep the work started at drag enter, everything else of the session is discarded
+  speculation = wdt->speculation;
+  wdt->speculation = NULL;
+  expansion = wdt->expansion;
+  wdt->expansion = NULL;
   cleanup_current_entry(wdt);
 
   {
@@ -887,44 +1279,21 @@ static IDataObject *prepare_drop_dataobj(struct wrapped_drop_target *const wdt,
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
+    if (!expansion) {
+      expansion = start_expansion(d, file_list);
+    }
+    finish_expansion(d, &expansion, file_list);
     if (d->drop) {
+      uint64_t const start = gcmz_trace_now();
       if (!d->drop(file_list, grfKeyState, capture_modifier_keys(), false, d->userdata, err)) {
         gcmz_logf_warn(err, "%1$s", gettext("error occurred while executing %1$s script handler"), "drop");
         OV_ERROR_DESTROY(err);
       }
+      gcmz_trace_record("drop_hook", start);
     }
-    if (d->file_manage) {
-      size_t const file_count = gcmz_file_list_count(file_list);
-      for (size_t i = 0; i < file_count; i++) {
-        struct gcmz_file *file = gcmz_file_list_get_mutable(file_list, i);
-        if (!file || !file->path) {
-          continue;
-        }
-
-        managed_path = NULL;
-        if (!d->file_manage(file->path, &managed_path, d->userdata, err)) {
-          // Report error but continue processing other files
-          OV_ERROR_REPORT(err, NULL);
-          continue;
-        }
-
-        // If path changed, update the file list
-        if (wcscmp(file->path, managed_path) != 0) {
-          // If the old path was temporary, clean it up before replacing
-          if (file->temporary && d->cleanup) {
-            struct ov_error cleanup_err = {0};
-            if (!d->cleanup(file->path, d->userdata, &cleanup_err)) {
-              OV_ERROR_REPORT(&cleanup_err, NULL);
-            }
-          }
-          OV_ARRAY_DESTROY(&file->path);
-          file->path = managed_path;
-          managed_path = NULL;
-          file->temporary = false;
-        } else {
-          OV_ARRAY_DESTROY(&managed_path);
-        }
-      }
+    manage_files(d, file_list, speculation, false);
+    if (collapse_sequences(d, file_list)) {
+      manage_files(d, file_list, NULL, true);
     }
 
     replacement_dataobj = create_dataobj_with_placeholders(wdt, file_list, pt.x, pt.y, err);
@@ -946,9 +1315,8 @@ static IDataObject *prepare_drop_dataobj(struct wrapped_drop_target *const wdt,
 
 cleanup:
   LeaveCriticalSection(&wdt->cs);
-  if (managed_path) {
-    OV_ARRAY_DESTROY(&managed_path);
-  }
+  speculation_destroy(&speculation);
+  gcmz_dir_expand_destroy(&expansion);
   if (file_list) {
     gcmz_file_list_destroy(&file_list);
   }
@@ -1004,8 +1372,11 @@ wrapped_drop_target_drop(IDropTarget *This, IDataObject *pDataObj, DWORD grfKeyS
   IDataObject *data_to_use = pDataObj;
   HRESULT hr = E_FAIL;
   struct ov_error err = {0};
+  uint64_t const start = gcmz_trace_now();
+  uint64_t forward_start = 0;
 
   replacement_dataobj = prepare_drop_dataobj(impl, pDataObj, pt, grfKeyState, &err);
+  gcmz_trace_record("prepare_drop", start);
   if (!replacement_dataobj) {
 #if GCMZ_DEBUG
     OutputDebugStringW(L"wrapped_drop_target_drop: No replacement, passing through original\n");
@@ -1029,6 +1400,7 @@ wrapped_drop_target_drop(IDropTarget *This, IDataObject *pDataObj, DWORD grfKeyS
   OutputDebugStringW(L"wrapped_drop_target_drop: Executing Leave->Enter->Over->Drop sequence\n");
 #endif
 
+  forward_start = gcmz_trace_now();
   hr = IDropTarget_DragLeave(impl->original);
 #if GCMZ_DEBUG
   ov_snprintf_wchar(debug_msg, 256, NULL, L"wrapped_drop_target_drop: DragLeave returned hr=0x%08x\n", hr);
@@ -1077,6 +1449,10 @@ wrapped_drop_target_drop(IDropTarget *This, IDataObject *pDataObj, DWORD grfKeyS
   hr = IDropTarget_Drop(impl->original, data_to_use, grfKeyState, pt, pdwEffect);
 
 cleanup:
+  if (forward_start) {
+    gcmz_trace_record("forward_drop", forward_start);
+  }
+  gcmz_trace_record("drop", start);
 
   if (replacement_dataobj) {
     IDataObject_Release(replacement_dataobj);
@@ -1109,16 +1485,27 @@ struct gcmz_drop *gcmz_drop_create(struct gcmz_drop_options const *const options
         .drag_enter = options->drag_enter,
         .drop = options->drop,
         .drag_leave = options->drag_leave,
+        .expand_directories = options->expand_directories,
+        .collapse_sequences = options->collapse_sequences,
         .userdata = options->userdata,
     };
 
     InitializeCriticalSection(&d->targets_cs);
+    InitializeCriticalSection(&d->speculations_cs);
+    InitializeConditionVariable(&d->speculations_finished);
+
+    if (!gcmz_access_cache_create(&d->access_cache, access_cache_ttl_ms, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
 
     result = true;
   }
 
 cleanup:
   if (!result && d) {
+    gcmz_access_cache_destroy(&d->access_cache);
+    DeleteCriticalSection(&d->speculations_cs);
     DeleteCriticalSection(&d->targets_cs);
     OV_FREE(&d);
   }
@@ -1142,10 +1529,19 @@ void gcmz_drop_destroy(struct gcmz_drop **const d) {
   }
   LeaveCriticalSection(&c->targets_cs);
 
+  // Cancelled speculations may still be winding down on their workers
+  EnterCriticalSection(&c->speculations_cs);
+  while (c->speculations > 0) {
+    SleepConditionVariableCS(&c->speculations_finished, &c->speculations_cs, INFINITE);
+  }
+  LeaveCriticalSection(&c->speculations_cs);
+
 #if GCMZ_DEBUG
   OutputDebugStringW(L"gcmz_drop_destroy: Drop system cleaned up successfully\n");
 #endif
 
+  gcmz_access_cache_destroy(&c->access_cache);
+  DeleteCriticalSection(&c->speculations_cs);
   DeleteCriticalSection(&c->targets_cs);
   OV_FREE(d);
 }
@@ -1312,7 +1708,6 @@ bool gcmz_drop_simulate_drop(struct gcmz_drop *const d,
   }
 
   bool result = false;
-  wchar_t *managed_path = NULL;
 
   {
     // Step 1: EXO conversion (if enabled)
@@ -1331,6 +1726,11 @@ bool gcmz_drop_simulate_drop(struct gcmz_drop *const d,
       goto cleanup;
     }
 
+    {
+      struct gcmz_dir_expand *expansion = start_expansion(d, file_list);
+      finish_expansion(d, &expansion, file_list);
+    }
+
     // Step 2: Call Lua handlers in sequence (Enter → Drop)
     if (d->drag_enter) {
       if (!d->drag_enter(file_list, 0, 0, true, d->userdata, err)) {
@@ -1346,36 +1746,9 @@ bool gcmz_drop_simulate_drop(struct gcmz_drop *const d,
     }
 
     // Step 3: Apply file management (copying, etc.)
-    if (d->file_manage) {
-      size_t const file_count = gcmz_file_list_count(file_list);
-      for (size_t i = 0; i < file_count; i++) {
-        struct gcmz_file *file = gcmz_file_list_get_mutable(file_list, i);
-        if (!file || !file->path) {
-          continue;
-        }
-
-        if (!d->file_manage(file->path, &managed_path, d->userdata, err)) {
-          // Report error but continue processing other files
-          OV_ERROR_REPORT(err, NULL);
-          continue;
-        }
-
-        // If path changed, update the file list
-        if (wcscmp(file->path, managed_path) != 0) {
-          // If the old path was temporary, clean it up before replacing
-          if (file->temporary && d->cleanup) {
-            struct ov_error cleanup_err = {0};
-            if (!d->cleanup(file->path, d->userdata, &cleanup_err)) {
-              OV_ERROR_REPORT(&cleanup_err, NULL);
-            }
-          }
-          wchar_t *old_path = file->path;
-          file->path = managed_path;
-          managed_path = old_path; // Will be freed in cleanup
-          file->temporary = false;
-        }
-        OV_ARRAY_DESTROY(&managed_path);
-      }
+    manage_files(d, file_list, NULL, false);
+    if (collapse_sequences(d, file_list)) {
+      manage_files(d, file_list, NULL, true);
     }
 
     // Step 4: Call completion callback with processed file list
@@ -1384,8 +1757,5 @@ bool gcmz_drop_simulate_drop(struct gcmz_drop *const d,
   result = true;
 
 cleanup:
-  if (managed_path) {
-    OV_ARRAY_DESTROY(&managed_path);
-  }
   return result;
 }
@@ -32,14 +32,22 @@ typedef bool (*gcmz_drop_cleanup_temp_file_fn)(wchar_t const *const path, void *
 /**
  * @brief File management callback
  *
+ * Also called speculatively on a worker thread while the cursor hovers, so it must be thread-safe.
+ * The result may go unused if the drag is cancelled or the drop handler changes the files,
+ * in which case a file reported as created is handed to the cleanup callback.
+ *
  * @param source_file Source file path to process
+ * @param cancel Processing should stop as soon as possible when this becomes non-zero (can be NULL)
  * @param final_file [out] Final file path (caller must OV_ARRAY_DESTROY)
+ * @param created [out] Set to true if final_file is a new file made by this call (can be NULL)
  * @param userdata User data passed to the function
  * @param err [out] Error information on failure
  * @return true on success, false on failure
  */
 typedef bool (*gcmz_drop_file_manage_fn)(wchar_t const *source_file,
+                                         long volatile *cancel,
                                          wchar_t **final_file,
+                                         bool *created,
                                          void *userdata,
                                          struct ov_error *const err);
 
@@ -106,18 +114,48 @@ typedef bool (*gcmz_drop_drop_fn)(struct gcmz_file_list *file_list,
  */
 typedef bool (*gcmz_drop_drag_leave_fn)(void *userdata, struct ov_error *const err);
 
+/**
+ * @brief Folder expansion callback
+ *
+ * Called when a drag enters and when files are dropped, to decide whether dropped folders
+ * are replaced by the files inside before the script handlers see them.
+ *
+ * @param extensions [out] Semicolon-separated extensions of the files to take (caller must OV_ARRAY_DESTROY),
+ *                   left NULL to take every file
+ * @param userdata User data passed to the function
+ * @param err [out] Error information on failure
+ * @return ov_true to expand folders, ov_false to leave them as they are, ov_indeterminate on error
+ */
+typedef ov_tribool (*gcmz_drop_expand_directories_fn)(wchar_t **extensions,
+                                                      void *userdata,
+                                                      struct ov_error *const err);
+
+/**
+ * @brief Image sequence collapsing callback
+ *
+ * Called when files are dropped, after file management, to decide whether numbered image sequences
+ * are replaced by a single sequence object.
+ *
+ * @param userdata User data passed to the function
+ * @param err [out] Error information on failure
+ * @return ov_true to collapse sequences, ov_false to leave them as they are, ov_indeterminate on error
+ */
+typedef ov_tribool (*gcmz_drop_collapse_sequences_fn)(void *userdata, struct ov_error *const err);
+
 /**
  * @brief Options for drop context creation
  */
 struct gcmz_drop_options {
-  gcmz_drop_dataobj_extract_fn extract;   ///< Required: Data object extraction function
-  gcmz_drop_cleanup_temp_file_fn cleanup; ///< Required: Temporary file cleanup function
-  gcmz_drop_file_manage_fn file_manage;   ///< Optional: File management function
-  gcmz_drop_exo_convert_fn exo_convert;   ///< Optional: EXO conversion callback
-  gcmz_drop_drag_enter_fn drag_enter;     ///< Optional: Drag enter callback
-  gcmz_drop_drop_fn drop;                 ///< Optional: Drop callback
-  gcmz_drop_drag_leave_fn drag_leave;     ///< Optional: Drag leave callback
-  void *userdata;                         ///< User data passed to all callbacks
+  gcmz_drop_dataobj_extract_fn extract;               ///< Required: Data object extraction function
+  gcmz_drop_cleanup_temp_file_fn cleanup;             ///< Required: Temporary file cleanup function
+  gcmz_drop_file_manage_fn file_manage;               ///< Optional: File management function
+  gcmz_drop_exo_convert_fn exo_convert;               ///< Optional: EXO conversion callback
+  gcmz_drop_drag_enter_fn drag_enter;                 ///< Optional: Drag enter callback
+  gcmz_drop_drop_fn drop;                             ///< Optional: Drop callback
+  gcmz_drop_drag_leave_fn drag_leave;                 ///< Optional: Drag leave callback
+  gcmz_drop_expand_directories_fn expand_directories; ///< Optional: Folder expansion callback
+  gcmz_drop_collapse_sequences_fn collapse_sequences; ///< Optional: Image sequence collapsing callback
+  void *userdata;                                     ///< User data passed to all callbacks
 };
 
 /**
@@ -10,9 +10,14 @@
 
 #include <ole2.h>
 
+#include <ovarray.h>
 #include <ovprintf.h>
 
+#include <string.h>
+
 #include "drop.h"
+#include "file.h"
+#include "temp.h"
 
 struct test_drop_target {
   IDropTarget vtbl;
@@ -111,6 +116,177 @@ static bool mock_cleanup_temp_files(wchar_t const *const path, void *userdata, s
   return true;
 }
 
+struct sequence_state {
+  wchar_t *managed_dir;
+  bool collapse;
+  size_t manage_calls;
+  size_t completed_files;
+  bool object_found;
+  char object_content[4096];
+};
+
+// Copies into a separate folder under the same name, like a save folder would
+static bool mock_file_manage(wchar_t const *source_file,
+                             long volatile *cancel,
+                             wchar_t **final_file,
+                             bool *created,
+                             void *userdata,
+                             struct ov_error *const err) {
+  (void)cancel;
+  struct sequence_state *const state = (struct sequence_state *)userdata;
+  ++state->manage_calls;
+  wchar_t const *const name = wcsrchr(source_file, L'\\') + 1;
+  size_t const len = wcslen(state->managed_dir) + 1 + wcslen(name);
+  if (!OV_ARRAY_GROW(final_file, len + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  ov_snprintf_wchar(*final_file, len + 1, NULL, L"%ls\\%ls", state->managed_dir, name);
+  OV_ARRAY_SET_LENGTH(*final_file, len);
+  if (!CopyFileW(source_file, *final_file, FALSE)) {
+    OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+    OV_ARRAY_DESTROY(final_file);
+    return false;
+  }
+  if (created) {
+    *created = true;
+  }
+  return true;
+}
+
+static ov_tribool mock_collapse_sequences(void *userdata, struct ov_error *const err) {
+  (void)err;
+  struct sequence_state const *const state = (struct sequence_state const *)userdata;
+  return state->collapse ? ov_true : ov_false;
+}
+
+static void sequence_completion(struct gcmz_file_list const *file_list, void *userdata) {
+  struct sequence_state *const state = (struct sequence_state *)userdata;
+  state->completed_files = gcmz_file_list_count(file_list);
+  struct gcmz_file const *const file = gcmz_file_list_get(file_list, 0);
+  wchar_t const *const ext = file ? wcsrchr(file->path, L'.') : NULL;
+  if (!ext || wcscmp(ext, L".object") != 0) {
+    return;
+  }
+  if (wcsncmp(file->path, state->managed_dir, wcslen(state->managed_dir)) != 0) {
+    return;
+  }
+  HANDLE h = CreateFileW(file->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  DWORD read = 0;
+  if (ReadFile(h, state->object_content, sizeof(state->object_content) - 1, &read, NULL)) {
+    state->object_content[read] = '\0';
+    state->object_found = true;
+  }
+  CloseHandle(h);
+}
+
+static struct gcmz_file_list *create_frames(struct ov_error *const err) {
+  struct gcmz_file_list *list = gcmz_file_list_create(err);
+  wchar_t *path = NULL;
+  if (!list) {
+    return NULL;
+  }
+  for (int i = 1; i <= 32; ++i) {
+    wchar_t name[64];
+    ov_snprintf_wchar(name, 64, NULL, L"frame_%04d.png", i);
+    if (!gcmz_temp_build_path(&path, name, err)) {
+      goto failed;
+    }
+    HANDLE h = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) {
+      OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+      goto failed;
+    }
+    CloseHandle(h);
+    if (!gcmz_file_list_add(list, path, NULL, err)) {
+      goto failed;
+    }
+    OV_ARRAY_DESTROY(&path);
+  }
+  return list;
+
+failed:
+  if (path) {
+    OV_ARRAY_DESTROY(&path);
+  }
+  gcmz_file_list_destroy(&list);
+  return NULL;
+}
+
+static void test_drop_simulate_sequences(void) {
+  struct gcmz_drop *d = NULL;
+  struct gcmz_file_list *list = NULL;
+  struct sequence_state state = {0};
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_temp_create_directory(&err), &err)) {
+    return;
+  }
+  if (!TEST_SUCCEEDED(gcmz_temp_build_path(&state.managed_dir, L"managed", &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_CHECK(CreateDirectoryW(state.managed_dir, NULL))) {
+    goto cleanup;
+  }
+  d = gcmz_drop_create(
+      &(struct gcmz_drop_options){
+          .extract = mock_dataobj_extract,
+          .cleanup = mock_cleanup_temp_files,
+          .file_manage = mock_file_manage,
+          .collapse_sequences = mock_collapse_sequences,
+          .userdata = &state,
+      },
+      &err);
+  if (!TEST_SUCCEEDED(d != NULL, &err)) {
+    goto cleanup;
+  }
+
+  TEST_CASE("disabled by default");
+  {
+    list = create_frames(&err);
+    if (!TEST_SUCCEEDED(list != NULL, &err)) {
+      goto cleanup;
+    }
+    if (TEST_SUCCEEDED(gcmz_drop_simulate_drop(d, list, false, sequence_completion, &state, &err), &err)) {
+      TEST_CHECK(state.completed_files == 32);
+      TEST_CHECK(state.manage_calls == 32);
+      TEST_CHECK(!state.object_found);
+    }
+    gcmz_file_list_destroy(&list);
+  }
+
+  TEST_CASE("collapsed frames are managed");
+  {
+    state.collapse = true;
+    state.manage_calls = 0;
+    list = create_frames(&err);
+    if (!TEST_SUCCEEDED(list != NULL, &err)) {
+      goto cleanup;
+    }
+    if (TEST_SUCCEEDED(gcmz_drop_simulate_drop(d, list, false, sequence_completion, &state, &err), &err)) {
+      TEST_CHECK(state.completed_files == 1);
+      // Every frame, then the generated object
+      TEST_CHECK(state.manage_calls == 33);
+      if (TEST_CHECK(state.object_found)) {
+        TEST_CHECK(strstr(state.object_content, "\\managed\\frame_0001.png\r\n") != NULL);
+        TEST_MSG("got: %s", state.object_content);
+      }
+    }
+    gcmz_file_list_destroy(&list);
+  }
+
+cleanup:
+  gcmz_file_list_destroy(&list);
+  gcmz_drop_destroy(&d);
+  if (state.managed_dir) {
+    OV_ARRAY_DESTROY(&state.managed_dir);
+  }
+  gcmz_temp_remove_directory();
+}
+
 static void test_drop_null_safety(void) {
   struct ov_error err = {0};
   gcmz_drop_destroy(NULL);
@@ -185,5 +361,6 @@ cleanup:
 TEST_LIST = {
     {"drop_null_safety", test_drop_null_safety},
     {"drop_real_com_integration", test_drop_real_com_integration},
+    {"drop_simulate_sequences", test_drop_simulate_sequences},
     {NULL, NULL},
 };
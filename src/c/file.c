@@ -1,13 +1,54 @@
 #include "file.h"
 
 #include <ovarray.h>
+#include <ovhashmap.h>
+#include <ovutf.h>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
 #include <wchar.h>
 
+#include "arena.h"
+
+enum {
+  own_arena_chunk_size = 4096,
+};
+
+/**
+ * @brief Derived forms of an entry's path, computed on demand and kept in the arena
+ */
+struct file_cache {
+  wchar_t const *folded; ///< Case-folded path used as the index key
+  size_t folded_len;
+  char const *path_utf8;
+};
+
+struct file_index_item {
+  wchar_t const *key;
+  size_t key_bytes;
+  size_t pos; ///< Position of the first entry with this path
+};
+
 struct gcmz_file_list {
   struct gcmz_file *files;
+  struct file_cache *caches; ///< Parallel to files
+  struct gcmz_arena *arena;  ///< Storage for path and mime_type strings and their cached forms
+  struct ov_hashmap *index;  ///< Built on the first lookup, dropped when positions or paths change
+  wchar_t *fold_buffer;      ///< Case-folded lookup key
+  bool owns_arena;
 };
 
-struct gcmz_file_list *gcmz_file_list_create(struct ov_error *const err) {
+static void get_key_from_file_index_item(void const *const item, void const **const key, size_t *const key_bytes) {
+  struct file_index_item const *const i = (struct file_index_item const *)item;
+  *key = i->key;
+  *key_bytes = i->key_bytes;
+}
+
+static struct gcmz_file_list *file_list_create(struct gcmz_arena *const arena, struct ov_error *const err) {
   struct gcmz_file_list *new_list = NULL;
   struct gcmz_file_list *result = NULL;
 
@@ -17,7 +58,10 @@ struct gcmz_file_list *gcmz_file_list_create(struct ov_error *const err) {
       goto cleanup;
     }
 
-    new_list->files = NULL;
+    *new_list = (struct gcmz_file_list){
+        .arena = arena,
+        .owns_arena = !arena,
+    };
     result = new_list;
     new_list = NULL;
   }
@@ -29,6 +73,54 @@ cleanup:
   return result;
 }
 
+struct gcmz_file_list *gcmz_file_list_create(struct ov_error *const err) {
+  struct gcmz_file_list *const result = file_list_create(NULL, err);
+  if (!result) {
+    OV_ERROR_ADD_TRACE(err);
+  }
+  return result;
+}
+
+struct gcmz_file_list *gcmz_file_list_create_with_arena(struct gcmz_arena *const arena, struct ov_error *const err) {
+  if (!arena) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return NULL;
+  }
+  struct gcmz_file_list *const result = file_list_create(arena, err);
+  if (!result) {
+    OV_ERROR_ADD_TRACE(err);
+  }
+  return result;
+}
+
+static NODISCARD bool file_list_ensure_arena(struct gcmz_file_list *const list, struct ov_error *const err) {
+  if (!list->arena && !gcmz_arena_create(&list->arena, own_arena_chunk_size, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  return true;
+}
+
+static wchar_t *file_list_copy_string(struct gcmz_file_list *const list,
+                                      wchar_t const *const src,
+                                      struct ov_error *const err) {
+  if (!file_list_ensure_arena(list, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return NULL;
+  }
+  wchar_t *const result = gcmz_arena_wcsdup(list->arena, src, err);
+  if (!result) {
+    OV_ERROR_ADD_TRACE(err);
+  }
+  return result;
+}
+
+static void file_list_drop_index(struct gcmz_file_list *const list) {
+  if (list->index) {
+    OV_HASHMAP_DESTROY(&list->index);
+  }
+}
+
 void gcmz_file_list_destroy(struct gcmz_file_list **const list) {
   if (!list || !*list) {
     return;
@@ -36,21 +128,100 @@ void gcmz_file_list_destroy(struct gcmz_file_list **const list) {
 
   struct gcmz_file_list *l = *list;
   if (l->files) {
-    size_t const count = OV_ARRAY_LENGTH(l->files);
-    for (size_t i = 0; i < count; i++) {
-      if (l->files[i].path) {
-        OV_ARRAY_DESTROY(&l->files[i].path);
-      }
-      if (l->files[i].mime_type) {
-        OV_ARRAY_DESTROY(&l->files[i].mime_type);
-      }
-    }
     OV_ARRAY_DESTROY(&l->files);
   }
+  if (l->caches) {
+    OV_ARRAY_DESTROY(&l->caches);
+  }
+  file_list_drop_index(l);
+  if (l->fold_buffer) {
+    OV_ARRAY_DESTROY(&l->fold_buffer);
+  }
+  if (l->owns_arena) {
+    gcmz_arena_destroy(&l->arena);
+  }
 
   OV_FREE((void **)list);
 }
 
+/**
+ * @brief Case-fold a path the way the file system compares names
+ */
+static void fold_path(wchar_t *const path, size_t const len) {
+  if (len) {
+    CharUpperBuffW(path, (DWORD)len);
+  }
+}
+
+/**
+ * @brief Get the case-folded form of an entry's path, folding it on first use
+ */
+static struct file_cache const *
+file_list_get_folded(struct gcmz_file_list *const list, size_t const pos, struct ov_error *const err) {
+  struct file_cache *const c = &list->caches[pos];
+  if (c->folded) {
+    return c;
+  }
+  size_t const len = wcslen(list->files[pos].path);
+  wchar_t *const folded =
+      (wchar_t *)gcmz_arena_alloc(list->arena, (len + 1) * sizeof(wchar_t), alignof(wchar_t), err);
+  if (!folded) {
+    OV_ERROR_ADD_TRACE(err);
+    return NULL;
+  }
+  memcpy(folded, list->files[pos].path, (len + 1) * sizeof(wchar_t));
+  fold_path(folded, len);
+  c->folded = folded;
+  c->folded_len = len;
+  return c;
+}
+
+/**
+ * @brief Add an entry to the index unless an earlier entry has the same path
+ */
+static NODISCARD bool
+file_list_index_entry(struct gcmz_file_list *const list, size_t const pos, struct ov_error *const err) {
+  struct file_cache const *const c = file_list_get_folded(list, pos, err);
+  if (!c) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  struct file_index_item const item = {
+      .key = c->folded,
+      .key_bytes = c->folded_len * sizeof(wchar_t),
+      .pos = pos,
+  };
+  if (OV_HASHMAP_GET(list->index, &item)) {
+    return true;
+  }
+  if (!OV_HASHMAP_SET(list->index, &item)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  return true;
+}
+
+static NODISCARD bool file_list_build_index(struct gcmz_file_list *const list, struct ov_error *const err) {
+  if (list->index) {
+    return true;
+  }
+  size_t const count = OV_ARRAY_LENGTH(list->files);
+  list->index = OV_HASHMAP_CREATE_DYNAMIC(
+      sizeof(struct file_index_item), count < 16 ? 16 : count * 2, get_key_from_file_index_item);
+  if (!list->index) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!file_list_index_entry(list, i, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      file_list_drop_index(list);
+      return false;
+    }
+  }
+  return true;
+}
+
 static NODISCARD bool file_list_add(struct gcmz_file_list *const list,
                                     wchar_t const *const path,
                                     wchar_t const *const mime_type,
@@ -61,49 +232,43 @@ static NODISCARD bool file_list_add(struct gcmz_file_list *const list,
     return false;
   }
 
+  // Strings are not freed on failure, they are released with the arena
   struct gcmz_file file = {
       .temporary = temporary,
   };
-  bool result = false;
 
-  {
-    size_t const path_len = wcslen(path);
-    if (!OV_ARRAY_GROW(&file.path, path_len + 1)) {
-      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-      goto cleanup;
-    }
-    wcscpy(file.path, path);
-
-    if (mime_type) {
-      size_t const mime_len = wcslen(mime_type);
-      if (!OV_ARRAY_GROW(&file.mime_type, mime_len + 1)) {
-        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-        goto cleanup;
-      }
-      wcscpy(file.mime_type, mime_type);
-    }
-
-    size_t const index = OV_ARRAY_LENGTH(list->files);
-    if (!OV_ARRAY_GROW(&list->files, index + 1)) {
-      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-      goto cleanup;
+  file.path = file_list_copy_string(list, path, err);
+  if (!file.path) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  if (mime_type) {
+    file.mime_type = file_list_copy_string(list, mime_type, err);
+    if (!file.mime_type) {
+      OV_ERROR_ADD_TRACE(err);
+      return false;
     }
-    OV_ARRAY_SET_LENGTH(list->files, index + 1);
-
-    list->files[index] = file;
-    file = (struct gcmz_file){0};
   }
 
-  result = true;
-
-cleanup:
-  if (file.path) {
-    OV_ARRAY_DESTROY(&file.path);
+  size_t const index = OV_ARRAY_LENGTH(list->files);
+  if (!OV_ARRAY_GROW(&list->files, index + 1) || !OV_ARRAY_GROW(&list->caches, index + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
   }
-  if (file.mime_type) {
-    OV_ARRAY_DESTROY(&file.mime_type);
+  OV_ARRAY_SET_LENGTH(list->files, index + 1);
+  OV_ARRAY_SET_LENGTH(list->caches, index + 1);
+  list->files[index] = file;
+  list->caches[index] = (struct file_cache){0};
+
+  if (list->index) {
+    struct ov_error index_err = {0};
+    if (!file_list_index_entry(list, index, &index_err)) {
+      // The entry is valid, only the index is out of date; rebuild it on the next lookup
+      OV_ERROR_DESTROY(&index_err);
+      file_list_drop_index(list);
+    }
   }
-  return result;
+  return true;
 }
 
 NODISCARD bool gcmz_file_list_add(struct gcmz_file_list *const list,
@@ -138,21 +303,111 @@ gcmz_file_list_remove(struct gcmz_file_list *const list, size_t const index, str
     return false;
   }
 
-  if (list->files[index].path) {
-    OV_ARRAY_DESTROY(&list->files[index].path);
-  }
-  if (list->files[index].mime_type) {
-    OV_ARRAY_DESTROY(&list->files[index].mime_type);
-  }
-
   for (size_t j = index; j < count - 1; j++) {
     list->files[j] = list->files[j + 1];
+    list->caches[j] = list->caches[j + 1];
   }
   OV_ARRAY_SET_LENGTH(list->files, count - 1);
+  OV_ARRAY_SET_LENGTH(list->caches, count - 1);
+  file_list_drop_index(list);
 
   return true;
 }
 
+NODISCARD bool gcmz_file_list_set_path(struct gcmz_file_list *const list,
+                                       size_t const index,
+                                       wchar_t const *const path,
+                                       struct ov_error *const err) {
+  if (!list || !path || !list->files || index >= OV_ARRAY_LENGTH(list->files)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  wchar_t *const copy = file_list_copy_string(list, path, err);
+  if (!copy) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  list->files[index].path = copy;
+  list->caches[index] = (struct file_cache){0};
+  file_list_drop_index(list);
+  return true;
+}
+
+NODISCARD bool gcmz_file_list_find(struct gcmz_file_list *const list,
+                                   wchar_t const *const path,
+                                   size_t *const index,
+                                   struct ov_error *const err) {
+  if (!list || !path || !index) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  *index = SIZE_MAX;
+  if (!list->files || OV_ARRAY_LENGTH(list->files) == 0) {
+    return true;
+  }
+  if (!file_list_build_index(list, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  size_t const len = wcslen(path);
+  if (!OV_ARRAY_GROW(&list->fold_buffer, len + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  memcpy(list->fold_buffer, path, (len + 1) * sizeof(wchar_t));
+  fold_path(list->fold_buffer, len);
+  struct file_index_item const *const item =
+      (struct file_index_item const *)OV_HASHMAP_GET(list->index,
+                                                     &((struct file_index_item const){
+                                                         .key = list->fold_buffer,
+                                                         .key_bytes = len * sizeof(wchar_t),
+                                                     }));
+  if (item) {
+    *index = item->pos;
+  }
+  return true;
+}
+
+char const *
+gcmz_file_list_get_path_utf8(struct gcmz_file_list *const list, size_t const index, struct ov_error *const err) {
+  if (!list || !list->files || index >= OV_ARRAY_LENGTH(list->files)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return NULL;
+  }
+  struct file_cache *const c = &list->caches[index];
+  if (c->path_utf8) {
+    return c->path_utf8;
+  }
+  wchar_t const *const path = list->files[index].path;
+  size_t const src_len = wcslen(path);
+  size_t const len = src_len ? ov_wchar_to_utf8_len(path, src_len) : 0;
+  if (src_len && !len) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    return NULL;
+  }
+  char *const utf8 = (char *)gcmz_arena_alloc(list->arena, len + 1, 1, err);
+  if (!utf8) {
+    OV_ERROR_ADD_TRACE(err);
+    return NULL;
+  }
+  if (len && ov_wchar_to_utf8(path, src_len, utf8, len + 1, NULL) == 0) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    return NULL;
+  }
+  utf8[len] = '\0';
+  c->path_utf8 = utf8;
+  return utf8;
+}
+
+void gcmz_file_list_swap(struct gcmz_file_list *const a, struct gcmz_file_list *const b) {
+  if (!a || !b) {
+    return;
+  }
+  struct gcmz_file_list const tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
 size_t gcmz_file_list_count(struct gcmz_file_list const *const list) {
   if (!list || !list->files) {
     return 0;
@@ -178,15 +433,14 @@ void gcmz_file_list_clear(struct gcmz_file_list *const list) {
   if (!list || !list->files) {
     return;
   }
-
-  size_t const count = OV_ARRAY_LENGTH(list->files);
-  for (size_t i = 0; i < count; i++) {
-    if (list->files[i].path) {
-      OV_ARRAY_DESTROY(&list->files[i].path);
-    }
-    if (list->files[i].mime_type) {
-      OV_ARRAY_DESTROY(&list->files[i].mime_type);
-    }
-  }
   OV_ARRAY_SET_LENGTH(list->files, 0);
+  OV_ARRAY_SET_LENGTH(list->caches, 0);
+  file_list_drop_index(list);
+  if (list->owns_arena) {
+    gcmz_arena_reset(list->arena);
+  }
+}
+
+void gcmz_file_list_get_arena_stats(struct gcmz_file_list const *const list, struct gcmz_arena_stats *const stats) {
+  gcmz_arena_get_stats(list ? list->arena : NULL, stats);
 }
@@ -2,6 +2,9 @@
 
 #include <ovbase.h>
 
+struct gcmz_arena;
+struct gcmz_arena_stats;
+
 /**
  * @brief File entry structure for GCMZDrops file management
  *
@@ -13,8 +16,8 @@
  *       must be handled separately by the caller based on the temporary flag.
  */
 struct gcmz_file {
-  wchar_t *path;      ///< Wide character file path (null-terminated), owned by this structure
-  wchar_t *mime_type; ///< Wide character MIME type string (null-terminated), owned by this structure, can be NULL
+  wchar_t *path;      ///< Wide character file path (null-terminated), allocated from the list's arena
+  wchar_t *mime_type; ///< Wide character MIME type string (null-terminated), from the list's arena, can be NULL
   bool temporary;     ///< Metadata flag indicating this file is temporary. Does NOT trigger automatic file deletion.
 };
 
@@ -22,6 +25,9 @@ struct gcmz_file {
  * @brief Opaque structure for managing a list of files
  *
  * Internal structure that maintains a dynamic array of gcmz_file entries.
+ * Paths are indexed case-insensitively on the first lookup so that membership tests take constant time.
+ * Path and MIME type strings are allocated from an arena and are released together,
+ * either when the list is cleared or destroyed, or with the arena the list was created on.
  * All memory management is handled automatically by the API functions.
  */
 struct gcmz_file_list;
@@ -52,6 +58,19 @@ struct gcmz_file_list *gcmz_file_list_create(struct ov_error *const err);
  */
 void gcmz_file_list_destroy(struct gcmz_file_list **const list);
 
+/**
+ * @brief Create a new empty file list that allocates its strings from an existing arena
+ *
+ * Used to tie the strings of a list to a longer-lived scope such as a drag session.
+ * The strings are not released by gcmz_file_list_remove, gcmz_file_list_clear or gcmz_file_list_destroy,
+ * only when the arena is reset or destroyed, which must not happen while the list is in use.
+ *
+ * @param arena Arena to allocate strings from. Must not be NULL and must outlive the list.
+ * @param err Pointer to error structure for error information. Can be NULL.
+ * @return Pointer to new file list on success, NULL on failure (check err for details)
+ */
+struct gcmz_file_list *gcmz_file_list_create_with_arena(struct gcmz_arena *const arena, struct ov_error *const err);
+
 /**
  * @brief Add a regular file to the file list
  *
@@ -93,7 +112,7 @@ NODISCARD bool gcmz_file_list_add_temporary(struct gcmz_file_list *const list,
  *
  * Removes the file entry at the specified index from the list. All file entries
  * after the removed entry are shifted forward to fill the gap. The removed entry's
- * memory (path and MIME type strings) is automatically freed.
+ * strings stay allocated in the arena until the list is cleared or destroyed.
  *
  * @note This function only removes the entry from the list. The actual file on disk
  *       is NOT deleted. Caller must handle file cleanup separately if needed.
@@ -105,6 +124,64 @@ NODISCARD bool gcmz_file_list_add_temporary(struct gcmz_file_list *const list,
  */
 NODISCARD bool gcmz_file_list_remove(struct gcmz_file_list *const list, size_t const index, struct ov_error *const err);
 
+/**
+ * @brief Replace the path of a file entry
+ *
+ * The path is copied into the list's arena. Other fields of the entry are left unchanged.
+ *
+ * @param list Pointer to file list. Must not be NULL.
+ * @param index Zero-based index of the file entry. Must be less than the list count.
+ * @param path New wide character file path. Must not be NULL and must be null-terminated.
+ * @param err Pointer to error structure for error information. Can be NULL.
+ * @return true on success, false on failure (check err for details)
+ */
+NODISCARD bool gcmz_file_list_set_path(struct gcmz_file_list *const list,
+                                       size_t const index,
+                                       wchar_t const *const path,
+                                       struct ov_error *const err);
+
+/**
+ * @brief Find a file entry by path
+ *
+ * Paths are compared case-insensitively like the file system does.
+ * The index is built on the first call and kept up to date while entries are only added,
+ * so repeated lookups take constant time.
+ *
+ * @param list Pointer to file list. Must not be NULL.
+ * @param path Wide character file path to look for. Must not be NULL.
+ * @param index [out] Zero-based index of the first entry with the path, SIZE_MAX if not found
+ * @param err Pointer to error structure for error information. Can be NULL.
+ * @return true on success (whether or not the path was found), false on failure
+ */
+NODISCARD bool gcmz_file_list_find(struct gcmz_file_list *const list,
+                                   wchar_t const *const path,
+                                   size_t *const index,
+                                   struct ov_error *const err);
+
+/**
+ * @brief Get the UTF-8 form of a file entry's path
+ *
+ * The conversion is done once and cached until the path changes.
+ *
+ * @param list Pointer to file list. Must not be NULL.
+ * @param index Zero-based index of the file entry. Must be less than the list count.
+ * @param err Pointer to error structure for error information. Can be NULL.
+ * @return UTF-8 path owned by the list, NULL on failure
+ */
+char const *
+gcmz_file_list_get_path_utf8(struct gcmz_file_list *const list, size_t const index, struct ov_error *const err);
+
+/**
+ * @brief Exchange the contents of two file lists
+ *
+ * Used to replace a list with a newly built one in a single step.
+ * The arenas the strings are allocated from are exchanged along with the entries.
+ *
+ * @param a Pointer to file list. Must not be NULL.
+ * @param b Pointer to file list. Must not be NULL.
+ */
+void gcmz_file_list_swap(struct gcmz_file_list *const a, struct gcmz_file_list *const b);
+
 /**
  * @brief Get the number of files in the list
  *
@@ -136,8 +213,8 @@ struct gcmz_file const *gcmz_file_list_get(struct gcmz_file_list const *const li
  * The returned pointer is valid until the list is modified (entries added/removed)
  * or the list is destroyed. Use this function when you need to modify file properties.
  *
- * @warning Do not directly modify the path or mime_type pointers. Use appropriate
- *          functions to update these fields to prevent memory leaks.
+ * @warning Do not directly modify or free the path or mime_type pointers,
+ *          use gcmz_file_list_set_path to replace the path.
  *
  * @param list Pointer to file list. Must not be NULL.
  * @param index Zero-based index of the file entry to retrieve. Must be less than the list count.
@@ -149,6 +226,7 @@ struct gcmz_file *gcmz_file_list_get_mutable(struct gcmz_file_list *const list,
  * @brief Clear all entries from the file list
  *
  * Removes all file entries from the list and frees their associated memory.
+ * If the list was created with gcmz_file_list_create_with_arena, the strings stay in the arena.
  * The list structure itself is preserved and can be reused to add new entries.
  *
  * @note This function only clears in-memory entries. Actual files on disk
@@ -157,3 +235,11 @@ struct gcmz_file *gcmz_file_list_get_mutable(struct gcmz_file_list *const list,
  * @param list Pointer to file list. Must not be NULL.
  */
 void gcmz_file_list_clear(struct gcmz_file_list *const list);
+
+/**
+ * @brief Get the allocation counters of the arena holding the list's strings
+ *
+ * @param list Pointer to file list. Can be NULL (all counters are 0).
+ * @param stats [out] Counters
+ */
+void gcmz_file_list_get_arena_stats(struct gcmz_file_list const *const list, struct gcmz_arena_stats *const stats);
@@ -2,6 +2,13 @@
 
 #include "file.h"
 
+#include "arena.h"
+
+#include <ovprintf.h>
+
+#include <stdint.h>
+#include <string.h>
+
 static void test_file_list_functionality(void) {
   struct gcmz_file_list *list = NULL;
   struct ov_error err = {0};
@@ -41,4 +48,171 @@ static void test_file_list_functionality(void) {
   gcmz_file_list_destroy(&list);
 }
 
-TEST_LIST = {{"test_file_list_functionality", test_file_list_functionality}, {NULL, NULL}};
+static void test_file_list_arena(void) {
+  enum { file_count = 1000 };
+  struct gcmz_arena *arena = NULL;
+  struct gcmz_file_list *list = NULL;
+  struct gcmz_arena_stats stats = {0};
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_arena_create(&arena, 0, &err), &err)) {
+    return;
+  }
+  list = gcmz_file_list_create_with_arena(arena, &err);
+  if (!TEST_SUCCEEDED(list != NULL, &err)) {
+    goto cleanup;
+  }
+
+  for (size_t i = 0; i < file_count; ++i) {
+    if (!TEST_SUCCEEDED(
+            gcmz_file_list_add_temporary(list, L"C:\\test\\sequence\\frame.png", L"image/png", &err), &err)) {
+      goto cleanup;
+    }
+  }
+  // Each entry used to cost two heap allocations for its path and MIME type
+  gcmz_arena_get_stats(arena, &stats);
+  TEST_CHECK(stats.allocations == file_count * 2);
+  TEST_CHECK(stats.heap_allocations < file_count / 10);
+  TEST_MSG("%zu strings in %zu heap allocations", stats.allocations, stats.heap_allocations);
+
+  if (TEST_SUCCEEDED(gcmz_file_list_set_path(list, 1, L"C:\\managed\\frame.png", &err), &err)) {
+    struct gcmz_file const *const file = gcmz_file_list_get(list, 1);
+    if (TEST_CHECK(file != NULL)) {
+      TEST_CHECK(wcscmp(file->path, L"C:\\managed\\frame.png") == 0);
+      TEST_CHECK(wcscmp(file->mime_type, L"image/png") == 0);
+      TEST_CHECK(file->temporary == true);
+    }
+  }
+  TEST_FAILED_WITH(gcmz_file_list_set_path(list, file_count, L"C:\\x", &err),
+                   &err,
+                   ov_error_type_generic,
+                   ov_error_generic_invalid_argument);
+
+  // Strings stay in the arena until the drag session releases it
+  gcmz_file_list_clear(list);
+  TEST_CHECK(gcmz_file_list_count(list) == 0);
+  gcmz_file_list_get_arena_stats(list, &stats);
+  TEST_CHECK(stats.allocations == file_count * 2 + 1);
+
+cleanup:
+  gcmz_file_list_destroy(&list);
+  gcmz_arena_destroy(&arena);
+}
+
+static void test_file_list_find(void) {
+  enum { frame_count = 10000 };
+  struct gcmz_file_list *list = NULL;
+  struct gcmz_file_list *other = NULL;
+  size_t index = 0;
+  wchar_t path[64];
+  struct ov_error err = {0};
+
+  list = gcmz_file_list_create(&err);
+  if (!TEST_SUCCEEDED(list != NULL, &err)) {
+    return;
+  }
+  other = gcmz_file_list_create(&err);
+  if (!TEST_SUCCEEDED(other != NULL, &err)) {
+    goto cleanup;
+  }
+
+  TEST_CASE("empty list");
+  if (TEST_SUCCEEDED(gcmz_file_list_find(list, L"C:\\test\\a.png", &index, &err), &err)) {
+    TEST_CHECK(index == SIZE_MAX);
+  }
+
+  TEST_CASE("case-insensitive and first match wins");
+  if (!TEST_SUCCEEDED(gcmz_file_list_add(list, L"C:\\Test\\A.png", NULL, &err), &err) ||
+      !TEST_SUCCEEDED(gcmz_file_list_add(list, L"C:\\test\\b.png", NULL, &err), &err)) {
+    goto cleanup;
+  }
+  if (TEST_SUCCEEDED(gcmz_file_list_find(list, L"c:\\TEST\\a.PNG", &index, &err), &err)) {
+    TEST_CHECK(index == 0);
+  }
+  // Added after the index was built
+  if (!TEST_SUCCEEDED(gcmz_file_list_add(list, L"C:\\test\\a.png", NULL, &err), &err) ||
+      !TEST_SUCCEEDED(gcmz_file_list_add(list, L"C:\\test\\c.png", NULL, &err), &err)) {
+    goto cleanup;
+  }
+  if (TEST_SUCCEEDED(gcmz_file_list_find(list, L"C:\\test\\a.png", &index, &err), &err)) {
+    TEST_CHECK(index == 0);
+  }
+  if (TEST_SUCCEEDED(gcmz_file_list_find(list, L"C:\\test\\c.png", &index, &err), &err)) {
+    TEST_CHECK(index == 3);
+  }
+  if (TEST_SUCCEEDED(gcmz_file_list_find(list, L"C:\\test", &index, &err), &err)) {
+    TEST_CHECK(index == SIZE_MAX);
+  }
+
+  TEST_CASE("remove and set_path");
+  if (TEST_SUCCEEDED(gcmz_file_list_remove(list, 0, &err), &err)) {
+    if (TEST_SUCCEEDED(gcmz_file_list_find(list, L"C:\\test\\a.png", &index, &err), &err)) {
+      TEST_CHECK(index == 1);
+    }
+  }
+  if (TEST_SUCCEEDED(gcmz_file_list_set_path(list, 0, L"D:\\b.png", &err), &err)) {
+    if (TEST_SUCCEEDED(gcmz_file_list_find(list, L"C:\\test\\b.png", &index, &err), &err)) {
+      TEST_CHECK(index == SIZE_MAX);
+    }
+    if (TEST_SUCCEEDED(gcmz_file_list_find(list, L"d:\\B.png", &index, &err), &err)) {
+      TEST_CHECK(index == 0);
+    }
+  }
+
+  TEST_CASE("utf8 path");
+  {
+    char const *const utf8 = gcmz_file_list_get_path_utf8(list, 0, &err);
+    if (TEST_SUCCEEDED(utf8 != NULL, &err)) {
+      TEST_CHECK(strcmp(utf8, "D:\\b.png") == 0);
+      TEST_CHECK(gcmz_file_list_get_path_utf8(list, 0, &err) == utf8);
+    }
+    if (TEST_SUCCEEDED(gcmz_file_list_set_path(list, 0, L"D:\\\x7d20\x6750.png", &err), &err)) {
+      char const *const changed = gcmz_file_list_get_path_utf8(list, 0, &err);
+      if (TEST_SUCCEEDED(changed != NULL, &err)) {
+        TEST_CHECK(strcmp(changed, "D:\\\xe7\xb4\xa0\xe6\x9d\x90.png") == 0);
+      }
+    }
+  }
+
+  TEST_CASE("swap");
+  if (TEST_SUCCEEDED(gcmz_file_list_add(other, L"E:\\x.png", NULL, &err), &err)) {
+    gcmz_file_list_swap(list, other);
+    TEST_CHECK(gcmz_file_list_count(list) == 1);
+    TEST_CHECK(gcmz_file_list_count(other) == 3);
+    if (TEST_SUCCEEDED(gcmz_file_list_find(other, L"C:\\test\\c.png", &index, &err), &err)) {
+      TEST_CHECK(index == 2);
+    }
+  }
+
+  TEST_CASE("image sequence");
+  gcmz_file_list_clear(list);
+  for (int i = 0; i < frame_count; ++i) {
+    ov_snprintf_wchar(path, sizeof(path) / sizeof(path[0]), NULL, L"C:\\seq\\frame_%05d.png", i);
+    if (!TEST_SUCCEEDED(gcmz_file_list_add(list, path, L"image/png", &err), &err)) {
+      goto cleanup;
+    }
+  }
+  {
+    bool all_found = true;
+    for (int i = frame_count - 1; i >= 0; --i) {
+      ov_snprintf_wchar(path, sizeof(path) / sizeof(path[0]), NULL, L"C:\\SEQ\\FRAME_%05d.PNG", i);
+      if (!gcmz_file_list_find(list, path, &index, &err)) {
+        TEST_SUCCEEDED(false, &err);
+        goto cleanup;
+      }
+      all_found = all_found && index == (size_t)i;
+    }
+    TEST_CHECK(all_found);
+  }
+
+cleanup:
+  gcmz_file_list_destroy(&other);
+  gcmz_file_list_destroy(&list);
+}
+
+TEST_LIST = {
+    {"test_file_list_functionality", test_file_list_functionality},
+    {"test_file_list_arena", test_file_list_arena},
+    {"test_file_list_find", test_file_list_find},
+    {NULL, NULL},
+};
@@ -31,6 +31,7 @@
 
 #include <ovarray.h>
 #include <ovbase.h>
+#include <ovhashmap.h>
 #include <ovmo.h>
 #include <ovprintf.h>
 #include <ovthreads.h>
@@ -54,6 +55,7 @@
 #include "delayed_cleanup.h"
 #include "do.h"
 #include "do_sub.h"
+#include "downscale.h"
 #include "drop.h"
 #include "error.h"
 #include "file.h"
@@ -61,9 +63,14 @@
 #include "ini_reader.h"
 #include "logf.h"
 #include "lua.h"
+#include "lua_alloc.h"
 #include "lua_api.h"
+#include "lua_async.h"
+#include "lua_pool.h"
 #include "luautil.h"
+#include "script_watcher.h"
 #include "temp.h"
+#include "trace.h"
 #include "tray.h"
 #include "version.h"
 #include "window_list.h"
@@ -72,6 +79,10 @@
 #  define GCMZ_SCRIPT_SUBDIR "GCMZScript"
 #endif
 
+#ifndef GCMZ_LUA_HOOK_MEMORY_BUDGET
+#  define GCMZ_LUA_HOOK_MEMORY_BUDGET ((size_t)64 * 1024 * 1024)
+#endif
+
 /**
  * @brief Find all aviutl2Manager windows in the current process
  *
@@ -136,17 +147,28 @@ struct gcmzdrops {
   struct gcmz_api *api;
   struct gcmz_drop *drop;
   struct gcmz_lua_context *lua_ctx;
+  struct gcmz_lua_pool *lua_pool;
   struct gcmz_tray *tray;
   struct gcmz_window_list *window_list;
   struct gcmz_do_sub *do_sub;
+  struct gcmz_script_watcher *script_watcher;
 
   struct aviutl2_edit_handle *edit;
   uint32_t aviutl2_version;
   wchar_t *project_path;
+  LONG volatile project_width;  ///< Read by file management on worker threads, 0 until known
+  LONG volatile project_height; ///< Read by file management on worker threads, 0 until known
 
   enum gcmzdrops_plugin_state plugin_state;
   mtx_t init_mtx;
   cnd_t init_cond;
+
+  struct media_info_cache_entry *media_cache; ///< get_media_info results for this session
+  struct ov_hashmap *media_cache_index;       ///< Path to position in media_cache
+  mtx_t media_cache_mtx;
+
+  struct gcmz_file_list *paste_cache; ///< Processed files of the last clipboard paste, main thread only
+  DWORD paste_cache_sequence;         ///< Clipboard sequence number the paste cache was made from
 };
 
 /**
@@ -250,35 +272,25 @@ struct clipboard_paste_context {
   struct aviutl2_edit_section *edit; ///< Edit section (valid during callback)
   int layer;                         ///< Target layer (0-based, captured early)
   int frame;                         ///< Target frame position (captured early)
+  bool inserted;                     ///< [out] Whether the files were inserted into the timeline
 };
 
 /**
- * @brief Create text object from file
+ * @brief Read the content of a file as a null-terminated string
  *
- * Reads a text file, creates a text object alias, and inserts it into the timeline.
- *
- * @param file_path Path to text file
- * @param edit Edit section
- * @param layer Layer number (0-based)
- * @param frame Frame position
+ * @param file_path Path to the file
+ * @param content [out] File content, caller must OV_ARRAY_DESTROY
  * @param err Error output
- * @return Object handle on success, NULL on failure
+ * @return true on success, false on failure
  */
-static aviutl2_object_handle create_text_object(wchar_t const *const file_path,
-                                                struct aviutl2_edit_section *const edit,
-                                                int const layer,
-                                                int const frame,
-                                                struct ov_error *const err) {
-  if (!file_path || !edit || !edit->create_object_from_alias) {
+static bool read_file_content(wchar_t const *const file_path, char **const content, struct ov_error *const err) {
+  if (!file_path || !content) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
-    return NULL;
+    return false;
   }
 
   struct ovl_source *source = NULL;
-  char *content = NULL;
-  char *escaped_content = NULL;
-  char *alias = NULL;
-  aviutl2_object_handle obj = NULL;
+  bool result = false;
 
   {
     if (!ovl_source_file_create(file_path, &source, err)) {
@@ -293,17 +305,50 @@ static aviutl2_object_handle create_text_object(wchar_t const *const file_path,
     }
 
     size_t const size = (size_t)file_size;
-    if (!OV_ARRAY_GROW(&content, size + 1)) {
+    if (!OV_ARRAY_GROW(content, size + 1)) {
       OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
       goto cleanup;
     }
 
-    size_t const bytes_read = ovl_source_read(source, content, 0, size);
-    if (bytes_read != size) {
+    if (ovl_source_read(source, *content, 0, size) != size) {
       OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "failed to read file");
       goto cleanup;
     }
-    content[size] = '\0';
+    (*content)[size] = '\0';
+  }
+
+  result = true;
+
+cleanup:
+  if (source) {
+    ovl_source_destroy(&source);
+  }
+  return result;
+}
+
+/**
+ * @brief Build a text object alias from a text file
+ *
+ * @param file_path Path to text file
+ * @param alias [out] Alias string, caller must OV_ARRAY_DESTROY
+ * @param err Error output
+ * @return true on success, false on failure
+ */
+static bool build_text_alias(wchar_t const *const file_path, char **const alias, struct ov_error *const err) {
+  if (!file_path || !alias) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  char *content = NULL;
+  char *escaped_content = NULL;
+  bool result = false;
+
+  {
+    if (!read_file_content(file_path, &content, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
 
     // Escape newlines in content for alias format (replace \n with \\n)
     size_t escaped_len = 0;
@@ -338,92 +383,222 @@ static aviutl2_object_handle create_text_object(wchar_t const *const file_path,
       goto cleanup;
     }
 
-    if (!OV_ARRAY_GROW(&alias, (size_t)alias_len + 1)) {
+    if (!OV_ARRAY_GROW(alias, (size_t)alias_len + 1)) {
       OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
       goto cleanup;
     }
 
-    ov_snprintf_char(alias, (size_t)alias_len + 1, NULL, alias_format, escaped_content);
-
-    obj = edit->create_object_from_alias(alias, layer, frame, 0);
-    if (!obj) {
-      OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "create_object_from_alias failed");
-    }
+    ov_snprintf_char(*alias, (size_t)alias_len + 1, NULL, alias_format, escaped_content);
   }
 
+  result = true;
+
 cleanup:
-  OV_ARRAY_DESTROY(&alias);
   OV_ARRAY_DESTROY(&escaped_content);
   OV_ARRAY_DESTROY(&content);
-  ovl_source_destroy(&source);
+  return result;
+}
+
+/**
+ * @brief How a file is inserted into the timeline
+ */
+enum timeline_item_kind {
+  timeline_item_skip,  ///< Not inserted, already reported while planning
+  timeline_item_alias, ///< Inserted from a prepared alias (.object and .txt files)
+  timeline_item_media, ///< Inserted with create_object_from_media_file if the host supports it
+};
 
-  return obj;
+/**
+ * @brief A file of a planned timeline insertion
+ */
+struct timeline_item {
+  wchar_t const *path;
+  char *alias;     ///< Prepared alias for timeline_item_alias
+  int alias_flags; ///< Flags for create_object_from_alias
+  int layer_span;  ///< Number of layers the inserted objects occupy
+  enum timeline_item_kind kind;
+  bool unsupported; ///< Set during insertion when the host does not support the media file
+  bool failed;      ///< Set during insertion when the host failed to create the object
+};
+
+/**
+ * @brief Insertion of a file list planned outside the edit section
+ *
+ * Reading and parsing files is done while planning, so that the edit section only has to
+ * make the host calls.
+ */
+struct timeline_plan {
+  struct timeline_item *items;
+  uint64_t plan_us; ///< Time spent planning
+};
+
+static void timeline_plan_destroy(struct timeline_plan *const plan) {
+  if (!plan || !plan->items) {
+    return;
+  }
+  size_t const n = OV_ARRAY_LENGTH(plan->items);
+  for (size_t i = 0; i < n; ++i) {
+    if (plan->items[i].alias) {
+      OV_ARRAY_DESTROY(&plan->items[i].alias);
+    }
+  }
+  OV_ARRAY_DESTROY(&plan->items);
 }
 
 /**
- * @brief Create an object from .object file
+ * @brief Classify the files of a list and prepare their aliases and layer spans
  *
- * Reads an .object file and creates an AviUtl2 object using its content.
+ * Files that cannot be inserted are reported here and planned as timeline_item_skip.
+ * The plan refers to the paths of file_list, which must outlive it.
  *
- * @param file_path Path to the .object file
- * @param edit Edit section interface
- * @param layer Layer number (0-based)
- * @param frame Frame position
+ * @param file_list List of files to insert
+ * @param plan [out] Plan, caller must timeline_plan_destroy
  * @param err Error output
- * @return Object handle on success, NULL on failure
+ * @return true on success, false on failure
  */
-static aviutl2_object_handle create_object_from_file(wchar_t const *const file_path,
-                                                     struct aviutl2_edit_section *const edit,
-                                                     int const layer,
-                                                     int const frame,
-                                                     struct ov_error *const err) {
-  if (!file_path || !edit || !edit->create_object_from_alias) {
+static NODISCARD bool timeline_plan_build(struct gcmz_file_list const *const file_list,
+                                          struct timeline_plan *const plan,
+                                          struct ov_error *const err) {
+  if (!file_list || !plan) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
-    return NULL;
+    return false;
   }
 
-  struct ovl_source *source = NULL;
-  char *content = NULL;
-  aviutl2_object_handle obj = NULL;
+  uint64_t const start = gcmz_trace_now();
+  size_t const count = gcmz_file_list_count(file_list);
+  struct timeline_plan p = {0};
+  bool result = false;
 
-  {
-    if (!ovl_source_file_create(file_path, &source, err)) {
-      OV_ERROR_ADD_TRACE(err);
-      goto cleanup;
+  if (!OV_ARRAY_GROW(&p.items, count ? count : 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(file_list, i);
+    struct timeline_item *const item = &p.items[i];
+    *item = (struct timeline_item){
+        .path = file ? file->path : NULL,
+        .layer_span = 1,
+        .kind = timeline_item_skip,
+    };
+    OV_ARRAY_SET_LENGTH(p.items, i + 1);
+    if (!item->path) {
+      gcmz_logf_warn(NULL, "%1$hs", "%1$hs", gettext("skipping invalid file in list"));
+      continue;
     }
-
-    uint64_t const file_size = ovl_source_size(source);
-    if (file_size == UINT64_MAX || file_size > SIZE_MAX - 1) {
-      OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "file size too large or invalid");
-      goto cleanup;
+    wchar_t const *const ext = wcsrchr(item->path, L'.');
+    if (!ext) {
+      gcmz_logf_warn(NULL, "%1$ls", gettext("skipping file with no extension: %1$ls"), item->path);
+      continue;
     }
-
-    size_t const size = (size_t)file_size;
-    if (!OV_ARRAY_GROW(&content, size + 1)) {
-      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-      goto cleanup;
+    if (ovl_path_is_same_ext(ext, L".object")) {
+      if (!read_file_content(item->path, &item->alias, err)) {
+        gcmz_logf_warn(err, "%1$ls", gettext("failed to insert file: %1$ls"), item->path);
+        OV_ERROR_DESTROY(err);
+        continue;
+      }
+      item->alias_flags = 1;
+      if (!get_object_layer_count(item->path, &item->layer_span, NULL)) {
+        item->layer_span = 1;
+      }
+      item->kind = timeline_item_alias;
+      continue;
     }
-
-    if (ovl_source_read(source, content, 0, size) != size) {
-      OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "failed to read file");
-      goto cleanup;
+    if (ovl_path_is_same_ext(ext, L".txt")) {
+      if (!build_text_alias(item->path, &item->alias, err)) {
+        gcmz_logf_warn(err, "%1$ls", gettext("failed to insert file: %1$ls"), item->path);
+        OV_ERROR_DESTROY(err);
+        continue;
+      }
+      item->kind = timeline_item_alias;
+      continue;
     }
-    content[size] = '\0';
+    item->kind = timeline_item_media;
+  }
+  p.plan_us = gcmz_trace_elapsed_us(start);
+  gcmz_trace_record("timeline_plan", start);
+  *plan = p;
+  p = (struct timeline_plan){0};
+  result = true;
+
+cleanup:
+  timeline_plan_destroy(&p);
+  return result;
+}
 
-    obj = edit->create_object_from_alias(content, layer, frame, 1);
+/**
+ * @brief Insert a planned file list into the timeline
+ *
+ * Runs inside the edit section, so nothing but host calls happens here;
+ * failures are recorded in the plan and reported by timeline_plan_report afterwards.
+ *
+ * @param plan Plan built by timeline_plan_build
+ * @param edit Edit section
+ * @param start_layer Starting layer (0-based)
+ * @param frame Frame position
+ * @return First object handle, NULL if nothing was inserted
+ */
+static aviutl2_object_handle timeline_plan_insert(struct timeline_plan *const plan,
+                                                  struct aviutl2_edit_section *const edit,
+                                                  int const start_layer,
+                                                  int const frame) {
+  uint64_t const start = gcmz_trace_now();
+  size_t const n = OV_ARRAY_LENGTH(plan->items);
+  aviutl2_object_handle first_obj = NULL;
+  size_t inserted = 0;
+  int layer = start_layer;
+
+  for (size_t i = 0; i < n; ++i) {
+    struct timeline_item *const item = &plan->items[i];
+    aviutl2_object_handle obj = NULL;
+    switch (item->kind) {
+    case timeline_item_skip:
+      continue;
+    case timeline_item_alias:
+      obj = edit->create_object_from_alias(item->alias, layer, frame, item->alias_flags);
+      break;
+    case timeline_item_media:
+      if (!edit->is_support_media_file(item->path, false)) {
+        item->unsupported = true;
+        continue;
+      }
+      obj = edit->create_object_from_media_file(item->path, layer, frame, 0);
+      break;
+    }
     if (!obj) {
-      OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "create_object_from_alias failed");
+      item->failed = true;
+      continue;
+    }
+    if (!first_obj) {
+      first_obj = obj;
     }
+    layer += item->layer_span;
+    ++inserted;
   }
 
-cleanup:
-  if (content) {
-    OV_ARRAY_DESTROY(&content);
-  }
-  if (source) {
-    ovl_source_destroy(&source);
+  gcmz_trace_record("timeline_insert", start);
+  gcmz_logf_verbose(NULL,
+                    "%1$zu%2$zu%3$zu",
+                    "inserted %1$zu objects in %2$zu us after %3$zu us of planning",
+                    inserted,
+                    (size_t)gcmz_trace_elapsed_us(start),
+                    (size_t)plan->plan_us);
+  return first_obj;
+}
+
+/**
+ * @brief Report files that could not be inserted, once the edit section has been left
+ */
+static void timeline_plan_report(struct timeline_plan const *const plan) {
+  size_t const n = OV_ARRAY_LENGTH(plan->items);
+  for (size_t i = 0; i < n; ++i) {
+    struct timeline_item const *const item = &plan->items[i];
+    if (item->unsupported) {
+      gcmz_logf_warn(NULL, "%1$ls", gettext("skipping unsupported file: %1$ls"), item->path);
+    } else if (item->failed) {
+      gcmz_logf_warn(NULL, "%1$ls", gettext("failed to insert file: %1$ls"), item->path);
+    }
   }
-  return obj;
 }
 
 /**
@@ -451,69 +626,45 @@ static aviutl2_object_handle insert_files_to_timeline(struct gcmz_file_list cons
     return NULL;
   }
 
-  size_t const count = gcmz_file_list_count(file_list);
-  aviutl2_object_handle first_obj = NULL;
-  int current_layer = start_layer;
+  struct timeline_plan plan = {0};
+  if (!timeline_plan_build(file_list, &plan, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return NULL;
+  }
+  aviutl2_object_handle const first_obj = timeline_plan_insert(&plan, edit, start_layer, frame);
+  timeline_plan_report(&plan);
+  timeline_plan_destroy(&plan);
+  return first_obj;
+}
 
-  for (size_t i = 0; i < count; ++i) {
-    struct gcmz_file const *const file = gcmz_file_list_get(file_list, i);
-    if (!file || !file->path) {
-      gcmz_logf_warn(NULL, "%1$hs", "%1$hs", gettext("skipping invalid file in list"));
-      continue;
-    }
-    wchar_t const *const ext = wcsrchr(file->path, L'.');
-    if (!ext) {
-      gcmz_logf_warn(NULL, "%1$ls", gettext("skipping file with no extension: %1$ls"), file->path);
-      continue;
-    }
-    if (ovl_path_is_same_ext(ext, L".object")) {
-      aviutl2_object_handle obj = create_object_from_file(file->path, edit, current_layer, frame, err);
-      if (!obj) {
-        gcmz_logf_warn(err, "%1$ls", gettext("failed to insert file: %1$ls"), file->path);
-        OV_ERROR_DESTROY(err);
-        continue;
-      }
-      if (!first_obj) {
-        first_obj = obj;
-      }
-      int layer_count = 1;
-      if (get_object_layer_count(file->path, &layer_count, NULL)) {
-        current_layer += layer_count;
-      } else {
-        ++current_layer;
-      }
-      continue;
-    }
-    if (ovl_path_is_same_ext(ext, L".txt")) {
-      aviutl2_object_handle obj = create_text_object(file->path, edit, current_layer, frame, err);
-      if (!obj) {
-        gcmz_logf_warn(err, "%1$ls", gettext("failed to insert file: %1$ls"), file->path);
-        OV_ERROR_DESTROY(err);
-        continue;
-      }
-      if (!first_obj) {
-        first_obj = obj;
-      }
-      ++current_layer;
-      continue;
-    }
-    if (edit->is_support_media_file(file->path, false)) {
-      aviutl2_object_handle obj = edit->create_object_from_media_file(file->path, current_layer, frame, 0);
-      if (!obj) {
-        gcmz_logf_warn(err, "%1$ls", gettext("failed to insert file: %1$ls"), file->path);
-        OV_ERROR_DESTROY(err);
-        continue;
-      }
-      if (!first_obj) {
-        first_obj = obj;
-      }
-      ++current_layer;
-      continue;
-    }
-    gcmz_logf_warn(NULL, "%1$ls", gettext("skipping unsupported file: %1$ls"), file->path);
+/**
+ * @brief Forget the files of the last clipboard paste
+ *
+ * Called when anything that shapes the processed files changes, such as settings, scripts or the project.
+ */
+static void invalidate_paste_cache(struct gcmzdrops *const ctx) {
+  if (ctx->paste_cache) {
+    gcmz_file_list_destroy(&ctx->paste_cache);
   }
+  ctx->paste_cache_sequence = 0;
+}
 
-  return first_obj;
+/**
+ * @brief Check whether the cached paste can be inserted again as it is
+ */
+static bool paste_cache_is_valid(struct gcmzdrops const *const ctx, DWORD const sequence) {
+  if (!ctx->paste_cache || !sequence || sequence != ctx->paste_cache_sequence) {
+    return false;
+  }
+  // Temporary files may have been cleaned up and saved files removed by the user since
+  size_t const n = gcmz_file_list_count(ctx->paste_cache);
+  for (size_t i = 0; i < n; ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(ctx->paste_cache, i);
+    if (!file || !file->path || GetFileAttributesW(file->path) == INVALID_FILE_ATTRIBUTES) {
+      return false;
+    }
+  }
+  return true;
 }
 
 /**
@@ -539,6 +690,7 @@ static void on_clipboard_paste_completion(struct gcmz_file_list const *const fil
     return;
   }
   paste_ctx->edit->set_focus_object(obj);
+  paste_ctx->inserted = true;
 }
 
 /**
@@ -568,7 +720,7 @@ static void request_api_get_info_edit_section(void *param, struct aviutl2_edit_s
  * @brief Context for request_api file insertion
  */
 struct request_api_insert_context {
-  struct gcmz_file_list const *file_list;
+  struct timeline_plan *plan; ///< Planned before entering the edit section
   int layer;
   int frame;
   int frame_advance;
@@ -580,7 +732,7 @@ struct request_api_insert_context {
  */
 static void request_api_insert_edit_section(void *param, struct aviutl2_edit_section *edit) {
   struct request_api_insert_context *const insert_ctx = (struct request_api_insert_context *)param;
-  if (!insert_ctx || !insert_ctx->file_list || !edit) {
+  if (!insert_ctx || !insert_ctx->plan || !edit) {
     return;
   }
 
@@ -617,11 +769,9 @@ static void request_api_insert_edit_section(void *param, struct aviutl2_edit_sec
     }
   }
 
-  struct ov_error err = {0};
-  aviutl2_object_handle const obj = insert_files_to_timeline(insert_ctx->file_list, edit, layer, frame, &err);
+  aviutl2_object_handle const obj = timeline_plan_insert(insert_ctx->plan, edit, layer, frame);
   if (!obj) {
-    gcmz_logf_error(&err, "%1$hs", "%1$hs", gettext("failed to insert files into timeline"));
-    OV_ERROR_DESTROY(&err);
+    gcmz_logf_error(NULL, "%1$hs", "%1$hs", gettext("failed to insert files into timeline"));
     return;
   }
   edit->set_focus_object(obj);
@@ -694,8 +844,21 @@ static void request_api(struct gcmz_api_request_params *const params, gcmz_api_r
   };
 
   struct ov_error err = {0};
+  // Run handlers on a pooled context so that requests do not contend with interactive drops.
+  // The same context is held through drag_enter and drop, edit APIs still go through call_edit_section.
+  struct gcmz_lua_context *pooled = NULL;
+  if (ctx->lua_pool) {
+    pooled = gcmz_lua_pool_acquire(ctx->lua_pool, &err);
+    if (!pooled) {
+      gcmz_logf_warn(&err, "%1$hs", "%1$hs", "failed to prepare pooled Lua state, using the main Lua state");
+      OV_ERROR_DESTROY(&err);
+    }
+  }
   bool const r = gcmz_drop_simulate_drop(
       ctx->drop, params->files, params->use_exo_converter, on_request_api_lua_complete, &lua_result, &err);
+  if (pooled) {
+    gcmz_lua_pool_release(ctx->lua_pool, pooled);
+  }
   if (!r) {
     OV_ERROR_SET(&err, ov_error_type_generic, ov_error_generic_fail, "simulated drop failed");
     gcmz_logf_error(&err, "%1$hs", "%1$hs", gettext("failed to drop from external API request"));
@@ -710,18 +873,39 @@ static void request_api(struct gcmz_api_request_params *const params, gcmz_api_r
   }
 
   // Phase 3: File insertion (short edit_section)
+  // Files are read and classified beforehand so that the edit section only makes host calls
+  struct timeline_plan plan = {0};
+  if (!timeline_plan_build(lua_result.processed_files, &plan, &err)) {
+    gcmz_logf_error(&err, "%1$hs", "%1$hs", gettext("failed to insert files into timeline"));
+    OV_ERROR_DESTROY(&err);
+    complete(params);
+    return;
+  }
   struct request_api_insert_context insert_ctx = {
-      .file_list = lua_result.processed_files,
+      .plan = &plan,
       .layer = layer,
       .frame = info_ctx.frame,
       .frame_advance = params->frame_advance,
       .margin = params->margin,
   };
   ctx->edit->call_edit_section_param(&insert_ctx, request_api_insert_edit_section);
+  timeline_plan_report(&plan);
+  timeline_plan_destroy(&plan);
 
   complete(params);
 }
 
+static void update_project_size(void *userdata) {
+  struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
+  if (!ctx || !ctx->edit) {
+    return;
+  }
+  struct aviutl2_edit_info ei = {0};
+  ctx->edit->get_edit_info(&ei, sizeof(ei));
+  InterlockedExchange(&ctx->project_width, ei.width);
+  InterlockedExchange(&ctx->project_height, ei.height);
+}
+
 static void update_api_project_data(void *userdata) {
   struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
   if (!ctx || !ctx->edit || !ctx->api) {
@@ -884,6 +1068,7 @@ void gcmzdrops_show_config_dialog(struct gcmzdrops *const ctx, void *const hwnd,
   bool success = false;
 
   {
+    invalidate_paste_cache(ctx);
     if (!gcmz_config_dialog_show(
             &(struct gcmz_config_dialog_options){
                 .config = ctx->config,
@@ -990,6 +1175,68 @@ static void tray_menu_debug_output(void *userdata, struct gcmz_tray_callback_eve
   }
 }
 
+static void tray_menu_export_trace(void *userdata, struct gcmz_tray_callback_event *const event) {
+  (void)userdata;
+  static wchar_t label[64];
+  switch (event->type) {
+  case gcmz_tray_callback_query_info:
+    if (label[0] == L'\0') {
+      ov_snprintf_wchar(label, sizeof(label) / sizeof(label[0]), L"%s", L"%s", "Export Trace");
+    }
+    event->result.query_info.label = label;
+    event->result.query_info.enabled = true;
+    break;
+
+  case gcmz_tray_callback_clicked: {
+    struct ov_error err = {0};
+    char *json = NULL;
+    struct ovl_file *file = NULL;
+    wchar_t *path = NULL;
+    bool result = false;
+
+    {
+      if (!gcmz_trace_export_chrome_json(&json, &err)) {
+        OV_ERROR_ADD_TRACE(&err);
+        goto cleanup;
+      }
+      if (!ovl_file_create_temp(L"gcmz_trace.json", &file, &path, &err)) {
+        OV_ERROR_ADD_TRACE(&err);
+        goto cleanup;
+      }
+      size_t const json_len = OV_ARRAY_LENGTH(json);
+      size_t written = 0;
+      if (!ovl_file_write(file, json, json_len, &written, &err)) {
+        OV_ERROR_ADD_TRACE(&err);
+        goto cleanup;
+      }
+      if (written != json_len) {
+        OV_ERROR_SET_GENERIC(&err, ov_error_generic_fail);
+        goto cleanup;
+      }
+      gcmz_logf_info(NULL, NULL, "Trace exported to %ls", path);
+    }
+
+    result = true;
+
+  cleanup:
+    if (file) {
+      ovl_file_close(file);
+    }
+    if (path) {
+      OV_ARRAY_DESTROY(&path);
+    }
+    if (json) {
+      OV_ARRAY_DESTROY(&json);
+    }
+    if (!result) {
+      gcmz_logf_error(&err, "%1$hs", "%1$hs", "failed to export trace");
+      OV_ERROR_REPORT(&err, NULL);
+    }
+    break;
+  }
+  }
+}
+
 static void tray_menu_test_complete_external_api(struct gcmz_api_request_params *const params) {
   gcmz_logf_info(NULL, "%1$hs", "%1$hs", "API request test completed");
   if (params && params->files) {
@@ -1231,10 +1478,29 @@ static void tray_menu_test_external_api_object(void *userdata, struct gcmz_tray_
 }
 #endif // NDEBUG
 
+static bool get_dataobj_options(struct gcmzdrops *const ctx,
+                                struct gcmz_dataobj_options *const options,
+                                struct ov_error *const err) {
+  bool dib_as_bmp = false;
+  if (!gcmz_config_get_bitmaps_as_bmp(ctx->config, &dib_as_bmp, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  *options = (struct gcmz_dataobj_options){
+      .dib_as_bmp = dib_as_bmp,
+  };
+  return true;
+}
+
 static bool
 extract_from_dataobj(void *dataobj, struct gcmz_file_list *dest, void *userdata, struct ov_error *const err) {
-  (void)userdata;
-  if (!gcmz_dataobj_extract_from_dataobj(dataobj, dest, err)) {
+  struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
+  struct gcmz_dataobj_options options;
+  if (!get_dataobj_options(ctx, &options, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  if (!gcmz_dataobj_extract_from_dataobj(dataobj, dest, &options, err)) {
     OV_ERROR_ADD_TRACE(err);
     return false;
   }
@@ -1307,7 +1573,48 @@ static wchar_t *get_save_path(wchar_t const *filename, void *userdata, struct ov
   return r;
 }
 
-static bool copy_file(wchar_t const *source_file, wchar_t **final_file, void *userdata, struct ov_error *const err) {
+/**
+ * @brief Shrink a generated image that is larger than the project
+ *
+ * Only files in the temporary directory such as clipboard images and browser downloads are touched,
+ * since they are copied into the save directory anyway. Failures are logged and leave the file as it is.
+ *
+ * @param ctx Plugin context
+ * @param source_file Source file path
+ * @return Path of the downscaled copy (caller must delete the file and OV_ARRAY_DESTROY), NULL to use the source
+ */
+static wchar_t *downscale_generated_image(struct gcmzdrops *const ctx, wchar_t const *const source_file) {
+  struct ov_error err = {0};
+  wchar_t *downscaled = NULL;
+  bool enabled = false;
+  if (!gcmz_config_get_downscale_images(ctx->config, &enabled, &err)) {
+    OV_ERROR_REPORT(&err, NULL);
+    return NULL;
+  }
+  LONG const width = InterlockedCompareExchange(&ctx->project_width, 0, 0);
+  LONG const height = InterlockedCompareExchange(&ctx->project_height, 0, 0);
+  if (!enabled || width <= 0 || height <= 0 || !gcmz_copy_is_temporary(source_file)) {
+    return NULL;
+  }
+  uint64_t const start = gcmz_trace_now();
+  if (!gcmz_downscale_file(source_file, (uint32_t)width, (uint32_t)height, &downscaled, &err)) {
+    gcmz_logf_warn(&err, "%1$hs", "%1$hs", gettext("failed to downscale image, using the original size"));
+    OV_ERROR_DESTROY(&err);
+    return NULL;
+  }
+  gcmz_trace_record("downscale_image", start);
+  if (downscaled) {
+    gcmz_logf_verbose(NULL, "%1$ls%2$d%3$d", "downscaled %1$ls to fit %2$dx%3$d", source_file, (int)width, (int)height);
+  }
+  return downscaled;
+}
+
+static bool copy_file(wchar_t const *source_file,
+                      long volatile *cancel,
+                      wchar_t **final_file,
+                      bool *created,
+                      void *userdata,
+                      struct ov_error *const err) {
   struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
   if (!ctx) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
@@ -1318,22 +1625,112 @@ static bool copy_file(wchar_t const *source_file, wchar_t **final_file, void *us
     OV_ERROR_ADD_TRACE(err);
     return false;
   }
-  // gcmz_copy does not necessarily copy the file.
-  // If a file with the same hash value exists at the destination, it returns that path.
-  if (!gcmz_copy(source_file, mode, get_save_path, ctx, final_file, err)) {
+  bool is_new = false;
+  wchar_t *downscaled = downscale_generated_image(ctx, source_file);
+  if (downscaled) {
+    // The shrunk copy is stored under its own hash, so dropping the same image again reuses it
+    bool reused = false;
+    bool const ok = gcmz_copy_hashed(downscaled, NULL, get_save_path, ctx, cancel, final_file, &reused, err);
+    DeleteFileW(downscaled);
+    OV_ARRAY_DESTROY(&downscaled);
+    if (!ok) {
+      OV_ERROR_ADD_TRACE(err);
+      return false;
+    }
+    is_new = !reused;
+  } else if (!gcmz_copy(source_file, mode, get_save_path, ctx, cancel, final_file, &is_new, err)) {
+    // gcmz_copy does not necessarily copy the file.
+    // If a file with the same hash value exists at the destination, it returns that path.
     OV_ERROR_ADD_TRACE(err);
     return false;
   }
+  if (created) {
+    *created = is_new;
+  }
   return true;
 }
 
+static ov_tribool get_directory_expansion(wchar_t **const extensions, void *userdata, struct ov_error *const err) {
+  struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
+  if (!ctx || !extensions) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return ov_indeterminate;
+  }
+  bool enabled = false;
+  if (!gcmz_config_get_expand_directories(ctx->config, &enabled, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return ov_indeterminate;
+  }
+  if (!enabled) {
+    return ov_false;
+  }
+  if (!gcmz_config_get_expand_extensions(ctx->config, extensions, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return ov_indeterminate;
+  }
+  // An empty list takes every file
+  if ((*extensions)[0] == L'\0') {
+    OV_ARRAY_DESTROY(extensions);
+  }
+  return ov_true;
+}
+
+static ov_tribool get_sequence_collapsing(void *userdata, struct ov_error *const err) {
+  struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
+  if (!ctx) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return ov_indeterminate;
+  }
+  bool enabled = false;
+  if (!gcmz_config_get_collapse_sequences(ctx->config, &enabled, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return ov_indeterminate;
+  }
+  return enabled ? ov_true : ov_false;
+}
+
+/**
+ * @brief Get the Lua context for the calling thread
+ *
+ * Threads holding a pooled context (external API requests) use it,
+ * everything else runs on the primary context.
+ */
+static struct gcmz_lua_context *get_lua_context(struct gcmzdrops *const ctx) {
+  return ctx->lua_pool ? gcmz_lua_pool_get_current(ctx->lua_pool) : ctx->lua_ctx;
+}
+
+/**
+ * @brief Log memory usage of a Lua context after a hook returned
+ */
+static void log_lua_memory_stats(struct gcmz_lua_context const *const lua, char const *const hook) {
+  struct gcmz_lua_alloc_stats stats;
+  if (!gcmz_lua_alloc_get_stats(gcmz_lua_get_state(lua), &stats)) {
+    return;
+  }
+  if (stats.budget_exceeded) {
+    gcmz_logf_warn(
+        NULL, "%1$hs%2$zu", "%1$hs: Lua memory budget of %2$zu bytes exceeded, handler aborted", hook, stats.budget);
+  }
+  gcmz_logf_verbose(NULL,
+                    "%1$hs%2$zu%3$zu%4$zu%5$zu",
+                    "%1$hs: Lua memory in use %2$zu bytes, hook peak %3$zu bytes, peak %4$zu bytes, pooled %5$zu bytes",
+                    hook,
+                    stats.current,
+                    stats.hook_peak,
+                    stats.peak,
+                    stats.pooled);
+}
+
 static bool lua_exo_convert_adapter(struct gcmz_file_list *file_list, void *userdata, struct ov_error *const err) {
   struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
   if (!ctx || !ctx->lua_ctx) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return false;
   }
-  return gcmz_lua_call_exo_convert(ctx->lua_ctx, file_list, err);
+  struct gcmz_lua_context *const lua = get_lua_context(ctx);
+  bool const result = gcmz_lua_call_exo_convert(lua, file_list, err);
+  log_lua_memory_stats(lua, "exo_convert");
+  return result;
 }
 
 static bool lua_drag_enter_adapter(struct gcmz_file_list *file_list,
@@ -1347,7 +1744,10 @@ static bool lua_drag_enter_adapter(struct gcmz_file_list *file_list,
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return false;
   }
-  return gcmz_lua_call_drag_enter(ctx->lua_ctx, file_list, key_state, modifier_keys, from_api, err);
+  struct gcmz_lua_context *const lua = get_lua_context(ctx);
+  bool const result = gcmz_lua_call_drag_enter(lua, file_list, key_state, modifier_keys, from_api, err);
+  log_lua_memory_stats(lua, "drag_enter");
+  return result;
 }
 
 static bool lua_drop_adapter(struct gcmz_file_list *file_list,
@@ -1364,7 +1764,10 @@ static bool lua_drop_adapter(struct gcmz_file_list *file_list,
 
   // Lua processing runs outside edit_section.
   // get_media_info calls within Lua will enter edit_section temporarily if needed.
-  return gcmz_lua_call_drop(ctx->lua_ctx, file_list, key_state, modifier_keys, from_api, err);
+  struct gcmz_lua_context *const lua = get_lua_context(ctx);
+  bool const result = gcmz_lua_call_drop(lua, file_list, key_state, modifier_keys, from_api, err);
+  log_lua_memory_stats(lua, "drop");
+  return result;
 }
 
 static bool lua_drag_leave_adapter(void *userdata, struct ov_error *const err) {
@@ -1373,7 +1776,7 @@ static bool lua_drag_leave_adapter(void *userdata, struct ov_error *const err) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return false;
   }
-  return gcmz_lua_call_drag_leave(ctx->lua_ctx, err);
+  return gcmz_lua_call_drag_leave(get_lua_context(ctx), err);
 }
 
 static void lua_debug_print(void *userdata, char const *message) {
@@ -1611,11 +2014,212 @@ cleanup:
   }
 }
 
+/**
+ * @brief Cached get_media_info result
+ *
+ * Entries are only reused while the file size and last write time stay the same.
+ */
+struct media_info_cache_entry {
+  char *path; ///< UTF-8 path as passed from Lua
+  size_t path_len;
+  uint64_t size;
+  uint64_t mtime;
+  struct aviutl2_media_info info;
+  bool ok; ///< false if the file is not supported
+};
+
+struct media_info_cache_index_item {
+  char const *path;
+  size_t path_len;
+  size_t pos;
+};
+
+static void get_key_from_media_info_cache_index_item(void const *const item,
+                                                     void const **const key,
+                                                     size_t *const key_bytes) {
+  struct media_info_cache_index_item const *i = (struct media_info_cache_index_item const *)item;
+  *key = i->path;
+  *key_bytes = i->path_len;
+}
+
+static void media_info_cache_destroy(struct gcmzdrops *const ctx) {
+  if (ctx->media_cache) {
+    size_t const n = OV_ARRAY_LENGTH(ctx->media_cache);
+    for (size_t i = 0; i < n; ++i) {
+      OV_FREE(&ctx->media_cache[i].path);
+    }
+    OV_ARRAY_DESTROY(&ctx->media_cache);
+  }
+  if (ctx->media_cache_index) {
+    OV_HASHMAP_DESTROY(&ctx->media_cache_index);
+  }
+}
+
+/**
+ * @brief Look up a cached result, must be called with media_cache_mtx held
+ */
+static struct media_info_cache_entry *
+media_info_cache_find(struct gcmzdrops *const ctx, char const *const path, size_t const path_len) {
+  if (!ctx->media_cache_index) {
+    return NULL;
+  }
+  struct media_info_cache_index_item const *const item =
+      (struct media_info_cache_index_item const *)OV_HASHMAP_GET(ctx->media_cache_index,
+                                                                 &((struct media_info_cache_index_item const){
+                                                                     .path = path,
+                                                                     .path_len = path_len,
+                                                                 }));
+  return item ? &ctx->media_cache[item->pos] : NULL;
+}
+
+/**
+ * @brief Store a result, must be called with media_cache_mtx held
+ *
+ * Failing to cache is not an error, the result is simply probed again next time.
+ */
+static void media_info_cache_store(struct gcmzdrops *const ctx,
+                                   char const *const path,
+                                   uint64_t const size,
+                                   uint64_t const mtime,
+                                   struct aviutl2_media_info const *const info,
+                                   bool const ok) {
+  size_t const path_len = strlen(path);
+  struct media_info_cache_entry *e = media_info_cache_find(ctx, path, path_len);
+  if (!e) {
+    if (!ctx->media_cache_index) {
+      ctx->media_cache_index = OV_HASHMAP_CREATE_DYNAMIC(
+          sizeof(struct media_info_cache_index_item), 16, get_key_from_media_info_cache_index_item);
+      if (!ctx->media_cache_index) {
+        return;
+      }
+    }
+    char *key = NULL;
+    if (!OV_REALLOC(&key, path_len + 1, sizeof(char))) {
+      return;
+    }
+    memcpy(key, path, path_len + 1);
+    size_t const pos = OV_ARRAY_LENGTH(ctx->media_cache);
+    if (!OV_ARRAY_GROW(&ctx->media_cache, pos + 1)) {
+      OV_FREE(&key);
+      return;
+    }
+    if (!OV_HASHMAP_SET(ctx->media_cache_index,
+                        &((struct media_info_cache_index_item){
+                            .path = key,
+                            .path_len = path_len,
+                            .pos = pos,
+                        }))) {
+      OV_FREE(&key);
+      return;
+    }
+    ctx->media_cache[pos] = (struct media_info_cache_entry){
+        .path = key,
+        .path_len = path_len,
+    };
+    OV_ARRAY_SET_LENGTH(ctx->media_cache, pos + 1);
+    e = &ctx->media_cache[pos];
+  }
+  e->size = size;
+  e->mtime = mtime;
+  e->info = *info;
+  e->ok = ok;
+}
+
+/**
+ * @brief File identity used to validate cached media information
+ */
+struct media_file_stamp {
+  uint64_t size;
+  uint64_t mtime;
+  bool valid;
+};
+
+static struct media_file_stamp get_media_file_stamp(wchar_t const *const path) {
+  WIN32_FILE_ATTRIBUTE_DATA fad;
+  if (!GetFileAttributesExW(path, GetFileExInfoStandard, &fad)) {
+    return (struct media_file_stamp){0};
+  }
+  return (struct media_file_stamp){
+      .size = ((uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow,
+      .mtime = ((uint64_t)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime,
+      .valid = true,
+  };
+}
+
+/**
+ * @brief Module names handed from the script watcher thread to the main thread
+ */
+struct script_reload_request {
+  struct gcmzdrops *ctx;
+  char **module_names;
+};
+
+static void script_reload_request_destroy(struct script_reload_request **const req) {
+  if (!req || !*req) {
+    return;
+  }
+  if ((*req)->module_names) {
+    size_t const n = OV_ARRAY_LENGTH((*req)->module_names);
+    for (size_t i = 0; i < n; ++i) {
+      OV_ARRAY_DESTROY(&(*req)->module_names[i]);
+    }
+    OV_ARRAY_DESTROY(&(*req)->module_names);
+  }
+  OV_FREE(req);
+}
+
+static void reload_scripts(void *const data) {
+  struct script_reload_request *req = (struct script_reload_request *)data;
+  char const *const *const names = (char const *const *)req->module_names;
+  size_t const n = OV_ARRAY_LENGTH(req->module_names);
+  struct ov_error err = {0};
+  invalidate_paste_cache(req->ctx);
+  if (gcmz_lua_reload_handlers(req->ctx->lua_ctx, names, n, &err)) {
+    for (size_t i = 0; i < n; ++i) {
+      gcmz_logf_verbose(NULL, "%1$hs", "reloaded script module: %1$hs", names[i]);
+    }
+  } else {
+    gcmz_logf_warn(&err, "%1$hs", "%1$hs", gettext("failed to reload scripts"));
+    OV_ERROR_DESTROY(&err);
+  }
+  script_reload_request_destroy(&req);
+}
+
+/**
+ * @brief Called on the script watcher thread, Lua is only touched on the main thread
+ */
+static void on_scripts_changed(char const *const *const module_names, size_t const count, void *const userdata) {
+  struct script_reload_request *req = NULL;
+  if (!OV_REALLOC(&req, 1, sizeof(struct script_reload_request))) {
+    return;
+  }
+  *req = (struct script_reload_request){.ctx = (struct gcmzdrops *)userdata};
+  if (!OV_ARRAY_GROW(&req->module_names, count)) {
+    script_reload_request_destroy(&req);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    size_t const len = strlen(module_names[i]);
+    char *name = NULL;
+    if (!OV_ARRAY_GROW(&name, len + 1)) {
+      script_reload_request_destroy(&req);
+      return;
+    }
+    memcpy(name, module_names[i], len + 1);
+    req->module_names[i] = name;
+    OV_ARRAY_SET_LENGTH(req->module_names, i + 1);
+  }
+  gcmz_do(reload_scripts, req);
+}
+
 static void finalize(void *const userdata) {
   struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
   if (!ctx) {
     return;
   }
+  if (ctx->script_watcher) {
+    gcmz_script_watcher_destroy(&ctx->script_watcher);
+  }
   if (ctx->tray) {
     gcmz_tray_destroy(&ctx->tray);
   }
@@ -1625,6 +2229,9 @@ static void finalize(void *const userdata) {
   if (ctx->drop) {
     gcmz_drop_destroy(&ctx->drop);
   }
+  if (ctx->lua_pool) {
+    gcmz_lua_pool_destroy(&ctx->lua_pool);
+  }
   if (ctx->config) {
     gcmz_config_destroy(&ctx->config);
   }
@@ -1634,12 +2241,15 @@ static void finalize(void *const userdata) {
   if (ctx->project_path) {
     OV_ARRAY_DESTROY(&ctx->project_path);
   }
+  invalidate_paste_cache(ctx);
   gcmz_delayed_cleanup_exit();
   gcmz_temp_remove_directory();
   gcmz_do_exit();
   gcmz_error_set_owner_window_callback(NULL);
   gcmz_do_sub_destroy(&ctx->do_sub);
   if (ctx->plugin_state != gcmzdrops_plugin_state_not_initialized) {
+    media_info_cache_destroy(ctx);
+    mtx_destroy(&ctx->media_cache_mtx);
     cnd_destroy(&ctx->init_cond);
     mtx_destroy(&ctx->init_mtx);
     ctx->plugin_state = gcmzdrops_plugin_state_not_initialized;
@@ -1762,28 +2372,39 @@ cleanup:
  * @brief Context for get_media_info edit_section callback
  */
 struct get_media_info_context {
-  wchar_t const *filepath_w;       ///< Input: file path (wchar_t)
-  struct aviutl2_media_info *info; ///< Output: media info
-  bool result;                     ///< Result flag
+  wchar_t **filepaths_w;            ///< Input: file paths (wchar_t)
+  size_t const *targets;            ///< Input: indices of the files to probe
+  size_t target_count;              ///< Input: number of targets
+  struct aviutl2_media_info *infos; ///< Output: media info for each file
+  bool *results;                    ///< Output: result flag for each file
+  bool *probed;                     ///< Output: true for each file that get_media_info was actually called for
 };
 
 /**
  * @brief Edit section callback for get_media_info
  *
- * Calls edit->get_media_info within the edit section.
+ * Calls edit->get_media_info for every target within a single edit section.
  */
 static void get_media_info_edit_section(void *param, struct aviutl2_edit_section *edit) {
   struct get_media_info_context *const gmc = (struct get_media_info_context *)param;
   if (!gmc || !edit || !edit->get_media_info) {
     return;
   }
-  gmc->result = edit->get_media_info(gmc->filepath_w, gmc->info, sizeof(*gmc->info));
+  for (size_t i = 0; i < gmc->target_count; ++i) {
+    size_t const t = gmc->targets[i];
+    gmc->results[t] = edit->get_media_info(gmc->filepaths_w[t], &gmc->infos[t], sizeof(gmc->infos[t]));
+    gmc->probed[t] = true;
+  }
 }
 
-static bool
-get_media_info_utf8(char const *filepath, struct aviutl2_media_info *info, void *userdata, struct ov_error *err) {
+static bool get_media_info_batch_utf8(char const *const *const filepaths,
+                                      size_t const count,
+                                      struct aviutl2_media_info *const infos,
+                                      bool *const results,
+                                      void *userdata,
+                                      struct ov_error *err) {
   struct gcmzdrops *const ctx = (struct gcmzdrops *)userdata;
-  if (!filepath || !info) {
+  if (!filepaths || !infos || !results) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return false;
   }
@@ -1797,48 +2418,119 @@ get_media_info_utf8(char const *filepath, struct aviutl2_media_info *info, void
     return false;
   }
 
-  wchar_t *filepath_w = NULL;
+  wchar_t **filepaths_w = NULL;
+  struct media_file_stamp *stamps = NULL;
+  size_t *targets = NULL;
+  bool *probed = NULL;
+  size_t target_count = 0;
   bool result = false;
 
   {
-    int const filepath_len = MultiByteToWideChar(CP_UTF8, 0, filepath, -1, NULL, 0);
-    if (filepath_len <= 0) {
-      OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
-      goto cleanup;
-    }
-
-    if (!OV_ARRAY_GROW(&filepath_w, (size_t)filepath_len)) {
+    if (!OV_ARRAY_GROW(&filepaths_w, count) || !OV_ARRAY_GROW(&stamps, count) || !OV_ARRAY_GROW(&targets, count) ||
+        !OV_ARRAY_GROW(&probed, count)) {
       OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
       goto cleanup;
     }
+    memset(filepaths_w, 0, sizeof(*filepaths_w) * count);
+    memset(probed, 0, sizeof(*probed) * count);
+    OV_ARRAY_SET_LENGTH(filepaths_w, count);
 
-    if (MultiByteToWideChar(CP_UTF8, 0, filepath, -1, filepath_w, filepath_len) <= 0) {
-      OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
-      goto cleanup;
+    for (size_t i = 0; i < count; ++i) {
+      infos[i] = (struct aviutl2_media_info){0};
+      results[i] = false;
+      if (!gcmz_utf8_to_wchar(filepaths[i], &filepaths_w[i], err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+      stamps[i] = filepaths_w[i] ? get_media_file_stamp(filepaths_w[i]) : (struct media_file_stamp){0};
+      if (stamps[i].valid) {
+        mtx_lock(&ctx->media_cache_mtx);
+        struct media_info_cache_entry const *const e =
+            media_info_cache_find(ctx, filepaths[i], strlen(filepaths[i]));
+        bool const hit = e && e->size == stamps[i].size && e->mtime == stamps[i].mtime;
+        if (hit) {
+          infos[i] = e->info;
+          results[i] = e->ok;
+        }
+        mtx_unlock(&ctx->media_cache_mtx);
+        if (hit) {
+          continue;
+        }
+      }
+      if (filepaths_w[i]) {
+        targets[target_count++] = i;
+      }
     }
 
-    // Enter edit section temporarily to call get_media_info
-    struct get_media_info_context gmc = {
-        .filepath_w = filepath_w,
-        .info = info,
-        .result = false,
-    };
-    ctx->edit->call_edit_section_param(&gmc, get_media_info_edit_section);
-    if (!gmc.result) {
-      OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "unsupported media file");
-      goto cleanup;
+    if (target_count) {
+      // Enter edit section once for all files that were not cached
+      struct get_media_info_context gmc = {
+          .filepaths_w = filepaths_w,
+          .targets = targets,
+          .target_count = target_count,
+          .infos = infos,
+          .results = results,
+          .probed = probed,
+      };
+      if (!ctx->edit->call_edit_section_param(&gmc, get_media_info_edit_section)) {
+        OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "failed to enter edit section");
+        goto cleanup;
+      }
+
+      // Files the edit section did not get to are left uncached so that they are probed next time
+      mtx_lock(&ctx->media_cache_mtx);
+      for (size_t i = 0; i < target_count; ++i) {
+        size_t const t = targets[i];
+        if (stamps[t].valid && probed[t]) {
+          media_info_cache_store(ctx, filepaths[t], stamps[t].size, stamps[t].mtime, &infos[t], results[t]);
+        }
+      }
+      mtx_unlock(&ctx->media_cache_mtx);
     }
   }
 
   result = true;
 
 cleanup:
-  if (filepath_w) {
-    OV_ARRAY_DESTROY(&filepath_w);
+  if (filepaths_w) {
+    size_t const n = OV_ARRAY_LENGTH(filepaths_w);
+    for (size_t i = 0; i < n; ++i) {
+      if (filepaths_w[i]) {
+        OV_ARRAY_DESTROY(&filepaths_w[i]);
+      }
+    }
+    OV_ARRAY_DESTROY(&filepaths_w);
+  }
+  if (stamps) {
+    OV_ARRAY_DESTROY(&stamps);
+  }
+  if (targets) {
+    OV_ARRAY_DESTROY(&targets);
+  }
+  if (probed) {
+    OV_ARRAY_DESTROY(&probed);
   }
   return result;
 }
 
+static bool
+get_media_info_utf8(char const *filepath, struct aviutl2_media_info *info, void *userdata, struct ov_error *err) {
+  if (!filepath || !info) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  bool ok = false;
+  if (!get_media_info_batch_utf8(&filepath, 1, info, &ok, userdata, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  if (!ok) {
+    OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "unsupported media file");
+    return false;
+  }
+  return true;
+}
+
 static HICON load_icon(struct ov_error *const err) {
   enum { IDI_APPICON = 101 };
   void *hinstance = NULL;
@@ -1970,6 +2662,12 @@ NODISCARD bool gcmzdrops_create(struct gcmzdrops **const ctx,
       OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
       goto cleanup;
     }
+    if (mtx_init(&c->media_cache_mtx, mtx_plain) != thrd_success) {
+      cnd_destroy(&c->init_cond);
+      mtx_destroy(&c->init_mtx);
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
     c->plugin_state = gcmzdrops_plugin_state_initializing;
 
     {
@@ -2042,6 +2740,7 @@ NODISCARD bool gcmzdrops_create(struct gcmzdrops **const ctx,
         .debug_print = lua_debug_print,
         .script_dir_provider = get_script_directory_utf8,
         .get_media_info = get_media_info_utf8,
+        .get_media_info_batch = get_media_info_batch_utf8,
         .script_modules_key = gcmz_lua_get_script_modules_key(),
         .userdata = c,
         .aviutl2_ver = c->aviutl2_version,
@@ -2058,11 +2757,29 @@ NODISCARD bool gcmzdrops_create(struct gcmzdrops **const ctx,
                             .api_register_callback = register_lua_api,
                             .schedule_cleanup_callback = schedule_cleanup,
                             .create_temp_file_callback = create_temp_file_utf8,
+                            .hook_memory_budget = GCMZ_LUA_HOOK_MEMORY_BUDGET,
                         },
                         err)) {
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
+    // External API requests arrive on their own thread; replicas are only created once requests come in
+    enum { lua_pool_max_replicas = 2 };
+    if (!gcmz_lua_pool_create(&c->lua_pool, c->lua_ctx, lua_pool_max_replicas, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    // Editing scripts while AviUtl is running reloads the changed handlers; saves usually touch
+    // a file several times, so changes are only picked up after a short quiet period
+    {
+      enum { script_reload_debounce_ms = 300 };
+      struct ov_error watch_err = {0};
+      if (!gcmz_script_watcher_create(
+              &c->script_watcher, script_dir, script_reload_debounce_ms, on_scripts_changed, c, &watch_err)) {
+        gcmz_logf_warn(&watch_err, "%1$hs", "%1$hs", gettext("failed to watch script directory"));
+        OV_ERROR_DESTROY(&watch_err);
+      }
+    }
 
     c->drop = gcmz_drop_create(
         &(struct gcmz_drop_options){
@@ -2073,6 +2790,8 @@ NODISCARD bool gcmzdrops_create(struct gcmzdrops **const ctx,
             .drag_enter = lua_drag_enter_adapter,
             .drop = lua_drop_adapter,
             .drag_leave = lua_drag_leave_adapter,
+            .expand_directories = get_directory_expansion,
+            .collapse_sequences = get_sequence_collapsing,
             .userdata = c,
         },
         err);
@@ -2108,6 +2827,10 @@ NODISCARD bool gcmzdrops_create(struct gcmzdrops **const ctx,
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
+    if (!gcmz_tray_add_menu_item(c->tray, tray_menu_export_trace, c, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
     if (!gcmz_tray_add_menu_item(c->tray, tray_menu_test_external_api, c, err)) {
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
@@ -2166,6 +2889,9 @@ handle_project_path_update(struct gcmzdrops *const ctx, wchar_t const *const pro
   bool success = false;
   size_t const path_len = project_path ? wcslen(project_path) : 0;
 
+  // Project based save paths may point somewhere else now
+  invalidate_paste_cache(ctx);
+
   if (!path_len) {
     if (ctx->project_path) {
       ctx->project_path[0] = L'\0';
@@ -2186,6 +2912,7 @@ handle_project_path_update(struct gcmzdrops *const ctx, wchar_t const *const pro
     gcmz_do(update_api_project_data, ctx);
   }
   mtx_unlock(&ctx->init_mtx);
+  gcmz_do(update_project_size, ctx);
 
   success = true;
 
@@ -2231,8 +2958,29 @@ void gcmzdrops_paste_from_clipboard(struct gcmzdrops *const ctx, struct aviutl2_
   struct ov_error err = {0};
   IDataObject *dataobj = NULL;
   struct gcmz_file_list *file_list = NULL;
+  struct clipboard_paste_context paste_ctx = {
+      .edit = edit,
+      .layer = layer,
+      .frame = frame,
+  };
   bool success = false;
 
+  // Read before the clipboard so that a change during extraction only causes a miss next time
+  DWORD const sequence = GetClipboardSequenceNumber();
+  if (paste_cache_is_valid(ctx, sequence)) {
+    gcmz_logf_verbose(NULL,
+                      "%1$zu",
+                      "pasting %1$zu file(s) processed by the previous paste",
+                      gcmz_file_list_count(ctx->paste_cache));
+    on_clipboard_paste_completion(ctx->paste_cache, &paste_ctx);
+    if (!paste_ctx.inserted) {
+      // Process the clipboard again next time rather than repeating the same failure
+      invalidate_paste_cache(ctx);
+    }
+    return;
+  }
+  invalidate_paste_cache(ctx);
+
   HRESULT hr = OleGetClipboard(&dataobj);
   if (FAILED(hr)) {
     OV_ERROR_SET_HRESULT(&err, hr);
@@ -2248,9 +2996,16 @@ void gcmzdrops_paste_from_clipboard(struct gcmzdrops *const ctx, struct aviutl2_
     OV_ERROR_ADD_TRACE(&err);
     goto cleanup;
   }
-  if (!gcmz_dataobj_extract_from_dataobj(dataobj, file_list, &err)) {
-    OV_ERROR_ADD_TRACE(&err);
-    goto cleanup;
+  {
+    struct gcmz_dataobj_options options;
+    if (!get_dataobj_options(ctx, &options, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!gcmz_dataobj_extract_from_dataobj(dataobj, file_list, &options, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
   }
   if (gcmz_file_list_count(file_list) == 0) {
     success = true;
@@ -2258,22 +3013,22 @@ void gcmzdrops_paste_from_clipboard(struct gcmzdrops *const ctx, struct aviutl2_
   }
 
   {
-    bool const r = gcmz_drop_simulate_drop(ctx->drop,
-                                           file_list,
-                                           false,
-                                           on_clipboard_paste_completion,
-                                           &(struct clipboard_paste_context){
-                                               .edit = edit,
-                                               .layer = layer,
-                                               .frame = frame,
-                                           },
-                                           &err);
+    bool const r =
+        gcmz_drop_simulate_drop(ctx->drop, file_list, false, on_clipboard_paste_completion, &paste_ctx, &err);
     if (!r) {
       OV_ERROR_ADD_TRACE(&err);
       goto cleanup;
     }
   }
 
+  // The list now holds the managed files, so the same clipboard can be inserted again without processing.
+  // A failed insertion already reported its error and is not worth repeating from the cache.
+  if (sequence && paste_ctx.inserted) {
+    ctx->paste_cache = file_list;
+    ctx->paste_cache_sequence = sequence;
+    file_list = NULL;
+  }
+
   success = true;
 cleanup:
   if (!success) {
@@ -693,6 +693,8 @@ bool gcmz_ini_reader_iter_sections(struct gcmz_ini_reader const *const reader, s
   }
   internal_section_name_to_section(section->name, section->name_len, &iter->name, &iter->name_len);
   iter->line_number = section->line_number;
+  iter->line = section->line;
+  iter->line_len = section->line_len;
   return true;
 }
 
@@ -723,6 +725,8 @@ bool gcmz_ini_reader_iter_entries(struct gcmz_ini_reader const *const reader,
   iter->name = entry->name;
   iter->name_len = entry->name_len;
   iter->line_number = entry->line_number;
+  iter->line = entry->line;
+  iter->line_len = entry->line_len;
   return true;
 }
 
@@ -84,6 +84,8 @@ struct gcmz_ini_iter {
   char const *name;   ///< Section/entry name (NOT null-terminated, use name_len)
   size_t name_len;    ///< Length of name
   size_t line_number; ///< Line number where item was defined
+  char const *line;   ///< Original line where item was defined (NOT null-terminated, may be NULL)
+  size_t line_len;    ///< Length of line
   size_t index;       ///< Iterator index for next call
   void const *state;  ///< Internal state (do not modify)
 };
@@ -23,6 +23,7 @@
 #include <ovmo.h>
 #include <ovprintf.h>
 #include <ovrand.h>
+#include <ovthreads.h>
 #include <ovutf.h>
 
 #include <ovl/path.h>
@@ -32,15 +33,45 @@
 #include "file.h"
 #include "gcmz_types.h"
 #include "logf.h"
+#include "lua_alloc.h"
 #include "lua_script_module_param.h"
 #include "luautil.h"
 
+enum handler_registration_type {
+  handler_registration_script,
+  handler_registration_script_file,
+  handler_registration_script_module,
+  handler_registration_reload,
+};
+
+/**
+ * @brief Record of a handler or script module added after creation, replayed onto replicas
+ */
+struct handler_registration {
+  enum handler_registration_type type;
+  char *script;      // handler_registration_script
+  wchar_t *filepath; // handler_registration_script_file
+  char *source;      // handler_registration_script, handler_registration_script_module
+  char *module_name; // handler_registration_script_module, handler_registration_reload
+  struct aviutl2_script_module_table *table;
+};
+
 struct gcmz_lua_context {
   lua_State *L;
+  struct gcmz_lua_alloc *alloc; // NULL if L uses the built-in allocator
+  size_t hook_memory_budget;
+  gcmz_lua_api_register_callback api_register_callback;
   gcmz_lua_schedule_cleanup_callback schedule_cleanup_callback;
   gcmz_lua_create_temp_file_callback create_temp_file_callback;
   void *userdata;
+  wchar_t *script_dir;
   int entrypoint_ref; // Lua registry reference for entrypoint module
+
+  // Registrations are appended from the main thread while replicas may be synchronized from other threads
+  mtx_t registrations_mtx;
+  struct handler_registration *registrations;
+  size_t replayed; // Number of source registrations already replayed (replica only)
+  bool replica;
 };
 
 #define LUA_SET_STRING_FIELD(L, key, value)                                                                            \
@@ -74,7 +105,7 @@ struct gcmz_lua_context {
  * @param err [out] Error information on failure
  * @return true on success, false on failure
  */
-static bool create_files_table(lua_State *L, struct gcmz_file_list const *const file_list, struct ov_error *const err) {
+static bool create_files_table(lua_State *L, struct gcmz_file_list *const file_list, struct ov_error *const err) {
   if (!L || !file_list) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
     return false;
@@ -95,11 +126,13 @@ static bool create_files_table(lua_State *L, struct gcmz_file_list const *const
 
     lua_createtable(L, 0, 2);
 
-    if (!gcmz_wchar_to_utf8(file->path, &buffer, err)) {
+    // Cached in the list, every hook of a drag session passes the same paths
+    char const *const filepath = gcmz_file_list_get_path_utf8(file_list, i, err);
+    if (!filepath) {
       OV_ERROR_ADD_TRACE(err);
       goto cleanup;
     }
-    LUA_SET_STRING_FIELD(L, "filepath", buffer);
+    LUA_SET_STRING_FIELD(L, "filepath", filepath);
 
     if (!gcmz_wchar_to_utf8(file->mime_type, &buffer, err)) {
       OV_ERROR_ADD_TRACE(err);
@@ -152,114 +185,18 @@ static bool lua_get_bool_field(lua_State *L, char const *const key, bool default
   return value;
 }
 
-/**
- * @brief Free collected paths array
- */
-static void free_collected_paths(wchar_t ***const paths, size_t count) {
-  if (!paths || !*paths) {
-    return;
-  }
-  for (size_t i = 0; i < count; i++) {
-    if ((*paths)[i]) {
-      OV_ARRAY_DESTROY(&(*paths)[i]);
-    }
-  }
-  OV_ARRAY_DESTROY(paths);
-}
-
-/**
- * @brief Collect file paths from Lua table
- *
- * @param L Lua state
- * @param table_index Stack index of the Lua table
- * @param out_paths [out] Array of collected paths
- * @param out_count [out] Number of paths collected
- * @param err [out] Error information on failure
- * @return true on success, false on failure
- */
-static bool collect_paths_from_table(
-    lua_State *L, int table_index, wchar_t ***const out_paths, size_t *const out_count, struct ov_error *const err) {
-  size_t const table_len = lua_objlen(L, table_index);
-  if (table_len == 0) {
-    *out_paths = NULL;
-    *out_count = 0;
-    return true;
-  }
-
-  wchar_t **paths = NULL;
-  size_t count = 0;
-  bool result = false;
-
-  if (!OV_ARRAY_GROW(&paths, table_len)) {
-    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
-    return false;
-  }
-  for (size_t i = 0; i < table_len; i++) {
-    paths[i] = NULL;
-  }
-
-  for (size_t i = 1; i <= table_len; i++) {
-    lua_rawgeti(L, table_index, (int)i);
-    if (!lua_istable(L, -1)) {
-      lua_pop(L, 1);
-      continue;
-    }
-
-    char const *const filepath = lua_get_string_field(L, "filepath");
-    lua_pop(L, 1); // Pop file entry table
-
-    if (!filepath) {
-      continue;
-    }
-
-    wchar_t *path_w = NULL;
-    if (!gcmz_utf8_to_wchar(filepath, &path_w, err)) {
-      OV_ERROR_ADD_TRACE(err);
-      goto cleanup;
-    }
-    if (path_w) {
-      paths[count++] = path_w;
-    }
-  }
-
-  result = true;
-
-cleanup:
-  if (result) {
-    *out_paths = paths;
-    *out_count = count;
-  } else {
-    free_collected_paths(&paths, count);
-  }
-  return result;
-}
-
-/**
- * @brief Check if path exists in path array
- */
-static bool path_exists_in_array(wchar_t const *const path, wchar_t **const paths, size_t count) {
-  for (size_t i = 0; i < count; i++) {
-    if (paths[i] && wcscmp(path, paths[i]) == 0) {
-      return true;
-    }
-  }
-  return false;
-}
-
 /**
  * @brief Schedule cleanup for removed temporary files
  *
  * @param file_list Existing file list
- * @param new_paths New collected paths
- * @param new_paths_count Number of new collected paths
+ * @param new_list File list built from the table returned by the handlers
  * @param callback Cleanup scheduling callback
  * @param userdata User data passed to callback
  * @param err [out] Error information on failure
  * @return true on success, false on failure
  */
 static bool schedule_removed_temp_files_cleanup(struct gcmz_file_list const *const file_list,
-                                                wchar_t **const new_paths,
-                                                size_t new_paths_count,
+                                                struct gcmz_file_list *const new_list,
                                                 gcmz_lua_schedule_cleanup_callback callback,
                                                 void *userdata,
                                                 struct ov_error *const err) {
@@ -274,7 +211,12 @@ static bool schedule_removed_temp_files_cleanup(struct gcmz_file_list const *con
       continue;
     }
 
-    if (!path_exists_in_array(file->path, new_paths, new_paths_count)) {
+    size_t found = SIZE_MAX;
+    if (!gcmz_file_list_find(new_list, file->path, &found, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      return false;
+    }
+    if (found == SIZE_MAX) {
       if (!callback(file->path, userdata, err)) {
         OV_ERROR_ADD_TRACE(err);
         return false;
@@ -381,35 +323,35 @@ static bool update_file_list_from_table(lua_State *L,
     return true; // Not a table, no update needed
   }
 
-  wchar_t **new_paths = NULL;
-  size_t new_paths_count = 0;
+  struct gcmz_file_list *new_list = NULL;
   wchar_t *path_buffer = NULL;
   wchar_t *mime_buffer = NULL;
   bool result = false;
 
-  if (!collect_paths_from_table(L, table_index, &new_paths, &new_paths_count, err)) {
+  // Build the new list first so that the old one stays intact if an entry is invalid
+  new_list = gcmz_file_list_create(err);
+  if (!new_list) {
     OV_ERROR_ADD_TRACE(err);
     goto cleanup;
   }
-  if (!schedule_removed_temp_files_cleanup(
-          file_list, new_paths, new_paths_count, schedule_cleanup_callback, userdata, err)) {
-    OV_ERROR_ADD_TRACE(err);
-    goto cleanup;
-  }
-  gcmz_file_list_clear(file_list);
   for (size_t i = 1, len = lua_objlen(L, table_index); i <= len; ++i) {
     lua_rawgeti(L, table_index, (int)i);
     if (!lua_istable(L, -1)) {
       lua_pop(L, 1);
       continue;
     }
-    if (!parse_and_add_file_entry(L, file_list, &path_buffer, &mime_buffer, err)) {
+    if (!parse_and_add_file_entry(L, new_list, &path_buffer, &mime_buffer, err)) {
       OV_ERROR_ADD_TRACE(err);
       lua_pop(L, 1);
       goto cleanup;
     }
     lua_pop(L, 1);
   }
+  if (!schedule_removed_temp_files_cleanup(file_list, new_list, schedule_cleanup_callback, userdata, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  gcmz_file_list_swap(file_list, new_list);
 
   result = true;
 
@@ -420,7 +362,7 @@ cleanup:
   if (mime_buffer) {
     OV_ARRAY_DESTROY(&mime_buffer);
   }
-  free_collected_paths(&new_paths, new_paths_count);
+  gcmz_file_list_destroy(&new_list);
   return result;
 }
 
@@ -645,8 +587,22 @@ NODISCARD bool gcmz_lua_create(struct gcmz_lua_context **const ctx, struct ov_er
       goto cleanup;
     }
     *c = (struct gcmz_lua_context){.entrypoint_ref = LUA_NOREF};
+    if (mtx_init(&c->registrations_mtx, mtx_plain) != thrd_success) {
+      OV_FREE(&c);
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
 
-    c->L = luaL_newstate();
+    if (!gcmz_lua_alloc_create(&c->alloc, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    c->L = lua_newstate(gcmz_lua_alloc_fn, c->alloc);
+    if (!c->L) {
+      // LuaJIT built without GC64 on x64 refuses custom allocators
+      gcmz_lua_alloc_destroy(&c->alloc);
+      c->L = luaL_newstate();
+    }
     if (!c->L) {
       OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
       goto cleanup;
@@ -678,11 +634,28 @@ cleanup:
     if (c->L) {
       lua_close(c->L);
     }
+    gcmz_lua_alloc_destroy(&c->alloc);
+    mtx_destroy(&c->registrations_mtx);
     OV_FREE(&c);
   }
   return result;
 }
 
+static void handler_registration_destroy(struct handler_registration *const reg) {
+  if (reg->script) {
+    OV_ARRAY_DESTROY(&reg->script);
+  }
+  if (reg->filepath) {
+    OV_ARRAY_DESTROY(&reg->filepath);
+  }
+  if (reg->source) {
+    OV_ARRAY_DESTROY(&reg->source);
+  }
+  if (reg->module_name) {
+    OV_ARRAY_DESTROY(&reg->module_name);
+  }
+}
+
 void gcmz_lua_destroy(struct gcmz_lua_context **const ctx) {
   if (!ctx || !*ctx) {
     return;
@@ -695,6 +668,18 @@ void gcmz_lua_destroy(struct gcmz_lua_context **const ctx) {
     }
     lua_close(c->L);
   }
+  gcmz_lua_alloc_destroy(&c->alloc);
+  if (c->registrations) {
+    size_t const n = OV_ARRAY_LENGTH(c->registrations);
+    for (size_t i = 0; i < n; ++i) {
+      handler_registration_destroy(&c->registrations[i]);
+    }
+    OV_ARRAY_DESTROY(&c->registrations);
+  }
+  if (c->script_dir) {
+    OV_ARRAY_DESTROY(&c->script_dir);
+  }
+  mtx_destroy(&c->registrations_mtx);
   OV_FREE(ctx);
 }
 
@@ -709,9 +694,21 @@ NODISCARD bool gcmz_lua_setup(struct gcmz_lua_context *const ctx,
   bool result = false;
   char *utf8_dir = NULL;
 
+  ctx->api_register_callback = options->api_register_callback;
   ctx->schedule_cleanup_callback = options->schedule_cleanup_callback;
   ctx->create_temp_file_callback = options->create_temp_file_callback;
   ctx->userdata = options->userdata;
+  ctx->hook_memory_budget = options->hook_memory_budget;
+
+  {
+    // Kept so that replicas can be set up identically
+    size_t const script_dir_len = wcslen(options->script_dir);
+    if (!OV_ARRAY_GROW(&ctx->script_dir, script_dir_len + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    wcscpy(ctx->script_dir, options->script_dir);
+  }
 
   if (options->api_register_callback) {
     if (!options->api_register_callback(ctx->L, options->userdata, err)) {
@@ -776,6 +773,26 @@ struct lua_State *gcmz_lua_get_state(struct gcmz_lua_context const *const ctx) {
   return ctx->L;
 }
 
+/**
+ * @brief Call a hook function on the stack with the per-hook memory budget applied
+ *
+ * Same as gcmz_lua_pcall, except that a memory error caused by the budget is reported as such.
+ */
+static bool call_hook(struct gcmz_lua_context const *const ctx, int nargs, int nresults, struct ov_error *const err) {
+  gcmz_lua_alloc_begin_hook(ctx->alloc, ctx->hook_memory_budget);
+  bool const ok = gcmz_lua_pcall(ctx->L, nargs, nresults, err);
+  if (gcmz_lua_alloc_end_hook(ctx->alloc) && !ok && err) {
+    OV_ERROR_DESTROY(err);
+    OV_ERROR_SETF(err,
+                  ov_error_type_generic,
+                  ov_error_generic_fail,
+                  "%1$zu",
+                  "Lua memory budget of %1$zu bytes exceeded",
+                  ctx->hook_memory_budget);
+  }
+  return ok;
+}
+
 /**
  * Call drag_enter hook via Lua entrypoint module
  */
@@ -825,7 +842,7 @@ NODISCARD bool gcmz_lua_call_drag_enter(struct gcmz_lua_context const *const ctx
   }
 
   // Call drag_enter(files, state) -> files
-  if (!gcmz_lua_pcall(L, 2, 1, err)) {
+  if (!call_hook(ctx, 2, 1, err)) {
     OV_ERROR_ADD_TRACE(err);
     goto cleanup;
   }
@@ -872,7 +889,7 @@ NODISCARD bool gcmz_lua_call_drag_leave(struct gcmz_lua_context const *const ctx
   lua_remove(L, -2); // Remove entrypoint, keep function
 
   // Call drag_leave()
-  if (!gcmz_lua_pcall(L, 0, 0, err)) {
+  if (!call_hook(ctx, 0, 0, err)) {
     OV_ERROR_ADD_TRACE(err);
     lua_settop(L, base_top);
     return false;
@@ -931,7 +948,7 @@ NODISCARD bool gcmz_lua_call_drop(struct gcmz_lua_context const *const ctx,
   }
 
   // Call drop(files, state) -> files
-  if (!gcmz_lua_pcall(L, 2, 1, err)) {
+  if (!call_hook(ctx, 2, 1, err)) {
     OV_ERROR_ADD_TRACE(err);
     goto cleanup;
   }
@@ -989,7 +1006,7 @@ NODISCARD bool gcmz_lua_call_exo_convert(struct gcmz_lua_context const *const ct
   }
 
   // Call exo_convert(files) -> files
-  if (!gcmz_lua_pcall(L, 1, 1, err)) {
+  if (!call_hook(ctx, 1, 1, err)) {
     OV_ERROR_ADD_TRACE(err);
     goto cleanup;
   }
@@ -1007,6 +1024,95 @@ cleanup:
   return result;
 }
 
+static bool copy_string(char const *const src, size_t const len, char **const dest, struct ov_error *const err) {
+  if (!OV_ARRAY_GROW(dest, len + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  memcpy(*dest, src, len);
+  (*dest)[len] = '\0';
+  OV_ARRAY_SET_LENGTH(*dest, len);
+  return true;
+}
+
+/**
+ * @brief Record a successful registration so it can be replayed onto replicas
+ *
+ * Replicas do not record their own registrations since they only mirror the source context.
+ *
+ * @param ctx Lua context the registration was applied to
+ * @param type Registration type
+ * @param script Handler script (handler_registration_script only)
+ * @param script_len Length of script in bytes
+ * @param filepath Handler script path (handler_registration_script_file only)
+ * @param source Source path (UTF-8)
+ * @param module_name Script module name or reloaded handler module name
+ * @param table Script module table (handler_registration_script_module only)
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+static bool record_registration(struct gcmz_lua_context *const ctx,
+                                enum handler_registration_type const type,
+                                char const *const script,
+                                size_t const script_len,
+                                wchar_t const *const filepath,
+                                char const *const source,
+                                char const *const module_name,
+                                struct aviutl2_script_module_table *const table,
+                                struct ov_error *const err) {
+  if (ctx->replica) {
+    return true;
+  }
+
+  struct handler_registration reg = {
+      .type = type,
+      .table = table,
+  };
+  bool result = false;
+
+  {
+    if (script && !copy_string(script, script_len, &reg.script, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    if (filepath) {
+      size_t const filepath_len = wcslen(filepath);
+      if (!OV_ARRAY_GROW(&reg.filepath, filepath_len + 1)) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      wcscpy(reg.filepath, filepath);
+    }
+    if (source && !copy_string(source, strlen(source), &reg.source, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    if (module_name && !copy_string(module_name, strlen(module_name), &reg.module_name, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+
+    mtx_lock(&ctx->registrations_mtx);
+    size_t const n = OV_ARRAY_LENGTH(ctx->registrations);
+    bool const grown = OV_ARRAY_GROW(&ctx->registrations, n + 1);
+    if (grown) {
+      ctx->registrations[n] = reg;
+      OV_ARRAY_SET_LENGTH(ctx->registrations, n + 1);
+      reg = (struct handler_registration){0};
+    }
+    mtx_unlock(&ctx->registrations_mtx);
+    if (!grown) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+  }
+  result = true;
+
+cleanup:
+  handler_registration_destroy(&reg);
+  return result;
+}
+
 NODISCARD bool gcmz_lua_add_handler_script(struct gcmz_lua_context *const ctx,
                                            char const *const script,
                                            size_t const script_len,
@@ -1039,6 +1145,10 @@ NODISCARD bool gcmz_lua_add_handler_script(struct gcmz_lua_context *const ctx,
       lua_pop(L, 2);
       goto cleanup;
     }
+    if (!record_registration(ctx, handler_registration_script, script, script_len, NULL, source, NULL, NULL, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
   }
 
   result = true;
@@ -1084,6 +1194,10 @@ NODISCARD bool gcmz_lua_add_handler_script_file(struct gcmz_lua_context *const c
       lua_pop(L, 2);
       goto cleanup;
     }
+    if (!record_registration(ctx, handler_registration_script_file, NULL, 0, filepath, NULL, NULL, NULL, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
   }
 
   result = true;
@@ -1096,6 +1210,111 @@ cleanup:
   return result;
 }
 
+static bool is_regular_file(wchar_t const *const path) {
+  DWORD const attrs = GetFileAttributesW(path);
+  return attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+NODISCARD bool gcmz_lua_reload_handlers(struct gcmz_lua_context *const ctx,
+                                        char const *const *const module_names,
+                                        size_t const count,
+                                        struct ov_error *const err) {
+  if (!ctx || !ctx->L || !ctx->script_dir || (!module_names && count) || ctx->entrypoint_ref == LUA_NOREF) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  lua_State *L = ctx->L;
+  int base_top = lua_gettop(L);
+  size_t const script_dir_len = wcslen(ctx->script_dir);
+  wchar_t *name = NULL;
+  wchar_t *filepath = NULL;
+  char *utf8_path = NULL;
+  bool result = false;
+
+  {
+    // Get entrypoint.reload_handlers function
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ctx->entrypoint_ref);
+    lua_getfield(L, -1, "reload_handlers");
+    if (!lua_isfunction(L, -1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_unexpected);
+      goto cleanup;
+    }
+    lua_remove(L, -2); // Remove entrypoint, keep function
+
+    // Create table for module info: { { name = "modname", path = "filepath" or nil }, ... }
+    lua_createtable(L, (int)count, 0);
+    int n = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (!module_names[i] || !*module_names[i]) {
+        continue;
+      }
+      if (!gcmz_utf8_to_wchar(module_names[i], &name, err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+      // Same lookup order as package.path: script_dir\name.lua, then script_dir\name\init.lua
+      static wchar_t const init_lua_suffix[] = L"\\init.lua";
+      size_t const name_len = wcslen(name);
+      if (!OV_ARRAY_GROW(&filepath, script_dir_len + 1 + name_len + sizeof(init_lua_suffix) / sizeof(wchar_t))) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      wcscpy(filepath, ctx->script_dir);
+      filepath[script_dir_len] = L'\\';
+      wcscpy(filepath + script_dir_len + 1, name);
+      wcscpy(filepath + script_dir_len + 1 + name_len, L".lua");
+      bool found = is_regular_file(filepath);
+      if (!found) {
+        wcscpy(filepath + script_dir_len + 1 + name_len, init_lua_suffix);
+        found = is_regular_file(filepath);
+      }
+      lua_createtable(L, 0, 2);
+      lua_pushstring(L, module_names[i]);
+      lua_setfield(L, -2, "name");
+      if (found) {
+        if (!gcmz_wchar_to_utf8(filepath, &utf8_path, err)) {
+          OV_ERROR_ADD_TRACE(err);
+          goto cleanup;
+        }
+        lua_pushstring(L, utf8_path);
+        lua_setfield(L, -2, "path");
+      }
+      lua_rawseti(L, -2, ++n);
+    }
+
+    // Call reload_handlers(modinfo)
+    if (!gcmz_lua_pcall(L, 1, 0, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      if (!module_names[i] || !*module_names[i]) {
+        continue;
+      }
+      if (!record_registration(ctx, handler_registration_reload, NULL, 0, NULL, NULL, module_names[i], NULL, err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+    }
+  }
+
+  result = true;
+
+cleanup:
+  lua_settop(L, base_top);
+  if (name) {
+    OV_ARRAY_DESTROY(&name);
+  }
+  if (filepath) {
+    OV_ARRAY_DESTROY(&filepath);
+  }
+  if (utf8_path) {
+    OV_ARRAY_DESTROY(&utf8_path);
+  }
+  return result;
+}
+
 /**
  * @brief Callback wrapper for enum_modules Lua call
  */
@@ -1324,6 +1543,11 @@ bool gcmz_lua_register_script_module(struct gcmz_lua_context *const ctx,
     // Stack: [modules_table]
     lua_pop(L, 1);
     // Stack: []
+
+    if (!record_registration(ctx, handler_registration_script_module, NULL, 0, NULL, source, module_name, table, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
   }
 
   result = true;
@@ -1403,3 +1627,111 @@ cleanup:
   lua_settop(L, base_top);
   return result;
 }
+
+static bool replay_registration(struct gcmz_lua_context *const replica,
+                                struct handler_registration const *const reg,
+                                struct ov_error *const err) {
+  switch (reg->type) {
+  case handler_registration_script:
+    if (!gcmz_lua_add_handler_script(replica, reg->script, OV_ARRAY_LENGTH(reg->script), reg->source, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      return false;
+    }
+    return true;
+  case handler_registration_script_file:
+    if (!gcmz_lua_add_handler_script_file(replica, reg->filepath, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      return false;
+    }
+    return true;
+  case handler_registration_script_module:
+    if (!gcmz_lua_register_script_module(replica, reg->table, reg->module_name, reg->source, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      return false;
+    }
+    return true;
+  case handler_registration_reload: {
+    char const *const module_names[] = {reg->module_name};
+    if (!gcmz_lua_reload_handlers(replica, module_names, 1, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      return false;
+    }
+    return true;
+  }
+  }
+  OV_ERROR_SET_GENERIC(err, ov_error_generic_unexpected);
+  return false;
+}
+
+NODISCARD bool gcmz_lua_sync_replica(struct gcmz_lua_context *const src,
+                                     struct gcmz_lua_context *const replica,
+                                     struct ov_error *const err) {
+  if (!src || !replica || !replica->replica || src == replica) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  bool result = false;
+
+  mtx_lock(&src->registrations_mtx);
+  {
+    size_t const n = OV_ARRAY_LENGTH(src->registrations);
+    for (size_t i = replica->replayed; i < n; ++i) {
+      if (!replay_registration(replica, &src->registrations[i], err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+      replica->replayed = i + 1;
+    }
+  }
+  result = true;
+
+cleanup:
+  mtx_unlock(&src->registrations_mtx);
+  return result;
+}
+
+NODISCARD bool gcmz_lua_create_replica(struct gcmz_lua_context *const src,
+                                       struct gcmz_lua_context **const dest,
+                                       struct ov_error *const err) {
+  if (!src || !src->script_dir || src->entrypoint_ref == LUA_NOREF || !dest || *dest) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  struct gcmz_lua_context *c = NULL;
+  bool result = false;
+
+  {
+    if (!gcmz_lua_create(&c, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    c->replica = true;
+    if (!gcmz_lua_setup(c,
+                        &(struct gcmz_lua_options){
+                            .script_dir = src->script_dir,
+                            .api_register_callback = src->api_register_callback,
+                            .schedule_cleanup_callback = src->schedule_cleanup_callback,
+                            .create_temp_file_callback = src->create_temp_file_callback,
+                            .userdata = src->userdata,
+                            .hook_memory_budget = src->hook_memory_budget,
+                        },
+                        err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    if (!gcmz_lua_sync_replica(src, c, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+  }
+
+  *dest = c;
+  c = NULL;
+  result = true;
+
+cleanup:
+  gcmz_lua_destroy(&c);
+  return result;
+}
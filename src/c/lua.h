@@ -58,6 +58,7 @@ struct gcmz_lua_options {
   gcmz_lua_create_temp_file_callback
       create_temp_file_callback; ///< Callback for creating temporary files (required for EXO conversion)
   void *userdata;                ///< User data passed to all callback functions
+  size_t hook_memory_budget;     ///< Maximum memory growth in bytes while a hook runs (0 for unlimited)
 };
 
 /**
@@ -200,6 +201,26 @@ NODISCARD bool gcmz_lua_add_handler_script_file(struct gcmz_lua_context *const c
                                                 NATIVE_CHAR const *const filepath,
                                                 struct ov_error *const err);
 
+/**
+ * @brief Reload handler modules from the script directory
+ *
+ * Removes the handlers registered from the given modules, drops the modules and their submodules
+ * from package.loaded, and loads them again with require. A module whose file no longer exists is only removed.
+ * Handlers from other modules keep their state.
+ * Waits inside hooks do not dispatch messages, so this only overlaps hooks when a handler runs a message loop
+ * of its own. entrypoint.lua then queues the reload while its busy flag is set and applies it when the hooks finish.
+ *
+ * @param ctx Lua context instance
+ * @param module_names Top-level module names (UTF-8)
+ * @param count Number of module names
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure. Errors in the reloaded scripts are logged, not returned.
+ */
+NODISCARD bool gcmz_lua_reload_handlers(struct gcmz_lua_context *const ctx,
+                                        char const *const *const module_names,
+                                        size_t const count,
+                                        struct ov_error *const err);
+
 /**
  * @brief Callback function type for enumerating handler modules
  *
@@ -284,3 +305,34 @@ NODISCARD bool gcmz_lua_register_script_module(struct gcmz_lua_context *const ct
                                                char const *const module_name,
                                                char const *const source,
                                                struct ov_error *const err);
+
+/**
+ * @brief Create a replica of an initialized Lua context
+ *
+ * The replica is a separate lua_State set up with the same options as src,
+ * then handler scripts and script modules registered to src are replayed onto it in order.
+ * Global variables and module-level state are NOT shared between src and the replica.
+ *
+ * @param src Source Lua context (must have been set up with gcmz_lua_setup)
+ * @param dest [out] Pointer to store the created replica
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_lua_create_replica(struct gcmz_lua_context *const src,
+                                       struct gcmz_lua_context **const dest,
+                                       struct ov_error *const err);
+
+/**
+ * @brief Replay registrations added to src since the replica was created or last synchronized
+ *
+ * Thread-safe with respect to registrations being added to src.
+ * The replica itself must not be used by other threads during the call.
+ *
+ * @param src Source Lua context
+ * @param replica Replica created by gcmz_lua_create_replica from src
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_lua_sync_replica(struct gcmz_lua_context *const src,
+                                     struct gcmz_lua_context *const replica,
+                                     struct ov_error *const err);
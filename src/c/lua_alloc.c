@@ -0,0 +1,226 @@
+#include "lua_alloc.h"
+
+#include <string.h>
+
+#include <ovarray.h>
+
+#ifdef __GNUC__
+#  ifndef __has_warning
+#    define __has_warning(x) 0
+#  endif
+#  pragma GCC diagnostic push
+#  if __has_warning("-Wreserved-macro-identifier")
+#    pragma GCC diagnostic ignored "-Wreserved-macro-identifier"
+#  endif
+#endif // __GNUC__
+#include <lua.h>
+#ifdef __GNUC__
+#  pragma GCC diagnostic pop
+#endif // __GNUC__
+
+enum {
+  size_class_granularity = 16,
+  size_class_count = 16,
+  small_object_max = size_class_granularity * size_class_count,
+  chunk_size = 64 * 1024,
+};
+
+struct free_block {
+  struct free_block *next;
+};
+
+struct gcmz_lua_alloc {
+  struct free_block *free_lists[size_class_count];
+  void **chunks; ///< All chunks carved into small blocks, released on destruction
+  uint8_t *chunk_pos;
+  size_t chunk_remain;
+  size_t hook_base; ///< Value of stats.current when the hook began
+  bool hook_active;
+  struct gcmz_lua_alloc_stats stats;
+};
+
+static size_t size_class(size_t const size) { return (size - 1) / size_class_granularity; }
+
+static void *pool_alloc(struct gcmz_lua_alloc *const a, size_t const cls) {
+  struct free_block *const b = a->free_lists[cls];
+  if (b) {
+    a->free_lists[cls] = b->next;
+    return b;
+  }
+  size_t const block_size = (cls + 1) * size_class_granularity;
+  if (a->chunk_remain < block_size) {
+    // The tail of the previous chunk is smaller than a block and is left unused
+    size_t const n = OV_ARRAY_LENGTH(a->chunks);
+    if (!OV_ARRAY_GROW(&a->chunks, n + 1)) {
+      return NULL;
+    }
+    void *chunk = NULL;
+    if (!OV_REALLOC(&chunk, chunk_size, 1)) {
+      return NULL;
+    }
+    a->chunks[n] = chunk;
+    OV_ARRAY_SET_LENGTH(a->chunks, n + 1);
+    a->chunk_pos = (uint8_t *)chunk;
+    a->chunk_remain = chunk_size;
+    a->stats.pooled += chunk_size;
+  }
+  void *const p = a->chunk_pos;
+  a->chunk_pos += block_size;
+  a->chunk_remain -= block_size;
+  return p;
+}
+
+static void release(struct gcmz_lua_alloc *const a, void *ptr, size_t const size) {
+  if (size <= small_object_max) {
+    struct free_block *const b = (struct free_block *)ptr;
+    size_t const cls = size_class(size);
+    b->next = a->free_lists[cls];
+    a->free_lists[cls] = b;
+    return;
+  }
+  OV_FREE(&ptr);
+}
+
+/**
+ * @brief Track a heap block that is kept as a small block so that destruction frees it
+ *
+ * Once recorded with a small size, the block goes to a free list when Lua releases it.
+ */
+static void adopt_heap_block(struct gcmz_lua_alloc *const a, void *const block) {
+  size_t const n = OV_ARRAY_LENGTH(a->chunks);
+  if (!OV_ARRAY_GROW(&a->chunks, n + 1)) {
+    // Still out of memory, the block is reused by the pool but never freed
+    return;
+  }
+  a->chunks[n] = block;
+  OV_ARRAY_SET_LENGTH(a->chunks, n + 1);
+}
+
+void *gcmz_lua_alloc_fn(void *ud, void *ptr, size_t osize, size_t nsize) {
+  struct gcmz_lua_alloc *const a = (struct gcmz_lua_alloc *)ud;
+  if (!ptr) {
+    osize = 0;
+  }
+  if (nsize == 0) {
+    if (ptr) {
+      release(a, ptr, osize);
+      a->stats.current -= osize;
+    }
+    return NULL;
+  }
+  if (a->hook_active && a->stats.budget && nsize > osize) {
+    size_t const next = a->stats.current + (nsize - osize);
+    if (next > a->hook_base && next - a->hook_base > a->stats.budget) {
+      a->stats.budget_exceeded = true;
+      return NULL;
+    }
+  }
+
+  void *p = NULL;
+  bool const small_old = ptr && osize <= small_object_max;
+  bool const small_new = nsize <= small_object_max;
+  if (small_old && small_new && size_class(osize) == size_class(nsize)) {
+    p = ptr;
+  } else if (ptr && !small_old && !small_new) {
+    p = ptr;
+    if (!OV_REALLOC(&p, nsize, 1)) {
+      if (nsize > osize) {
+        return NULL;
+      }
+      // Lua requires shrinking to succeed, the block just stays larger than needed
+      p = ptr;
+    }
+  } else {
+    if (small_new) {
+      p = pool_alloc(a, size_class(nsize));
+    } else if (!OV_REALLOC(&p, nsize, 1)) {
+      p = NULL;
+    }
+    if (!p) {
+      if (!ptr || nsize > osize) {
+        return NULL;
+      }
+      // Lua requires shrinking to succeed, so the old block is kept even though it is larger than needed
+      if (!small_old) {
+        adopt_heap_block(a, ptr);
+      }
+      p = ptr;
+    } else if (ptr) {
+      memcpy(p, ptr, osize < nsize ? osize : nsize);
+      release(a, ptr, osize);
+    }
+  }
+
+  if (!ptr) {
+    ++a->stats.allocations;
+  }
+  a->stats.current = a->stats.current - osize + nsize;
+  if (a->stats.current > a->stats.peak) {
+    a->stats.peak = a->stats.current;
+  }
+  if (a->stats.current > a->stats.hook_peak) {
+    a->stats.hook_peak = a->stats.current;
+  }
+  return p;
+}
+
+bool gcmz_lua_alloc_create(struct gcmz_lua_alloc **const a, struct ov_error *const err) {
+  if (!a || *a) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  struct gcmz_lua_alloc *na = NULL;
+  if (!OV_REALLOC(&na, 1, sizeof(struct gcmz_lua_alloc))) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  *na = (struct gcmz_lua_alloc){0};
+  *a = na;
+  return true;
+}
+
+void gcmz_lua_alloc_destroy(struct gcmz_lua_alloc **const a) {
+  if (!a || !*a) {
+    return;
+  }
+  struct gcmz_lua_alloc *const na = *a;
+  if (na->chunks) {
+    size_t const n = OV_ARRAY_LENGTH(na->chunks);
+    for (size_t i = 0; i < n; ++i) {
+      OV_FREE(&na->chunks[i]);
+    }
+    OV_ARRAY_DESTROY(&na->chunks);
+  }
+  OV_FREE(a);
+}
+
+void gcmz_lua_alloc_begin_hook(struct gcmz_lua_alloc *const a, size_t const budget) {
+  if (!a) {
+    return;
+  }
+  a->hook_base = a->stats.current;
+  a->hook_active = true;
+  a->stats.hook_peak = a->stats.current;
+  a->stats.budget = budget;
+  a->stats.budget_exceeded = false;
+}
+
+bool gcmz_lua_alloc_end_hook(struct gcmz_lua_alloc *const a) {
+  if (!a) {
+    return false;
+  }
+  a->hook_active = false;
+  return a->stats.budget_exceeded;
+}
+
+bool gcmz_lua_alloc_get_stats(struct lua_State *const L, struct gcmz_lua_alloc_stats *const stats) {
+  if (!L || !stats) {
+    return false;
+  }
+  void *ud = NULL;
+  if (lua_getallocf(L, &ud) != gcmz_lua_alloc_fn || !ud) {
+    return false;
+  }
+  *stats = ((struct gcmz_lua_alloc const *)ud)->stats;
+  return true;
+}
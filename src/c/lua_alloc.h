@@ -0,0 +1,77 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct lua_State;
+struct gcmz_lua_alloc;
+
+/**
+ * @brief Memory statistics of a Lua state using gcmz_lua_alloc
+ */
+struct gcmz_lua_alloc_stats {
+  size_t current;       ///< Bytes currently allocated by Lua
+  size_t peak;          ///< High-water mark of current since the state was created
+  size_t hook_peak;     ///< High-water mark of current since the last gcmz_lua_alloc_begin_hook
+  size_t pooled;        ///< Bytes reserved for small object pools (includes free blocks)
+  uint64_t allocations; ///< Number of allocations made
+  size_t budget;        ///< Budget of the current or last hook, 0 if unlimited
+  bool budget_exceeded; ///< true if an allocation was refused during the current or last hook
+};
+
+/**
+ * @brief Create an allocator for a single Lua state
+ *
+ * Small objects are served from per-size-class free lists carved out of large chunks,
+ * larger ones go to the heap directly. Chunks are only returned on destruction.
+ * The allocator is not thread-safe, same as the Lua state that uses it.
+ *
+ * @param a [out] Pointer to store the created allocator
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_lua_alloc_create(struct gcmz_lua_alloc **const a, struct ov_error *const err);
+
+/**
+ * @brief Destroy the allocator
+ *
+ * Must be called after lua_close of the state using it.
+ *
+ * @param a Pointer to the allocator, set to NULL on return
+ */
+void gcmz_lua_alloc_destroy(struct gcmz_lua_alloc **const a);
+
+/**
+ * @brief lua_Alloc compatible allocation function
+ *
+ * Pass to lua_newstate together with the allocator as ud.
+ */
+void *gcmz_lua_alloc_fn(void *ud, void *ptr, size_t osize, size_t nsize);
+
+/**
+ * @brief Start accounting for a hook call
+ *
+ * While the hook runs, allocations that would grow memory usage beyond budget bytes
+ * above the usage at this point are refused, which makes Lua raise a memory error.
+ * Collectable garbage counts towards the budget until it is collected.
+ *
+ * @param a Allocator
+ * @param budget Maximum growth in bytes, 0 for unlimited
+ */
+void gcmz_lua_alloc_begin_hook(struct gcmz_lua_alloc *const a, size_t const budget);
+
+/**
+ * @brief Stop accounting for a hook call
+ *
+ * @param a Allocator
+ * @return true if an allocation was refused since gcmz_lua_alloc_begin_hook
+ */
+bool gcmz_lua_alloc_end_hook(struct gcmz_lua_alloc *const a);
+
+/**
+ * @brief Get memory statistics of a Lua state
+ *
+ * @param L Lua state
+ * @param stats [out] Statistics
+ * @return true on success, false if the state does not use gcmz_lua_alloc
+ */
+bool gcmz_lua_alloc_get_stats(struct lua_State *const L, struct gcmz_lua_alloc_stats *const stats);
@@ -7,12 +7,18 @@
 #include <windows.h>
 
 #include <ovarray.h>
-#include <ovl/file.h>
 #include <ovmo.h>
 #include <ovutf.h>
 
 #include <aviutl2_plugin2.h>
 
+#include "codec.h"
+#include "copy.h"
+#include "lua_alloc.h"
+#include "lua_async.h"
+#include "lua_ffi.h"
+#include "lua_ini.h"
+#include "lua_json.h"
 #include "luautil.h"
 
 #ifdef __GNUC__
@@ -150,8 +156,8 @@ static bool convert_encoding_internal(char const *src_text,
   bool success = false;
 
   {
-    // Handle same codepage case
-    if (src_codepage == dest_codepage) {
+    // Handle same codepage case; empty input is also copied since the Win32 APIs reject it
+    if (src_codepage == dest_codepage || src_len == 0) {
       if (!OV_ARRAY_GROW(result, src_len + 1)) {
         OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
         goto cleanup;
@@ -255,6 +261,30 @@ cleanup:
   return success;
 }
 
+static bool get_codec_encoding(int const codepage, enum gcmz_codec_encoding *const enc) {
+  switch (codepage) {
+  case ENCODING_SJIS:
+    *enc = gcmz_codec_encoding_sjis;
+    return true;
+  case ENCODING_UTF8:
+    *enc = gcmz_codec_encoding_utf8;
+    return true;
+  case ENCODING_UTF16LE:
+    *enc = gcmz_codec_encoding_utf16le;
+    return true;
+  case ENCODING_UTF16BE:
+    *enc = gcmz_codec_encoding_utf16be;
+    return true;
+  case ENCODING_ANSI:
+    if (GetACP() == ENCODING_SJIS) {
+      *enc = gcmz_codec_encoding_sjis;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
 static int gcmz_lua_convert_encoding(lua_State *L) {
   char const *src_text = luaL_checkstring(L, 1);
   char const *src_encoding = luaL_checkstring(L, 2);
@@ -277,7 +307,28 @@ static int gcmz_lua_convert_encoding(lua_State *L) {
   struct ov_error err = {0};
   char *result = NULL;
   size_t result_len = 0;
-  size_t src_len = strlen(src_text);
+  size_t src_len = 0;
+  lua_tolstring(L, 1, &src_len);
+
+  // The built-in codec handles the common encodings without going through an intermediate wchar_t buffer.
+  // Its output only differs from Win32 when something had to be replaced, in which case Win32 is used instead.
+  enum gcmz_codec_encoding src_enc;
+  enum gcmz_codec_encoding dest_enc;
+  if (get_codec_encoding(src_codepage, &src_enc) && get_codec_encoding(dest_codepage, &dest_enc)) {
+    size_t replaced = 0;
+    if (!gcmz_codec_convert(src_text, src_len, src_enc, dest_enc, &result, &replaced, &err)) {
+      if (result) {
+        OV_ARRAY_DESTROY(&result);
+      }
+      return gcmz_luafn_result_err(L, &err);
+    }
+    if (!replaced) {
+      lua_pushlstring(L, result, OV_ARRAY_LENGTH(result));
+      OV_ARRAY_DESTROY(&result);
+      return 1;
+    }
+    OV_ARRAY_DESTROY(&result);
+  }
 
   if (!convert_encoding_internal(src_text, src_len, src_codepage, dest_codepage, &result, &result_len, &err)) {
     if (result) {
@@ -316,6 +367,42 @@ static int gcmz_lua_create_temp_file(lua_State *L) {
   return 1;
 }
 
+static wchar_t *save_path_provider_wchar(wchar_t const *filename, void *userdata, struct ov_error *err) {
+  (void)userdata;
+  char *filename_utf8 = NULL;
+  char *path = NULL;
+  wchar_t *path_w = NULL;
+  wchar_t *result = NULL;
+
+  if (!gcmz_wchar_to_utf8(filename, &filename_utf8, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  path = g_lua_api_options.save_path_provider(g_lua_api_options.userdata, filename_utf8, err);
+  if (!path) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  if (!gcmz_utf8_to_wchar(path, &path_w, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  result = path_w;
+  path_w = NULL;
+
+cleanup:
+  if (path_w) {
+    OV_ARRAY_DESTROY(&path_w);
+  }
+  if (path) {
+    OV_ARRAY_DESTROY(&path);
+  }
+  if (filename_utf8) {
+    OV_ARRAY_DESTROY(&filename_utf8);
+  }
+  return result;
+}
+
 static int gcmz_lua_save_file(lua_State *L) {
   char const *src_path = luaL_checkstring(L, 1);
   char const *dest_filename = luaL_checkstring(L, 2);
@@ -328,106 +415,72 @@ static int gcmz_lua_save_file(lua_State *L) {
     return luaL_error(L, "save_file is not available (no save path provider configured)");
   }
 
+  bool dedupe = false;
+  if (!lua_isnoneornil(L, 3)) {
+    luaL_checktype(L, 3, LUA_TTABLE);
+    lua_getfield(L, 3, "dedupe");
+    dedupe = lua_toboolean(L, -1) != 0;
+    lua_pop(L, 1);
+  }
+
   struct ov_error err = {0};
   char *dest_path = NULL;
   wchar_t *src_path_w = NULL;
+  wchar_t *dest_filename_w = NULL;
   wchar_t *dest_path_w = NULL;
-  struct ovl_file *src_file = NULL;
-  struct ovl_file *dest_file = NULL;
-  char *buffer = NULL;
+  bool reused = false;
   int result = -1;
 
   {
-    dest_path = g_lua_api_options.save_path_provider(g_lua_api_options.userdata, dest_filename, &err);
-    if (!dest_path) {
+    if (!gcmz_utf8_to_wchar(src_path, &src_path_w, &err)) {
       OV_ERROR_ADD_TRACE(&err);
       goto cleanup;
     }
 
-    size_t const src_len = strlen(src_path);
-    size_t const src_wlen = ov_utf8_to_wchar_len(src_path, src_len);
-    if (src_wlen == 0) {
-      OV_ERROR_SET_GENERIC(&err, ov_error_generic_invalid_argument);
-      goto cleanup;
-    }
-    if (!OV_ARRAY_GROW(&src_path_w, src_wlen + 1)) {
-      OV_ERROR_SET_GENERIC(&err, ov_error_generic_out_of_memory);
-      goto cleanup;
-    }
-    ov_utf8_to_wchar(src_path, src_len, src_path_w, src_wlen + 1, NULL);
-
-    size_t const dest_len = strlen(dest_path);
-    size_t const dest_wlen = ov_utf8_to_wchar_len(dest_path, dest_len);
-    if (dest_wlen == 0) {
-      OV_ERROR_SET_GENERIC(&err, ov_error_generic_invalid_argument);
-      goto cleanup;
-    }
-    if (!OV_ARRAY_GROW(&dest_path_w, dest_wlen + 1)) {
-      OV_ERROR_SET_GENERIC(&err, ov_error_generic_out_of_memory);
-      goto cleanup;
-    }
-    ov_utf8_to_wchar(dest_path, dest_len, dest_path_w, dest_wlen + 1, NULL);
-
-    if (!ovl_file_open(src_path_w, &src_file, &err)) {
-      OV_ERROR_ADD_TRACE(&err);
-      goto cleanup;
-    }
-    uint64_t file_size = 0;
-    if (!ovl_file_size(src_file, &file_size, &err)) {
-      OV_ERROR_ADD_TRACE(&err);
-      goto cleanup;
-    }
-    if (!ovl_file_create(dest_path_w, &dest_file, &err)) {
-      OV_ERROR_ADD_TRACE(&err);
-      goto cleanup;
-    }
-    static size_t const chunk_size = 64 * 1024;
-    if (!OV_ARRAY_GROW(&buffer, chunk_size)) {
-      OV_ERROR_SET_GENERIC(&err, ov_error_generic_out_of_memory);
-      goto cleanup;
-    }
-    uint64_t remaining = file_size;
-    while (remaining > 0) {
-      size_t const to_read = remaining > chunk_size ? chunk_size : (size_t)remaining;
-      size_t bytes_read = 0;
-      if (!ovl_file_read(src_file, buffer, to_read, &bytes_read, &err)) {
+    if (dedupe) {
+      // Same content-addressed naming and reuse as files copied by the drop pipeline
+      if (!gcmz_utf8_to_wchar(dest_filename, &dest_filename_w, &err)) {
         OV_ERROR_ADD_TRACE(&err);
         goto cleanup;
       }
-      if (bytes_read == 0) {
-        break;
+      if (!gcmz_copy_hashed(
+              src_path_w, dest_filename_w, save_path_provider_wchar, NULL, NULL, &dest_path_w, &reused, &err)) {
+        OV_ERROR_ADD_TRACE(&err);
+        goto cleanup;
       }
-      size_t bytes_written = 0;
-      if (!ovl_file_write(dest_file, buffer, bytes_read, &bytes_written, &err)) {
+      if (!gcmz_wchar_to_utf8(dest_path_w, &dest_path, &err)) {
         OV_ERROR_ADD_TRACE(&err);
         goto cleanup;
       }
-      if (bytes_written != bytes_read) {
-        OV_ERROR_SET_GENERIC(&err, ov_error_generic_fail);
+    } else {
+      dest_path = g_lua_api_options.save_path_provider(g_lua_api_options.userdata, dest_filename, &err);
+      if (!dest_path) {
+        OV_ERROR_ADD_TRACE(&err);
+        goto cleanup;
+      }
+      if (!gcmz_utf8_to_wchar(dest_path, &dest_path_w, &err)) {
+        OV_ERROR_ADD_TRACE(&err);
+        goto cleanup;
+      }
+      // CopyFileW lets the file system clone blocks where supported instead of streaming through user space
+      if (!CopyFileW(src_path_w, dest_path_w, FALSE)) {
+        OV_ERROR_SET_HRESULT(&err, HRESULT_FROM_WIN32(GetLastError()));
         goto cleanup;
       }
-      remaining -= bytes_read;
     }
     lua_pushstring(L, dest_path);
+    lua_pushboolean(L, reused);
   }
 
-  result = 1;
+  result = 2;
 
 cleanup:
-  if (buffer) {
-    OV_ARRAY_DESTROY(&buffer);
-  }
-  if (dest_file) {
-    ovl_file_close(dest_file);
-    dest_file = NULL;
-  }
-  if (src_file) {
-    ovl_file_close(src_file);
-    src_file = NULL;
-  }
   if (dest_path_w) {
     OV_ARRAY_DESTROY(&dest_path_w);
   }
+  if (dest_filename_w) {
+    OV_ARRAY_DESTROY(&dest_filename_w);
+  }
   if (src_path_w) {
     OV_ARRAY_DESTROY(&src_path_w);
   }
@@ -464,6 +517,43 @@ static int gcmz_lua_get_versions(lua_State *L) {
   return 1;
 }
 
+// Returns nil if the state does not use gcmz_lua_alloc
+static int gcmz_lua_get_memory_stats(lua_State *L) {
+  struct gcmz_lua_alloc_stats stats;
+  if (!gcmz_lua_alloc_get_stats(L, &stats)) {
+    lua_pushnil(L);
+    return 1;
+  }
+
+  lua_createtable(L, 0, 6);
+
+  lua_pushstring(L, "current");
+  lua_pushnumber(L, (lua_Number)stats.current);
+  lua_settable(L, -3);
+
+  lua_pushstring(L, "peak");
+  lua_pushnumber(L, (lua_Number)stats.peak);
+  lua_settable(L, -3);
+
+  lua_pushstring(L, "hook_peak");
+  lua_pushnumber(L, (lua_Number)stats.hook_peak);
+  lua_settable(L, -3);
+
+  lua_pushstring(L, "pooled");
+  lua_pushnumber(L, (lua_Number)stats.pooled);
+  lua_settable(L, -3);
+
+  lua_pushstring(L, "allocations");
+  lua_pushnumber(L, (lua_Number)stats.allocations);
+  lua_settable(L, -3);
+
+  lua_pushstring(L, "budget");
+  lua_pushnumber(L, (lua_Number)stats.budget);
+  lua_settable(L, -3);
+
+  return 1;
+}
+
 static int gcmz_lua_get_script_directory(lua_State *L) {
   if (!g_lua_api_options.script_dir_provider) {
     return luaL_error(L, "get_script_directory is not available (no script directory provider configured)");
@@ -489,6 +579,39 @@ cleanup:
   return result < 0 ? gcmz_luafn_result_err(L, &err) : result;
 }
 
+static void push_media_info(lua_State *L, struct aviutl2_media_info const *const info) {
+  lua_createtable(L, 0, 5);
+
+  // video_track_num and audio_track_num are always present (0 has meaning)
+  lua_pushstring(L, "video_track_num");
+  lua_pushinteger(L, info->video_track_num);
+  lua_settable(L, -3);
+
+  lua_pushstring(L, "audio_track_num");
+  lua_pushinteger(L, info->audio_track_num);
+  lua_settable(L, -3);
+
+  // total_time is nil for still images (video_track_num > 0 but no duration)
+  lua_pushstring(L, "total_time");
+  if (info->video_track_num > 0 && info->total_time <= 0) {
+    lua_pushnil(L); // still image
+  } else {
+    lua_pushnumber(L, info->total_time);
+  }
+  lua_settable(L, -3);
+
+  // width and height are nil for audio-only files
+  if (info->video_track_num > 0) {
+    lua_pushstring(L, "width");
+    lua_pushinteger(L, info->width);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "height");
+    lua_pushinteger(L, info->height);
+    lua_settable(L, -3);
+  }
+}
+
 static int gcmz_lua_get_media_info(lua_State *L) {
   if (!g_lua_api_options.get_media_info) {
     return luaL_error(L, "get_media_info is not available (no media info provider configured)");
@@ -508,40 +631,88 @@ static int gcmz_lua_get_media_info(lua_State *L) {
     goto cleanup;
   }
 
-  lua_createtable(L, 0, 5);
-
-  // video_track_num and audio_track_num are always present (0 has meaning)
-  lua_pushstring(L, "video_track_num");
-  lua_pushinteger(L, info.video_track_num);
-  lua_settable(L, -3);
+  push_media_info(L, &info);
+  result = 1;
 
-  lua_pushstring(L, "audio_track_num");
-  lua_pushinteger(L, info.audio_track_num);
-  lua_settable(L, -3);
+cleanup:
+  return result < 0 ? gcmz_luafn_result_err(L, &err) : result;
+}
 
-  // total_time is nil for still images (video_track_num > 0 but no duration)
-  lua_pushstring(L, "total_time");
-  if (info.video_track_num > 0 && info.total_time <= 0) {
-    lua_pushnil(L); // still image
-  } else {
-    lua_pushnumber(L, info.total_time);
+// Returns a table with an info table (or false if unsupported) for each path
+static int gcmz_lua_get_media_info_batch(lua_State *L) {
+  if (!g_lua_api_options.get_media_info_batch && !g_lua_api_options.get_media_info) {
+    return luaL_error(L, "get_media_info_batch is not available (no media info provider configured)");
+  }
+  luaL_checktype(L, 1, LUA_TTABLE);
+  size_t const count = lua_objlen(L, 1);
+  for (size_t i = 0; i < count; ++i) {
+    lua_rawgeti(L, 1, (int)(i + 1));
+    char const *const filepath = lua_tostring(L, -1);
+    lua_pop(L, 1);
+    if (!filepath || !*filepath) {
+      return luaL_error(L, "get_media_info_batch requires filepath at index %d", (int)(i + 1));
+    }
   }
-  lua_settable(L, -3);
 
-  // width and height are nil for audio-only files
-  if (info.video_track_num > 0) {
-    lua_pushstring(L, "width");
-    lua_pushinteger(L, info.width);
-    lua_settable(L, -3);
+  struct ov_error err = {0};
+  char const **filepaths = NULL;
+  struct aviutl2_media_info *infos = NULL;
+  bool *results = NULL;
+  int result = -1;
 
-    lua_pushstring(L, "height");
-    lua_pushinteger(L, info.height);
-    lua_settable(L, -3);
+  {
+    if (!OV_ARRAY_GROW(&filepaths, count + 1) || !OV_ARRAY_GROW(&infos, count + 1) ||
+        !OV_ARRAY_GROW(&results, count + 1)) {
+      OV_ERROR_SET_GENERIC(&err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    // Strings stay alive because they are referenced from the argument table
+    for (size_t i = 0; i < count; ++i) {
+      lua_rawgeti(L, 1, (int)(i + 1));
+      filepaths[i] = lua_tostring(L, -1);
+      lua_pop(L, 1);
+      infos[i] = (struct aviutl2_media_info){0};
+      results[i] = false;
+    }
+
+    if (g_lua_api_options.get_media_info_batch) {
+      if (!g_lua_api_options.get_media_info_batch(filepaths, count, infos, results, g_lua_api_options.userdata, &err)) {
+        OV_ERROR_ADD_TRACE(&err);
+        goto cleanup;
+      }
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        struct ov_error e = {0};
+        results[i] = g_lua_api_options.get_media_info(filepaths[i], &infos[i], g_lua_api_options.userdata, &e);
+        if (!results[i]) {
+          OV_ERROR_DESTROY(&e);
+        }
+      }
+    }
+
+    lua_createtable(L, (int)count, 0);
+    for (size_t i = 0; i < count; ++i) {
+      if (results[i]) {
+        push_media_info(L, &infos[i]);
+      } else {
+        lua_pushboolean(L, 0);
+      }
+      lua_rawseti(L, -2, (int)(i + 1));
+    }
   }
 
   result = 1;
 
 cleanup:
+  if (results) {
+    OV_ARRAY_DESTROY(&results);
+  }
+  if (infos) {
+    OV_ARRAY_DESTROY(&infos);
+  }
+  if (filepaths) {
+    OV_ARRAY_DESTROY(&filepaths);
+  }
   return result < 0 ? gcmz_luafn_result_err(L, &err) : result;
 }
 
@@ -1007,6 +1178,10 @@ bool gcmz_lua_api_register(struct lua_State *const L, struct ov_error *const err
   lua_setfield(L, -2, "decode_exo_text");
   lua_pushcfunction(L, gcmz_lua_get_media_info);
   lua_setfield(L, -2, "get_media_info");
+  lua_pushcfunction(L, gcmz_lua_get_media_info_batch);
+  lua_setfield(L, -2, "get_media_info_batch");
+  lua_pushcfunction(L, gcmz_lua_get_memory_stats);
+  lua_setfield(L, -2, "get_memory_stats");
   lua_pushcfunction(L, gcmz_lua_get_project_data);
   lua_setfield(L, -2, "get_project_data");
   lua_pushcfunction(L, gcmz_lua_get_script_directory);
@@ -1017,6 +1192,11 @@ bool gcmz_lua_api_register(struct lua_State *const L, struct ov_error *const err
   lua_setfield(L, -2, "get_versions");
   lua_pushcfunction(L, gcmz_lua_save_file);
   lua_setfield(L, -2, "save_file");
+  if (!gcmz_lua_async_register(L, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    lua_pop(L, 1);
+    return false;
+  }
   lua_setglobal(L, "gcmz");
 
   // Register global helper functions
@@ -1025,5 +1205,19 @@ bool gcmz_lua_api_register(struct lua_State *const L, struct ov_error *const err
   lua_pushcfunction(L, global_lua_i18n);
   lua_setglobal(L, "i18n");
 
+  // Native json/ini modules take precedence over json.lua/ini.lua via package.preload
+  if (!gcmz_lua_json_register(L, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  if (!gcmz_lua_ini_register(L, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+  if (!gcmz_lua_ffi_register(L, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    return false;
+  }
+
   return true;
 }
@@ -73,6 +73,26 @@ typedef NODISCARD bool (*gcmz_lua_api_get_media_info_fn)(char const *filepath,
                                                          void *userdata,
                                                          struct ov_error *err);
 
+/**
+ * @brief Callback function type for getting information of multiple media files at once
+ *
+ * Unsupported files are not an error; their entry in results is set to false.
+ *
+ * @param filepaths Media file paths (UTF-8)
+ * @param count Number of paths
+ * @param infos [out] Media information for each path
+ * @param results [out] true for each path whose information was retrieved
+ * @param userdata User-provided data
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+typedef NODISCARD bool (*gcmz_lua_api_get_media_info_batch_fn)(char const *const *filepaths,
+                                                               size_t count,
+                                                               struct aviutl2_media_info *infos,
+                                                               bool *results,
+                                                               void *userdata,
+                                                               struct ov_error *err);
+
 /**
  * @brief Options for Lua API registration
  */
@@ -83,6 +103,7 @@ struct gcmz_lua_api_options {
   gcmz_lua_api_debug_print_fn debug_print;
   gcmz_lua_api_script_dir_provider_fn script_dir_provider;
   gcmz_lua_api_get_media_info_fn get_media_info;
+  gcmz_lua_api_get_media_info_batch_fn get_media_info_batch; ///< Optional, falls back to get_media_info
   char const *script_modules_key;
   void *userdata;
   uint32_t aviutl2_ver;
@@ -5,10 +5,15 @@
 #include <ovarray.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <aviutl2_plugin2.h>
 
+#define STRINGIZE2(x) #x
+#define STRINGIZE(x) STRINGIZE2(x)
+#define INI_LUA_PATH STRINGIZE(SOURCE_DIR) "/../lua/ini.lua"
+
 #ifdef __GNUC__
 #  ifndef __has_warning
 #    define __has_warning(x) 0
@@ -335,6 +340,191 @@ static void test_get_script_directory(void) {
   gcmz_lua_api_set_options(NULL);
 }
 
+// Mock callback for save_file, saves directly under %TEMP%
+static char *mock_get_save_path(void *userdata, char const *filename, struct ov_error *err) {
+  (void)userdata;
+  char const *const temp = getenv("TEMP");
+  if (!temp) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    return NULL;
+  }
+  size_t const temp_len = strlen(temp);
+  size_t const filename_len = strlen(filename);
+  char *result = NULL;
+  if (!OV_ARRAY_GROW(&result, temp_len + 1 + filename_len + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return NULL;
+  }
+  memcpy(result, temp, temp_len);
+  result[temp_len] = '\\';
+  memcpy(result + temp_len + 1, filename, filename_len + 1);
+  return result;
+}
+
+static void test_save_file(void) {
+  lua_State *L = luaL_newstate();
+  TEST_ASSERT(L != NULL);
+
+  luaL_openlibs(L);
+
+  gcmz_lua_api_set_options(&(struct gcmz_lua_api_options){
+      .save_path_provider = mock_get_save_path,
+  });
+
+  struct ov_error err = {0};
+  if (!TEST_SUCCEEDED(gcmz_lua_api_register(L, &err), &err)) {
+    lua_close(L);
+    gcmz_lua_api_set_options(NULL);
+    return;
+  }
+
+  static char const script[] =
+      "local src = os.getenv('TEMP') .. '\\\\gcmz_lua_save_file_src.txt' "
+      "local f = io.open(src, 'wb') f:write('save_file test') f:close() "
+      "local plain, plain_reused = gcmz.save_file(src, 'gcmz_lua_save_file_plain.gcmztest') "
+      "local first, first_reused = gcmz.save_file(src, 'gcmz_lua_save_file.gcmztest', {dedupe = true}) "
+      "local second, second_reused = gcmz.save_file(src, 'other_name.gcmztest', {dedupe = true}) "
+      "f = io.open(first, 'rb') local content = f:read('*a') f:close() "
+      "os.remove(src) os.remove(plain) os.remove(first) "
+      "return table.concat({plain:match('[^\\\\]+$'), tostring(plain_reused), tostring(first_reused), "
+      "tostring(first:match('gcmz_lua_save_file%.%x+%.gcmztest$') ~= nil), tostring(second_reused), "
+      "tostring(first == second), content}, '|')";
+  if (TEST_CHECK(luaL_dostring(L, script) == LUA_OK)) {
+    char const *const expected = "gcmz_lua_save_file_plain.gcmztest|false|false|true|true|true|save_file test";
+    TEST_CHECK(strcmp(lua_tostring(L, -1), expected) == 0);
+    TEST_MSG("want %s, got %s", expected, lua_tostring(L, -1));
+  } else {
+    TEST_MSG("error: %s", lua_tostring(L, -1));
+  }
+  lua_pop(L, 1);
+
+  lua_close(L);
+  gcmz_lua_api_set_options(NULL);
+}
+
+// Mock callbacks for get_media_info, only "*.mp4" is supported
+static bool mock_get_media_info(char const *filepath,
+                                struct aviutl2_media_info *info,
+                                void *userdata,
+                                struct ov_error *err) {
+  (void)userdata;
+  size_t const len = strlen(filepath);
+  if (len < 4 || strcmp(filepath + len - 4, ".mp4") != 0) {
+    OV_ERROR_SET(err, ov_error_type_generic, ov_error_generic_fail, "unsupported media file");
+    return false;
+  }
+  *info = (struct aviutl2_media_info){
+      .video_track_num = 1,
+      .audio_track_num = 1,
+      .total_time = 2.5,
+      .width = 1920,
+      .height = 1080,
+  };
+  return true;
+}
+
+static bool mock_get_media_info_batch(char const *const *filepaths,
+                                      size_t count,
+                                      struct aviutl2_media_info *infos,
+                                      bool *results,
+                                      void *userdata,
+                                      struct ov_error *err) {
+  (void)err;
+  ++*(int *)userdata;
+  for (size_t i = 0; i < count; ++i) {
+    struct ov_error e = {0};
+    results[i] = mock_get_media_info(filepaths[i], &infos[i], NULL, &e);
+    if (!results[i]) {
+      OV_ERROR_DESTROY(&e);
+    }
+  }
+  return true;
+}
+
+static void test_get_media_info_batch(void) {
+  static char const script[] =
+      "local r = gcmz.get_media_info_batch({'a.mp4', 'b.txt', 'c.mp4'}) "
+      "return table.concat({#r, r[1].width, r[1].height, tostring(r[2]), r[3].total_time}, '|')";
+  static char const expected[] = "3|1920|1080|false|2.5";
+  int batch_calls = 0;
+  struct {
+    char const *name;
+    struct gcmz_lua_api_options options;
+    int want_batch_calls;
+  } const cases[] = {
+      {"fallback", {.get_media_info = mock_get_media_info}, 0},
+      {"batch",
+       {
+           .get_media_info = mock_get_media_info,
+           .get_media_info_batch = mock_get_media_info_batch,
+           .userdata = &batch_calls,
+       },
+       1},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    TEST_CASE(cases[i].name);
+    lua_State *L = luaL_newstate();
+    TEST_ASSERT(L != NULL);
+    luaL_openlibs(L);
+    gcmz_lua_api_set_options(&cases[i].options);
+    batch_calls = 0;
+
+    struct ov_error err = {0};
+    if (TEST_SUCCEEDED(gcmz_lua_api_register(L, &err), &err)) {
+      if (TEST_CHECK(luaL_dostring(L, script) == LUA_OK)) {
+        TEST_CHECK(strcmp(lua_tostring(L, -1), expected) == 0);
+        TEST_MSG("want %s, got %s", expected, lua_tostring(L, -1));
+      } else {
+        TEST_MSG("error: %s", lua_tostring(L, -1));
+      }
+      lua_pop(L, 1);
+      TEST_CHECK(batch_calls == cases[i].want_batch_calls);
+    }
+
+    lua_close(L);
+    gcmz_lua_api_set_options(NULL);
+  }
+}
+
+static void test_ffi(void) {
+  lua_State *L = luaL_newstate();
+  TEST_ASSERT(L != NULL);
+
+  luaL_openlibs(L);
+
+  struct ov_error err = {0};
+  if (!TEST_SUCCEEDED(gcmz_lua_api_register(L, &err), &err)) {
+    lua_close(L);
+    return;
+  }
+
+  static char const script[] =
+      "local gf = require('gcmz_ffi') "
+      "local path = os.getenv('TEMP') .. '\\\\gcmz_lua_ffi_test.bin' "
+      "local buf = gf.from_string('abcdef') "
+      "local p = buf:ptr() "
+      "for i = 0, #buf - 1 do p[i] = p[i] - 32 end "
+      "buf:ptr(4, 2)[1] = 0x21 "
+      "buf:save(path) "
+      "local loaded = gf.load(path) "
+      "os.remove(path) "
+      "local z = gf.new(3) "
+      "local ok = pcall(buf.ptr, buf, 5, 2) "
+      "local _, n1 = buf:ptr(2) local _, n2 = buf:ptr(1, 3) "
+      "return table.concat({loaded:tostring(), loaded:tostring(1, 2), #z, z:ptr()[2], tostring(ok), "
+      "#gf.new(0), n1, n2}, '|')";
+  if (TEST_CHECK(luaL_dostring(L, script) == LUA_OK)) {
+    char const *const expected = "ABCDE!|BC|3|0|false|0|4|3";
+    TEST_CHECK(strcmp(lua_tostring(L, -1), expected) == 0);
+    TEST_MSG("want %s, got %s", expected, lua_tostring(L, -1));
+  } else {
+    TEST_MSG("error: %s", lua_tostring(L, -1));
+  }
+  lua_pop(L, 1);
+
+  lua_close(L);
+}
+
 static void test_get_script_directory_no_provider(void) {
   lua_State *L = luaL_newstate();
   TEST_ASSERT(L != NULL);
@@ -453,6 +643,260 @@ static void test_i18n(void) {
   gcmz_lua_api_set_options(NULL);
 }
 
+static void test_json(void) {
+  lua_State *L = luaL_newstate();
+  TEST_ASSERT(L != NULL);
+
+  luaL_openlibs(L);
+
+  struct ov_error err = {0};
+  if (!TEST_SUCCEEDED(gcmz_lua_api_register(L, &err), &err)) {
+    lua_close(L);
+    return;
+  }
+
+  // require('json') must resolve to the native module registered in package.preload
+  int result = luaL_dostring(L, "return type(package.preload.json) == 'function' and type(require('json').decode)");
+  TEST_CHECK(result == LUA_OK);
+  TEST_CHECK(lua_isstring(L, -1) && strcmp(lua_tostring(L, -1), "function") == 0);
+  lua_pop(L, 1);
+
+  static struct {
+    char const *name;
+    char const *script;
+  } const cases[] = {
+      {"decode object",
+       "local t = require('json').decode('{\"a\":1,\"b\":\"x\",\"c\":true}') return t.a == 1 and t.b == 'x' and t.c "
+       "== true"},
+      {"decode array",
+       "local t = require('json').decode(' [1, 2, 3, \"four\"] ') return #t == 4 and t[1] == 1 and t[4] == 'four'"},
+      {"decode null in object",
+       "local t = require('json').decode('{\"v\":null}') return t.v == nil and next(t) == nil"},
+      {"decode null in array",
+       "local t = require('json').decode('[1,null,3]') return t[1] == 1 and t[2] == nil and t[3] == 3"},
+      {"decode null", "return require('json').decode('null') == nil"},
+      {"decode escapes",
+       "return require('json').decode('\"a\\\\n\\\\u3042\\\\ud83c\\\\udf19\\\\/\"') == "
+       "'a\\n\\227\\129\\130\\240\\159\\140\\153/'"},
+      {"decode embedded nul", "return require('json').decode('\"a\\\\u0000b\"') == 'a\\0b'"},
+      {"decode numbers",
+       "local t = require('json').decode('[-1.5e2, 0, 9007199254740993]') return t[1] == -150 and t[2] == 0 and t[3] "
+       "== 9007199254740992"},
+      {"decode error position",
+       "local ok, e = pcall(require('json').decode, '{\\n  \"a\": }') return not ok and e:find('at line 2 col') ~= "
+       "nil"},
+      {"decode trailing garbage", "return not pcall(require('json').decode, '[1] x')"},
+      {"decode non-string",
+       "local ok, e = pcall(require('json').decode, 1) return not ok and e:find('expected argument of type string, "
+       "got number', 1, true) ~= nil"},
+      {"encode scalars",
+       "local json = require('json') return json.encode(nil) == 'null' and json.encode(true) == 'true' and "
+       "json.encode(false) == 'false' and json.encode() == 'null'"},
+      {"encode numbers",
+       "local json = require('json') return json.encode(1) == '1' and json.encode(-0.5) == '-0.5' and "
+       "json.encode(1/3) == '0.33333333333333'"},
+      {"encode empty table as array", "return require('json').encode({}) == '[]'"},
+      {"encode array", "return require('json').encode({1, 'two', false, {}}) == '[1,\"two\",false,[]]'"},
+      {"encode object", "return require('json').encode({name = 'x'}) == '{\"name\":\"x\"}'"},
+      {"encode escapes",
+       "return require('json').encode('a\"\\\\\\n\\t\\1') == '\"a\\\\\"\\\\\\\\\\\\n\\\\t\\\\u0001\"'"},
+      {"encode utf8", "return require('json').encode('テスト') == '\"テスト\"'"},
+      {"encode round trip",
+       "local json = require('json') local t = json.decode(json.encode({a = {1, 2, {b = 'c'}}, d = 'e'})) return "
+       "t.a[3].b == 'c' and t.d == 'e' and #t.a == 3"},
+      {"encode sparse array",
+       "local ok, e = pcall(require('json').encode, {1, nil, 3}) return not ok and e:find('sparse array', 1, true) "
+       "~= nil"},
+      {"encode mixed keys",
+       "local ok, e = pcall(require('json').encode, {1, a = 2}) return not ok and e:find('mixed or invalid key "
+       "types', 1, true) ~= nil"},
+      {"encode non-string key", "return not pcall(require('json').encode, {[true] = 1})"},
+      {"encode circular",
+       "local t = {} t.self = t local ok, e = pcall(require('json').encode, t) return not ok and e:find('circular "
+       "reference', 1, true) ~= nil"},
+      {"encode shared reference", "local s = {1} return require('json').encode({s, s}) == '[[1],[1]]'"},
+      {"encode nan",
+       "local ok, e = pcall(require('json').encode, 0/0) return not ok and e:find('unexpected number value') ~= nil"},
+      {"encode inf", "return not pcall(require('json').encode, math.huge)"},
+      {"encode function",
+       "local ok, e = pcall(require('json').encode, print) return not ok and e:find(\"unexpected type 'function'\", "
+       "1, true) ~= nil"},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    TEST_CASE(cases[i].name);
+    result = luaL_dostring(L, cases[i].script);
+    if (!TEST_CHECK(result == LUA_OK)) {
+      TEST_MSG("error: %s", lua_tostring(L, -1));
+      lua_pop(L, 1);
+      continue;
+    }
+    TEST_CHECK(lua_toboolean(L, -1));
+    lua_pop(L, 1);
+  }
+
+  lua_close(L);
+}
+
+static void test_ini(void) {
+  lua_State *L = luaL_newstate();
+  TEST_ASSERT(L != NULL);
+
+  luaL_openlibs(L);
+
+  struct ov_error err = {0};
+  if (!TEST_SUCCEEDED(gcmz_lua_api_register(L, &err), &err)) {
+    lua_close(L);
+    return;
+  }
+
+  int result = luaL_dostring(L, "return type(package.preload.ini) == 'function' and type(require('ini').new)");
+  TEST_CHECK(result == LUA_OK);
+  TEST_CHECK(lua_isstring(L, -1) && strcmp(lua_tostring(L, -1), "function") == 0);
+  lua_pop(L, 1);
+
+  // Every case runs against both the native module and ini.lua and must produce the same string
+  if (!TEST_CHECK(luaL_loadfile(L, INI_LUA_PATH) == LUA_OK && lua_pcall(L, 0, 1, 0) == LUA_OK)) {
+    TEST_MSG("failed to load ini.lua: %s", lua_tostring(L, -1));
+    lua_close(L);
+    return;
+  }
+  int const ini_lua = lua_gettop(L);
+  lua_getglobal(L, "require");
+  lua_pushstring(L, "ini");
+  lua_call(L, 1, 1);
+  int const ini_native = lua_gettop(L);
+
+  static struct {
+    char const *name;
+    char const *script;
+  } const cases[] = {
+      {"parse", "return tostring(ini.new('a=1\\r\\n[s1]\\r\\nk = v \\r\\nx=y=z\\r\\n[s2]\\r\\n[s3]\\nq=\\n'))"},
+      {"parse empty", "return tostring(ini.new()) .. tostring(ini.new(''))"},
+      {"parse iterator",
+       "local lines = {'[s]', 'b=2', 'a=1'} local i = 0 return tostring(ini.new(function() i = i + 1 return "
+       "lines[i] end))"},
+      {"insertion order",
+       "local o = ini.new() o:set('s', 'b', 1) o:set('s', 'a', true) o:set('t', 'c', 'x') o:set('s', 'b', 'y') "
+       "return tostring(o)"},
+      {"delete and re-add",
+       "local o = ini.new('[s]\\na=1\\nb=2\\n[t]\\nc=3\\n') o:delete('s', 'a') o:set('s', 'a', 'again') "
+       "o:deletesection('t') o:set('t', 'd', 2.5) o:set('u', 'k', 'v') o:delete('u', 'k') o:delete('x', 'y') "
+       "o:deletesection('x') return tostring(o)"},
+      {"accessors",
+       "local o = ini.new('[s]\\nk=v\\nn=1\\n') return table.concat({o:get('s', 'k'), tostring(o:get('s', 'x')), "
+       "o:get('s', 'x', 'def'), tostring(o:exists('s', 'k')), tostring(o:exists('s', 'x')), "
+       "tostring(o:sectionexists('s')), tostring(o:sectionexists('x')), table.concat(o:sections(), ','), "
+       "table.concat(o:keys('s'), ','), #o:keys('x')}, '|')"},
+      {"module functions",
+       "local o = ini.new() ini.set(o, 's', 'k', 'v') return ini.get(o, 's', 'k') .. tostring(ini.exists(o, 's', "
+       "'k'))"},
+      {"save and load",
+       "local path = os.getenv('TEMP') .. '\\\\gcmz_lua_ini_test.ini' local o = ini.new('[s]\\nk=テスト\\n') "
+       "o:set('t', 1, 2) o:save(path) local loaded = ini.load(path) os.remove(path) return tostring(loaded)"},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    TEST_CASE(cases[i].name);
+    char const *results[2] = {NULL, NULL};
+    int const modules[2] = {ini_native, ini_lua};
+    for (size_t j = 0; j < 2; ++j) {
+      if (!TEST_CHECK(luaL_loadstring(L, cases[i].script) == LUA_OK)) {
+        TEST_MSG("error: %s", lua_tostring(L, -1));
+        lua_pop(L, 1);
+        break;
+      }
+      // Expose the module under test as the global 'ini'
+      lua_pushvalue(L, modules[j]);
+      lua_setglobal(L, "ini");
+      if (!TEST_CHECK(lua_pcall(L, 0, 1, 0) == LUA_OK)) {
+        TEST_MSG("error: %s", lua_tostring(L, -1));
+        lua_pop(L, 1);
+        break;
+      }
+      results[j] = lua_tostring(L, -1);
+    }
+    if (results[0] && results[1]) {
+      TEST_CHECK(strcmp(results[0], results[1]) == 0);
+      TEST_MSG("native: %s", results[0]);
+      TEST_MSG("ini.lua: %s", results[1]);
+    }
+    lua_settop(L, ini_native);
+  }
+
+  lua_close(L);
+}
+
+static void test_async(void) {
+  lua_State *L = luaL_newstate();
+  TEST_ASSERT(L != NULL);
+
+  luaL_openlibs(L);
+
+  struct ov_error err = {0};
+  if (!TEST_SUCCEEDED(gcmz_lua_api_register(L, &err), &err)) {
+    lua_close(L);
+    return;
+  }
+
+  static struct {
+    char const *name;
+    char const *script;
+    char const *expected;
+  } const cases[] = {
+      {"run_process blocking", "return tostring(gcmz.run_process('cmd.exe /c exit 3'))", "3"},
+      {"run_process in coroutine",
+       "local co = coroutine.create(function() return gcmz.run_process('cmd.exe /c exit 5') end) "
+       "local ok, op = coroutine.resume(co) local status = coroutine.status(co) "
+       "local _, code = coroutine.resume(co, gcmz.await(op)) return status .. ':' .. tostring(code)",
+       "suspended:5"},
+      {"copy_file",
+       "local src = os.getenv('TEMP') .. '/gcmz_lua_async_src.txt' "
+       "local dst = os.getenv('TEMP') .. '/gcmz_lua_async_dst.txt' "
+       "local f = io.open(src, 'wb') f:write('hello') f:close() "
+       "local co = coroutine.wrap(function() return gcmz.copy_file(src, dst) end) "
+       "local r = tostring(gcmz.await(co())) f = io.open(dst, 'rb') r = r .. ':' .. f:read('*a') f:close() "
+       "os.remove(src) os.remove(dst) return r",
+       "true:hello"},
+      {"copy_file failure",
+       "local ok, msg = gcmz.copy_file(os.getenv('TEMP') .. '/gcmz_lua_async_missing.txt', "
+       "os.getenv('TEMP') .. '/gcmz_lua_async_missing2.txt') "
+       "return tostring(ok) .. ':' .. tostring(msg:find('CopyFile failed', 1, true) ~= nil)",
+       "nil:true"},
+      {"spawn",
+       "local job = gcmz.spawn('cmd.exe /c echo hello&& exit 7', {capture = true}) local code = job:wait() "
+       "local out, chunk = '', job:read() while chunk do out = out .. chunk chunk = job:read() end "
+       "return tostring(code) .. ':' .. tostring(job:exit_code()) .. ':' .. out:gsub('%s+$', '')",
+       "7:7:hello"},
+      {"spawn wait timeout and kill",
+       "local job = gcmz.spawn('cmd.exe /c ping -n 30 127.0.0.1') local code, msg = job:wait(10) "
+       "job:kill() return tostring(code) .. ':' .. msg .. ':' .. tostring(job:wait())",
+       "nil:timeout:1"},
+      {"spawn in coroutine",
+       "local co = coroutine.create(function() return gcmz.spawn('cmd.exe /c exit 4'):wait() end) "
+       "local _, op = coroutine.resume(co) local _, code = coroutine.resume(co, gcmz.await(op)) "
+       "return tostring(code)",
+       "4"},
+      {"spawn busy",
+       "local jobs, r = {}, nil for i = 1, 256 do local job, msg = gcmz.spawn('cmd.exe /c ping -n 30 127.0.0.1') "
+       "if not job then r = msg break end jobs[i] = job end "
+       "for _, job in ipairs(jobs) do job:kill() job:wait() end jobs = nil collectgarbage() "
+       "return tostring(r) .. ':' .. tostring(gcmz.spawn('cmd.exe /c exit 2'):wait())",
+       "busy:2"},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    TEST_CASE(cases[i].name);
+    if (!TEST_CHECK(luaL_dostring(L, cases[i].script) == LUA_OK)) {
+      TEST_MSG("error: %s", lua_tostring(L, -1));
+      lua_pop(L, 1);
+      continue;
+    }
+    TEST_CHECK(strcmp(lua_tostring(L, -1), cases[i].expected) == 0);
+    TEST_MSG("want %s, got %s", cases[i].expected, lua_tostring(L, -1));
+    lua_pop(L, 1);
+  }
+
+  lua_close(L);
+}
+
 TEST_LIST = {
     {"api_register", test_api_register},
     {"convert_encoding", test_convert_encoding},
@@ -461,6 +905,12 @@ TEST_LIST = {
     {"debug_print", test_debug_print},
     {"get_script_directory", test_get_script_directory},
     {"get_script_directory_no_provider", test_get_script_directory_no_provider},
+    {"save_file", test_save_file},
+    {"get_media_info_batch", test_get_media_info_batch},
     {"i18n", test_i18n},
+    {"json", test_json},
+    {"ini", test_ini},
+    {"async", test_async},
+    {"ffi", test_ffi},
     {NULL, NULL},
 };
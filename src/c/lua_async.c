@@ -0,0 +1,643 @@
+// NOTE:
+// When adding or modifying API functions, please also update LUA.md
+
+#include "lua_async.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <ovarray.h>
+#include <ovthreads.h>
+
+#include "luautil.h"
+
+#ifdef __GNUC__
+#  ifndef __has_warning
+#    define __has_warning(x) 0
+#  endif
+#  pragma GCC diagnostic push
+#  if __has_warning("-Wreserved-macro-identifier")
+#    pragma GCC diagnostic ignored "-Wreserved-macro-identifier"
+#  endif
+#endif // __GNUC__
+#include <lauxlib.h>
+#include <lua.h>
+#ifdef __GNUC__
+#  pragma GCC diagnostic pop
+#endif // __GNUC__
+
+static char const g_async_op_metatable_name[] = "gcmz_async_op";
+static char const g_job_metatable_name[] = "gcmz_job";
+static HANDLE g_job_slots = NULL; ///< Semaphore limiting the number of running gcmz.spawn processes
+
+enum async_op_type {
+  async_op_process,
+  async_op_copy_file,
+};
+
+/**
+ * @brief Pending asynchronous operation
+ *
+ * Lives in a Lua userdata so that it is released even if the waiting coroutine is abandoned.
+ */
+struct async_op {
+  enum async_op_type type;
+  HANDLE handle; ///< Signaled on completion (process handle or copy completion event)
+  thrd_t thread;
+  bool thread_started;
+  wchar_t *src;
+  wchar_t *dest;
+  DWORD error; ///< Win32 error code of the copy (written by the worker thread before signaling)
+};
+
+bool gcmz_lua_async_wait(void *const handle, uint32_t const timeout_ms) {
+  if (!handle) {
+    return false;
+  }
+  return WaitForSingleObject((HANDLE)handle, timeout_ms) == WAIT_OBJECT_0;
+}
+
+static int copy_thread(void *const userdata) {
+  struct async_op *const op = (struct async_op *)userdata;
+  op->error = CopyFileW(op->src, op->dest, FALSE) ? 0 : GetLastError();
+  SetEvent(op->handle);
+  return 0;
+}
+
+static void async_op_join(struct async_op *const op) {
+  if (op->thread_started) {
+    thrd_join(op->thread, NULL);
+    op->thread_started = false;
+  }
+}
+
+static int async_op_gc(lua_State *const L) {
+  struct async_op *const op = (struct async_op *)luaL_checkudata(L, 1, g_async_op_metatable_name);
+  // A running copy still references op, so it has to finish before the memory goes away
+  async_op_join(op);
+  if (op->handle) {
+    CloseHandle(op->handle);
+    op->handle = NULL;
+  }
+  if (op->src) {
+    OV_ARRAY_DESTROY(&op->src);
+  }
+  if (op->dest) {
+    OV_ARRAY_DESTROY(&op->dest);
+  }
+  return 0;
+}
+
+static struct async_op *push_async_op(lua_State *const L, enum async_op_type const type) {
+  struct async_op *const op = (struct async_op *)lua_newuserdata(L, sizeof(struct async_op));
+  *op = (struct async_op){.type = type};
+  if (luaL_newmetatable(L, g_async_op_metatable_name)) {
+    lua_pushcfunction(L, async_op_gc);
+    lua_setfield(L, -2, "__gc");
+  }
+  lua_setmetatable(L, -2);
+  return op;
+}
+
+/**
+ * @brief Push the results of a completed operation
+ */
+static int push_async_op_results(lua_State *const L, struct async_op *const op) {
+  switch (op->type) {
+  case async_op_process: {
+    DWORD exit_code = 0;
+    if (!GetExitCodeProcess(op->handle, &exit_code)) {
+      lua_pushnil(L);
+      lua_pushfstring(L, "GetExitCodeProcess failed (error %d)", (int)GetLastError());
+      return 2;
+    }
+    lua_pushinteger(L, (lua_Integer)exit_code);
+    return 1;
+  }
+  case async_op_copy_file:
+    async_op_join(op);
+    if (op->error) {
+      lua_pushnil(L);
+      lua_pushfstring(L, "CopyFile failed (error %d)", (int)op->error);
+      return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Wait for an operation however long it takes and push its results
+ */
+static int wait_async_op(lua_State *const L, struct async_op *const op) {
+  if (!gcmz_lua_async_wait(op->handle, INFINITE)) {
+    return luaL_error(L, "failed to wait for operation (error %d)", (int)GetLastError());
+  }
+  return push_async_op_results(L, op);
+}
+
+/**
+ * @brief Yield the operation at the top of the stack, or wait for it on the main Lua thread
+ */
+static int yield_or_wait(lua_State *const L) {
+  struct async_op *const op = (struct async_op *)lua_touserdata(L, -1);
+  if (!lua_pushthread(L)) {
+    lua_pop(L, 1);
+    // Resumed with the results of gcmz.await(op)
+    return lua_yield(L, 1);
+  }
+  lua_pop(L, 1);
+  return wait_async_op(L, op);
+}
+
+/**
+ * @brief gcmz.await(op) - Wait for a pending operation and return its results
+ */
+static int gcmz_lua_await(lua_State *const L) {
+  return wait_async_op(L, (struct async_op *)luaL_checkudata(L, 1, g_async_op_metatable_name));
+}
+
+/**
+ * @brief gcmz.run_process(cmdline) - Run a process without a window and return its exit code
+ */
+static int gcmz_lua_run_process(lua_State *const L) {
+  char const *const cmdline = luaL_checkstring(L, 1);
+
+  wchar_t *cmdline_w = NULL;
+  struct ov_error err = {0};
+  int result = -1;
+
+  {
+    if (!gcmz_utf8_to_wchar(cmdline, &cmdline_w, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    struct async_op *const op = push_async_op(L, async_op_process);
+    STARTUPINFOW si = {.cb = sizeof(STARTUPINFOW)};
+    PROCESS_INFORMATION pi = {0};
+    // CreateProcessW may modify the command line buffer, cmdline_w is writable
+    if (!CreateProcessW(NULL, cmdline_w, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
+      lua_pushnil(L);
+      lua_pushfstring(L, "CreateProcess failed (error %d)", (int)GetLastError());
+      result = 2;
+      goto cleanup;
+    }
+    CloseHandle(pi.hThread);
+    op->handle = pi.hProcess;
+  }
+  result = 0;
+
+cleanup:
+  if (cmdline_w) {
+    OV_ARRAY_DESTROY(&cmdline_w);
+  }
+  if (result < 0) {
+    return gcmz_luafn_err(L, &err);
+  }
+  return result ? result : yield_or_wait(L);
+}
+
+/**
+ * @brief gcmz.copy_file(src, dest) - Copy a file on a worker thread
+ */
+static int gcmz_lua_copy_file(lua_State *const L) {
+  char const *const src = luaL_checkstring(L, 1);
+  char const *const dest = luaL_checkstring(L, 2);
+
+  struct ov_error err = {0};
+  int result = -1;
+
+  {
+    struct async_op *const op = push_async_op(L, async_op_copy_file);
+    if (!gcmz_utf8_to_wchar(src, &op->src, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!gcmz_utf8_to_wchar(dest, &op->dest, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    op->handle = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!op->handle) {
+      OV_ERROR_SET_HRESULT(&err, HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    if (thrd_create(&op->thread, copy_thread, op) != thrd_success) {
+      OV_ERROR_SET_GENERIC(&err, ov_error_generic_fail);
+      goto cleanup;
+    }
+    op->thread_started = true;
+  }
+  result = 0;
+
+cleanup:
+  if (result < 0) {
+    return gcmz_luafn_err(L, &err);
+  }
+  return yield_or_wait(L);
+}
+
+/**
+ * @brief Process started by gcmz.spawn
+ *
+ * Holds one slot of g_job_slots while the process is running.
+ * The slot is given back by a thread pool wait callback as soon as the process exits,
+ * so it does not depend on the script calling wait().
+ */
+struct job {
+  HANDLE process;
+  HANDLE output; ///< Read end of the stdout/stderr pipe (NULL if output is not captured)
+  HANDLE exit_wait;
+  LONG slot_released;
+  DWORD pid;
+};
+
+static HANDLE get_job_slots(void) {
+  HANDLE slots = (HANDLE)InterlockedCompareExchangePointer((PVOID volatile *)&g_job_slots, NULL, NULL);
+  if (slots) {
+    return slots;
+  }
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  LONG const n = si.dwNumberOfProcessors ? (LONG)si.dwNumberOfProcessors : 1;
+  HANDLE const created = CreateSemaphoreW(NULL, n, n, NULL);
+  if (!created) {
+    return NULL;
+  }
+  slots = (HANDLE)InterlockedCompareExchangePointer((PVOID volatile *)&g_job_slots, created, NULL);
+  if (slots) {
+    // Another thread won the race
+    CloseHandle(created);
+    return slots;
+  }
+  return created;
+}
+
+static void job_release_slot(struct job *const j) {
+  if (InterlockedExchange(&j->slot_released, 1) == 0) {
+    ReleaseSemaphore(g_job_slots, 1, NULL);
+  }
+}
+
+static void CALLBACK job_exited(PVOID userdata, BOOLEAN timed_out) {
+  (void)timed_out;
+  job_release_slot((struct job *)userdata);
+}
+
+static struct job *check_job(lua_State *const L) {
+  struct job *const j = (struct job *)luaL_checkudata(L, 1, g_job_metatable_name);
+  if (!j->process) {
+    luaL_error(L, "attempt to use a closed job");
+  }
+  return j;
+}
+
+static int job_gc(lua_State *const L) {
+  struct job *const j = (struct job *)luaL_checkudata(L, 1, g_job_metatable_name);
+  if (!j->process) {
+    return 0;
+  }
+  // Abandoned jobs must not keep a slot forever, and nobody can read their output anymore
+  if (WaitForSingleObject(j->process, 0) == WAIT_TIMEOUT) {
+    TerminateProcess(j->process, 1);
+  }
+  if (j->exit_wait) {
+    // Blocks until a running callback has finished, then the slot can be released here safely
+    UnregisterWaitEx(j->exit_wait, INVALID_HANDLE_VALUE);
+    j->exit_wait = NULL;
+  }
+  job_release_slot(j);
+  if (j->output) {
+    CloseHandle(j->output);
+    j->output = NULL;
+  }
+  CloseHandle(j->process);
+  j->process = NULL;
+  return 0;
+}
+
+/**
+ * @brief job:read() - Return captured output available without blocking
+ *
+ * Returns an empty string when no data is available yet, or nil once the pipe is closed and drained.
+ */
+static int job_read(lua_State *const L) {
+  struct job *const j = check_job(L);
+  if (!j->output) {
+    return luaL_error(L, "output is not captured, pass {capture = true} to gcmz.spawn");
+  }
+  DWORD available = 0;
+  if (!PeekNamedPipe(j->output, NULL, 0, NULL, &available, NULL)) {
+    DWORD const error = GetLastError();
+    if (error == ERROR_BROKEN_PIPE) {
+      lua_pushnil(L);
+      return 1;
+    }
+    lua_pushnil(L);
+    lua_pushfstring(L, "PeekNamedPipe failed (error %d)", (int)error);
+    return 2;
+  }
+  if (!available) {
+    lua_pushliteral(L, "");
+    return 1;
+  }
+  luaL_Buffer b;
+  luaL_buffinit(L, &b);
+  while (available) {
+    DWORD const want = available < LUAL_BUFFERSIZE ? available : LUAL_BUFFERSIZE;
+    DWORD bytes_read = 0;
+    if (!ReadFile(j->output, luaL_prepbuffer(&b), want, &bytes_read, NULL) || !bytes_read) {
+      break;
+    }
+    luaL_addsize(&b, bytes_read);
+    available -= bytes_read;
+  }
+  luaL_pushresult(&b);
+  return 1;
+}
+
+/**
+ * @brief job:wait([timeout_ms]) - Wait for the process to exit and return its exit code
+ *
+ * Without timeout inside a coroutine, yields a pending operation like gcmz.run_process.
+ * Returns nil, "timeout" if the process is still running after timeout_ms.
+ */
+static int job_wait(lua_State *const L) {
+  struct job *const j = check_job(L);
+  if (lua_isnoneornil(L, 2)) {
+    struct async_op *const op = push_async_op(L, async_op_process);
+    HANDLE const self = GetCurrentProcess();
+    DWORD const access = SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION;
+    if (!DuplicateHandle(self, j->process, self, &op->handle, access, FALSE, 0)) {
+      return luaL_error(L, "DuplicateHandle failed (error %d)", (int)GetLastError());
+    }
+    return yield_or_wait(L);
+  }
+  lua_Integer const timeout = luaL_checkinteger(L, 2);
+  uint32_t const timeout_ms = timeout < 0 || timeout >= (lua_Integer)INFINITE ? INFINITE : (uint32_t)timeout;
+  if (!gcmz_lua_async_wait(j->process, timeout_ms)) {
+    lua_pushnil(L);
+    lua_pushliteral(L, "timeout");
+    return 2;
+  }
+  DWORD exit_code = 0;
+  if (!GetExitCodeProcess(j->process, &exit_code)) {
+    return luaL_error(L, "GetExitCodeProcess failed (error %d)", (int)GetLastError());
+  }
+  lua_pushinteger(L, (lua_Integer)exit_code);
+  return 1;
+}
+
+/**
+ * @brief job:exit_code() - Return the exit code, or nil while the process is running
+ */
+static int job_exit_code(lua_State *const L) {
+  struct job *const j = check_job(L);
+  if (WaitForSingleObject(j->process, 0) != WAIT_OBJECT_0) {
+    lua_pushnil(L);
+    return 1;
+  }
+  DWORD exit_code = 0;
+  if (!GetExitCodeProcess(j->process, &exit_code)) {
+    return luaL_error(L, "GetExitCodeProcess failed (error %d)", (int)GetLastError());
+  }
+  lua_pushinteger(L, (lua_Integer)exit_code);
+  return 1;
+}
+
+/**
+ * @brief job:kill() - Terminate the process
+ */
+static int job_kill(lua_State *const L) {
+  struct job *const j = check_job(L);
+  if (WaitForSingleObject(j->process, 0) == WAIT_OBJECT_0) {
+    lua_pushboolean(L, 1);
+    return 1;
+  }
+  if (!TerminateProcess(j->process, 1)) {
+    lua_pushnil(L);
+    lua_pushfstring(L, "TerminateProcess failed (error %d)", (int)GetLastError());
+    return 2;
+  }
+  lua_pushboolean(L, 1);
+  return 1;
+}
+
+/**
+ * @brief job:pid() - Return the process ID
+ */
+static int job_pid(lua_State *const L) {
+  struct job *const j = check_job(L);
+  lua_pushinteger(L, (lua_Integer)j->pid);
+  return 1;
+}
+
+static void push_job_metatable(lua_State *const L) {
+  if (!luaL_newmetatable(L, g_job_metatable_name)) {
+    return;
+  }
+  lua_pushcfunction(L, job_gc);
+  lua_setfield(L, -2, "__gc");
+  lua_newtable(L);
+  lua_pushcfunction(L, job_exit_code);
+  lua_setfield(L, -2, "exit_code");
+  lua_pushcfunction(L, job_kill);
+  lua_setfield(L, -2, "kill");
+  lua_pushcfunction(L, job_pid);
+  lua_setfield(L, -2, "pid");
+  lua_pushcfunction(L, job_read);
+  lua_setfield(L, -2, "read");
+  lua_pushcfunction(L, job_wait);
+  lua_setfield(L, -2, "wait");
+  lua_setfield(L, -2, "__index");
+}
+
+/**
+ * @brief gcmz.spawn(cmdline[, opts]) - Start a process without waiting for it
+ *
+ * The number of running jobs is limited to one per logical processor. At the limit, waits up to
+ * opts.timeout milliseconds (0 by default) for a job to exit and returns nil, "busy" if none does.
+ * The wait is never unbounded because the running jobs may need the caller to drain their output.
+ * opts.capture = true connects stdout and stderr to a pipe readable with job:read().
+ * opts.dir sets the working directory.
+ */
+static int gcmz_lua_spawn(lua_State *const L) {
+  char const *const cmdline = luaL_checkstring(L, 1);
+  bool capture = false;
+  char const *dir = NULL;
+  uint32_t timeout_ms = 0;
+  if (!lua_isnoneornil(L, 2)) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_getfield(L, 2, "capture");
+    capture = lua_toboolean(L, -1) != 0;
+    lua_getfield(L, 2, "timeout");
+    lua_Integer const timeout = luaL_optinteger(L, -1, 0);
+    timeout_ms = timeout <= 0 ? 0 : timeout >= (lua_Integer)INFINITE ? INFINITE - 1 : (uint32_t)timeout;
+    // Left on the stack so that dir stays alive until the end of the call
+    lua_getfield(L, 2, "dir");
+    dir = lua_tostring(L, -1);
+  }
+
+  wchar_t *cmdline_w = NULL;
+  wchar_t *dir_w = NULL;
+  HANDLE read_pipe = NULL;
+  HANDLE write_pipe = NULL;
+  HANDLE nul = INVALID_HANDLE_VALUE;
+  LPPROC_THREAD_ATTRIBUTE_LIST attrs = NULL;
+  bool attrs_initialized = false;
+  bool slot_acquired = false;
+  struct ov_error err = {0};
+  int result = -1;
+
+  {
+    if (!gcmz_utf8_to_wchar(cmdline, &cmdline_w, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (dir && !gcmz_utf8_to_wchar(dir, &dir_w, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+
+    SECURITY_ATTRIBUTES sa = {
+        .nLength = sizeof(SECURITY_ATTRIBUTES),
+        .bInheritHandle = TRUE,
+    };
+    // Uncaptured output goes to NUL so that a full pipe can never stall the child
+    nul = CreateFileW(
+        L"NUL", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, NULL);
+    if (nul == INVALID_HANDLE_VALUE) {
+      OV_ERROR_SET_HRESULT(&err, HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    if (capture) {
+      if (!CreatePipe(&read_pipe, &write_pipe, &sa, 0)) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "CreatePipe failed (error %d)", (int)GetLastError());
+        result = 2;
+        goto cleanup;
+      }
+      SetHandleInformation(read_pipe, HANDLE_FLAG_INHERIT, 0);
+    }
+
+    // Only the handles of this job are inherited, not whatever else is inheritable in the process
+    HANDLE inherit[2] = {nul, write_pipe};
+    SIZE_T attrs_size = 0;
+    InitializeProcThreadAttributeList(NULL, 1, 0, &attrs_size);
+    if (!OV_REALLOC(&attrs, 1, attrs_size)) {
+      OV_ERROR_SET_GENERIC(&err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    if (!InitializeProcThreadAttributeList(attrs, 1, 0, &attrs_size)) {
+      OV_ERROR_SET_HRESULT(&err, HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    attrs_initialized = true;
+    if (!UpdateProcThreadAttribute(attrs,
+                                   0,
+                                   PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+                                   inherit,
+                                   (capture ? 2 : 1) * sizeof(HANDLE),
+                                   NULL,
+                                   NULL)) {
+      OV_ERROR_SET_HRESULT(&err, HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+
+    HANDLE const slots = get_job_slots();
+    if (!slots) {
+      OV_ERROR_SET_HRESULT(&err, HRESULT_FROM_WIN32(GetLastError()));
+      goto cleanup;
+    }
+    if (!gcmz_lua_async_wait(slots, timeout_ms)) {
+      lua_pushnil(L);
+      lua_pushliteral(L, "busy");
+      result = 2;
+      goto cleanup;
+    }
+    slot_acquired = true;
+
+    push_job_metatable(L);
+    struct job *const j = (struct job *)lua_newuserdata(L, sizeof(struct job));
+    *j = (struct job){.slot_released = 1};
+    lua_insert(L, -2);
+    lua_setmetatable(L, -2);
+
+    STARTUPINFOEXW si = {
+        .StartupInfo =
+            {
+                .cb = sizeof(STARTUPINFOEXW),
+                .dwFlags = STARTF_USESTDHANDLES,
+                .hStdInput = nul,
+                .hStdOutput = capture ? write_pipe : nul,
+                .hStdError = capture ? write_pipe : nul,
+            },
+        .lpAttributeList = attrs,
+    };
+    PROCESS_INFORMATION pi = {0};
+    DWORD const flags = CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT;
+    if (!CreateProcessW(NULL, cmdline_w, NULL, NULL, TRUE, flags, NULL, dir_w, &si.StartupInfo, &pi)) {
+      lua_pushnil(L);
+      lua_pushfstring(L, "CreateProcess failed (error %d)", (int)GetLastError());
+      result = 2;
+      goto cleanup;
+    }
+    CloseHandle(pi.hThread);
+    j->process = pi.hProcess;
+    j->pid = pi.dwProcessId;
+    j->output = read_pipe;
+    read_pipe = NULL;
+    // From here on the slot belongs to the job
+    j->slot_released = 0;
+    slot_acquired = false;
+    if (!RegisterWaitForSingleObject(&j->exit_wait, j->process, job_exited, j, INFINITE, WT_EXECUTEONLYONCE)) {
+      // Fall back to releasing the slot when the job is collected
+      j->exit_wait = NULL;
+    }
+  }
+  result = 1;
+
+cleanup:
+  if (slot_acquired) {
+    ReleaseSemaphore(g_job_slots, 1, NULL);
+  }
+  if (write_pipe) {
+    CloseHandle(write_pipe);
+  }
+  if (read_pipe) {
+    CloseHandle(read_pipe);
+  }
+  if (nul != INVALID_HANDLE_VALUE) {
+    CloseHandle(nul);
+  }
+  if (attrs_initialized) {
+    DeleteProcThreadAttributeList(attrs);
+  }
+  if (attrs) {
+    OV_FREE(&attrs);
+  }
+  if (dir_w) {
+    OV_ARRAY_DESTROY(&dir_w);
+  }
+  if (cmdline_w) {
+    OV_ARRAY_DESTROY(&cmdline_w);
+  }
+  return result < 0 ? gcmz_luafn_err(L, &err) : result;
+}
+
+bool gcmz_lua_async_register(struct lua_State *const L, struct ov_error *const err) {
+  if (!L || !lua_istable(L, -1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  lua_pushcfunction(L, gcmz_lua_await);
+  lua_setfield(L, -2, "await");
+  lua_pushcfunction(L, gcmz_lua_copy_file);
+  lua_setfield(L, -2, "copy_file");
+  lua_pushcfunction(L, gcmz_lua_run_process);
+  lua_setfield(L, -2, "run_process");
+  lua_pushcfunction(L, gcmz_lua_spawn);
+  lua_setfield(L, -2, "spawn");
+  return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct lua_State;
+
+/**
+ * @brief Add asynchronous functions to the table at the top of the stack
+ *
+ * Adds run_process, copy_file, await and spawn.
+ * When run_process or copy_file is called inside a coroutine, it yields a pending operation
+ * instead of blocking. The hook runner in entrypoint.lua waits for it with await and
+ * resumes the coroutine with the results. Outside of coroutines they wait before returning.
+ * Waits are unbounded and never dispatch window messages, because hooks run inside drag and drop
+ * callbacks that must not be re-entered; a long operation keeps the calling thread busy until it ends.
+ * spawn starts a process and returns a job handle immediately; the number of running jobs is
+ * limited to the number of logical processors across all Lua states.
+ *
+ * @param L Lua state with the target table at the top of the stack
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_lua_async_register(struct lua_State *const L, struct ov_error *const err);
+
+/**
+ * @brief Wait for a kernel object without dispatching messages
+ *
+ * @param handle Waitable handle
+ * @param timeout_ms Timeout in milliseconds (UINT32_MAX for infinite)
+ * @return true if the handle was signaled, false on timeout or failure
+ */
+bool gcmz_lua_async_wait(void *const handle, uint32_t const timeout_ms);
@@ -0,0 +1,364 @@
+// NOTE:
+// When modifying behavior, please also update the documentation in LUA.md
+
+#include "lua_ffi.h"
+
+#include <string.h>
+
+#include <ovarray.h>
+#include <ovl/file.h>
+
+#include "luautil.h"
+
+#ifdef __GNUC__
+#  ifndef __has_warning
+#    define __has_warning(x) 0
+#  endif
+#  pragma GCC diagnostic push
+#  if __has_warning("-Wreserved-macro-identifier")
+#    pragma GCC diagnostic ignored "-Wreserved-macro-identifier"
+#  endif
+#endif // __GNUC__
+#include <lauxlib.h>
+#include <lua.h>
+#ifdef __GNUC__
+#  pragma GCC diagnostic pop
+#endif // __GNUC__
+
+static char const g_buffer_metatable_name[] = "gcmz_ffi_buffer";
+
+/**
+ * @brief Byte buffer shared with Lua as cdata
+ *
+ * The memory is only released by __gc, and buffers cannot be resized,
+ * so a pointer obtained from buf:ptr() stays valid while it is referenced.
+ */
+struct ffi_buffer {
+  uint8_t *data; ///< Always allocated, at least 1 byte even for an empty buffer
+  size_t size;
+};
+
+static struct ffi_buffer *check_buffer(lua_State *const L) {
+  return (struct ffi_buffer *)luaL_checkudata(L, 1, g_buffer_metatable_name);
+}
+
+static size_t check_size(lua_State *const L, int const idx) {
+  lua_Integer const n = luaL_checkinteger(L, idx);
+  if (n < 0) {
+    luaL_argerror(L, idx, "must not be negative");
+  }
+  return (size_t)n;
+}
+
+/**
+ * @brief Check optional offset and length arguments against the buffer size
+ *
+ * Length defaults to the rest of the buffer.
+ */
+static void check_range(lua_State *const L,
+                        struct ffi_buffer const *const b,
+                        int const idx,
+                        size_t *const offset,
+                        size_t *const len) {
+  *offset = lua_isnoneornil(L, idx) ? 0 : check_size(L, idx);
+  if (*offset > b->size) {
+    luaL_argerror(L, idx, "offset out of range");
+  }
+  *len = lua_isnoneornil(L, idx + 1) ? b->size - *offset : check_size(L, idx + 1);
+  if (*len > b->size - *offset) {
+    luaL_argerror(L, idx + 1, "length out of range");
+  }
+}
+
+static struct ffi_buffer *push_new_buffer(lua_State *const L, size_t const size, struct ov_error *const err) {
+  struct ffi_buffer *const b = (struct ffi_buffer *)lua_newuserdata(L, sizeof(struct ffi_buffer));
+  *b = (struct ffi_buffer){0};
+  luaL_getmetatable(L, g_buffer_metatable_name);
+  lua_setmetatable(L, -2);
+  if (!OV_REALLOC(&b->data, size ? size : 1, sizeof(uint8_t))) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return NULL;
+  }
+  b->size = size;
+  return b;
+}
+
+/**
+ * @brief gcmz_ffi.new(size) -> buffer
+ *
+ * The buffer is filled with zeros.
+ */
+static int ffi_new(lua_State *const L) {
+  size_t const size = check_size(L, 1);
+  struct ov_error err = {0};
+  struct ffi_buffer *const b = push_new_buffer(L, size, &err);
+  if (!b) {
+    OV_ERROR_ADD_TRACE(&err);
+    return gcmz_luafn_err(L, &err);
+  }
+  memset(b->data, 0, size);
+  return 1;
+}
+
+/**
+ * @brief gcmz_ffi.from_string(s) -> buffer
+ */
+static int ffi_from_string(lua_State *const L) {
+  size_t len = 0;
+  char const *const s = luaL_checklstring(L, 1, &len);
+  struct ov_error err = {0};
+  struct ffi_buffer *const b = push_new_buffer(L, len, &err);
+  if (!b) {
+    OV_ERROR_ADD_TRACE(&err);
+    return gcmz_luafn_err(L, &err);
+  }
+  memcpy(b->data, s, len);
+  return 1;
+}
+
+/**
+ * @brief gcmz_ffi.load(filepath) -> buffer
+ *
+ * Reads the whole file into a new buffer.
+ */
+static int ffi_load(lua_State *const L) {
+  char const *const filepath = luaL_checkstring(L, 1);
+
+  struct ov_error err = {0};
+  wchar_t *filepath_w = NULL;
+  struct ovl_file *file = NULL;
+  int result = -1;
+
+  {
+    if (!gcmz_utf8_to_wchar(filepath, &filepath_w, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!ovl_file_open(filepath_w, &file, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    uint64_t file_size = 0;
+    if (!ovl_file_size(file, &file_size, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (file_size > SIZE_MAX / 2) {
+      OV_ERROR_SET(&err, ov_error_type_generic, ov_error_generic_fail, "file is too large");
+      goto cleanup;
+    }
+    size_t const size = (size_t)file_size;
+    struct ffi_buffer *const b = push_new_buffer(L, size, &err);
+    if (!b) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    size_t pos = 0;
+    while (pos < size) {
+      size_t bytes_read = 0;
+      if (!ovl_file_read(file, b->data + pos, size - pos, &bytes_read, &err)) {
+        OV_ERROR_ADD_TRACE(&err);
+        goto cleanup;
+      }
+      if (bytes_read == 0) {
+        break;
+      }
+      pos += bytes_read;
+    }
+    if (pos != size) {
+      OV_ERROR_SET(&err, ov_error_type_generic, ov_error_generic_fail, "file size changed while reading");
+      goto cleanup;
+    }
+  }
+  result = 1;
+
+cleanup:
+  if (file) {
+    ovl_file_close(file);
+    file = NULL;
+  }
+  if (filepath_w) {
+    OV_ARRAY_DESTROY(&filepath_w);
+  }
+  return result < 0 ? gcmz_luafn_err(L, &err) : result;
+}
+
+/**
+ * @brief buf:ptr([offset[, len]]) -> uint8_t* cdata, integer
+ *
+ * The range is checked against the buffer size, and its length is returned with the pointer
+ * because cdata pointers carry no bounds of their own.
+ * The returned cdata keeps the buffer alive through a weak-keyed anchor table.
+ *
+ * Upvalues: 1 = ffi.cast, 2 = uint8_t* ctype, 3 = anchor table
+ */
+static int buffer_ptr(lua_State *const L) {
+  struct ffi_buffer const *const b = check_buffer(L);
+  size_t offset = 0;
+  size_t len = 0;
+  check_range(L, b, 2, &offset, &len);
+  lua_pushvalue(L, lua_upvalueindex(1));
+  lua_pushvalue(L, lua_upvalueindex(2));
+  lua_pushlightuserdata(L, b->data + offset);
+  lua_call(L, 2, 1);
+  lua_pushvalue(L, -1);
+  lua_pushvalue(L, 1);
+  lua_rawset(L, lua_upvalueindex(3));
+  lua_pushinteger(L, (lua_Integer)len);
+  return 2;
+}
+
+/**
+ * @brief buf:size() -> integer, also available as #buf
+ */
+static int buffer_size(lua_State *const L) {
+  struct ffi_buffer const *const b = check_buffer(L);
+  lua_pushinteger(L, (lua_Integer)b->size);
+  return 1;
+}
+
+/**
+ * @brief buf:tostring([offset[, len]]) -> string
+ */
+static int buffer_tostring(lua_State *const L) {
+  struct ffi_buffer const *const b = check_buffer(L);
+  size_t offset = 0;
+  size_t len = 0;
+  check_range(L, b, 2, &offset, &len);
+  lua_pushlstring(L, (char const *)b->data + offset, len);
+  return 1;
+}
+
+/**
+ * @brief buf:save(filepath)
+ */
+static int buffer_save(lua_State *const L) {
+  struct ffi_buffer const *const b = check_buffer(L);
+  char const *const filepath = luaL_checkstring(L, 2);
+
+  struct ov_error err = {0};
+  wchar_t *filepath_w = NULL;
+  struct ovl_file *file = NULL;
+  int result = -1;
+
+  {
+    if (!gcmz_utf8_to_wchar(filepath, &filepath_w, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!ovl_file_create(filepath_w, &file, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    size_t written = 0;
+    if (!ovl_file_write(file, b->data, b->size, &written, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (written != b->size) {
+      OV_ERROR_SET(&err, ov_error_type_generic, ov_error_generic_fail, "failed to write complete buffer");
+      goto cleanup;
+    }
+  }
+  result = 0;
+
+cleanup:
+  if (file) {
+    ovl_file_close(file);
+    file = NULL;
+  }
+  if (filepath_w) {
+    OV_ARRAY_DESTROY(&filepath_w);
+  }
+  return result < 0 ? gcmz_luafn_err(L, &err) : result;
+}
+
+static int buffer_gc(lua_State *const L) {
+  struct ffi_buffer *const b = check_buffer(L);
+  if (b->data) {
+    OV_FREE(&b->data);
+  }
+  b->size = 0;
+  return 0;
+}
+
+static int ffi_open(lua_State *const L) {
+  lua_getglobal(L, "require");
+  lua_pushliteral(L, "ffi");
+  if (lua_pcall(L, 1, 1, 0) != 0 || !lua_istable(L, -1)) {
+    return luaL_error(L, "gcmz_ffi requires the LuaJIT ffi library");
+  }
+  int const ffi = lua_gettop(L);
+
+  lua_createtable(L, 0, 3);
+  lua_pushcfunction(L, ffi_new);
+  lua_setfield(L, -2, "new");
+  lua_pushcfunction(L, ffi_from_string);
+  lua_setfield(L, -2, "from_string");
+  lua_pushcfunction(L, ffi_load);
+  lua_setfield(L, -2, "load");
+
+  luaL_newmetatable(L, g_buffer_metatable_name);
+  lua_createtable(L, 0, 4);
+  lua_getfield(L, ffi, "cast");
+  lua_getfield(L, ffi, "typeof");
+  lua_pushliteral(L, "uint8_t *");
+  lua_call(L, 1, 1);
+  lua_createtable(L, 0, 0);
+  lua_createtable(L, 0, 1);
+  lua_pushliteral(L, "k");
+  lua_setfield(L, -2, "__mode");
+  lua_setmetatable(L, -2);
+  lua_pushcclosure(L, buffer_ptr, 3);
+  lua_setfield(L, -2, "ptr");
+  lua_pushcfunction(L, buffer_size);
+  lua_setfield(L, -2, "size");
+  lua_pushcfunction(L, buffer_tostring);
+  lua_setfield(L, -2, "tostring");
+  lua_pushcfunction(L, buffer_save);
+  lua_setfield(L, -2, "save");
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, buffer_size);
+  lua_setfield(L, -2, "__len");
+  lua_pushcfunction(L, buffer_gc);
+  lua_setfield(L, -2, "__gc");
+  lua_pop(L, 1);
+  return 1;
+}
+
+bool gcmz_lua_ffi_to_buffer(struct lua_State *const L, int const idx, void **const data, size_t *const size) {
+  if (!L || !data || !size || lua_type(L, idx) != LUA_TUSERDATA || !lua_getmetatable(L, idx)) {
+    return false;
+  }
+  luaL_getmetatable(L, g_buffer_metatable_name);
+  bool const is_buffer = lua_rawequal(L, -1, -2) != 0;
+  lua_pop(L, 2);
+  if (!is_buffer) {
+    return false;
+  }
+  struct ffi_buffer const *const b = (struct ffi_buffer const *)lua_touserdata(L, idx);
+  *data = b->data;
+  *size = b->size;
+  return true;
+}
+
+bool gcmz_lua_ffi_register(struct lua_State *const L, struct ov_error *const err) {
+  if (!L) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  lua_getglobal(L, "package");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    return true;
+  }
+  lua_getfield(L, -1, "preload");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 2);
+    return true;
+  }
+  lua_pushcfunction(L, ffi_open);
+  lua_setfield(L, -2, "gcmz_ffi");
+  lua_pop(L, 2);
+  return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct lua_State;
+
+/**
+ * @brief Register the opt-in gcmz_ffi module to the given Lua state
+ *
+ * Installs a C implementation into package.preload["gcmz_ffi"].
+ * The module hands out byte buffers whose contents can be accessed as LuaJIT FFI cdata
+ * (uint8_t *) without copying them into Lua strings.
+ * Nothing is loaded until a handler calls require('gcmz_ffi'), and requiring it fails
+ * when the ffi library is not available.
+ * When the package library is not loaded, registration is skipped.
+ *
+ * @param L Lua state to register the module to
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_lua_ffi_register(struct lua_State *const L, struct ov_error *const err);
+
+/**
+ * @brief Get the memory of a gcmz_ffi buffer on the Lua stack
+ *
+ * Lets C code read a buffer in place instead of converting it to a Lua table or string.
+ * The memory stays valid while the buffer is referenced from Lua.
+ *
+ * @param L Lua state
+ * @param idx Stack index of the value
+ * @param data [out] Start of the buffer
+ * @param size [out] Size of the buffer in bytes
+ * @return true if the value is a gcmz_ffi buffer, false otherwise
+ */
+bool gcmz_lua_ffi_to_buffer(struct lua_State *const L, int const idx, void **const data, size_t *const size);
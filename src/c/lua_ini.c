@@ -0,0 +1,901 @@
+// NOTE:
+// This module must stay API-compatible with src/lua/ini.lua, which remains as a fallback.
+// When modifying behavior, please also update the documentation in LUA.md
+
+#include "lua_ini.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ovarray.h>
+#include <ovhashmap.h>
+#include <ovl/file.h>
+
+#include "ini_reader.h"
+#include "luautil.h"
+
+#ifdef __GNUC__
+#  ifndef __has_warning
+#    define __has_warning(x) 0
+#  endif
+#  pragma GCC diagnostic push
+#  if __has_warning("-Wreserved-macro-identifier")
+#    pragma GCC diagnostic ignored "-Wreserved-macro-identifier"
+#  endif
+#endif // __GNUC__
+#include <lauxlib.h>
+#include <lua.h>
+#ifdef __GNUC__
+#  pragma GCC diagnostic pop
+#endif // __GNUC__
+
+static char const g_ini_metatable_name[] = "gcmz_ini";
+
+struct ini_entry {
+  char *key;
+  size_t key_len;
+  char *value;
+  size_t value_len;
+  bool deleted;
+};
+
+struct ini_section {
+  char *name;
+  size_t name_len;
+  struct ini_entry *entries; ///< Entries in insertion order (deleted ones are kept as tombstones)
+  struct ov_hashmap *index;  ///< Key to position in entries
+  bool deleted;
+};
+
+/**
+ * @brief Hashmap item mapping a name to its position in an insertion ordered array
+ *
+ * name points to the string owned by the section or entry that was registered first.
+ * Deleted sections and entries keep their name alive, so re-adding one only updates pos.
+ */
+struct ini_index_item {
+  char const *name;
+  size_t name_len;
+  size_t pos;
+};
+
+struct lua_ini {
+  struct ini_section *sections; ///< Sections in insertion order (deleted ones are kept as tombstones)
+  struct ov_hashmap *index;     ///< Section name to position in sections
+};
+
+static void get_key_from_index_item(void const *const item, void const **const key, size_t *const key_bytes) {
+  struct ini_index_item const *i = (struct ini_index_item const *)item;
+  *key = i->name;
+  *key_bytes = i->name_len;
+}
+
+static bool dup_string(char const *const src, size_t const len, char **const dest) {
+  char *p = NULL;
+  if (!OV_REALLOC(&p, len + 1, sizeof(char))) {
+    return false;
+  }
+  if (len > 0) {
+    memcpy(p, src, len);
+  }
+  p[len] = '\0';
+  *dest = p;
+  return true;
+}
+
+static void entry_destroy(struct ini_entry *const e) {
+  if (e->key) {
+    OV_FREE(&e->key);
+  }
+  if (e->value) {
+    OV_FREE(&e->value);
+  }
+}
+
+static void section_clear_entries(struct ini_section *const s) {
+  if (s->entries) {
+    size_t const n = OV_ARRAY_LENGTH(s->entries);
+    for (size_t i = 0; i < n; ++i) {
+      entry_destroy(&s->entries[i]);
+    }
+    OV_ARRAY_DESTROY(&s->entries);
+  }
+  if (s->index) {
+    OV_HASHMAP_DESTROY(&s->index);
+  }
+}
+
+static void section_destroy(struct ini_section *const s) {
+  section_clear_entries(s);
+  if (s->name) {
+    OV_FREE(&s->name);
+  }
+}
+
+static void ini_destroy(struct lua_ini *const ini) {
+  if (ini->sections) {
+    size_t const n = OV_ARRAY_LENGTH(ini->sections);
+    for (size_t i = 0; i < n; ++i) {
+      section_destroy(&ini->sections[i]);
+    }
+    OV_ARRAY_DESTROY(&ini->sections);
+  }
+  if (ini->index) {
+    OV_HASHMAP_DESTROY(&ini->index);
+  }
+}
+
+static struct ini_index_item *
+find_index_item(struct ov_hashmap *const map, char const *const name, size_t const name_len) {
+  return (struct ini_index_item *)ov_deconster_(OV_HASHMAP_GET(map,
+                                                               &((struct ini_index_item const){
+                                                                   .name = name,
+                                                                   .name_len = name_len,
+                                                               })));
+}
+
+static struct ini_section *
+find_section(struct lua_ini const *const ini, char const *const name, size_t const name_len) {
+  struct ini_index_item const *const item = find_index_item(ini->index, name, name_len);
+  if (!item || ini->sections[item->pos].deleted) {
+    return NULL;
+  }
+  return &ini->sections[item->pos];
+}
+
+static struct ini_entry *find_entry(struct lua_ini const *const ini,
+                                    char const *const sect,
+                                    size_t const sect_len,
+                                    char const *const key,
+                                    size_t const key_len) {
+  struct ini_section const *const s = find_section(ini, sect, sect_len);
+  if (!s) {
+    return NULL;
+  }
+  struct ini_index_item const *const item = find_index_item(s->index, key, key_len);
+  if (!item || s->entries[item->pos].deleted) {
+    return NULL;
+  }
+  return &s->entries[item->pos];
+}
+
+static struct ini_section *get_or_add_section(struct lua_ini *const ini,
+                                              char const *const name,
+                                              size_t const name_len,
+                                              struct ov_error *const err) {
+  struct ini_index_item *const item = find_index_item(ini->index, name, name_len);
+  if (item && !ini->sections[item->pos].deleted) {
+    return &ini->sections[item->pos];
+  }
+
+  struct ini_section s = {0};
+  struct ini_section *result = NULL;
+
+  {
+    if (!dup_string(name, name_len, &s.name)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    s.name_len = name_len;
+    s.index = OV_HASHMAP_CREATE_DYNAMIC(sizeof(struct ini_index_item), 8, get_key_from_index_item);
+    if (!s.index) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    size_t const pos = OV_ARRAY_LENGTH(ini->sections);
+    if (!OV_ARRAY_GROW(&ini->sections, pos + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    if (item) {
+      // Re-adding a deleted section appends it, same as ini.lua
+      item->pos = pos;
+    } else if (!OV_HASHMAP_SET(ini->index,
+                               &((struct ini_index_item){
+                                   .name = s.name,
+                                   .name_len = name_len,
+                                   .pos = pos,
+                               }))) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    ini->sections[pos] = s;
+    OV_ARRAY_SET_LENGTH(ini->sections, pos + 1);
+    s = (struct ini_section){0};
+    result = &ini->sections[pos];
+  }
+
+cleanup:
+  section_destroy(&s);
+  return result;
+}
+
+static bool set_value(struct lua_ini *const ini,
+                      char const *const sect,
+                      size_t const sect_len,
+                      char const *const key,
+                      size_t const key_len,
+                      char const *const value,
+                      size_t const value_len,
+                      struct ov_error *const err) {
+  struct ini_entry e = {0};
+  char *v = NULL;
+  bool result = false;
+
+  {
+    struct ini_section *const s = get_or_add_section(ini, sect, sect_len, err);
+    if (!s) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    if (!dup_string(value, value_len, &v)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+
+    struct ini_index_item *const item = find_index_item(s->index, key, key_len);
+    if (item && !s->entries[item->pos].deleted) {
+      struct ini_entry *const found = &s->entries[item->pos];
+      OV_FREE(&found->value);
+      found->value = v;
+      found->value_len = value_len;
+      v = NULL;
+      result = true;
+      goto cleanup;
+    }
+
+    if (!dup_string(key, key_len, &e.key)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    e.key_len = key_len;
+    e.value = v;
+    e.value_len = value_len;
+    v = NULL;
+
+    size_t const pos = OV_ARRAY_LENGTH(s->entries);
+    if (!OV_ARRAY_GROW(&s->entries, pos + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    if (item) {
+      item->pos = pos;
+    } else if (!OV_HASHMAP_SET(s->index,
+                               &((struct ini_index_item){
+                                   .name = e.key,
+                                   .name_len = key_len,
+                                   .pos = pos,
+                               }))) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    s->entries[pos] = e;
+    OV_ARRAY_SET_LENGTH(s->entries, pos + 1);
+    e = (struct ini_entry){0};
+  }
+  result = true;
+
+cleanup:
+  if (v) {
+    OV_FREE(&v);
+  }
+  entry_destroy(&e);
+  return result;
+}
+
+struct loaded_entry {
+  char const *section;
+  size_t section_len;
+  char const *line;
+  size_t line_len;
+  size_t line_number;
+};
+
+static int compare_loaded_entry(void const *const a, void const *const b) {
+  size_t const la = ((struct loaded_entry const *)a)->line_number;
+  size_t const lb = ((struct loaded_entry const *)b)->line_number;
+  return (la > lb) - (la < lb);
+}
+
+/**
+ * @brief Populate ini from parsed reader contents
+ *
+ * gcmz_ini_reader iterates in unspecified order, so all entries are collected and sorted
+ * by line number once, then replayed through set_value to get the same insertion order as ini.lua.
+ * Keys and values are taken verbatim from the original line like ini.lua does,
+ * so values keep characters such as ';' and '#'.
+ */
+static bool load_from_reader(struct lua_ini *const ini,
+                             struct gcmz_ini_reader const *const reader,
+                             struct ov_error *const err) {
+  struct loaded_entry *entries = NULL;
+  char *section_name = NULL;
+  bool result = false;
+
+  {
+    struct gcmz_ini_iter sect_iter = {0};
+    while (gcmz_ini_reader_iter_sections(reader, &sect_iter)) {
+      // iter_entries looks sections up by null-terminated name, NULL means the global section
+      char const *section = NULL;
+      if (sect_iter.name) {
+        if (!OV_ARRAY_GROW(&section_name, sect_iter.name_len + 1)) {
+          OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+          goto cleanup;
+        }
+        memcpy(section_name, sect_iter.name, sect_iter.name_len);
+        section_name[sect_iter.name_len] = '\0';
+        section = section_name;
+      }
+
+      size_t n = OV_ARRAY_LENGTH(entries);
+      if (!OV_ARRAY_GROW(&entries, n + gcmz_ini_reader_get_entry_count(reader, section))) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      struct gcmz_ini_iter entry_iter = {0};
+      while (gcmz_ini_reader_iter_entries(reader, section, &entry_iter)) {
+        if (!entry_iter.line) {
+          continue;
+        }
+        if (!OV_ARRAY_GROW(&entries, n + 1)) {
+          OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+          goto cleanup;
+        }
+        // Keys before the first section header belong to "" like ini.lua
+        entries[n++] = (struct loaded_entry){
+            .section = sect_iter.name ? sect_iter.name : "",
+            .section_len = sect_iter.name_len,
+            .line = entry_iter.line,
+            .line_len = entry_iter.line_len,
+            .line_number = entry_iter.line_number,
+        };
+        OV_ARRAY_SET_LENGTH(entries, n);
+      }
+    }
+
+    size_t const n = OV_ARRAY_LENGTH(entries);
+    if (n > 1) {
+      qsort(entries, n, sizeof(struct loaded_entry), compare_loaded_entry);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      struct loaded_entry const *const le = &entries[i];
+      char const *const eq = (char const *)memchr(le->line, '=', le->line_len);
+      if (!eq) {
+        continue;
+      }
+      size_t const key_len = (size_t)(eq - le->line);
+      if (!set_value(ini,
+                     le->section,
+                     le->section_len,
+                     le->line,
+                     key_len,
+                     eq + 1,
+                     le->line_len - key_len - 1,
+                     err)) {
+        OV_ERROR_ADD_TRACE(err);
+        goto cleanup;
+      }
+    }
+  }
+  result = true;
+
+cleanup:
+  if (section_name) {
+    OV_ARRAY_DESTROY(&section_name);
+  }
+  if (entries) {
+    OV_ARRAY_DESTROY(&entries);
+  }
+  return result;
+}
+
+static size_t serialized_size(struct lua_ini const *const ini) {
+  size_t size = 0;
+  size_t const ns = OV_ARRAY_LENGTH(ini->sections);
+  for (size_t i = 0; i < ns; ++i) {
+    struct ini_section const *const s = &ini->sections[i];
+    if (s->deleted) {
+      continue;
+    }
+    size += s->name_len + 4; // "[" name "]\r\n"
+    size_t const ne = OV_ARRAY_LENGTH(s->entries);
+    for (size_t j = 0; j < ne; ++j) {
+      struct ini_entry const *const e = &s->entries[j];
+      if (!e->deleted) {
+        size += e->key_len + e->value_len + 3; // key "=" value "\r\n"
+      }
+    }
+  }
+  // ini.lua always terminates with CRLF, even when there is nothing to write
+  return size ? size : 2;
+}
+
+static void serialize(struct lua_ini const *const ini, char *dest) {
+  char *const start = dest;
+  size_t const ns = OV_ARRAY_LENGTH(ini->sections);
+  for (size_t i = 0; i < ns; ++i) {
+    struct ini_section const *const s = &ini->sections[i];
+    if (s->deleted) {
+      continue;
+    }
+    *dest++ = '[';
+    memcpy(dest, s->name, s->name_len);
+    dest += s->name_len;
+    memcpy(dest, "]\r\n", 3);
+    dest += 3;
+    size_t const ne = OV_ARRAY_LENGTH(s->entries);
+    for (size_t j = 0; j < ne; ++j) {
+      struct ini_entry const *const e = &s->entries[j];
+      if (e->deleted) {
+        continue;
+      }
+      memcpy(dest, e->key, e->key_len);
+      dest += e->key_len;
+      *dest++ = '=';
+      memcpy(dest, e->value, e->value_len);
+      dest += e->value_len;
+      memcpy(dest, "\r\n", 2);
+      dest += 2;
+    }
+  }
+  if (dest == start) {
+    memcpy(dest, "\r\n", 2);
+  }
+}
+
+/**
+ * @brief Serialize ini into a GC-managed buffer pushed on the stack
+ */
+static char const *push_serialized(lua_State *const L, struct lua_ini const *const ini, size_t *const len) {
+  size_t const size = serialized_size(ini);
+  char *const buf = (char *)lua_newuserdata(L, size);
+  serialize(ini, buf);
+  *len = size;
+  return buf;
+}
+
+/**
+ * @brief Convert the argument at idx to string in place with the same rules as tostring()
+ */
+static char const *arg_tolstring(lua_State *const L, int const idx, size_t *const len) {
+  int const type = lua_type(L, idx);
+  if (type != LUA_TSTRING && type != LUA_TNUMBER) {
+    lua_getglobal(L, "tostring");
+    lua_pushvalue(L, idx);
+    lua_call(L, 1, 1);
+    if (lua_type(L, -1) != LUA_TSTRING) {
+      luaL_error(L, "'tostring' must return a string");
+      return NULL;
+    }
+    lua_replace(L, idx);
+  }
+  return lua_tolstring(L, idx, len);
+}
+
+static struct lua_ini *check_ini(lua_State *const L) {
+  return (struct lua_ini *)luaL_checkudata(L, 1, g_ini_metatable_name);
+}
+
+static struct lua_ini *push_new_ini(lua_State *const L) {
+  struct lua_ini *const ini = (struct lua_ini *)lua_newuserdata(L, sizeof(struct lua_ini));
+  *ini = (struct lua_ini){0};
+  luaL_getmetatable(L, g_ini_metatable_name);
+  lua_setmetatable(L, -2);
+  ini->index = OV_HASHMAP_CREATE_DYNAMIC(sizeof(struct ini_index_item), 8, get_key_from_index_item);
+  if (!ini->index) {
+    luaL_error(L, "not enough memory");
+    return NULL;
+  }
+  return ini;
+}
+
+static int ini_gc(lua_State *const L) {
+  struct lua_ini *const ini = (struct lua_ini *)lua_touserdata(L, 1);
+  if (ini) {
+    ini_destroy(ini);
+  }
+  return 0;
+}
+
+/**
+ * @brief Push a new ini object parsed from a memory buffer
+ */
+static int push_ini_from_memory(lua_State *const L, char const *const str, size_t const len) {
+  struct lua_ini *const ini = push_new_ini(L);
+  if (len == 0) {
+    return 1;
+  }
+
+  struct ov_error err = {0};
+  struct gcmz_ini_reader *reader = NULL;
+  int result = -1;
+
+  {
+    if (!gcmz_ini_reader_create(&reader, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!gcmz_ini_reader_load_memory(reader, str, len, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!load_from_reader(ini, reader, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+  }
+  result = 1;
+
+cleanup:
+  if (reader) {
+    gcmz_ini_reader_destroy(&reader);
+  }
+  return result < 0 ? gcmz_luafn_err(L, &err) : result;
+}
+
+/**
+ * @brief Collect lines from a generic-for style iterator and push them joined with LF
+ */
+static void push_lines_from_iterator(lua_State *const L, int const iter_idx) {
+  lua_newtable(L);
+  int const lines = lua_gettop(L);
+  lua_pushnil(L);
+  int const control = lua_gettop(L);
+  int n = 0;
+  for (;;) {
+    lua_pushvalue(L, iter_idx);
+    lua_pushnil(L);
+    lua_pushvalue(L, control);
+    lua_call(L, 2, 1);
+    if (lua_isnil(L, -1)) {
+      lua_pop(L, 1);
+      break;
+    }
+    if (lua_type(L, -1) != LUA_TSTRING && lua_type(L, -1) != LUA_TNUMBER) {
+      luaL_error(L, "line iterator must return strings");
+      return;
+    }
+    lua_pushvalue(L, -1);
+    lua_replace(L, control);
+    lua_rawseti(L, lines, ++n);
+  }
+  lua_pop(L, 1);
+
+  luaL_Buffer b;
+  luaL_buffinit(L, &b);
+  for (int i = 1; i <= n; ++i) {
+    lua_rawgeti(L, lines, i);
+    luaL_addvalue(&b);
+    luaL_addchar(&b, '\n');
+  }
+  luaL_pushresult(&b);
+  lua_remove(L, lines);
+}
+
+/**
+ * @brief ini.new([source]) -> ini
+ *
+ * source can be nil, a line iterator function, or anything convertible with tostring().
+ */
+static int ini_new(lua_State *const L) {
+  lua_settop(L, 1);
+  switch (lua_type(L, 1)) {
+  case LUA_TNIL:
+    push_new_ini(L);
+    return 1;
+  case LUA_TFUNCTION:
+    push_lines_from_iterator(L, 1);
+    break;
+  default:
+    arg_tolstring(L, 1, NULL);
+    lua_pushvalue(L, 1);
+    break;
+  }
+  size_t len = 0;
+  char const *const str = lua_tolstring(L, -1, &len);
+  return push_ini_from_memory(L, str, len);
+}
+
+/**
+ * @brief ini.load(filepath) -> ini
+ */
+static int ini_load(lua_State *const L) {
+  lua_settop(L, 1);
+  char const *const filepath = arg_tolstring(L, 1, NULL);
+
+  struct ov_error err = {0};
+  wchar_t *filepath_w = NULL;
+  struct gcmz_ini_reader *reader = NULL;
+  int result = -1;
+
+  {
+    struct lua_ini *const ini = push_new_ini(L);
+    if (!gcmz_utf8_to_wchar(filepath, &filepath_w, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!gcmz_ini_reader_create(&reader, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!gcmz_ini_reader_load_file(reader, filepath_w, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!load_from_reader(ini, reader, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+  }
+  result = 1;
+
+cleanup:
+  if (reader) {
+    gcmz_ini_reader_destroy(&reader);
+  }
+  if (filepath_w) {
+    OV_ARRAY_DESTROY(&filepath_w);
+  }
+  return result < 0 ? gcmz_luafn_err(L, &err) : result;
+}
+
+/**
+ * @brief ini:save(filepath)
+ *
+ * The whole document is serialized first and written with a single write call.
+ */
+static int ini_save(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  lua_settop(L, 2);
+  char const *const filepath = arg_tolstring(L, 2, NULL);
+  size_t len = 0;
+  char const *const buf = push_serialized(L, ini, &len);
+
+  struct ov_error err = {0};
+  wchar_t *filepath_w = NULL;
+  struct ovl_file *file = NULL;
+  int result = -1;
+
+  {
+    if (!gcmz_utf8_to_wchar(filepath, &filepath_w, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (!ovl_file_create(filepath_w, &file, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    size_t written = 0;
+    if (!ovl_file_write(file, buf, len, &written, &err)) {
+      OV_ERROR_ADD_TRACE(&err);
+      goto cleanup;
+    }
+    if (written != len) {
+      OV_ERROR_SET(&err, ov_error_type_generic, ov_error_generic_fail, "failed to write complete INI file");
+      goto cleanup;
+    }
+  }
+  result = 0;
+
+cleanup:
+  if (file) {
+    ovl_file_close(file);
+    file = NULL;
+  }
+  if (filepath_w) {
+    OV_ARRAY_DESTROY(&filepath_w);
+  }
+  return result < 0 ? gcmz_luafn_err(L, &err) : result;
+}
+
+static int ini_tostring(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  size_t len = 0;
+  char const *const buf = push_serialized(L, ini, &len);
+  lua_pushlstring(L, buf, len);
+  return 1;
+}
+
+/**
+ * @brief ini:get(sect, key[, default]) -> string or default
+ */
+static int ini_get(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  lua_settop(L, 4);
+  size_t sect_len = 0;
+  size_t key_len = 0;
+  char const *const sect = arg_tolstring(L, 2, &sect_len);
+  char const *const key = arg_tolstring(L, 3, &key_len);
+  struct ini_entry const *const e = find_entry(ini, sect, sect_len, key, key_len);
+  if (e) {
+    lua_pushlstring(L, e->value, e->value_len);
+  } else {
+    lua_pushvalue(L, 4);
+  }
+  return 1;
+}
+
+/**
+ * @brief ini:set(sect, key, value)
+ */
+static int ini_set(lua_State *const L) {
+  struct lua_ini *const ini = check_ini(L);
+  lua_settop(L, 4);
+  size_t sect_len = 0;
+  size_t key_len = 0;
+  size_t value_len = 0;
+  char const *const sect = arg_tolstring(L, 2, &sect_len);
+  char const *const key = arg_tolstring(L, 3, &key_len);
+  char const *const value = arg_tolstring(L, 4, &value_len);
+  struct ov_error err = {0};
+  if (!set_value(ini, sect, sect_len, key, key_len, value, value_len, &err)) {
+    OV_ERROR_ADD_TRACE(&err);
+    return gcmz_luafn_err(L, &err);
+  }
+  return 0;
+}
+
+/**
+ * @brief ini:delete(sect, key)
+ */
+static int ini_delete(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  lua_settop(L, 3);
+  size_t sect_len = 0;
+  size_t key_len = 0;
+  char const *const sect = arg_tolstring(L, 2, &sect_len);
+  char const *const key = arg_tolstring(L, 3, &key_len);
+  struct ini_entry *const e = find_entry(ini, sect, sect_len, key, key_len);
+  if (e) {
+    // The key stays alive because the index item may still point at it
+    OV_FREE(&e->value);
+    e->value_len = 0;
+    e->deleted = true;
+  }
+  return 0;
+}
+
+/**
+ * @brief ini:deletesection(sect)
+ */
+static int ini_deletesection(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  lua_settop(L, 2);
+  size_t sect_len = 0;
+  char const *const sect = arg_tolstring(L, 2, &sect_len);
+  struct ini_section *const s = find_section(ini, sect, sect_len);
+  if (s) {
+    // The name stays alive because the section index item may still point at it
+    section_clear_entries(s);
+    s->deleted = true;
+  }
+  return 0;
+}
+
+/**
+ * @brief ini:sections() -> {name, ...}
+ */
+static int ini_sections(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  size_t const ns = OV_ARRAY_LENGTH(ini->sections);
+  lua_createtable(L, ns > INT_MAX ? INT_MAX : (int)ns, 0);
+  int n = 0;
+  for (size_t i = 0; i < ns; ++i) {
+    struct ini_section const *const s = &ini->sections[i];
+    if (!s->deleted) {
+      lua_pushlstring(L, s->name, s->name_len);
+      lua_rawseti(L, -2, ++n);
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief ini:keys(sect) -> {key, ...}
+ */
+static int ini_keys(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  lua_settop(L, 2);
+  size_t sect_len = 0;
+  char const *const sect = arg_tolstring(L, 2, &sect_len);
+  struct ini_section const *const s = find_section(ini, sect, sect_len);
+  size_t const ne = s ? OV_ARRAY_LENGTH(s->entries) : 0;
+  lua_createtable(L, ne > INT_MAX ? INT_MAX : (int)ne, 0);
+  int n = 0;
+  for (size_t i = 0; i < ne; ++i) {
+    struct ini_entry const *const e = &s->entries[i];
+    if (!e->deleted) {
+      lua_pushlstring(L, e->key, e->key_len);
+      lua_rawseti(L, -2, ++n);
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief ini:sectionexists(sect) -> boolean
+ */
+static int ini_sectionexists(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  lua_settop(L, 2);
+  size_t sect_len = 0;
+  char const *const sect = arg_tolstring(L, 2, &sect_len);
+  lua_pushboolean(L, find_section(ini, sect, sect_len) != NULL);
+  return 1;
+}
+
+/**
+ * @brief ini:exists(sect, key) -> boolean
+ */
+static int ini_exists(lua_State *const L) {
+  struct lua_ini const *const ini = check_ini(L);
+  lua_settop(L, 3);
+  size_t sect_len = 0;
+  size_t key_len = 0;
+  char const *const sect = arg_tolstring(L, 2, &sect_len);
+  char const *const key = arg_tolstring(L, 3, &key_len);
+  lua_pushboolean(L, find_entry(ini, sect, sect_len, key, key_len) != NULL);
+  return 1;
+}
+
+static int ini_open(lua_State *const L) {
+  // Module table doubles as the method table, same as ini.lua
+  lua_createtable(L, 0, 14);
+  lua_pushcfunction(L, ini_new);
+  lua_setfield(L, -2, "new");
+  lua_pushcfunction(L, ini_new);
+  lua_setfield(L, -2, "new_core");
+  lua_pushcfunction(L, ini_load);
+  lua_setfield(L, -2, "load");
+  lua_pushcfunction(L, ini_save);
+  lua_setfield(L, -2, "save");
+  lua_pushcfunction(L, ini_get);
+  lua_setfield(L, -2, "get");
+  lua_pushcfunction(L, ini_set);
+  lua_setfield(L, -2, "set");
+  lua_pushcfunction(L, ini_delete);
+  lua_setfield(L, -2, "delete");
+  lua_pushcfunction(L, ini_deletesection);
+  lua_setfield(L, -2, "deletesection");
+  lua_pushcfunction(L, ini_sections);
+  lua_setfield(L, -2, "sections");
+  lua_pushcfunction(L, ini_keys);
+  lua_setfield(L, -2, "keys");
+  lua_pushcfunction(L, ini_sectionexists);
+  lua_setfield(L, -2, "sectionexists");
+  lua_pushcfunction(L, ini_exists);
+  lua_setfield(L, -2, "exists");
+
+  luaL_newmetatable(L, g_ini_metatable_name);
+  lua_pushvalue(L, -2);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, ini_tostring);
+  lua_setfield(L, -2, "__tostring");
+  lua_pushcfunction(L, ini_gc);
+  lua_setfield(L, -2, "__gc");
+  lua_pop(L, 1);
+  return 1;
+}
+
+bool gcmz_lua_ini_register(struct lua_State *const L, struct ov_error *const err) {
+  if (!L) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  lua_getglobal(L, "package");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    return true;
+  }
+  lua_getfield(L, -1, "preload");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 2);
+    return true;
+  }
+  lua_pushcfunction(L, ini_open);
+  lua_setfield(L, -2, "ini");
+  lua_pop(L, 2);
+  return true;
+}
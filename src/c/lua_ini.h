@@ -0,0 +1,20 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct lua_State;
+
+/**
+ * @brief Register the native ini module to the given Lua state
+ *
+ * Installs a C implementation into package.preload["ini"] so that require('ini')
+ * resolves to it before ini.lua is searched on package.path.
+ * The module is API-compatible with ini.lua (new, load, get, set, delete, deletesection,
+ * sections, keys, sectionexists, exists, save and tostring) and parses through gcmz_ini_reader.
+ * When the package library is not loaded, registration is skipped and ini.lua remains in use.
+ *
+ * @param L Lua state to register the module to
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_lua_ini_register(struct lua_State *const L, struct ov_error *const err);
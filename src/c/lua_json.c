@@ -0,0 +1,375 @@
+// NOTE:
+// This module must stay compatible with src/lua/json.lua, which remains as a fallback.
+// When modifying behavior, please also update the documentation in LUA.md
+
+#include "lua_json.h"
+
+#include <limits.h>
+#include <math.h>
+
+#include <ovprintf.h>
+
+#include "json.h"
+
+#ifdef __GNUC__
+#  ifndef __has_warning
+#    define __has_warning(x) 0
+#  endif
+#  pragma GCC diagnostic push
+#  if __has_warning("-Wreserved-macro-identifier")
+#    pragma GCC diagnostic ignored "-Wreserved-macro-identifier"
+#  endif
+#endif // __GNUC__
+#include <lauxlib.h>
+#include <lua.h>
+#ifdef __GNUC__
+#  pragma GCC diagnostic pop
+#endif // __GNUC__
+
+enum {
+  // Guards the C stack against deeply nested documents; json.lua has no explicit limit
+  // but would hit Lua's own recursion limits long before this.
+  json_max_depth = 1000,
+};
+
+static char const g_json_doc_metatable_name[] = "gcmz_json_doc";
+
+/**
+ * @brief yyjson resources owned by a Lua userdata
+ *
+ * Conversion can raise Lua errors (type errors, out of memory) at any point,
+ * so every yyjson allocation is anchored to a userdata whose __gc releases it.
+ * On the success path the resources are released immediately.
+ */
+struct json_doc_box {
+  yyjson_doc *doc;
+  yyjson_mut_doc *mut_doc;
+  char *written;
+};
+
+static void json_doc_box_release(struct json_doc_box *const box) {
+  if (box->written) {
+    struct yyjson_alc const *const alc = gcmz_json_get_alc();
+    alc->free(alc->ctx, box->written);
+    box->written = NULL;
+  }
+  if (box->mut_doc) {
+    yyjson_mut_doc_free(box->mut_doc);
+    box->mut_doc = NULL;
+  }
+  if (box->doc) {
+    yyjson_doc_free(box->doc);
+    box->doc = NULL;
+  }
+}
+
+static int json_doc_box_gc(lua_State *const L) {
+  struct json_doc_box *const box = (struct json_doc_box *)lua_touserdata(L, 1);
+  if (box) {
+    json_doc_box_release(box);
+  }
+  return 0;
+}
+
+static struct json_doc_box *push_doc_box(lua_State *const L) {
+  struct json_doc_box *const box = (struct json_doc_box *)lua_newuserdata(L, sizeof(struct json_doc_box));
+  *box = (struct json_doc_box){0};
+  if (luaL_newmetatable(L, g_json_doc_metatable_name)) {
+    lua_pushcfunction(L, json_doc_box_gc);
+    lua_setfield(L, -2, "__gc");
+  }
+  lua_setmetatable(L, -2);
+  return box;
+}
+
+static int clamp_size_hint(size_t const n) { return n > INT_MAX ? INT_MAX : (int)n; }
+
+static void push_json_value(lua_State *const L, yyjson_val *const val, int const depth) {
+  if (depth > json_max_depth) {
+    luaL_error(L, "nesting too deep");
+    return;
+  }
+  switch (yyjson_get_type(val)) {
+  case YYJSON_TYPE_NULL:
+    lua_pushnil(L);
+    return;
+  case YYJSON_TYPE_BOOL:
+    lua_pushboolean(L, yyjson_get_bool(val));
+    return;
+  case YYJSON_TYPE_NUM:
+    lua_pushnumber(L, yyjson_get_num(val));
+    return;
+  case YYJSON_TYPE_STR:
+    lua_pushlstring(L, yyjson_get_str(val), yyjson_get_len(val));
+    return;
+  case YYJSON_TYPE_ARR: {
+    luaL_checkstack(L, 2, "nesting too deep");
+    lua_createtable(L, clamp_size_hint(yyjson_arr_size(val)), 0);
+    size_t i, max;
+    yyjson_val *elem;
+    yyjson_arr_foreach(val, i, max, elem) {
+      // null leaves a hole at its index, same as json.lua
+      push_json_value(L, elem, depth + 1);
+      lua_rawseti(L, -2, (int)(i + 1));
+    }
+    return;
+  }
+  case YYJSON_TYPE_OBJ: {
+    luaL_checkstack(L, 3, "nesting too deep");
+    lua_createtable(L, 0, clamp_size_hint(yyjson_obj_size(val)));
+    size_t i, max;
+    yyjson_val *key;
+    yyjson_val *elem;
+    yyjson_obj_foreach(val, i, max, key, elem) {
+      lua_pushlstring(L, yyjson_get_str(key), yyjson_get_len(key));
+      push_json_value(L, elem, depth + 1);
+      lua_rawset(L, -3);
+    }
+    return;
+  }
+  default:
+    break;
+  }
+  luaL_error(L, "unexpected value in document");
+}
+
+/**
+ * @brief json.decode(str) -> value
+ *
+ * Errors are raised as "<message> at line <n> col <n>" like json.lua.
+ */
+static int json_decode(lua_State *const L) {
+  if (lua_type(L, 1) != LUA_TSTRING) {
+    return luaL_error(L, "expected argument of type string, got %s", luaL_typename(L, 1));
+  }
+  size_t len = 0;
+  char const *const str = lua_tolstring(L, 1, &len);
+
+  struct json_doc_box *const box = push_doc_box(L);
+  yyjson_read_err rerr = {0};
+  box->doc = yyjson_read_opts(
+      (char *)ov_deconster_(str), len, YYJSON_READ_ALLOW_INVALID_UNICODE, gcmz_json_get_alc(), &rerr);
+  if (!box->doc) {
+    if (rerr.code == YYJSON_READ_ERROR_MEMORY_ALLOCATION) {
+      return luaL_error(L, "not enough memory");
+    }
+    size_t line = 1;
+    size_t col = rerr.pos + 1;
+    size_t chr = 0;
+    if (!yyjson_locate_pos(str, len, rerr.pos, &line, &col, &chr)) {
+      line = 1;
+      col = rerr.pos + 1;
+    }
+    return luaL_error(L, "%s at line %d col %d", rerr.msg ? rerr.msg : "invalid json", (int)line, (int)col);
+  }
+  push_json_value(L, yyjson_doc_get_root(box->doc), 0);
+  json_doc_box_release(box);
+  return 1;
+}
+
+struct json_encoder {
+  lua_State *L;
+  yyjson_mut_doc *doc;
+  int visited; ///< Stack index of the table used for circular reference detection
+};
+
+static yyjson_mut_val *encode_value(struct json_encoder *const enc, int const idx, int const depth);
+
+static yyjson_mut_val *encode_number(struct json_encoder *const enc, lua_Number const v) {
+  if (isnan(v) || isinf(v)) {
+    lua_pushnumber(enc->L, v);
+    luaL_error(enc->L, "unexpected number value '%s'", lua_tostring(enc->L, -1));
+    return NULL;
+  }
+  // Written as raw text to keep json.lua's "%.14g" formatting
+  char buf[32];
+  int const n = ov_snprintf_char(buf, sizeof(buf), NULL, "%.14g", v);
+  if (n <= 0 || (size_t)n >= sizeof(buf)) {
+    luaL_error(enc->L, "failed to format number");
+    return NULL;
+  }
+  return yyjson_mut_rawncpy(enc->doc, buf, (size_t)n);
+}
+
+static yyjson_mut_val *encode_table(struct json_encoder *const enc, int const idx, int const depth) {
+  lua_State *const L = enc->L;
+  if (depth > json_max_depth) {
+    luaL_error(L, "nesting too deep");
+    return NULL;
+  }
+  luaL_checkstack(L, 4, "nesting too deep");
+
+  lua_pushvalue(L, idx);
+  lua_rawget(L, enc->visited);
+  if (lua_toboolean(L, -1)) {
+    luaL_error(L, "circular reference");
+    return NULL;
+  }
+  lua_pop(L, 1);
+  lua_pushvalue(L, idx);
+  lua_pushboolean(L, 1);
+  lua_rawset(L, enc->visited);
+
+  // Same rule as json.lua: a table is an array if t[1] exists or it is empty
+  lua_rawgeti(L, idx, 1);
+  bool is_array = !lua_isnil(L, -1);
+  lua_pop(L, 1);
+  if (!is_array) {
+    lua_pushnil(L);
+    if (lua_next(L, idx)) {
+      lua_pop(L, 2);
+    } else {
+      is_array = true;
+    }
+  }
+
+  yyjson_mut_val *result = NULL;
+  if (is_array) {
+    size_t n = 0;
+    lua_pushnil(L);
+    while (lua_next(L, idx)) {
+      lua_pop(L, 1);
+      if (lua_type(L, -1) != LUA_TNUMBER) {
+        luaL_error(L, "invalid table: mixed or invalid key types");
+        return NULL;
+      }
+      ++n;
+    }
+    size_t const len = lua_objlen(L, idx);
+    if (n != len) {
+      luaL_error(L, "invalid table: sparse array");
+      return NULL;
+    }
+    result = yyjson_mut_arr(enc->doc);
+    if (!result) {
+      luaL_error(L, "not enough memory");
+      return NULL;
+    }
+    for (size_t i = 1; i <= len; ++i) {
+      lua_rawgeti(L, idx, (int)i);
+      yyjson_mut_val *const v = encode_value(enc, lua_gettop(L), depth + 1);
+      lua_pop(L, 1);
+      if (!yyjson_mut_arr_append(result, v)) {
+        luaL_error(L, "not enough memory");
+        return NULL;
+      }
+    }
+  } else {
+    result = yyjson_mut_obj(enc->doc);
+    if (!result) {
+      luaL_error(L, "not enough memory");
+      return NULL;
+    }
+    lua_pushnil(L);
+    while (lua_next(L, idx)) {
+      if (lua_type(L, -2) != LUA_TSTRING) {
+        luaL_error(L, "invalid table: mixed or invalid key types");
+        return NULL;
+      }
+      // Keys and values are kept alive by the table being encoded, so they can be referenced without copying.
+      size_t key_len = 0;
+      char const *const key_str = lua_tolstring(L, -2, &key_len);
+      yyjson_mut_val *const key = yyjson_mut_strn(enc->doc, key_str, key_len);
+      yyjson_mut_val *const v = encode_value(enc, lua_gettop(L), depth + 1);
+      lua_pop(L, 1);
+      if (!key || !yyjson_mut_obj_add(result, key, v)) {
+        luaL_error(L, "not enough memory");
+        return NULL;
+      }
+    }
+  }
+
+  lua_pushvalue(L, idx);
+  lua_pushnil(L);
+  lua_rawset(L, enc->visited);
+  return result;
+}
+
+static yyjson_mut_val *encode_value(struct json_encoder *const enc, int const idx, int const depth) {
+  lua_State *const L = enc->L;
+  switch (lua_type(L, idx)) {
+  case LUA_TNIL:
+    return yyjson_mut_null(enc->doc);
+  case LUA_TBOOLEAN:
+    return yyjson_mut_bool(enc->doc, lua_toboolean(L, idx) != 0);
+  case LUA_TNUMBER:
+    return encode_number(enc, lua_tonumber(L, idx));
+  case LUA_TSTRING: {
+    size_t len = 0;
+    char const *const str = lua_tolstring(L, idx, &len);
+    return yyjson_mut_strn(enc->doc, str, len);
+  }
+  case LUA_TTABLE:
+    return encode_table(enc, idx, depth);
+  default:
+    break;
+  }
+  luaL_error(L, "unexpected type '%s'", luaL_typename(L, idx));
+  return NULL;
+}
+
+/**
+ * @brief json.encode(value) -> string
+ */
+static int json_encode(lua_State *const L) {
+  lua_settop(L, 1);
+  struct json_doc_box *const box = push_doc_box(L);
+  lua_newtable(L);
+
+  box->mut_doc = yyjson_mut_doc_new(gcmz_json_get_alc());
+  if (!box->mut_doc) {
+    return luaL_error(L, "not enough memory");
+  }
+  struct json_encoder enc = {
+      .L = L,
+      .doc = box->mut_doc,
+      .visited = lua_gettop(L),
+  };
+  yyjson_mut_val *const root = encode_value(&enc, 1, 0);
+  if (!root) {
+    return luaL_error(L, "not enough memory");
+  }
+  yyjson_mut_doc_set_root(box->mut_doc, root);
+
+  size_t len = 0;
+  yyjson_write_err werr = {0};
+  box->written =
+      yyjson_mut_write_opts(box->mut_doc, YYJSON_WRITE_ALLOW_INVALID_UNICODE, gcmz_json_get_alc(), &len, &werr);
+  if (!box->written) {
+    return luaL_error(L, "%s", werr.msg ? werr.msg : "failed to write json");
+  }
+  lua_pushlstring(L, box->written, len);
+  json_doc_box_release(box);
+  return 1;
+}
+
+static int json_open(lua_State *const L) {
+  lua_createtable(L, 0, 2);
+  lua_pushcfunction(L, json_decode);
+  lua_setfield(L, -2, "decode");
+  lua_pushcfunction(L, json_encode);
+  lua_setfield(L, -2, "encode");
+  return 1;
+}
+
+bool gcmz_lua_json_register(struct lua_State *const L, struct ov_error *const err) {
+  if (!L) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  lua_getglobal(L, "package");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    return true;
+  }
+  lua_getfield(L, -1, "preload");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 2);
+    return true;
+  }
+  lua_pushcfunction(L, json_open);
+  lua_setfield(L, -2, "json");
+  lua_pop(L, 2);
+  return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct lua_State;
+
+/**
+ * @brief Register the native json module to the given Lua state
+ *
+ * Installs a yyjson-backed implementation into package.preload["json"] so that
+ * require('json') resolves to it before json.lua is searched on package.path.
+ * The module provides json.encode and json.decode with the same semantics as json.lua
+ * (null decodes to nil, tables with index 1 or no keys encode as arrays).
+ * When the package library is not loaded, registration is skipped and json.lua remains in use.
+ *
+ * @param L Lua state to register the module to
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_lua_json_register(struct lua_State *const L, struct ov_error *const err);
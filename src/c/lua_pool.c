@@ -0,0 +1,190 @@
+#include "lua_pool.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <ovarray.h>
+#include <ovthreads.h>
+
+#include "lua.h"
+
+struct pool_slot {
+  struct gcmz_lua_context *ctx;
+  DWORD owner_thread_id; // Valid only while busy
+  bool busy;
+};
+
+struct gcmz_lua_pool {
+  struct gcmz_lua_context *primary;
+  struct pool_slot *slots; // OV_ARRAY, slots are only appended
+  size_t max_replicas;
+  size_t creating; // Replicas being created outside the lock
+  mtx_t mtx;
+  cnd_t cnd;
+};
+
+NODISCARD bool gcmz_lua_pool_create(struct gcmz_lua_pool **const pp,
+                                    struct gcmz_lua_context *const primary,
+                                    size_t const max_replicas,
+                                    struct ov_error *const err) {
+  if (!pp || *pp || !primary || !max_replicas) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  struct gcmz_lua_pool *p = NULL;
+  bool result = false;
+
+  {
+    if (!OV_REALLOC(&p, 1, sizeof(struct gcmz_lua_pool))) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    *p = (struct gcmz_lua_pool){
+        .primary = primary,
+        .max_replicas = max_replicas,
+    };
+    if (mtx_init(&p->mtx, mtx_plain) != thrd_success) {
+      OV_FREE(&p);
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
+    if (cnd_init(&p->cnd) != thrd_success) {
+      mtx_destroy(&p->mtx);
+      OV_FREE(&p);
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
+  }
+
+  *pp = p;
+  result = true;
+
+cleanup:
+  return result;
+}
+
+void gcmz_lua_pool_destroy(struct gcmz_lua_pool **const pp) {
+  if (!pp || !*pp) {
+    return;
+  }
+  struct gcmz_lua_pool *const p = *pp;
+  if (p->slots) {
+    size_t const n = OV_ARRAY_LENGTH(p->slots);
+    for (size_t i = 0; i < n; ++i) {
+      gcmz_lua_destroy(&p->slots[i].ctx);
+    }
+    OV_ARRAY_DESTROY(&p->slots);
+  }
+  cnd_destroy(&p->cnd);
+  mtx_destroy(&p->mtx);
+  OV_FREE(pp);
+}
+
+NODISCARD struct gcmz_lua_context *gcmz_lua_pool_acquire(struct gcmz_lua_pool *const p, struct ov_error *const err) {
+  if (!p) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return NULL;
+  }
+
+  DWORD const thread_id = GetCurrentThreadId();
+  struct gcmz_lua_context *ctx = NULL;
+  struct gcmz_lua_context *created = NULL;
+
+  mtx_lock(&p->mtx);
+  for (;;) {
+    size_t const n = OV_ARRAY_LENGTH(p->slots);
+    for (size_t i = 0; i < n; ++i) {
+      if (!p->slots[i].busy) {
+        p->slots[i].busy = true;
+        p->slots[i].owner_thread_id = thread_id;
+        ctx = p->slots[i].ctx;
+        break;
+      }
+    }
+    if (ctx) {
+      break;
+    }
+    if (n + p->creating >= p->max_replicas) {
+      cnd_wait(&p->cnd, &p->mtx);
+      continue;
+    }
+
+    // Replica setup loads every handler script, so it must not block other threads
+    ++p->creating;
+    mtx_unlock(&p->mtx);
+    bool const success = gcmz_lua_create_replica(p->primary, &created, err);
+    mtx_lock(&p->mtx);
+    --p->creating;
+    if (!success) {
+      OV_ERROR_ADD_TRACE(err);
+      cnd_broadcast(&p->cnd);
+      goto cleanup;
+    }
+    // Other slots may have been appended while unlocked
+    size_t const pos = OV_ARRAY_LENGTH(p->slots);
+    if (!OV_ARRAY_GROW(&p->slots, pos + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      cnd_broadcast(&p->cnd);
+      goto cleanup;
+    }
+    p->slots[pos] = (struct pool_slot){
+        .ctx = created,
+        .owner_thread_id = thread_id,
+        .busy = true,
+    };
+    OV_ARRAY_SET_LENGTH(p->slots, pos + 1);
+    ctx = created;
+    created = NULL;
+    break;
+  }
+  mtx_unlock(&p->mtx);
+
+  // Catch up with handlers registered since this replica was last used
+  if (!gcmz_lua_sync_replica(p->primary, ctx, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    gcmz_lua_pool_release(p, ctx);
+    return NULL;
+  }
+  return ctx;
+
+cleanup:
+  mtx_unlock(&p->mtx);
+  gcmz_lua_destroy(&created);
+  return NULL;
+}
+
+void gcmz_lua_pool_release(struct gcmz_lua_pool *const p, struct gcmz_lua_context *const ctx) {
+  if (!p || !ctx) {
+    return;
+  }
+  mtx_lock(&p->mtx);
+  size_t const n = OV_ARRAY_LENGTH(p->slots);
+  for (size_t i = 0; i < n; ++i) {
+    if (p->slots[i].ctx == ctx) {
+      p->slots[i].busy = false;
+      p->slots[i].owner_thread_id = 0;
+      cnd_signal(&p->cnd);
+      break;
+    }
+  }
+  mtx_unlock(&p->mtx);
+}
+
+struct gcmz_lua_context *gcmz_lua_pool_get_current(struct gcmz_lua_pool *const p) {
+  if (!p) {
+    return NULL;
+  }
+  DWORD const thread_id = GetCurrentThreadId();
+  struct gcmz_lua_context *ctx = p->primary;
+  mtx_lock(&p->mtx);
+  size_t const n = OV_ARRAY_LENGTH(p->slots);
+  for (size_t i = 0; i < n; ++i) {
+    if (p->slots[i].busy && p->slots[i].owner_thread_id == thread_id) {
+      ctx = p->slots[i].ctx;
+      break;
+    }
+  }
+  mtx_unlock(&p->mtx);
+  return ctx;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct gcmz_lua_context;
+struct gcmz_lua_pool;
+
+/**
+ * @brief Create a pool of Lua contexts replicated from a primary context
+ *
+ * The primary context stays owned by the caller and keeps serving the main thread.
+ * Replicas are created lazily by gcmz_lua_pool_acquire up to max_replicas,
+ * so an idle pool costs nothing beyond the pool itself.
+ *
+ * Rules for handler-global state:
+ * - Each context has its own globals, upvalues and loaded modules; nothing is shared between them.
+ * - A context is held by one thread from acquire to release, so a drag_enter/drop sequence
+ *   processed within that span always sees the same handler state.
+ * - Handlers must not rely on state written on the main thread being visible to pooled contexts,
+ *   and vice versa. Persistent data should go through files or the gcmz API instead.
+ *
+ * @param pp [out] Pointer to store the created pool
+ * @param primary Primary Lua context (must be set up with gcmz_lua_setup, must outlive the pool)
+ * @param max_replicas Maximum number of replicas to create
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_lua_pool_create(struct gcmz_lua_pool **const pp,
+                                    struct gcmz_lua_context *const primary,
+                                    size_t const max_replicas,
+                                    struct ov_error *const err);
+
+/**
+ * @brief Destroy the pool and all replicas
+ *
+ * No context may be acquired at this point.
+ *
+ * @param pp Pool to destroy
+ */
+void gcmz_lua_pool_destroy(struct gcmz_lua_pool **const pp);
+
+/**
+ * @brief Acquire an idle replica for the calling thread
+ *
+ * Creates a new replica when none is idle and the limit is not reached, otherwise waits for a release.
+ * Handlers registered to the primary context since the replica was last used are replayed before returning.
+ *
+ * @param p Pool instance
+ * @param err [out] Error information on failure
+ * @return Acquired context on success, NULL on failure
+ */
+NODISCARD struct gcmz_lua_context *gcmz_lua_pool_acquire(struct gcmz_lua_pool *const p, struct ov_error *const err);
+
+/**
+ * @brief Return a replica acquired by gcmz_lua_pool_acquire to the pool
+ *
+ * @param p Pool instance
+ * @param ctx Context to release
+ */
+void gcmz_lua_pool_release(struct gcmz_lua_pool *const p, struct gcmz_lua_context *const ctx);
+
+/**
+ * @brief Get the context the calling thread should use
+ *
+ * @param p Pool instance
+ * @return Replica acquired by the calling thread, or the primary context if it holds none
+ */
+struct gcmz_lua_context *gcmz_lua_pool_get_current(struct gcmz_lua_pool *const p);
@@ -7,8 +7,25 @@
 #include <lauxlib.h>
 #include <lua.h>
 
+#include <limits.h>
 #include <string.h>
 
+#include "lua_ffi.h"
+
+/**
+ * @brief Numeric array argument as contiguous doubles
+ *
+ * Built on the first element access so that reading every element of a large array
+ * costs one pass over the Lua table instead of a type check and stack round trip per call.
+ * A gcmz_ffi buffer passed in place of a table is viewed in place as an array of doubles.
+ */
+struct array_view {
+  double const *values; ///< data, or the memory of a gcmz_ffi buffer
+  double *data;         ///< Values copied from a Lua table, NULL for a buffer view
+  int num;
+  bool ready;
+};
+
 struct script_module_param_context {
   lua_State *L;
   int base;
@@ -16,6 +33,7 @@ struct script_module_param_context {
   int num_pushed;
   bool has_error;
   char *error_msg;
+  struct array_view *views; ///< One per argument, allocated on the first array access
 };
 
 static struct script_module_param_context *g_ctx = NULL;
@@ -121,11 +139,98 @@ static bool param_get_table_boolean(int index, char const *key) {
   return result;
 }
 
+static int buffer_num_doubles(size_t const size) {
+  size_t const n = size / sizeof(double);
+  return n > INT_MAX ? INT_MAX : (int)n;
+}
+
+/**
+ * @brief Truncate an array element to int
+ *
+ * Buffer views hold arbitrary bytes, so NaN reads as 0 and out of range values are clamped
+ * instead of being converted with undefined behavior.
+ */
+static int array_value_to_int(double const value) {
+  if (value >= (double)INT_MAX) {
+    return INT_MAX;
+  }
+  if (value <= (double)INT_MIN) {
+    return INT_MIN;
+  }
+  return value == value ? (int)value : 0;
+}
+
+static void destroy_array_views(struct script_module_param_context *const ctx) {
+  if (!ctx->views) {
+    return;
+  }
+  size_t const n = OV_ARRAY_LENGTH(ctx->views);
+  for (size_t i = 0; i < n; ++i) {
+    if (ctx->views[i].data) {
+      OV_ARRAY_DESTROY(&ctx->views[i].data);
+    }
+  }
+  OV_ARRAY_DESTROY(&ctx->views);
+}
+
+/**
+ * @brief Get the numeric view of an array argument
+ *
+ * Lua values cannot change while the script module function runs, so the view stays valid until it returns.
+ *
+ * @return View, or NULL if it could not be allocated and the caller has to read the table directly
+ */
+static struct array_view const *get_array_view(int const index) {
+  if (!g_ctx->views) {
+    size_t const n = (size_t)g_ctx->num_args;
+    if (!OV_ARRAY_GROW(&g_ctx->views, n)) {
+      return NULL;
+    }
+    memset(g_ctx->views, 0, n * sizeof(struct array_view));
+    OV_ARRAY_SET_LENGTH(g_ctx->views, n);
+  }
+  struct array_view *const v = &g_ctx->views[index];
+  if (v->ready) {
+    return v;
+  }
+
+  lua_State *const L = g_ctx->L;
+  int const stack_index = g_ctx->base + index;
+  void *data = NULL;
+  size_t size = 0;
+  if (gcmz_lua_ffi_to_buffer(L, stack_index, &data, &size)) {
+    v->values = (double const *)data;
+    v->num = buffer_num_doubles(size);
+    v->ready = true;
+    return v;
+  }
+  int const num = lua_istable(L, stack_index) ? (int)lua_objlen(L, stack_index) : 0;
+  if (num > 0) {
+    if (!OV_ARRAY_GROW(&v->data, (size_t)num)) {
+      return NULL;
+    }
+    for (int i = 0; i < num; ++i) {
+      lua_rawgeti(L, stack_index, i + 1); // Lua arrays are 1-based
+      v->data[i] = lua_tonumber(L, -1);
+      lua_pop(L, 1);
+    }
+  }
+  v->values = v->data;
+  v->num = num;
+  v->ready = true;
+  return v;
+}
+
 static int param_get_array_num(int index) {
   if (!g_ctx || index < 0 || index >= g_ctx->num_args) {
     return 0;
   }
   int const stack_index = g_ctx->base + index;
+  void *data = NULL;
+  size_t size = 0;
+  if (gcmz_lua_ffi_to_buffer(g_ctx->L, stack_index, &data, &size)) {
+    return buffer_num_doubles(size);
+  }
   if (!lua_istable(g_ctx->L, stack_index)) {
     return 0;
   }
@@ -136,6 +241,10 @@ static int param_get_array_int(int index, int key) {
   if (!g_ctx || index < 0 || index >= g_ctx->num_args) {
     return 0;
   }
+  struct array_view const *const v = get_array_view(index);
+  if (v) {
+    return key >= 0 && key < v->num ? array_value_to_int(v->values[key]) : 0;
+  }
   int const stack_index = g_ctx->base + index;
   if (!lua_istable(g_ctx->L, stack_index)) {
     return 0;
@@ -150,6 +259,10 @@ static double param_get_array_double(int index, int key) {
   if (!g_ctx || index < 0 || index >= g_ctx->num_args) {
     return 0.0;
   }
+  struct array_view const *const v = get_array_view(index);
+  if (v) {
+    return key >= 0 && key < v->num ? v->values[key] : 0.0;
+  }
   int const stack_index = g_ctx->base + index;
   if (!lua_istable(g_ctx->L, stack_index)) {
     return 0.0;
@@ -333,6 +446,7 @@ int script_module_param_call(lua_State *const L, void (*func)(struct aviutl2_scr
       .num_pushed = 0,
       .has_error = false,
       .error_msg = NULL,
+      .views = NULL,
   };
   g_ctx = &ctx;
 
@@ -370,6 +484,7 @@ int script_module_param_call(lua_State *const L, void (*func)(struct aviutl2_scr
   func(&param);
 
   int result = ctx.num_pushed;
+  destroy_array_views(&ctx);
 
   // Check for errors
   if (ctx.has_error) {
@@ -13,6 +13,7 @@
 #include <ovtest.h>
 
 #include "lua.h"
+#include "lua_ffi.h"
 
 #include <ovarray.h>
 #include <ovprintf.h>
@@ -20,6 +21,7 @@
 
 #include <aviutl2_module2.h>
 
+#include <limits.h>
 #include <math.h>
 #include <windows.h>
 
@@ -175,6 +177,18 @@ static void func_array_double_param(struct aviutl2_script_module_param *param) {
   param->push_result_int(g_captured.array_num);
 }
 
+/**
+ * @brief Function that returns the sum of all elements of a numeric array
+ */
+static void func_sum_array_double(struct aviutl2_script_module_param *param) {
+  int const num = param->get_param_array_num(0);
+  double sum = 0.0;
+  for (int i = 0; i < num; i++) {
+    sum += param->get_param_array_double(0, i);
+  }
+  param->push_result_double(sum);
+}
+
 /**
  * @brief Function that reads array of strings
  */
@@ -362,6 +376,7 @@ static struct aviutl2_script_module_function g_test_functions[] = {
     {L"array_param", func_array_param},
     {L"array_double_param", func_array_double_param},
     {L"array_string_param", func_array_string_param},
+    {L"sum_array_double", func_sum_array_double},
     {L"multi_return", func_multi_return},
     {L"return_table_int", func_return_table_int},
     {L"return_table_double", func_return_table_double},
@@ -751,6 +766,68 @@ static void test_call_function_with_array_doubles(void) {
   gcmz_lua_destroy(&ctx);
 }
 
+static void test_call_function_with_array_buffer(void) {
+  struct gcmz_lua_context *ctx = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_lua_create(&ctx, &err), &err)) {
+    return;
+  }
+  if (!TEST_SUCCEEDED(gcmz_lua_register_script_module(ctx, &g_test_module, "testmod", NULL, &err), &err)) {
+    gcmz_lua_destroy(&ctx);
+    return;
+  }
+
+  lua_State *L = gcmz_lua_get_state(ctx);
+  if (!TEST_SUCCEEDED(gcmz_lua_ffi_register(L, &err), &err)) {
+    gcmz_lua_destroy(&ctx);
+    return;
+  }
+  register_module_lookup(L);
+  clear_captured();
+
+  // A gcmz_ffi buffer is read in place as an array of doubles
+  TEST_CHECK(run_lua_code(L,
+                          "local ffi = require('ffi')\n"
+                          "local buf = require('gcmz_ffi').new(3 * 8 + 4)\n"
+                          "local p = ffi.cast('double *', buf:ptr())\n"
+                          "p[0], p[1], p[2] = 1.5, -2.25, 42\n"
+                          "local m = get_test_module('testmod')\n"
+                          "assert(m.array_double_param(buf) == 3)\n"
+                          "assert(m.array_param(buf) == 3)\n",
+                          "array buffer"));
+
+  TEST_CHECK(g_captured.array_num == 3);
+  TEST_CHECK(fabs(g_captured.array_double_values[0] - 1.5) < 0.001);
+  TEST_CHECK(fabs(g_captured.array_double_values[1] - -2.25) < 0.001);
+  TEST_CHECK(fabs(g_captured.array_double_values[2] - 42.0) < 0.001);
+  TEST_CHECK(g_captured.array_int_values[0] == 1);
+  TEST_CHECK(g_captured.array_int_values[1] == -2);
+  TEST_CHECK(g_captured.array_int_values[2] == 42);
+
+  // Integer reads of NaN and out of range doubles are defined
+  clear_captured();
+  TEST_CHECK(run_lua_code(L,
+                          "local ffi = require('ffi')\n"
+                          "local buf = require('gcmz_ffi').new(3 * 8)\n"
+                          "local p = ffi.cast('double *', buf:ptr())\n"
+                          "p[0], p[1], p[2] = 0 / 0, 1e300, -1e300\n"
+                          "assert(get_test_module('testmod').array_param(buf) == 3)\n",
+                          "array buffer out of range"));
+  TEST_CHECK(g_captured.array_int_values[0] == 0);
+  TEST_CHECK(g_captured.array_int_values[1] == INT_MAX);
+  TEST_CHECK(g_captured.array_int_values[2] == INT_MIN);
+
+  // Non-numeric elements read as 0, a buffer smaller than one double is empty
+  TEST_CHECK(run_lua_code(L,
+                          "local m = get_test_module('testmod')\n"
+                          "assert(m.sum_array_double({1, '2', 'x', true, 4}) == 7)\n"
+                          "assert(m.sum_array_double(require('gcmz_ffi').new(7)) == 0)\n",
+                          "array conversion"));
+
+  gcmz_lua_destroy(&ctx);
+}
+
 static void test_call_function_with_array_strings(void) {
   struct gcmz_lua_context *ctx = NULL;
   struct ov_error err = {0};
@@ -1340,6 +1417,7 @@ TEST_LIST = {
     // Array parameter tests
     {"call_function_with_array", test_call_function_with_array},
     {"call_function_with_array_doubles", test_call_function_with_array_doubles},
+    {"call_function_with_array_buffer", test_call_function_with_array_buffer},
     {"call_function_with_array_strings", test_call_function_with_array_strings},
 
     // Return value tests
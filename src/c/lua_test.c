@@ -2,6 +2,8 @@
 
 #include "file.h"
 #include "lua.h"
+#include "lua_alloc.h"
+#include "lua_pool.h"
 #include "luautil.h"
 
 #include <ovarray.h>
@@ -1245,6 +1247,240 @@ cleanup:
   gcmz_lua_destroy(&ctx);
 }
 
+static lua_Integer get_handler_count(struct gcmz_lua_context *const ctx) {
+  lua_State *const L = gcmz_lua_get_state(ctx);
+  int const top = lua_gettop(L);
+  lua_Integer count = -1;
+  lua_getglobal(L, "require");
+  lua_pushstring(L, "entrypoint");
+  if (lua_pcall(L, 1, 1, 0) == LUA_OK) {
+    lua_getfield(L, -1, "get_module_count");
+    if (lua_pcall(L, 0, 1, 0) == LUA_OK && lua_isnumber(L, -1)) {
+      count = lua_tointeger(L, -1);
+    }
+  }
+  lua_settop(L, top);
+  return count;
+}
+
+static void test_lua_pool(void) {
+  struct gcmz_lua_context *ctx = NULL;
+  struct gcmz_lua_pool *pool = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_lua_create(&ctx, &err), &err)) {
+    return;
+  }
+  if (!TEST_SUCCEEDED(gcmz_lua_setup(ctx,
+                                     &(struct gcmz_lua_options){
+                                         .script_dir = LUA_SRC_DIR,
+                                         .api_register_callback = test_api_register_callback,
+                                     },
+                                     &err),
+                      &err)) {
+    goto cleanup;
+  }
+
+  static char const script1[] = "return { name = 'pool_test1', priority = 100 }";
+  static char const script2[] = "return { name = 'pool_test2', priority = 200 }";
+  if (!TEST_SUCCEEDED(gcmz_lua_add_handler_script(ctx, script1, sizeof(script1) - 1, "test://pool1", &err), &err)) {
+    goto cleanup;
+  }
+
+  TEST_FAILED_WITH(gcmz_lua_pool_create(&pool, ctx, 0, &err),
+                   &err,
+                   ov_error_type_generic,
+                   ov_error_generic_invalid_argument);
+  if (!TEST_SUCCEEDED(gcmz_lua_pool_create(&pool, ctx, 1, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(gcmz_lua_pool_get_current(pool) == ctx);
+
+  {
+    struct gcmz_lua_context *const replica = gcmz_lua_pool_acquire(pool, &err);
+    if (!TEST_SUCCEEDED(replica != NULL, &err)) {
+      goto cleanup;
+    }
+    TEST_CHECK(replica != ctx);
+    TEST_CHECK(gcmz_lua_pool_get_current(pool) == replica);
+    TEST_CHECK(get_handler_count(replica) == 1);
+
+    // Globals are per state
+    lua_State *const L = gcmz_lua_get_state(replica);
+    lua_pushboolean(L, 1);
+    lua_setglobal(L, "pool_test_global");
+    lua_getglobal(gcmz_lua_get_state(ctx), "pool_test_global");
+    TEST_CHECK(lua_isnil(gcmz_lua_get_state(ctx), -1));
+    lua_pop(gcmz_lua_get_state(ctx), 1);
+
+    gcmz_lua_pool_release(pool, replica);
+    TEST_CHECK(gcmz_lua_pool_get_current(pool) == ctx);
+  }
+
+  // Handlers added to the primary later are replayed on the next acquire
+  if (!TEST_SUCCEEDED(gcmz_lua_add_handler_script(ctx, script2, sizeof(script2) - 1, "test://pool2", &err), &err)) {
+    goto cleanup;
+  }
+  {
+    struct gcmz_lua_context *const replica = gcmz_lua_pool_acquire(pool, &err);
+    if (!TEST_SUCCEEDED(replica != NULL, &err)) {
+      goto cleanup;
+    }
+    TEST_CHECK(get_handler_count(replica) == 2);
+    TEST_CHECK(get_handler_count(ctx) == 2);
+    gcmz_lua_pool_release(pool, replica);
+  }
+
+cleanup:
+  gcmz_lua_pool_destroy(&pool);
+  gcmz_lua_destroy(&ctx);
+}
+
+static void test_memory_budget(void) {
+  enum {
+    budget = 4 * 1024 * 1024,
+  };
+  struct gcmz_lua_context *ctx = NULL;
+  struct gcmz_file_list *file_list = NULL;
+  lua_State *L = NULL;
+  struct gcmz_lua_alloc_stats stats = {0};
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_lua_create(&ctx, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_lua_setup(ctx,
+                                     &(struct gcmz_lua_options){
+                                         .script_dir = LUA_SRC_DIR,
+                                         .api_register_callback = test_api_register_callback,
+                                         .hook_memory_budget = budget,
+                                     },
+                                     &err),
+                      &err)) {
+    goto cleanup;
+  }
+
+  {
+    static char const script[] = "return {\n"
+                                 "  name = 'runaway_handler',\n"
+                                 "  drop = function(files, state)\n"
+                                 "    local t = {}\n"
+                                 "    for i = 1, 1000000 do t[i] = string.rep('x', 64) .. i end\n"
+                                 "  end,\n"
+                                 "}\n";
+    if (!TEST_SUCCEEDED(gcmz_lua_add_handler_script(ctx, script, sizeof(script) - 1, "test://runaway", &err), &err)) {
+      goto cleanup;
+    }
+  }
+
+  file_list = gcmz_file_list_create(&err);
+  if (!TEST_SUCCEEDED(file_list != NULL, &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_file_list_add(file_list, L"C:\\test\\file.txt", NULL, &err), &err)) {
+    goto cleanup;
+  }
+
+  L = gcmz_lua_get_state(ctx);
+  if (!TEST_CHECK(gcmz_lua_alloc_get_stats(L, &stats))) {
+    goto cleanup;
+  }
+  TEST_CHECK(stats.current > 0 && stats.peak >= stats.current && stats.pooled > 0 && stats.allocations > 0);
+
+  // The handler error is caught by entrypoint.lua, only the runaway handler is aborted
+  if (!gcmz_lua_call_drop(ctx, file_list, 0, 0, false, &err)) {
+    OV_ERROR_DESTROY(&err);
+  }
+  TEST_CHECK(gcmz_lua_alloc_get_stats(L, &stats));
+  TEST_CHECK(stats.budget_exceeded);
+  TEST_CHECK(stats.budget == budget);
+  TEST_CHECK(stats.hook_peak <= stats.peak);
+
+  // The budget only applies while a hook runs
+  TEST_CHECK(luaL_dostring(L, "_TEST_BIG = string.rep('y', 8 * 1024 * 1024)") == LUA_OK);
+  TEST_CHECK(gcmz_lua_alloc_get_stats(L, &stats));
+  TEST_CHECK(stats.current > (size_t)budget * 2);
+
+cleanup:
+  gcmz_file_list_destroy(&file_list);
+  gcmz_lua_destroy(&ctx);
+}
+
+static bool write_script(wchar_t const *const path, char const *const script) {
+  HANDLE h = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  DWORD written = 0;
+  BOOL const ok = WriteFile(h, script, (DWORD)strlen(script), &written, NULL);
+  CloseHandle(h);
+  return ok && written == strlen(script);
+}
+
+static void test_reload_handlers(void) {
+  static wchar_t const script_path[] = LUA_PLUGIN_TEST_DIR L"/reload_test.lua";
+  static char const *const module_names[] = {"reload_test"};
+  static char const check[] = "local ep = require('entrypoint')\n"
+                              "local found = 0\n"
+                              "for i = 1, ep.get_module_count() do\n"
+                              "  local entry = ep.get_module(i)\n"
+                              "  if entry.name == 'reload_test' then\n"
+                              "    found = found + 1\n"
+                              "    assert(entry.module.version == _EXPECT_VERSION)\n"
+                              "  end\n"
+                              "end\n"
+                              "assert(found == _EXPECT_FOUND)\n"
+                              "assert(require('test_handler').counter == 42)\n";
+  struct gcmz_lua_context *ctx = NULL;
+  lua_State *L = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_CHECK(write_script(script_path, "return { name = 'reload_test', version = 1 }"))) {
+    return;
+  }
+  if (!TEST_SUCCEEDED(gcmz_lua_create(&ctx, &err), &err)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_lua_setup(ctx,
+                                     &(struct gcmz_lua_options){
+                                         .script_dir = LUA_PLUGIN_TEST_DIR,
+                                         .api_register_callback = test_api_register_callback,
+                                     },
+                                     &err),
+                      &err)) {
+    goto cleanup;
+  }
+  L = gcmz_lua_get_state(ctx);
+  // State of a handler that is not reloaded must survive
+  TEST_CHECK(luaL_dostring(L, "require('test_handler').counter = 42") == LUA_OK);
+  TEST_CHECK(luaL_dostring(L, "_EXPECT_VERSION, _EXPECT_FOUND = 1, 1") == LUA_OK);
+  TEST_CHECK(luaL_dostring(L, check) == LUA_OK);
+
+  TEST_CASE("changed");
+  if (!TEST_CHECK(write_script(script_path, "return { name = 'reload_test', version = 2 }"))) {
+    goto cleanup;
+  }
+  if (TEST_SUCCEEDED(gcmz_lua_reload_handlers(ctx, module_names, 1, &err), &err)) {
+    TEST_CHECK(luaL_dostring(L, "_EXPECT_VERSION, _EXPECT_FOUND = 2, 1") == LUA_OK);
+    if (!TEST_CHECK(luaL_dostring(L, check) == LUA_OK)) {
+      TEST_MSG("%s", lua_tostring(L, -1));
+    }
+  }
+
+  TEST_CASE("deleted");
+  DeleteFileW(script_path);
+  if (TEST_SUCCEEDED(gcmz_lua_reload_handlers(ctx, module_names, 1, &err), &err)) {
+    TEST_CHECK(luaL_dostring(L, "_EXPECT_FOUND = 0") == LUA_OK);
+    if (!TEST_CHECK(luaL_dostring(L, check) == LUA_OK)) {
+      TEST_MSG("%s", lua_tostring(L, -1));
+    }
+  }
+
+cleanup:
+  gcmz_lua_destroy(&ctx);
+  DeleteFileW(script_path);
+}
+
 TEST_LIST = {
     {"create_destroy", test_create_destroy},
     {"standard_libraries", test_standard_libraries},
@@ -1268,5 +1504,8 @@ TEST_LIST = {
     {"plugin_loading_all_types", test_plugin_loading_all_types},
     {"handler_script_integration", test_handler_script_integration},
     {"load_handlers_error_reporting", test_load_handlers_error_reporting},
+    {"memory_budget", test_memory_budget},
+    {"reload_handlers", test_reload_handlers},
+    {"lua_pool", test_lua_pool},
     {NULL, NULL},
 };
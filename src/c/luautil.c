@@ -11,10 +11,15 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
 int gcmz_luafn_err_(struct lua_State *const L, struct ov_error *const e, char const *const funcname) {
   if (!L || !funcname) {
     if (e) {
@@ -117,6 +122,139 @@ bool gcmz_lua_pcall(struct lua_State *const L, int nargs, int nresults, struct o
   return true;
 }
 
+/**
+ * @brief Convert UTF-8 to UTF-16 in one pass
+ *
+ * dest must have room for src_len + 1 characters, which is enough for any valid input.
+ * Only well-formed UTF-8 is accepted so that anything else keeps the behavior of ov_utf8_to_wchar.
+ *
+ * @return Number of characters written excluding the terminator, or SIZE_MAX if src is not well-formed
+ */
+static size_t utf8_to_wchar_fast(uint8_t const *const src, size_t const src_len, wchar_t *const dest) {
+  size_t i = 0;
+  size_t o = 0;
+  while (i < src_len) {
+#if defined(__SSE2__)
+    __m128i const zero = _mm_setzero_si128();
+    while (i + 16 <= src_len) {
+      __m128i const v = _mm_loadu_si128((__m128i const *)(void const *)(src + i));
+      if (_mm_movemask_epi8(v)) {
+        break;
+      }
+      _mm_storeu_si128((__m128i *)(void *)(dest + o), _mm_unpacklo_epi8(v, zero));
+      _mm_storeu_si128((__m128i *)(void *)(dest + o + 8), _mm_unpackhi_epi8(v, zero));
+      i += 16;
+      o += 16;
+    }
+    if (i == src_len) {
+      break;
+    }
+#endif
+    uint8_t const b = src[i];
+    if (b < 0x80) {
+      dest[o++] = (wchar_t)b;
+      ++i;
+      continue;
+    }
+    size_t n;
+    uint32_t cp;
+    uint8_t lo = 0x80;
+    uint8_t hi = 0xbf;
+    if (b >= 0xc2 && b <= 0xdf) {
+      n = 2;
+      cp = b & 0x1f;
+    } else if (b >= 0xe0 && b <= 0xef) {
+      n = 3;
+      cp = b & 0x0f;
+      lo = b == 0xe0 ? 0xa0 : 0x80; // Overlong
+      hi = b == 0xed ? 0x9f : 0xbf; // Surrogates
+    } else if (b >= 0xf0 && b <= 0xf4) {
+      n = 4;
+      cp = b & 0x07;
+      lo = b == 0xf0 ? 0x90 : 0x80; // Overlong
+      hi = b == 0xf4 ? 0x8f : 0xbf; // Above U+10FFFF
+    } else {
+      return SIZE_MAX;
+    }
+    if (src_len - i < n || src[i + 1] < lo || src[i + 1] > hi) {
+      return SIZE_MAX;
+    }
+    for (size_t j = 1; j < n; ++j) {
+      if ((src[i + j] & 0xc0) != 0x80) {
+        return SIZE_MAX;
+      }
+      cp = (cp << 6) | (src[i + j] & 0x3f);
+    }
+    if (cp >= 0x10000) {
+      cp -= 0x10000;
+      dest[o++] = (wchar_t)(0xd800 + (cp >> 10));
+      dest[o++] = (wchar_t)(0xdc00 + (cp & 0x3ff));
+    } else {
+      dest[o++] = (wchar_t)cp;
+    }
+    i += n;
+  }
+  dest[o] = L'\0';
+  return o;
+}
+
+/**
+ * @brief Convert UTF-16 to UTF-8 in one pass
+ *
+ * dest must have room for src_len * 3 + 1 bytes, which is enough for any valid input.
+ * Unpaired surrogates are left to ov_wchar_to_utf8.
+ *
+ * @return Number of bytes written excluding the terminator, or SIZE_MAX if src has unpaired surrogates
+ */
+static size_t wchar_to_utf8_fast(wchar_t const *const src, size_t const src_len, uint8_t *const dest) {
+  size_t i = 0;
+  size_t o = 0;
+  while (i < src_len) {
+#if defined(__SSE2__)
+    __m128i const non_ascii = _mm_set1_epi16((short)0xff80);
+    __m128i const zero = _mm_setzero_si128();
+    while (i + 8 <= src_len) {
+      __m128i const v = _mm_loadu_si128((__m128i const *)(void const *)(src + i));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, non_ascii), zero)) != 0xffff) {
+        break;
+      }
+      _mm_storel_epi64((__m128i *)(void *)(dest + o), _mm_packus_epi16(v, v));
+      i += 8;
+      o += 8;
+    }
+    if (i == src_len) {
+      break;
+    }
+#endif
+    uint32_t cp = (uint32_t)src[i++];
+    if (cp < 0x80) {
+      dest[o++] = (uint8_t)cp;
+      continue;
+    }
+    if (cp < 0x800) {
+      dest[o++] = (uint8_t)(0xc0 | (cp >> 6));
+      dest[o++] = (uint8_t)(0x80 | (cp & 0x3f));
+      continue;
+    }
+    if (cp >= 0xd800 && cp <= 0xdfff) {
+      if (cp >= 0xdc00 || i == src_len || src[i] < 0xdc00 || src[i] > 0xdfff) {
+        return SIZE_MAX;
+      }
+      cp = 0x10000 + ((cp - 0xd800) << 10) + ((uint32_t)src[i++] - 0xdc00);
+      dest[o++] = (uint8_t)(0xf0 | (cp >> 18));
+      dest[o++] = (uint8_t)(0x80 | ((cp >> 12) & 0x3f));
+      dest[o++] = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+      dest[o++] = (uint8_t)(0x80 | (cp & 0x3f));
+      continue;
+    }
+    dest[o++] = (uint8_t)(0xe0 | (cp >> 12));
+    dest[o++] = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+    dest[o++] = (uint8_t)(0x80 | (cp & 0x3f));
+  }
+  dest[o] = '\0';
+  return o;
+}
+
 bool gcmz_utf8_to_wchar(char const *const src, wchar_t **const dest, struct ov_error *const err) {
   if (!dest) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
@@ -131,18 +269,26 @@ bool gcmz_utf8_to_wchar(char const *const src, wchar_t **const dest, struct ov_e
 
   bool result = false;
   size_t const src_len = strlen(src);
-  size_t const dest_len = ov_utf8_to_wchar_len(src, src_len);
-  if (dest_len == 0) {
-    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
-    goto cleanup;
-  }
-  if (!OV_ARRAY_GROW(dest, dest_len + 1)) {
+  // UTF-8 never needs more UTF-16 code units than bytes, so one upper-bound grow replaces the sizing pass
+  if (!OV_ARRAY_GROW(dest, src_len + 1)) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
     goto cleanup;
   }
-  if (ov_utf8_to_wchar(src, src_len, *dest, dest_len + 1, NULL) == 0) {
-    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
-    goto cleanup;
+  if (utf8_to_wchar_fast((uint8_t const *)src, src_len, *dest) == SIZE_MAX) {
+    // Ill-formed input, let ovutf decide how to handle it
+    size_t const dest_len = ov_utf8_to_wchar_len(src, src_len);
+    if (dest_len == 0) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
+    if (!OV_ARRAY_GROW(dest, dest_len + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    if (ov_utf8_to_wchar(src, src_len, *dest, dest_len + 1, NULL) == 0) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
   }
   result = true;
 
@@ -167,18 +313,26 @@ bool gcmz_wchar_to_utf8(wchar_t const *const src, char **const dest, struct ov_e
 
   bool result = false;
   size_t const src_len = wcslen(src);
-  size_t const dest_len = ov_wchar_to_utf8_len(src, src_len);
-  if (dest_len == 0) {
-    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
-    goto cleanup;
-  }
-  if (!OV_ARRAY_GROW(dest, dest_len + 1)) {
+  // Each UTF-16 code unit needs at most 3 bytes (a surrogate pair needs 4 for 2 units)
+  if (!OV_ARRAY_GROW(dest, src_len * 3 + 1)) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
     goto cleanup;
   }
-  if (ov_wchar_to_utf8(src, src_len, *dest, dest_len + 1, NULL) == 0) {
-    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
-    goto cleanup;
+  if (wchar_to_utf8_fast(src, src_len, (uint8_t *)*dest) == SIZE_MAX) {
+    // Unpaired surrogates, let ovutf decide how to handle them
+    size_t const dest_len = ov_wchar_to_utf8_len(src, src_len);
+    if (dest_len == 0) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
+    if (!OV_ARRAY_GROW(dest, dest_len + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    if (ov_wchar_to_utf8(src, src_len, *dest, dest_len + 1, NULL) == 0) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
   }
   result = true;
 
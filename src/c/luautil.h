@@ -59,6 +59,8 @@ bool gcmz_lua_pcall(struct lua_State *const L, int nargs, int nresults, struct o
  *
  * Allocates memory using OV_ARRAY_GROW. Caller is responsible for calling OV_ARRAY_DESTROY.
  * The buffer can be reused by passing a non-NULL pointer; it will be grown if needed.
+ * The buffer is grown to the worst-case size so the string is converted in one pass,
+ * reusing it across calls avoids an allocation per conversion.
  * If src is NULL or empty, the destination will contain an empty string.
  *
  * @param src Source UTF-8 string (can be NULL)
@@ -73,6 +75,8 @@ NODISCARD bool gcmz_utf8_to_wchar(char const *src, wchar_t **dest, struct ov_err
  *
  * Allocates memory using OV_ARRAY_GROW. Caller is responsible for calling OV_ARRAY_DESTROY.
  * The buffer can be reused by passing a non-NULL pointer; it will be grown if needed.
+ * The buffer is grown to the worst-case size so the string is converted in one pass,
+ * reusing it across calls avoids an allocation per conversion.
  * If src is NULL or empty, the destination will contain an empty string.
  *
  * @param src Source wide string (can be NULL)
@@ -2389,6 +2389,71 @@ cleanup:
   }
 }
 
+static void test_utf_conversion(void) {
+  static char const mixed_utf8[] =
+      "C:\\\xe7\xb4\xa0\xe6\x9d\x90\\abcdefghijklmnopqrstuvwxyz_\xc3\xa9_\xf0\x9f\x8e\xac.png";
+  static wchar_t const mixed_wide[] = L"C:\\\x7d20\x6750\\abcdefghijklmnopqrstuvwxyz_\x00e9_\xd83c\xdfac.png";
+  wchar_t *w = NULL;
+  char *u = NULL;
+  struct ov_error err = {0};
+
+  TEST_CASE("ascii longer than a vector");
+  if (TEST_SUCCEEDED(gcmz_utf8_to_wchar("0123456789abcdefghijklmnopqrstuvwxyz", &w, &err), &err)) {
+    TEST_CHECK(wcscmp(w, L"0123456789abcdefghijklmnopqrstuvwxyz") == 0);
+  }
+  if (TEST_SUCCEEDED(gcmz_wchar_to_utf8(L"0123456789abcdefghijklmnopqrstuvwxyz", &u, &err), &err)) {
+    TEST_CHECK(strcmp(u, "0123456789abcdefghijklmnopqrstuvwxyz") == 0);
+  }
+
+  TEST_CASE("mixed with multibyte and surrogate pairs");
+  if (TEST_SUCCEEDED(gcmz_utf8_to_wchar(mixed_utf8, &w, &err), &err)) {
+    TEST_CHECK(wcscmp(w, mixed_wide) == 0);
+  }
+  if (TEST_SUCCEEDED(gcmz_wchar_to_utf8(mixed_wide, &u, &err), &err)) {
+    TEST_CHECK(strcmp(u, mixed_utf8) == 0);
+  }
+
+  TEST_CASE("reused buffer shrinks to shorter result");
+  if (TEST_SUCCEEDED(gcmz_utf8_to_wchar("a", &w, &err), &err)) {
+    TEST_CHECK(wcscmp(w, L"a") == 0);
+  }
+  if (TEST_SUCCEEDED(gcmz_wchar_to_utf8(L"\x3042", &u, &err), &err)) {
+    TEST_CHECK(strcmp(u, "\xe3\x81\x82") == 0);
+  }
+  if (TEST_SUCCEEDED(gcmz_utf8_to_wchar("", &w, &err), &err)) {
+    TEST_CHECK(w[0] == L'\0');
+  }
+
+  TEST_CASE("ill-formed input behaves like ovutf");
+  {
+    static char const invalid_utf8[] = "abc\xc0\xafdef";
+    size_t const len = ov_utf8_to_wchar_len(invalid_utf8, strlen(invalid_utf8));
+    if (len == 0) {
+      TEST_CHECK(!gcmz_utf8_to_wchar(invalid_utf8, &w, &err));
+      OV_ERROR_DESTROY(&err);
+    } else if (TEST_SUCCEEDED(gcmz_utf8_to_wchar(invalid_utf8, &w, &err), &err)) {
+      TEST_CHECK(wcslen(w) == len);
+    }
+  }
+  {
+    static wchar_t const lone_surrogate[] = L"abc\xd800def";
+    size_t const len = ov_wchar_to_utf8_len(lone_surrogate, wcslen(lone_surrogate));
+    if (len == 0) {
+      TEST_CHECK(!gcmz_wchar_to_utf8(lone_surrogate, &u, &err));
+      OV_ERROR_DESTROY(&err);
+    } else if (TEST_SUCCEEDED(gcmz_wchar_to_utf8(lone_surrogate, &u, &err), &err)) {
+      TEST_CHECK(strlen(u) == len);
+    }
+  }
+
+  if (w) {
+    OV_ARRAY_DESTROY(&w);
+  }
+  if (u) {
+    OV_ARRAY_DESTROY(&u);
+  }
+}
+
 static void test_error_compatibility(void) {
   lua_State *L_standard = NULL;
   lua_State *L_override = NULL;
@@ -2795,5 +2860,6 @@ TEST_LIST = {
     {"io_lines_variants", test_io_lines_variants},
     {"io_read_formats", test_io_read_formats},
     {"error_compatibility", test_error_compatibility},
+    {"utf_conversion", test_utf_conversion},
     {NULL, NULL},
 };
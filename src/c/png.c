@@ -0,0 +1,935 @@
+#include "png.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+#include <ovarray.h>
+#include <ovthreads.h>
+
+enum {
+  max_threads = 8,
+  min_stripe_bytes = 256 * 1024, ///< Smaller stripes cost more in thread startup than they save
+  window_size = 32768,
+  hash_bits = 15,
+  hash_size = 1 << hash_bits,
+  min_match = 4,
+  max_match = 258,
+  block_symbols = 65536,
+  max_code_bits = 15,
+  max_cl_code_bits = 7,
+  max_supported_code_bits = 32,
+  num_lit_codes = 288,
+  num_dist_codes = 32,
+  num_cl_codes = 19,
+};
+
+static uint32_t const match_flag = 0x80000000;
+
+/**
+ * @brief Part of the image that is filtered and deflated on one thread
+ */
+struct stripe {
+  struct gcmz_png_image const *image;
+  uint8_t *filtered; ///< Filtered rows of the whole image, shared by all stripes
+  size_t row_bytes;  ///< Filter byte and RGB data of one row
+  uint32_t first_row;
+  uint32_t rows;
+  bool last;
+
+  uint8_t *deflated;
+  uint32_t adler;
+  bool failed;
+};
+
+static inline uint8_t abs_int8(uint8_t const v) { return v < 128 ? v : (uint8_t)(256 - v); }
+
+static void to_rgb(uint8_t const *const src, size_t const bytes_per_pixel, uint32_t const width, uint8_t *const dest) {
+  uint8_t const *s = src;
+  uint8_t *d = dest;
+  for (uint32_t x = 0; x < width; ++x) {
+    d[0] = s[2];
+    d[1] = s[1];
+    d[2] = s[0];
+    s += bytes_per_pixel;
+    d += 3;
+  }
+}
+
+static size_t filter_sub(uint8_t const *const cur, size_t const n, uint8_t *const out) {
+  size_t cost = 0;
+  size_t i = 0;
+  for (; i < 3 && i < n; ++i) {
+    out[i] = cur[i];
+    cost += abs_int8(out[i]);
+  }
+#if defined(__SSE2__)
+  {
+    __m128i const zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+      __m128i const a = _mm_loadu_si128((__m128i const *)(void const *)(cur + i - 3));
+      __m128i const x = _mm_loadu_si128((__m128i const *)(void const *)(cur + i));
+      __m128i const v = _mm_sub_epi8(x, a);
+      _mm_storeu_si128((__m128i *)(void *)(out + i), v);
+      __m128i const sad = _mm_sad_epu8(_mm_min_epu8(v, _mm_sub_epi8(zero, v)), zero);
+      cost += (size_t)_mm_cvtsi128_si32(sad) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = (uint8_t)(cur[i] - cur[i - 3]);
+    cost += abs_int8(out[i]);
+  }
+  return cost;
+}
+
+static size_t filter_up(uint8_t const *const cur, uint8_t const *const prev, size_t const n, uint8_t *const out) {
+  size_t cost = 0;
+  size_t i = 0;
+#if defined(__SSE2__)
+  {
+    __m128i const zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+      __m128i const b = _mm_loadu_si128((__m128i const *)(void const *)(prev + i));
+      __m128i const x = _mm_loadu_si128((__m128i const *)(void const *)(cur + i));
+      __m128i const v = _mm_sub_epi8(x, b);
+      _mm_storeu_si128((__m128i *)(void *)(out + i), v);
+      __m128i const sad = _mm_sad_epu8(_mm_min_epu8(v, _mm_sub_epi8(zero, v)), zero);
+      cost += (size_t)_mm_cvtsi128_si32(sad) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = (uint8_t)(cur[i] - prev[i]);
+    cost += abs_int8(out[i]);
+  }
+  return cost;
+}
+
+static inline uint8_t paeth(int const a, int const b, int const c) {
+  int const pa = abs(b - c);
+  int const pb = abs(a - c);
+  int const pc = abs(a + b - 2 * c);
+  if (pa <= pb && pa <= pc) {
+    return (uint8_t)a;
+  }
+  return (uint8_t)(pb <= pc ? b : c);
+}
+
+static size_t filter_paeth(uint8_t const *const cur, uint8_t const *const prev, size_t const n, uint8_t *const out) {
+  size_t cost = 0;
+  size_t i = 0;
+  for (; i < 3 && i < n; ++i) {
+    // Left and upper left are zero, so the predictor is the pixel above
+    out[i] = (uint8_t)(cur[i] - prev[i]);
+    cost += abs_int8(out[i]);
+  }
+#if defined(__SSE2__)
+  {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const low_bytes = _mm_set1_epi16(0xff);
+    for (; i + 8 <= n; i += 8) {
+      __m128i const a = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(void const *)(cur + i - 3)), zero);
+      __m128i const b = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(void const *)(prev + i)), zero);
+      __m128i const c = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(void const *)(prev + i - 3)), zero);
+      __m128i const x = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(void const *)(cur + i)), zero);
+      __m128i const bc = _mm_sub_epi16(b, c);
+      __m128i const ac = _mm_sub_epi16(a, c);
+      __m128i const abc = _mm_add_epi16(bc, ac);
+      __m128i const pa = _mm_max_epi16(bc, _mm_sub_epi16(zero, bc));
+      __m128i const pb = _mm_max_epi16(ac, _mm_sub_epi16(zero, ac));
+      __m128i const pc = _mm_max_epi16(abc, _mm_sub_epi16(zero, abc));
+      __m128i const use_a = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc)),
+                                             _mm_set1_epi16(-1));
+      __m128i const use_b = _mm_andnot_si128(use_a, _mm_andnot_si128(_mm_cmpgt_epi16(pb, pc), _mm_set1_epi16(-1)));
+      __m128i const use_c = _mm_andnot_si128(_mm_or_si128(use_a, use_b), _mm_set1_epi16(-1));
+      __m128i const pred = _mm_or_si128(_mm_or_si128(_mm_and_si128(use_a, a), _mm_and_si128(use_b, b)),
+                                        _mm_and_si128(use_c, c));
+      __m128i const v16 = _mm_and_si128(_mm_sub_epi16(x, pred), low_bytes);
+      __m128i const v = _mm_packus_epi16(v16, zero);
+      _mm_storel_epi64((__m128i *)(void *)(out + i), v);
+      __m128i const sad = _mm_sad_epu8(_mm_min_epu8(v, _mm_sub_epi8(zero, v)), zero);
+      cost += (size_t)_mm_cvtsi128_si32(sad);
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = (uint8_t)(cur[i] - paeth(cur[i - 3], prev[i], prev[i - 3]));
+    cost += abs_int8(out[i]);
+  }
+  return cost;
+}
+
+static int filter_proc(void *userdata) {
+  struct stripe *const s = (struct stripe *)userdata;
+  struct gcmz_png_image const *const image = s->image;
+  size_t const n = s->row_bytes - 1;
+  uint8_t *scratch = NULL;
+  if (!OV_ARRAY_GROW(&scratch, n * 5)) {
+    s->failed = true;
+    return 0;
+  }
+  uint8_t *cur = scratch;
+  uint8_t *prev = scratch + n;
+  uint8_t *const candidates[3] = {scratch + n * 2, scratch + n * 3, scratch + n * 4};
+  static uint8_t const filter_types[3] = {1, 2, 4}; // Sub, Up and Paeth
+  if (s->first_row == 0) {
+    memset(prev, 0, n);
+  } else {
+    to_rgb(image->pixels + (ptrdiff_t)(s->first_row - 1) * image->stride, image->bytes_per_pixel, image->width, prev);
+  }
+  for (uint32_t y = s->first_row; y < s->first_row + s->rows; ++y) {
+    to_rgb(image->pixels + (ptrdiff_t)y * image->stride, image->bytes_per_pixel, image->width, cur);
+    size_t const costs[3] = {
+        filter_sub(cur, n, candidates[0]),
+        filter_up(cur, prev, n, candidates[1]),
+        filter_paeth(cur, prev, n, candidates[2]),
+    };
+    size_t best = 0;
+    for (size_t i = 1; i < 3; ++i) {
+      if (costs[i] < costs[best]) {
+        best = i;
+      }
+    }
+    uint8_t *const row = s->filtered + (size_t)y * s->row_bytes;
+    row[0] = filter_types[best];
+    memcpy(row + 1, candidates[best], n);
+    uint8_t *const tmp = prev;
+    prev = cur;
+    cur = tmp;
+  }
+  OV_ARRAY_DESTROY(&scratch);
+  return 0;
+}
+
+static uint32_t adler32(uint32_t const adler, uint8_t const *p, size_t len) {
+  enum { base = 65521, nmax = 5552 };
+  uint32_t a = adler & 0xffff;
+  uint32_t b = adler >> 16;
+  while (len) {
+    size_t const n = len < nmax ? len : nmax;
+    for (size_t i = 0; i < n; ++i) {
+      a += p[i];
+      b += a;
+    }
+    a %= base;
+    b %= base;
+    p += n;
+    len -= n;
+  }
+  return a | (b << 16);
+}
+
+// Same as adler32_combine in zlib
+static uint32_t adler32_combine(uint32_t const adler1, uint32_t const adler2, size_t const len2) {
+  enum { base = 65521 };
+  uint32_t const rem = (uint32_t)(len2 % base);
+  uint32_t sum1 = adler1 & 0xffff;
+  uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % base);
+  sum1 += (adler2 & 0xffff) + base - 1;
+  sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + base - rem;
+  if (sum1 >= base) {
+    sum1 -= base;
+  }
+  if (sum1 >= base) {
+    sum1 -= base;
+  }
+  if (sum2 >= base * 2) {
+    sum2 -= base * 2;
+  }
+  if (sum2 >= base) {
+    sum2 -= base;
+  }
+  return sum1 | (sum2 << 16);
+}
+
+struct bit_writer {
+  uint8_t *out; ///< Capacity is reserved before each block, so writes are unchecked
+  size_t len;
+  uint64_t bits;
+  uint32_t count;
+};
+
+static inline void put_bits(struct bit_writer *const w, uint32_t const value, uint32_t const n) {
+  w->bits |= (uint64_t)value << w->count;
+  w->count += n;
+  while (w->count >= 8) {
+    w->out[w->len++] = (uint8_t)w->bits;
+    w->bits >>= 8;
+    w->count -= 8;
+  }
+}
+
+static void align_to_byte(struct bit_writer *const w) {
+  if (w->count) {
+    put_bits(w, 0, 8 - w->count);
+  }
+}
+
+struct sym_freq {
+  uint32_t key; ///< Frequency before building, then reused as tree links and code lengths
+  uint16_t sym;
+};
+
+static int compare_sym_freq(void const *const a, void const *const b) {
+  struct sym_freq const *const x = (struct sym_freq const *)a;
+  struct sym_freq const *const y = (struct sym_freq const *)b;
+  if (x->key != y->key) {
+    return x->key < y->key ? -1 : 1;
+  }
+  return x->sym < y->sym ? -1 : x->sym > y->sym;
+}
+
+// In-place minimum redundancy code lengths for frequencies in ascending order (Moffat and Katajainen)
+static void minimum_redundancy(struct sym_freq *const a, int const n) {
+  if (n == 1) {
+    a[0].key = 1;
+    return;
+  }
+  a[0].key += a[1].key;
+  int root = 0;
+  int leaf = 2;
+  for (int next = 1; next < n - 1; ++next) {
+    if (leaf >= n || a[root].key < a[leaf].key) {
+      a[next].key = a[root].key;
+      a[root++].key = (uint32_t)next;
+    } else {
+      a[next].key = a[leaf++].key;
+    }
+    if (leaf >= n || (root < next && a[root].key < a[leaf].key)) {
+      a[next].key += a[root].key;
+      a[root++].key = (uint32_t)next;
+    } else {
+      a[next].key += a[leaf++].key;
+    }
+  }
+  a[n - 2].key = 0;
+  for (int next = n - 3; next >= 0; --next) {
+    a[next].key = a[a[next].key].key + 1;
+  }
+  int avail = 1;
+  int used = 0;
+  uint32_t depth = 0;
+  int root2 = n - 2;
+  int next = n - 1;
+  while (avail > 0) {
+    while (root2 >= 0 && a[root2].key == depth) {
+      ++used;
+      --root2;
+    }
+    while (avail > used) {
+      a[next--].key = depth;
+      --avail;
+    }
+    avail = 2 * used;
+    ++depth;
+    used = 0;
+  }
+}
+
+static void build_code_lengths(uint32_t const *const freq,
+                               size_t const num_syms,
+                               uint32_t const limit,
+                               uint8_t *const lengths) {
+  struct sym_freq syms[num_lit_codes];
+  int n = 0;
+  for (size_t i = 0; i < num_syms; ++i) {
+    lengths[i] = 0;
+    if (freq[i]) {
+      syms[n++] = (struct sym_freq){.key = freq[i], .sym = (uint16_t)i};
+    }
+  }
+  if (n == 0) {
+    return;
+  }
+  qsort(syms, (size_t)n, sizeof(syms[0]), compare_sym_freq);
+  minimum_redundancy(syms, n);
+
+  // Clamp to the limit and fix up the Kraft sum by lengthening the shortest codes that can spare it
+  uint32_t counts[max_supported_code_bits + 1] = {0};
+  for (int i = 0; i < n; ++i) {
+    ++counts[syms[i].key < max_supported_code_bits ? syms[i].key : max_supported_code_bits];
+  }
+  for (uint32_t i = limit + 1; i <= max_supported_code_bits; ++i) {
+    counts[limit] += counts[i];
+    counts[i] = 0;
+  }
+  uint32_t total = 0;
+  for (uint32_t i = limit; i > 0; --i) {
+    total += counts[i] << (limit - i);
+  }
+  while (n > 1 && total != (1u << limit)) {
+    --counts[limit];
+    for (uint32_t i = limit - 1; i > 0; --i) {
+      if (counts[i]) {
+        --counts[i];
+        counts[i + 1] += 2;
+        break;
+      }
+    }
+    --total;
+  }
+
+  // Shortest codes go to the most frequent symbols, which are at the end
+  int j = n;
+  for (uint32_t len = 1; len <= limit; ++len) {
+    for (uint32_t c = counts[len]; c > 0; --c) {
+      lengths[syms[--j].sym] = (uint8_t)len;
+    }
+  }
+}
+
+static void build_codes(uint8_t const *const lengths, size_t const num_syms, uint16_t *const codes) {
+  uint32_t counts[max_code_bits + 1] = {0};
+  uint32_t next[max_code_bits + 2] = {0};
+  for (size_t i = 0; i < num_syms; ++i) {
+    ++counts[lengths[i]];
+  }
+  counts[0] = 0;
+  for (size_t len = 1; len <= max_code_bits; ++len) {
+    next[len + 1] = (next[len] + counts[len]) << 1;
+  }
+  for (size_t i = 0; i < num_syms; ++i) {
+    uint32_t const len = lengths[i];
+    if (!len) {
+      codes[i] = 0;
+      continue;
+    }
+    // Huffman codes are stored starting from the most significant bit
+    uint32_t code = next[len]++;
+    uint32_t reversed = 0;
+    for (uint32_t b = 0; b < len; ++b) {
+      reversed = (reversed << 1) | (code & 1);
+      code >>= 1;
+    }
+    codes[i] = (uint16_t)reversed;
+  }
+}
+
+static inline uint32_t floor_log2(uint32_t const v) { return 31 - (uint32_t)__builtin_clz(v); }
+
+static inline void length_code(uint32_t const len, uint32_t *const code, uint32_t *const extra_bits) {
+  uint32_t const x = len - 3;
+  if (x < 8) {
+    *code = 257 + x;
+    *extra_bits = 0;
+  } else if (x == 255) {
+    *code = 285;
+    *extra_bits = 0;
+  } else {
+    uint32_t const n = floor_log2(x);
+    *code = 257 + 4 * (n - 1) + ((x >> (n - 2)) & 3);
+    *extra_bits = n - 2;
+  }
+}
+
+static inline void dist_code(uint32_t const dist, uint32_t *const code, uint32_t *const extra_bits) {
+  uint32_t const x = dist - 1;
+  if (x < 4) {
+    *code = x;
+    *extra_bits = 0;
+  } else {
+    uint32_t const n = floor_log2(x);
+    *code = 2 * n + ((x >> (n - 1)) & 1);
+    *extra_bits = n - 1;
+  }
+}
+
+struct block {
+  uint32_t *syms; ///< Literals, or match_flag | length << 16 | distance
+  size_t len;
+  uint32_t lit_freq[num_lit_codes];
+  uint32_t dist_freq[num_dist_codes];
+};
+
+static bool write_block(struct block *const b, struct bit_writer *const w, bool const final) {
+  // Worst case is 15 + 5 bits of length and 15 + 13 bits of distance per symbol, plus the header
+  if (!OV_ARRAY_GROW(&w->out, w->len + b->len * 6 + 1024)) {
+    return false;
+  }
+  b->lit_freq[256] = 1;
+  {
+    // Some decoders reject a literal/length code with a single symbol
+    size_t used = 0;
+    for (size_t i = 0; i < 286; ++i) {
+      used += b->lit_freq[i] != 0;
+    }
+    if (used < 2) {
+      b->lit_freq[0] = 1;
+    }
+    used = 0;
+    for (size_t i = 0; i < 30; ++i) {
+      used += b->dist_freq[i] != 0;
+    }
+    if (used == 0) {
+      b->dist_freq[0] = 1;
+    }
+  }
+  uint8_t lit_lengths[286];
+  uint8_t dist_lengths[30];
+  uint16_t lit_codes[286];
+  uint16_t dist_codes[30];
+  build_code_lengths(b->lit_freq, 286, max_code_bits, lit_lengths);
+  build_code_lengths(b->dist_freq, 30, max_code_bits, dist_lengths);
+  build_codes(lit_lengths, 286, lit_codes);
+  build_codes(dist_lengths, 30, dist_codes);
+
+  size_t num_lit = 286;
+  while (num_lit > 257 && !lit_lengths[num_lit - 1]) {
+    --num_lit;
+  }
+  size_t num_dist = 30;
+  while (num_dist > 1 && !dist_lengths[num_dist - 1]) {
+    --num_dist;
+  }
+  uint8_t lengths[286 + 30];
+  memcpy(lengths, lit_lengths, num_lit);
+  memcpy(lengths + num_lit, dist_lengths, num_dist);
+
+  // Run-length encode both code length tables with the code length alphabet
+  uint8_t rle_syms[286 + 30];
+  uint8_t rle_extra[286 + 30];
+  size_t rle_len = 0;
+  uint32_t cl_freq[num_cl_codes] = {0};
+  size_t const total = num_lit + num_dist;
+  for (size_t i = 0; i < total;) {
+    uint8_t const len = lengths[i];
+    size_t run = 1;
+    while (i + run < total && lengths[i + run] == len) {
+      ++run;
+    }
+    i += run;
+    if (len == 0) {
+      while (run >= 11) {
+        size_t const r = run < 138 ? run : 138;
+        rle_syms[rle_len] = 18;
+        rle_extra[rle_len++] = (uint8_t)(r - 11);
+        run -= r;
+      }
+      if (run >= 3) {
+        rle_syms[rle_len] = 17;
+        rle_extra[rle_len++] = (uint8_t)(run - 3);
+        run = 0;
+      }
+    } else {
+      rle_syms[rle_len] = len;
+      rle_extra[rle_len++] = 0;
+      --run;
+      while (run >= 3) {
+        size_t const r = run < 6 ? run : 6;
+        rle_syms[rle_len] = 16;
+        rle_extra[rle_len++] = (uint8_t)(r - 3);
+        run -= r;
+      }
+    }
+    for (; run > 0; --run) {
+      rle_syms[rle_len] = len;
+      rle_extra[rle_len++] = 0;
+    }
+  }
+  for (size_t i = 0; i < rle_len; ++i) {
+    ++cl_freq[rle_syms[i]];
+  }
+  {
+    size_t used = 0;
+    for (size_t i = 0; i < num_cl_codes; ++i) {
+      used += cl_freq[i] != 0;
+    }
+    if (used < 2) {
+      // The code length code must be complete, so give it a second symbol
+      ++cl_freq[cl_freq[0] ? 1 : 0];
+    }
+  }
+  uint8_t cl_lengths[num_cl_codes];
+  uint16_t cl_codes[num_cl_codes];
+  build_code_lengths(cl_freq, num_cl_codes, max_cl_code_bits, cl_lengths);
+  build_codes(cl_lengths, num_cl_codes, cl_codes);
+  static uint8_t const cl_order[num_cl_codes] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  size_t num_cl = num_cl_codes;
+  while (num_cl > 4 && !cl_lengths[cl_order[num_cl - 1]]) {
+    --num_cl;
+  }
+
+  put_bits(w, final ? 1 : 0, 1);
+  put_bits(w, 2, 2);
+  put_bits(w, (uint32_t)(num_lit - 257), 5);
+  put_bits(w, (uint32_t)(num_dist - 1), 5);
+  put_bits(w, (uint32_t)(num_cl - 4), 4);
+  for (size_t i = 0; i < num_cl; ++i) {
+    put_bits(w, cl_lengths[cl_order[i]], 3);
+  }
+  static uint8_t const rle_extra_bits[3] = {2, 3, 7};
+  for (size_t i = 0; i < rle_len; ++i) {
+    uint8_t const sym = rle_syms[i];
+    put_bits(w, cl_codes[sym], cl_lengths[sym]);
+    if (sym >= 16) {
+      put_bits(w, rle_extra[i], rle_extra_bits[sym - 16]);
+    }
+  }
+
+  for (size_t i = 0; i < b->len; ++i) {
+    uint32_t const s = b->syms[i];
+    if (!(s & match_flag)) {
+      put_bits(w, lit_codes[s], lit_lengths[s]);
+      continue;
+    }
+    uint32_t const len = (s >> 16) & 0x1ff;
+    uint32_t const dist = s & 0xffff;
+    uint32_t code = 0;
+    uint32_t extra_bits = 0;
+    length_code(len, &code, &extra_bits);
+    put_bits(w, lit_codes[code], lit_lengths[code]);
+    if (extra_bits) {
+      put_bits(w, (len - 3) & ((1u << extra_bits) - 1), extra_bits);
+    }
+    dist_code(dist, &code, &extra_bits);
+    put_bits(w, dist_codes[code], dist_lengths[code]);
+    if (extra_bits) {
+      put_bits(w, (dist - 1) & ((1u << extra_bits) - 1), extra_bits);
+    }
+  }
+  put_bits(w, lit_codes[256], lit_lengths[256]);
+
+  b->len = 0;
+  memset(b->lit_freq, 0, sizeof(b->lit_freq));
+  memset(b->dist_freq, 0, sizeof(b->dist_freq));
+  return true;
+}
+
+static inline uint32_t load32(uint8_t const *const p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t hash4(uint32_t const v) { return (v * 2654435761u) >> (32 - hash_bits); }
+
+static inline size_t match_length(uint8_t const *const a, uint8_t const *const b, size_t const limit) {
+  size_t len = 0;
+  while (len + 8 <= limit) {
+    uint64_t x;
+    uint64_t y;
+    memcpy(&x, a + len, sizeof(x));
+    memcpy(&y, b + len, sizeof(y));
+    if (x != y) {
+      return len + (size_t)__builtin_ctzll(x ^ y) / 8;
+    }
+    len += 8;
+  }
+  while (len < limit && a[len] == b[len]) {
+    ++len;
+  }
+  return len;
+}
+
+// Greedy LZ77 with one candidate per hash slot, primed with the tail of the previous stripe
+static int deflate_proc(void *userdata) {
+  struct stripe *const s = (struct stripe *)userdata;
+  size_t const begin = (size_t)s->first_row * s->row_bytes;
+  size_t const end = begin + (size_t)s->rows * s->row_bytes;
+  size_t const dict = begin < window_size ? begin : window_size;
+  uint8_t const *const base = s->filtered + begin - dict;
+  size_t const n = end - begin + dict;
+  uint32_t *head = NULL;
+  struct block *b = NULL;
+  struct bit_writer w = {0};
+
+  s->adler = adler32(1, s->filtered + begin, end - begin);
+  if (!OV_ARRAY_GROW(&head, hash_size) || !OV_REALLOC(&b, 1, sizeof(*b))) {
+    goto cleanup;
+  }
+  *b = (struct block){0};
+  if (!OV_ARRAY_GROW(&b->syms, block_symbols) || !OV_ARRAY_GROW(&w.out, (end - begin) / 4 + 1024)) {
+    goto cleanup;
+  }
+  // Positions are stored plus one so that zero means an empty slot
+  memset(head, 0, sizeof(uint32_t) * hash_size);
+  for (size_t i = 0; i + min_match <= dict; ++i) {
+    head[hash4(load32(base + i))] = (uint32_t)(i + 1);
+  }
+
+  size_t i = dict;
+  while (i < n) {
+    if (b->len == block_symbols) {
+      if (!write_block(b, &w, false)) {
+        goto cleanup;
+      }
+    }
+    if (i + min_match <= n) {
+      uint32_t const v = load32(base + i);
+      uint32_t *const slot = &head[hash4(v)];
+      size_t const candidate = *slot;
+      *slot = (uint32_t)(i + 1);
+      if (candidate && i - (candidate - 1) <= window_size && load32(base + candidate - 1) == v) {
+        size_t const limit = n - i < max_match ? n - i : max_match;
+        size_t const dist = i - (candidate - 1);
+        uint8_t const *const p = base + i + min_match;
+        size_t const len = min_match + match_length(p - dist, p, limit - min_match);
+        uint32_t code = 0;
+        uint32_t extra_bits = 0;
+        length_code((uint32_t)len, &code, &extra_bits);
+        ++b->lit_freq[code];
+        dist_code((uint32_t)dist, &code, &extra_bits);
+        ++b->dist_freq[code];
+        b->syms[b->len++] = match_flag | (uint32_t)(len << 16) | (uint32_t)dist;
+        size_t const match_end = i + len;
+        for (++i; i < match_end && i + min_match <= n; ++i) {
+          head[hash4(load32(base + i))] = (uint32_t)(i + 1);
+        }
+        i = match_end;
+        continue;
+      }
+    }
+    ++b->lit_freq[base[i]];
+    b->syms[b->len++] = base[i];
+    ++i;
+  }
+  if (!write_block(b, &w, s->last)) {
+    goto cleanup;
+  }
+  if (s->last) {
+    align_to_byte(&w);
+  } else {
+    // An empty stored block brings the stream to a byte boundary so that the next stripe can follow
+    put_bits(&w, 0, 3);
+    align_to_byte(&w);
+    static uint8_t const empty_stored[4] = {0x00, 0x00, 0xff, 0xff};
+    memcpy(w.out + w.len, empty_stored, sizeof(empty_stored));
+    w.len += sizeof(empty_stored);
+  }
+  OV_ARRAY_SET_LENGTH(w.out, w.len);
+  s->deflated = w.out;
+  w.out = NULL;
+
+cleanup:
+  if (!s->deflated) {
+    s->failed = true;
+  }
+  if (w.out) {
+    OV_ARRAY_DESTROY(&w.out);
+  }
+  if (b) {
+    if (b->syms) {
+      OV_ARRAY_DESTROY(&b->syms);
+    }
+    OV_FREE(&b);
+  }
+  if (head) {
+    OV_ARRAY_DESTROY(&head);
+  }
+  return 0;
+}
+
+static void run_stripes(struct stripe *const stripes, size_t const n, int (*const proc)(void *)) {
+  thrd_t threads[max_threads];
+  bool started[max_threads] = {0};
+  for (size_t i = 1; i < n; ++i) {
+    started[i] = thrd_create(&threads[i], proc, &stripes[i]) == thrd_success;
+  }
+  proc(&stripes[0]);
+  for (size_t i = 1; i < n; ++i) {
+    if (started[i]) {
+      thrd_join(threads[i], NULL);
+    } else {
+      proc(&stripes[i]);
+    }
+  }
+}
+
+static size_t default_thread_count(void) {
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  size_t const n = si.dwNumberOfProcessors;
+  return n < 1 ? 1 : n > max_threads ? max_threads : n;
+}
+
+static void build_crc_table(uint32_t *const table) {
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; ++k) {
+      c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+    }
+    table[i] = c;
+  }
+}
+
+static uint32_t crc32_update(uint32_t const *const table, uint32_t crc, uint8_t const *const p, size_t const len) {
+  for (size_t i = 0; i < len; ++i) {
+    crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+static inline void put_u32be(uint8_t *const p, uint32_t const v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+/**
+ * @brief Append a chunk whose data is the concatenation of up to three parts
+ */
+static void write_chunk(uint8_t *const out,
+                        size_t *const pos,
+                        uint32_t const *const crc_table,
+                        char const type[4],
+                        uint8_t const *const parts[3],
+                        size_t const part_lens[3]) {
+  size_t const start = *pos;
+  size_t len = 0;
+  for (size_t i = 0; i < 3; ++i) {
+    len += part_lens[i];
+  }
+  put_u32be(out + start, (uint32_t)len);
+  memcpy(out + start + 4, type, 4);
+  size_t p = start + 8;
+  for (size_t i = 0; i < 3; ++i) {
+    if (part_lens[i]) {
+      memcpy(out + p, parts[i], part_lens[i]);
+      p += part_lens[i];
+    }
+  }
+  uint32_t const crc = crc32_update(crc_table, 0xffffffff, out + start + 4, len + 4) ^ 0xffffffff;
+  put_u32be(out + p, crc);
+  *pos = p + 4;
+}
+
+bool gcmz_png_encode(struct gcmz_png_image const *const image,
+                     size_t const threads,
+                     uint8_t **const png,
+                     struct ov_error *const err) {
+  if (!image || !image->pixels || !image->width || !image->height ||
+      (image->bytes_per_pixel != 3 && image->bytes_per_pixel != 4) || !png) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+  size_t const row_bytes = 1 + (size_t)image->width * 3;
+  // Hash slots hold 32-bit positions and PNG limits dimensions to 31 bits
+  if (image->width > INT32_MAX || image->height > INT32_MAX || row_bytes * image->height > INT32_MAX) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  struct stripe stripes[max_threads] = {0};
+  size_t num_stripes = threads ? threads : default_thread_count();
+  uint8_t *filtered = NULL;
+  uint8_t *out = NULL;
+  bool result = false;
+
+  {
+    size_t const total = row_bytes * image->height;
+    size_t const by_size = total / min_stripe_bytes;
+    if (num_stripes > max_threads) {
+      num_stripes = max_threads;
+    }
+    if (num_stripes > by_size) {
+      num_stripes = by_size ? by_size : 1;
+    }
+    if (num_stripes > image->height) {
+      num_stripes = image->height;
+    }
+    if (!OV_ARRAY_GROW(&filtered, total)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    uint32_t row = 0;
+    for (size_t i = 0; i < num_stripes; ++i) {
+      uint32_t const next = (uint32_t)((uint64_t)image->height * (i + 1) / num_stripes);
+      stripes[i] = (struct stripe){
+          .image = image,
+          .filtered = filtered,
+          .row_bytes = row_bytes,
+          .first_row = row,
+          .rows = next - row,
+          .last = i + 1 == num_stripes,
+      };
+      row = next;
+    }
+  }
+
+  // Deflating a stripe reads the end of the stripe before it, so every row is filtered first
+  run_stripes(stripes, num_stripes, filter_proc);
+  for (size_t i = 0; i < num_stripes; ++i) {
+    if (stripes[i].failed) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+  }
+  run_stripes(stripes, num_stripes, deflate_proc);
+
+  {
+    size_t size = 8 + 25 + 12;
+    uint32_t adler = 1;
+    for (size_t i = 0; i < num_stripes; ++i) {
+      if (stripes[i].failed) {
+        OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+        goto cleanup;
+      }
+      size += 12 + OV_ARRAY_LENGTH(stripes[i].deflated);
+      size_t const len = (size_t)stripes[i].rows * row_bytes;
+      adler = adler32_combine(adler, stripes[i].adler, len);
+    }
+    size += 2 + 4;
+    if (!OV_ARRAY_GROW(&out, size)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+
+    uint32_t crc_table[256];
+    build_crc_table(crc_table);
+    static uint8_t const signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    memcpy(out, signature, sizeof(signature));
+    size_t pos = sizeof(signature);
+
+    uint8_t ihdr[13] = {0};
+    put_u32be(ihdr, image->width);
+    put_u32be(ihdr + 4, image->height);
+    ihdr[8] = 8; // Bit depth
+    ihdr[9] = 2; // Truecolor
+    write_chunk(out, &pos, crc_table, "IHDR", (uint8_t const *[3]){ihdr}, (size_t[3]){sizeof(ihdr)});
+
+    // One IDAT per stripe, the zlib header goes in the first one and the checksum in the last one
+    static uint8_t const zlib_header[2] = {0x78, 0x01};
+    uint8_t trailer[4];
+    put_u32be(trailer, adler);
+    for (size_t i = 0; i < num_stripes; ++i) {
+      write_chunk(out,
+                  &pos,
+                  crc_table,
+                  "IDAT",
+                  (uint8_t const *[3]){zlib_header, stripes[i].deflated, trailer},
+                  (size_t[3]){
+                      i == 0 ? sizeof(zlib_header) : 0,
+                      OV_ARRAY_LENGTH(stripes[i].deflated),
+                      stripes[i].last ? sizeof(trailer) : 0,
+                  });
+    }
+    write_chunk(out, &pos, crc_table, "IEND", (uint8_t const *[3]){NULL}, (size_t[3]){0});
+    OV_ARRAY_SET_LENGTH(out, pos);
+  }
+
+  *png = out;
+  out = NULL;
+  result = true;
+
+cleanup:
+  if (out) {
+    OV_ARRAY_DESTROY(&out);
+  }
+  for (size_t i = 0; i < num_stripes; ++i) {
+    if (stripes[i].deflated) {
+      OV_ARRAY_DESTROY(&stripes[i].deflated);
+    }
+  }
+  if (filtered) {
+    OV_ARRAY_DESTROY(&filtered);
+  }
+  return result;
+}
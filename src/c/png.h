@@ -0,0 +1,33 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief 8-bit BGR image as found in DIB data
+ */
+struct gcmz_png_image {
+  uint8_t const *pixels;  ///< First byte of the top row
+  uint32_t width;         ///< Width in pixels
+  uint32_t height;        ///< Height in pixels
+  ptrdiff_t stride;       ///< Bytes from one row to the row below, negative for bottom-up DIBs
+  size_t bytes_per_pixel; ///< 3 for BGR or 4 for BGRX, the fourth byte is ignored
+};
+
+/**
+ * @brief Encode an image as an 8-bit RGB PNG
+ *
+ * The encoder favors speed over size. Each row gets the cheapest of the Sub, Up and Paeth filters,
+ * and the rows are split into stripes that are filtered and deflated on separate threads.
+ * The stripes are written as consecutive IDAT chunks of a single zlib stream,
+ * and each stripe may refer back into the stripe before it so that little compression is lost.
+ *
+ * @param image Image to encode
+ * @param threads Maximum number of threads, 0 to choose from the number of processors
+ * @param png [out] Encoded PNG file (caller must OV_ARRAY_DESTROY)
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_png_encode(struct gcmz_png_image const *const image,
+                               size_t const threads,
+                               uint8_t **const png,
+                               struct ov_error *const err);
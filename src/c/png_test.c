@@ -0,0 +1,199 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#ifndef COBJMACROS
+#  define COBJMACROS
+#endif
+#ifndef CONST_VTABLE
+#  define CONST_VTABLE
+#endif
+
+#include <ole2.h>
+#include <wincodec.h>
+
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include <string.h>
+
+#include "png.h"
+
+/**
+ * @brief Decode a PNG with WIC into top-down 24-bit BGR rows without padding
+ */
+static bool decode_png(uint8_t const *const png, uint32_t const width, uint32_t const height, uint8_t *const bgr) {
+  IWICImagingFactory *factory = NULL;
+  IWICStream *stream = NULL;
+  IWICBitmapDecoder *decoder = NULL;
+  IWICBitmapFrameDecode *frame = NULL;
+  IWICFormatConverter *converter = NULL;
+  bool result = false;
+  UINT w = 0;
+  UINT h = 0;
+  if (FAILED(CoCreateInstance(
+          &CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, &IID_IWICImagingFactory, (void **)&factory)) ||
+      FAILED(IWICImagingFactory_CreateStream(factory, &stream)) ||
+      FAILED(IWICStream_InitializeFromMemory(stream, (BYTE *)(uintptr_t)png, (DWORD)OV_ARRAY_LENGTH(png))) ||
+      FAILED(IWICImagingFactory_CreateDecoderFromStream(
+          factory, (IStream *)stream, NULL, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+      FAILED(IWICBitmapDecoder_GetFrame(decoder, 0, &frame)) || FAILED(IWICBitmapFrameDecode_GetSize(frame, &w, &h)) ||
+      w != width || h != height || FAILED(IWICImagingFactory_CreateFormatConverter(factory, &converter)) ||
+      FAILED(IWICFormatConverter_Initialize(converter,
+                                            (IWICBitmapSource *)frame,
+                                            &GUID_WICPixelFormat24bppBGR,
+                                            WICBitmapDitherTypeNone,
+                                            NULL,
+                                            0.0,
+                                            WICBitmapPaletteTypeCustom)) ||
+      FAILED(IWICFormatConverter_CopyPixels(converter, NULL, width * 3, width * height * 3, bgr))) {
+    goto cleanup;
+  }
+  result = true;
+
+cleanup:
+  if (converter) {
+    IWICFormatConverter_Release(converter);
+  }
+  if (frame) {
+    IWICBitmapFrameDecode_Release(frame);
+  }
+  if (decoder) {
+    IWICBitmapDecoder_Release(decoder);
+  }
+  if (stream) {
+    IWICStream_Release(stream);
+  }
+  if (factory) {
+    IWICImagingFactory_Release(factory);
+  }
+  return result;
+}
+
+/**
+ * @brief Encode a bottom-up DIB and check that it decodes to the same pixels
+ */
+static void check_round_trip(uint32_t const width,
+                             uint32_t const height,
+                             size_t const bytes_per_pixel,
+                             size_t const threads,
+                             bool const noisy) {
+  size_t const stride = (width * bytes_per_pixel + 3) & ~(size_t)3;
+  uint8_t *dib = NULL;
+  uint8_t *decoded = NULL;
+  uint8_t *png = NULL;
+  struct ov_error err = {0};
+  if (!TEST_CHECK(OV_ARRAY_GROW(&dib, stride * height)) ||
+      !TEST_CHECK(OV_ARRAY_GROW(&decoded, (size_t)width * height * 3))) {
+    goto cleanup;
+  }
+  {
+    uint32_t seed = 1;
+    for (uint32_t y = 0; y < height; ++y) {
+      for (size_t x = 0; x < stride; ++x) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t const gradient = (uint8_t)(x / 7 + y / 5);
+        dib[(size_t)y * stride + x] = noisy ? (uint8_t)(gradient + ((seed >> 16) & 7)) : gradient;
+      }
+    }
+  }
+  if (!TEST_SUCCEEDED(gcmz_png_encode(&(struct gcmz_png_image){
+                                          .pixels = dib + (size_t)(height - 1) * stride,
+                                          .width = width,
+                                          .height = height,
+                                          .stride = -(ptrdiff_t)stride,
+                                          .bytes_per_pixel = bytes_per_pixel,
+                                      },
+                                      threads,
+                                      &png,
+                                      &err),
+                      &err)) {
+    goto cleanup;
+  }
+  // Chunk headers alone outweigh the pixels of tiny images, so only larger ones are expected to shrink
+  if (stride * height >= 65536) {
+    TEST_CHECK(OV_ARRAY_LENGTH(png) < stride * height);
+    TEST_MSG("%zu bytes for %zu bytes of pixels", OV_ARRAY_LENGTH(png), stride * height);
+  }
+  if (!TEST_CHECK(decode_png(png, width, height, decoded))) {
+    goto cleanup;
+  }
+  {
+    size_t mismatch = SIZE_MAX;
+    for (uint32_t y = 0; y < height && mismatch == SIZE_MAX; ++y) {
+      uint8_t const *const src = dib + (size_t)(height - 1 - y) * stride;
+      uint8_t const *const dest = decoded + (size_t)y * width * 3;
+      for (uint32_t x = 0; x < width; ++x) {
+        if (memcmp(src + x * bytes_per_pixel, dest + x * 3, 3) != 0) {
+          mismatch = (size_t)y * width + x;
+          break;
+        }
+      }
+    }
+    TEST_CHECK(mismatch == SIZE_MAX);
+    TEST_MSG("first mismatch at pixel %zu", mismatch);
+  }
+
+cleanup:
+  if (png) {
+    OV_ARRAY_DESTROY(&png);
+  }
+  if (decoded) {
+    OV_ARRAY_DESTROY(&decoded);
+  }
+  if (dib) {
+    OV_ARRAY_DESTROY(&dib);
+  }
+}
+
+static void test_encode(void) {
+  HRESULT const hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+  if (!TEST_CHECK(SUCCEEDED(hr))) {
+    return;
+  }
+
+  TEST_CASE("24-bit single stripe");
+  {
+    check_round_trip(37, 11, 3, 1, true);
+  }
+
+  TEST_CASE("32-bit single pixel");
+  {
+    check_round_trip(1, 1, 4, 1, false);
+  }
+
+  TEST_CASE("32-bit multiple stripes");
+  {
+    check_round_trip(640, 480, 4, 4, true);
+  }
+
+  TEST_CASE("24-bit multiple stripes with padded rows");
+  {
+    check_round_trip(1023, 700, 3, 8, false);
+  }
+
+  TEST_CASE("invalid arguments");
+  {
+    struct ov_error err = {0};
+    uint8_t pixels[4] = {0};
+    uint8_t *png = NULL;
+    TEST_FAILED_WITH(gcmz_png_encode(NULL, 0, &png, &err),
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+    TEST_FAILED_WITH(gcmz_png_encode(&(struct gcmz_png_image){.pixels = pixels, .width = 1, .height = 1, .stride = 4},
+                                     0,
+                                     &png,
+                                     &err),
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+  }
+
+  CoUninitialize();
+}
+
+TEST_LIST = {
+    {"encode", test_encode},
+    {NULL, NULL},
+};
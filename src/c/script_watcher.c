@@ -0,0 +1,259 @@
+#include "script_watcher.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <string.h>
+
+#include <ovarray.h>
+#include <ovthreads.h>
+#include <ovutf.h>
+
+enum {
+  notify_buffer_dwords = 16 * 1024,
+  module_name_max = MAX_PATH,
+};
+
+// Modules loaded by the host itself are never reloaded as handlers
+static wchar_t const *const ignored_modules[] = {
+    L"entrypoint",
+    L"exo",
+    L"ini",
+    L"json",
+};
+
+struct gcmz_script_watcher {
+  HANDLE dir;
+  HANDLE stop_event;
+  OVERLAPPED overlapped;
+  bool reading;
+  bool thread_started;
+  thrd_t thread;
+  DWORD debounce_ms;
+  gcmz_script_watcher_callback callback;
+  void *userdata;
+  char **pending; ///< Module names collected since the last report, only touched by the watcher thread
+  DWORD buffer[notify_buffer_dwords];
+};
+
+static void clear_pending(struct gcmz_script_watcher *const w) {
+  size_t const n = OV_ARRAY_LENGTH(w->pending);
+  for (size_t i = 0; i < n; ++i) {
+    OV_ARRAY_DESTROY(&w->pending[i]);
+  }
+  if (w->pending) {
+    OV_ARRAY_SET_LENGTH(w->pending, 0);
+  }
+}
+
+static void add_pending(struct gcmz_script_watcher *const w, wchar_t const *const name, size_t const name_len) {
+  if (name_len == 0 || name_len >= module_name_max) {
+    return;
+  }
+  wchar_t buf[module_name_max];
+  memcpy(buf, name, name_len * sizeof(wchar_t));
+  buf[name_len] = L'\0';
+  for (size_t i = 0; i < sizeof(ignored_modules) / sizeof(ignored_modules[0]); ++i) {
+    if (_wcsicmp(buf, ignored_modules[i]) == 0) {
+      return;
+    }
+  }
+
+  size_t const utf8_len = ov_wchar_to_utf8_len(buf, name_len);
+  if (utf8_len == 0) {
+    return;
+  }
+  char *s = NULL;
+  if (!OV_ARRAY_GROW(&s, utf8_len + 1)) {
+    return;
+  }
+  ov_wchar_to_utf8(buf, name_len, s, utf8_len + 1, NULL);
+
+  size_t const n = OV_ARRAY_LENGTH(w->pending);
+  for (size_t i = 0; i < n; ++i) {
+    if (strcmp(w->pending[i], s) == 0) {
+      OV_ARRAY_DESTROY(&s);
+      return;
+    }
+  }
+  if (!OV_ARRAY_GROW(&w->pending, n + 1)) {
+    OV_ARRAY_DESTROY(&s);
+    return;
+  }
+  w->pending[n] = s;
+  OV_ARRAY_SET_LENGTH(w->pending, n + 1);
+}
+
+/**
+ * @brief Map a path relative to the script directory to the module that has to be reloaded
+ *
+ * "foo.lua" belongs to module "foo", and any *.lua below "foo\" belongs to module "foo" as well,
+ * since only the top-level module is registered as a handler.
+ */
+static void add_changed_path(struct gcmz_script_watcher *const w, wchar_t const *const path, size_t const path_len) {
+  static wchar_t const ext[] = L".lua";
+  size_t const ext_len = sizeof(ext) / sizeof(ext[0]) - 1;
+  if (path_len <= ext_len || _wcsnicmp(path + path_len - ext_len, ext, ext_len) != 0) {
+    return;
+  }
+  size_t sep = 0;
+  while (sep < path_len && path[sep] != L'\\') {
+    ++sep;
+  }
+  add_pending(w, path, sep < path_len ? sep : path_len - ext_len);
+}
+
+static void collect_changes(struct gcmz_script_watcher *const w, DWORD const bytes) {
+  uint8_t const *p = (uint8_t const *)w->buffer;
+  uint8_t const *const end = p + bytes;
+  while (p + sizeof(FILE_NOTIFY_INFORMATION) <= end) {
+    FILE_NOTIFY_INFORMATION const *const fni = (FILE_NOTIFY_INFORMATION const *)(void const *)p;
+    add_changed_path(w, fni->FileName, fni->FileNameLength / sizeof(wchar_t));
+    if (fni->NextEntryOffset == 0) {
+      break;
+    }
+    p += fni->NextEntryOffset;
+  }
+}
+
+static bool start_read(struct gcmz_script_watcher *const w) {
+  ResetEvent(w->overlapped.hEvent);
+  w->reading = ReadDirectoryChangesW(w->dir,
+                                     w->buffer,
+                                     sizeof(w->buffer),
+                                     TRUE,
+                                     FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                                         FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                     NULL,
+                                     &w->overlapped,
+                                     NULL);
+  return w->reading;
+}
+
+static int watcher_thread_proc(void *arg) {
+  struct gcmz_script_watcher *const w = (struct gcmz_script_watcher *)arg;
+  HANDLE const handles[2] = {w->stop_event, w->overlapped.hEvent};
+  while (w->reading) {
+    // Every new notification restarts the quiet period, so an editor saving several files
+    // or a sync tool touching a whole directory results in a single report.
+    DWORD const timeout = OV_ARRAY_LENGTH(w->pending) ? w->debounce_ms : INFINITE;
+    DWORD const r = WaitForMultipleObjects(2, handles, FALSE, timeout);
+    if (r == WAIT_TIMEOUT) {
+      w->callback((char const *const *)w->pending, OV_ARRAY_LENGTH(w->pending), w->userdata);
+      clear_pending(w);
+      continue;
+    }
+    if (r != WAIT_OBJECT_0 + 1) {
+      break;
+    }
+    DWORD bytes = 0;
+    w->reading = false;
+    if (!GetOverlappedResult(w->dir, &w->overlapped, &bytes, FALSE)) {
+      break;
+    }
+    // bytes is 0 when the buffer overflowed, changed files are unknown in that case
+    if (bytes) {
+      collect_changes(w, bytes);
+    }
+    start_read(w);
+  }
+  return 0;
+}
+
+void gcmz_script_watcher_destroy(struct gcmz_script_watcher **const w) {
+  if (!w || !*w) {
+    return;
+  }
+  struct gcmz_script_watcher *const sw = *w;
+  if (sw->thread_started) {
+    SetEvent(sw->stop_event);
+    thrd_join(sw->thread, NULL);
+  }
+  if (sw->reading) {
+    DWORD bytes = 0;
+    CancelIoEx(sw->dir, &sw->overlapped);
+    GetOverlappedResult(sw->dir, &sw->overlapped, &bytes, TRUE);
+  }
+  if (sw->dir != INVALID_HANDLE_VALUE) {
+    CloseHandle(sw->dir);
+  }
+  if (sw->overlapped.hEvent) {
+    CloseHandle(sw->overlapped.hEvent);
+  }
+  if (sw->stop_event) {
+    CloseHandle(sw->stop_event);
+  }
+  if (sw->pending) {
+    clear_pending(sw);
+    OV_ARRAY_DESTROY(&sw->pending);
+  }
+  OV_FREE(w);
+}
+
+bool gcmz_script_watcher_create(struct gcmz_script_watcher **const w,
+                                wchar_t const *const dir,
+                                uint32_t const debounce_ms,
+                                gcmz_script_watcher_callback const callback,
+                                void *const userdata,
+                                struct ov_error *const err) {
+  if (!w || *w || !dir || !callback) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  struct gcmz_script_watcher *sw = NULL;
+  bool result = false;
+
+  if (!OV_REALLOC(&sw, 1, sizeof(struct gcmz_script_watcher))) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  *sw = (struct gcmz_script_watcher){
+      .dir = INVALID_HANDLE_VALUE,
+      .debounce_ms = debounce_ms,
+      .callback = callback,
+      .userdata = userdata,
+  };
+
+  sw->stop_event = CreateEventW(NULL, TRUE, FALSE, NULL);
+  if (!sw->stop_event) {
+    OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  sw->overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+  if (!sw->overlapped.hEvent) {
+    OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  sw->dir = CreateFileW(dir,
+                        FILE_LIST_DIRECTORY,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL,
+                        OPEN_EXISTING,
+                        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                        NULL);
+  if (sw->dir == INVALID_HANDLE_VALUE) {
+    OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  // The first read is issued here so that changes made right after creation are not missed
+  if (!start_read(sw)) {
+    OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  if (thrd_create(&sw->thread, watcher_thread_proc, sw) != thrd_success) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+    goto cleanup;
+  }
+  sw->thread_started = true;
+
+  *w = sw;
+  sw = NULL;
+  result = true;
+
+cleanup:
+  if (sw) {
+    gcmz_script_watcher_destroy(&sw);
+  }
+  return result;
+}
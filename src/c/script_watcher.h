@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct gcmz_script_watcher;
+
+/**
+ * @brief Callback invoked when script files have changed
+ *
+ * Called on the watcher thread once no further change has been seen for the debounce period.
+ * Each name appears only once even if several files of the same module changed.
+ *
+ * @param module_names Top-level module names in UTF-8 ("foo" for foo.lua and for foo\init.lua)
+ * @param count Number of module names
+ * @param userdata User data passed to gcmz_script_watcher_create
+ */
+typedef void (*gcmz_script_watcher_callback)(char const *const *const module_names,
+                                             size_t const count,
+                                             void *const userdata);
+
+/**
+ * @brief Start watching a script directory for changes
+ *
+ * Monitors the directory recursively on a background thread and reports which handler modules
+ * have to be reloaded. Only *.lua files are considered, and files that are loaded by the host
+ * itself (entrypoint.lua, exo.lua, ini.lua, json.lua) are ignored.
+ *
+ * @param w [out] Pointer to store the created watcher
+ * @param dir Directory to watch
+ * @param debounce_ms Quiet period in milliseconds before changes are reported
+ * @param callback Callback invoked with changed module names
+ * @param userdata User data passed to the callback
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_script_watcher_create(struct gcmz_script_watcher **const w,
+                                          wchar_t const *const dir,
+                                          uint32_t const debounce_ms,
+                                          gcmz_script_watcher_callback const callback,
+                                          void *const userdata,
+                                          struct ov_error *const err);
+
+/**
+ * @brief Stop watching and destroy the watcher
+ *
+ * Blocks until the watcher thread has stopped. Pending changes that have not been reported yet are discarded.
+ * Must not be called from the callback.
+ *
+ * @param w Pointer to the watcher, set to NULL on return
+ */
+void gcmz_script_watcher_destroy(struct gcmz_script_watcher **const w);
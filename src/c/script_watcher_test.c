@@ -0,0 +1,134 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <ovtest.h>
+
+#include <string.h>
+
+#include <ovthreads.h>
+
+#include "script_watcher.h"
+
+struct received {
+  mtx_t mtx;
+  HANDLE event;
+  size_t calls;
+  bool foo;
+  bool bar;
+  bool unexpected;
+};
+
+static void on_change(char const *const *const module_names, size_t const count, void *const userdata) {
+  struct received *const r = (struct received *)userdata;
+  mtx_lock(&r->mtx);
+  ++r->calls;
+  for (size_t i = 0; i < count; ++i) {
+    if (strcmp(module_names[i], "foo") == 0) {
+      r->foo = true;
+    } else if (strcmp(module_names[i], "bar") == 0) {
+      r->bar = true;
+    } else {
+      r->unexpected = true;
+    }
+  }
+  if (r->foo && r->bar) {
+    SetEvent(r->event);
+  }
+  mtx_unlock(&r->mtx);
+}
+
+static bool write_file(wchar_t const *const path) {
+  HANDLE h = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  DWORD written = 0;
+  WriteFile(h, "return {}", 9, &written, NULL);
+  CloseHandle(h);
+  return true;
+}
+
+static void build_path(wchar_t *const dest, wchar_t const *const dir, wchar_t const *const name) {
+  wcscpy(dest, dir);
+  wcscat(dest, L"\\");
+  wcscat(dest, name);
+}
+
+static void test_module_changes(void) {
+  static wchar_t const *const files[] = {
+      L"foo.lua",
+      L"bar\\init.lua",
+      L"bar\\util.lua",
+      L"entrypoint.lua",
+      L"readme.txt",
+  };
+  wchar_t dir[MAX_PATH];
+  wchar_t path[MAX_PATH];
+  struct gcmz_script_watcher *w = NULL;
+  struct received r = {0};
+  struct ov_error err = {0};
+
+  GetTempPathW(MAX_PATH, dir);
+  wcscat(dir, L"gcmz_script_watcher_test");
+  CreateDirectoryW(dir, NULL);
+  build_path(path, dir, L"bar");
+  CreateDirectoryW(path, NULL);
+
+  if (!TEST_CHECK(mtx_init(&r.mtx, mtx_plain) == thrd_success)) {
+    goto cleanup;
+  }
+  r.event = CreateEventW(NULL, TRUE, FALSE, NULL);
+  if (!TEST_CHECK(r.event != NULL)) {
+    goto cleanup;
+  }
+  if (!TEST_SUCCEEDED(gcmz_script_watcher_create(&w, dir, 100, on_change, &r, &err), &err)) {
+    goto cleanup;
+  }
+
+  for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+    build_path(path, dir, files[i]);
+    TEST_CHECK(write_file(path));
+  }
+  TEST_CHECK(WaitForSingleObject(r.event, 5000) == WAIT_OBJECT_0);
+  gcmz_script_watcher_destroy(&w);
+
+  TEST_CHECK(r.foo);
+  TEST_CHECK(r.bar);
+  TEST_CHECK(!r.unexpected);
+  // All writes happen well within the quiet period, so they are reported at once
+  TEST_CHECK(r.calls == 1);
+  TEST_MSG("want 1 call, got %zu", r.calls);
+
+cleanup:
+  gcmz_script_watcher_destroy(&w);
+  if (r.event) {
+    CloseHandle(r.event);
+    mtx_destroy(&r.mtx);
+  }
+  for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+    build_path(path, dir, files[i]);
+    DeleteFileW(path);
+  }
+  build_path(path, dir, L"bar");
+  RemoveDirectoryW(path);
+  RemoveDirectoryW(dir);
+}
+
+static void test_invalid_directory(void) {
+  wchar_t dir[MAX_PATH];
+  struct gcmz_script_watcher *w = NULL;
+  struct ov_error err = {0};
+  GetTempPathW(MAX_PATH, dir);
+  wcscat(dir, L"gcmz_no_such_directory");
+  TEST_FAILED_WITH(gcmz_script_watcher_create(&w, dir, 100, on_change, NULL, &err),
+                   &err,
+                   ov_error_type_hresult,
+                   HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+  TEST_CHECK(w == NULL);
+}
+
+TEST_LIST = {
+    {"module_changes", test_module_changes},
+    {"invalid_directory", test_invalid_directory},
+    {NULL, NULL},
+};
@@ -0,0 +1,355 @@
+#include "sequence.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <ovarray.h>
+#include <ovl/file.h>
+#include <ovprintf.h>
+#include <ovutf.h>
+
+#include "file.h"
+#include "temp.h"
+
+enum {
+  max_digits = 9, ///< Keeps frame numbers within uint32_t
+};
+
+struct frame {
+  wchar_t const *path;
+  size_t index;      ///< Position in the file list
+  size_t stem_len;   ///< Length of the path up to the frame number
+  size_t digits_len; ///< Length of the frame number
+  uint32_t number;
+};
+
+struct run {
+  wchar_t const *first; ///< Path of the first frame
+  size_t frames;
+  wchar_t *object_path;
+  bool placed;
+};
+
+static bool is_image_extension(wchar_t const *const ext) {
+  static wchar_t const *const exts[] = {
+      L".png", L".jpg", L".jpeg", L".bmp", L".tga", L".tif", L".tiff", L".webp"};
+  for (size_t i = 0; i < sizeof(exts) / sizeof(exts[0]); ++i) {
+    if (_wcsicmp(ext, exts[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool parse_frame(wchar_t const *const path, size_t const index, struct frame *const f) {
+  wchar_t const *name = path;
+  for (wchar_t const *p = path; *p; ++p) {
+    if (*p == L'\\' || *p == L'/') {
+      name = p + 1;
+    }
+  }
+  wchar_t const *const ext = wcsrchr(name, L'.');
+  if (!ext || !is_image_extension(ext)) {
+    return false;
+  }
+  wchar_t const *digits = ext;
+  while (digits > name && digits[-1] >= L'0' && digits[-1] <= L'9') {
+    --digits;
+  }
+  size_t const digits_len = (size_t)(ext - digits);
+  if (digits_len == 0 || digits_len > max_digits) {
+    return false;
+  }
+  uint32_t number = 0;
+  for (wchar_t const *p = digits; p < ext; ++p) {
+    number = number * 10 + (uint32_t)(*p - L'0');
+  }
+  *f = (struct frame){
+      .path = path,
+      .index = index,
+      .stem_len = (size_t)(digits - path),
+      .digits_len = digits_len,
+      .number = number,
+  };
+  return true;
+}
+
+// Frames of the same sequence differ only in the digits of the frame number
+static int compare_pattern(struct frame const *const a, struct frame const *const b) {
+  if (a->stem_len != b->stem_len) {
+    return a->stem_len < b->stem_len ? -1 : 1;
+  }
+  if (a->digits_len != b->digits_len) {
+    return a->digits_len < b->digits_len ? -1 : 1;
+  }
+  int const r = _wcsnicmp(a->path, b->path, a->stem_len);
+  if (r != 0) {
+    return r;
+  }
+  return _wcsicmp(a->path + a->stem_len + a->digits_len, b->path + b->stem_len + b->digits_len);
+}
+
+static int compare_frames(void const *const a, void const *const b) {
+  struct frame const *const fa = (struct frame const *)a;
+  struct frame const *const fb = (struct frame const *)b;
+  int const r = compare_pattern(fa, fb);
+  if (r != 0) {
+    return r;
+  }
+  if (fa->number != fb->number) {
+    return fa->number < fb->number ? -1 : 1;
+  }
+  return fa->index < fb->index ? -1 : fa->index > fb->index ? 1 : 0;
+}
+
+static bool write_object(struct run const *const r, wchar_t **const object_path, struct ov_error *const err) {
+  char *path_utf8 = NULL;
+  char *content = NULL;
+  wchar_t *path = NULL;
+  struct ovl_file *file = NULL;
+  bool result = false;
+
+  {
+    size_t const len = wcslen(r->first);
+    size_t const utf8_len = ov_wchar_to_utf8_len(r->first, len);
+    if (!utf8_len) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
+    if (!OV_ARRAY_GROW(&path_utf8, utf8_len + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    ov_wchar_to_utf8(r->first, len, path_utf8, utf8_len + 1, NULL);
+
+    // clang-format off
+    static char const format[] =
+        "[0]\r\n"
+        "layer=0\r\n"
+        "frame=0,%zu\r\n"
+        "[0.0]\r\n"
+        "effect.name=画像ファイル\r\n"
+        "ファイル=%s\r\n"
+        "表示番号=0\r\n"
+        "連番ファイル=1\r\n"
+        "[0.1]\r\n"
+        "effect.name=標準描画\r\n"
+        "X=0.00\r\n"
+        "Y=0.00\r\n"
+        "Z=0.00\r\n"
+        "Group=1\r\n"
+        "中心X=0.00\r\n"
+        "中心Y=0.00\r\n"
+        "中心Z=0.00\r\n"
+        "X軸回転=0.00\r\n"
+        "Y軸回転=0.00\r\n"
+        "Z軸回転=0.00\r\n"
+        "拡大率=100.000\r\n"
+        "縦横比=0.000\r\n"
+        "透明度=0.00\r\n"
+        "合成モード=通常\r\n";
+    // clang-format on
+    int const content_len = ov_snprintf_char(NULL, 0, NULL, format, r->frames - 1, path_utf8);
+    if (content_len <= 0) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
+    if (!OV_ARRAY_GROW(&content, (size_t)content_len + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    ov_snprintf_char(content, (size_t)content_len + 1, NULL, format, r->frames - 1, path_utf8);
+
+    if (!gcmz_temp_create_unique_file(L"sequence.object", &path, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    if (!ovl_file_create(path, &file, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    size_t written = 0;
+    if (!ovl_file_write(file, content, (size_t)content_len, &written, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    if (written != (size_t)content_len) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
+    *object_path = path;
+    path = NULL;
+  }
+  result = true;
+
+cleanup:
+  if (file) {
+    ovl_file_close(file);
+  }
+  if (path) {
+    DeleteFileW(path);
+    OV_ARRAY_DESTROY(&path);
+  }
+  if (content) {
+    OV_ARRAY_DESTROY(&content);
+  }
+  if (path_utf8) {
+    OV_ARRAY_DESTROY(&path_utf8);
+  }
+  return result;
+}
+
+static bool find_runs(struct gcmz_file_list const *const file_list,
+                      size_t const min_frames,
+                      size_t *const run_of,
+                      struct run **const runs,
+                      struct ov_error *const err) {
+  size_t const count = gcmz_file_list_count(file_list);
+  struct frame *frames = NULL;
+  size_t n = 0;
+  bool result = false;
+
+  if (!OV_ARRAY_GROW(&frames, count)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    goto cleanup;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(file_list, i);
+    if (file && file->path && !file->temporary && parse_frame(file->path, i, &frames[n])) {
+      ++n;
+    }
+  }
+  if (n < min_frames) {
+    result = true;
+    goto cleanup;
+  }
+  qsort(frames, n, sizeof(struct frame), compare_frames);
+  for (size_t begin = 0, end = 0; begin < n; begin = end) {
+    end = begin + 1;
+    while (end < n && compare_pattern(&frames[end - 1], &frames[end]) == 0 &&
+           frames[end].number == frames[end - 1].number + 1) {
+      ++end;
+    }
+    if (end - begin < min_frames) {
+      continue;
+    }
+    size_t const id = OV_ARRAY_LENGTH(*runs);
+    if (!OV_ARRAY_GROW(runs, id + 1)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    (*runs)[id] = (struct run){
+        .first = frames[begin].path,
+        .frames = end - begin,
+    };
+    OV_ARRAY_SET_LENGTH(*runs, id + 1);
+    for (size_t i = begin; i < end; ++i) {
+      run_of[frames[i].index] = id;
+    }
+  }
+  result = true;
+
+cleanup:
+  if (frames) {
+    OV_ARRAY_DESTROY(&frames);
+  }
+  return result;
+}
+
+bool gcmz_sequence_collapse(struct gcmz_file_list *const file_list,
+                            size_t const min_frames,
+                            size_t *const collapsed,
+                            struct ov_error *const err) {
+  if (!file_list || min_frames < 2) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  size_t const count = gcmz_file_list_count(file_list);
+  size_t *run_of = NULL;
+  struct run *runs = NULL;
+  struct gcmz_file_list *rebuilt = NULL;
+  size_t num_runs = 0;
+  bool result = false;
+
+  if (count >= min_frames) {
+    if (!OV_ARRAY_GROW(&run_of, count)) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+      goto cleanup;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      run_of[i] = SIZE_MAX;
+    }
+    if (!find_runs(file_list, min_frames, run_of, &runs, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    num_runs = OV_ARRAY_LENGTH(runs);
+  }
+  if (num_runs == 0) {
+    result = true;
+    goto cleanup;
+  }
+
+  for (size_t r = 0; r < num_runs; ++r) {
+    if (!write_object(&runs[r], &runs[r].object_path, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+  }
+
+  rebuilt = gcmz_file_list_create(err);
+  if (!rebuilt) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    struct gcmz_file const *const file = gcmz_file_list_get(file_list, i);
+    if (!file) {
+      continue;
+    }
+    bool ok = true;
+    if (run_of[i] == SIZE_MAX) {
+      ok = file->temporary ? gcmz_file_list_add_temporary(rebuilt, file->path, file->mime_type, err)
+                           : gcmz_file_list_add(rebuilt, file->path, file->mime_type, err);
+    } else if (!runs[run_of[i]].placed) {
+      // The sequence object takes the place of its first frame in the list
+      ok = gcmz_file_list_add_temporary(rebuilt, runs[run_of[i]].object_path, L"application/x-aviutl-object", err);
+      runs[run_of[i]].placed = true;
+    }
+    if (!ok) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+  }
+  gcmz_file_list_swap(file_list, rebuilt);
+  result = true;
+
+cleanup:
+  if (runs) {
+    for (size_t r = 0; r < num_runs; ++r) {
+      if (runs[r].object_path) {
+        // Once swapped in, the list owns the files and cleans them up as temporary files
+        if (!result) {
+          DeleteFileW(runs[r].object_path);
+        }
+        OV_ARRAY_DESTROY(&runs[r].object_path);
+      }
+    }
+    OV_ARRAY_DESTROY(&runs);
+  }
+  if (run_of) {
+    OV_ARRAY_DESTROY(&run_of);
+  }
+  if (rebuilt) {
+    gcmz_file_list_destroy(&rebuilt);
+  }
+  if (result && collapsed) {
+    *collapsed = num_runs;
+  }
+  return result;
+}
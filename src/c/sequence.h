@@ -0,0 +1,25 @@
+#pragma once
+
+#include <ovbase.h>
+
+struct gcmz_file_list;
+
+/**
+ * @brief Collapse numbered image sequences into sequence objects
+ *
+ * Image files that share the folder, the file name up to a trailing frame number, the digit count and the
+ * extension, and whose frame numbers are contiguous, are detected as a sequence.
+ * Each sequence of at least min_frames files is replaced by a single generated .object file that shows
+ * the frames with 連番ファイル, one frame per image, placed where the first frame was in the list.
+ * Temporary files are left alone because the generated object refers to the frames in place.
+ *
+ * @param file_list File list to update in place
+ * @param min_frames Minimum number of frames for a sequence to be collapsed
+ * @param collapsed [out] Number of sequences collapsed, can be NULL
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_sequence_collapse(struct gcmz_file_list *const file_list,
+                                      size_t const min_frames,
+                                      size_t *const collapsed,
+                                      struct ov_error *const err);
@@ -0,0 +1,164 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <ovtest.h>
+
+#include <ovarray.h>
+#include <ovprintf.h>
+
+#include <string.h>
+
+#include "file.h"
+#include "sequence.h"
+#include "temp.h"
+
+static bool add_frames(struct gcmz_file_list *const list,
+                       wchar_t const *const format,
+                       int const first,
+                       int const last,
+                       struct ov_error *const err) {
+  for (int i = first; i <= last; ++i) {
+    wchar_t path[MAX_PATH];
+    ov_snprintf_wchar(path, MAX_PATH, NULL, format, i);
+    if (!gcmz_file_list_add(list, path, NULL, err)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool read_object(wchar_t const *const path, char *const buf, size_t const buf_size) {
+  HANDLE h = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  DWORD read = 0;
+  BOOL const ok = ReadFile(h, buf, (DWORD)(buf_size - 1), &read, NULL);
+  CloseHandle(h);
+  buf[ok ? read : 0] = '\0';
+  return ok;
+}
+
+static void test_collapse(void) {
+  struct gcmz_file_list *list = NULL;
+  struct ov_error err = {0};
+  size_t collapsed = 0;
+  char content[4096];
+
+  if (!TEST_SUCCEEDED(gcmz_temp_create_directory(&err), &err)) {
+    return;
+  }
+
+  TEST_CASE("single sequence");
+  {
+    list = gcmz_file_list_create(&err);
+    if (!TEST_SUCCEEDED(list != NULL, &err)) {
+      goto cleanup;
+    }
+    TEST_CHECK(gcmz_file_list_add(list, L"C:\\test\\readme.txt", L"text/plain", &err));
+    TEST_CHECK(add_frames(list, L"C:\\test\\frame_%04d.png", 1, 40, &err));
+    TEST_CHECK(gcmz_file_list_add(list, L"C:\\test\\other.png", NULL, &err));
+    if (TEST_SUCCEEDED(gcmz_sequence_collapse(list, 16, &collapsed, &err), &err)) {
+      TEST_CHECK(collapsed == 1);
+      TEST_CHECK(gcmz_file_list_count(list) == 3);
+      TEST_CHECK(wcscmp(gcmz_file_list_get(list, 0)->path, L"C:\\test\\readme.txt") == 0);
+      TEST_CHECK(wcscmp(gcmz_file_list_get(list, 0)->mime_type, L"text/plain") == 0);
+      TEST_CHECK(wcscmp(gcmz_file_list_get(list, 2)->path, L"C:\\test\\other.png") == 0);
+      struct gcmz_file const *const obj = gcmz_file_list_get(list, 1);
+      TEST_CHECK(obj->temporary);
+      TEST_CHECK(wcscmp(obj->mime_type, L"application/x-aviutl-object") == 0);
+      if (TEST_CHECK(read_object(obj->path, content, sizeof(content)))) {
+        TEST_CHECK(strstr(content, "frame=0,39\r\n") != NULL);
+        TEST_CHECK(strstr(content, "ファイル=C:\\test\\frame_0001.png\r\n") != NULL);
+        TEST_CHECK(strstr(content, "連番ファイル=1\r\n") != NULL);
+        TEST_MSG("got: %s", content);
+      }
+      DeleteFileW(obj->path);
+    }
+    gcmz_file_list_destroy(&list);
+  }
+
+  TEST_CASE("unordered frames");
+  {
+    list = gcmz_file_list_create(&err);
+    if (!TEST_SUCCEEDED(list != NULL, &err)) {
+      goto cleanup;
+    }
+    TEST_CHECK(add_frames(list, L"C:\\test\\b%03d.jpg", 20, 39, &err));
+    TEST_CHECK(add_frames(list, L"C:\\test\\b%03d.jpg", 0, 19, &err));
+    if (TEST_SUCCEEDED(gcmz_sequence_collapse(list, 16, &collapsed, &err), &err)) {
+      TEST_CHECK(collapsed == 1);
+      TEST_CHECK(gcmz_file_list_count(list) == 1);
+      struct gcmz_file const *const obj = gcmz_file_list_get(list, 0);
+      if (TEST_CHECK(read_object(obj->path, content, sizeof(content)))) {
+        TEST_CHECK(strstr(content, "frame=0,39\r\n") != NULL);
+        TEST_CHECK(strstr(content, "ファイル=C:\\test\\b000.jpg\r\n") != NULL);
+      }
+      DeleteFileW(obj->path);
+    }
+    gcmz_file_list_destroy(&list);
+  }
+
+  TEST_CASE("gaps and mismatches split sequences");
+  {
+    list = gcmz_file_list_create(&err);
+    if (!TEST_SUCCEEDED(list != NULL, &err)) {
+      goto cleanup;
+    }
+    // 1-10 is too short once split by the missing frame 11
+    TEST_CHECK(add_frames(list, L"C:\\test\\c_%04d.png", 1, 10, &err));
+    TEST_CHECK(add_frames(list, L"C:\\test\\c_%04d.png", 12, 31, &err));
+    // Different digit counts, extensions, folders and temporary files are never mixed in
+    TEST_CHECK(add_frames(list, L"C:\\test\\c_%05d.png", 32, 40, &err));
+    TEST_CHECK(add_frames(list, L"C:\\test\\c_%04d.bmp", 32, 40, &err));
+    TEST_CHECK(add_frames(list, L"C:\\other\\c_%04d.png", 32, 40, &err));
+    TEST_CHECK(gcmz_file_list_add_temporary(list, L"C:\\test\\c_0032.png", NULL, &err));
+    size_t const before = gcmz_file_list_count(list);
+    if (TEST_SUCCEEDED(gcmz_sequence_collapse(list, 16, &collapsed, &err), &err)) {
+      TEST_CHECK(collapsed == 1);
+      TEST_CHECK(gcmz_file_list_count(list) == before - 20 + 1);
+      struct gcmz_file const *const obj = gcmz_file_list_get(list, 10);
+      TEST_CHECK(obj->temporary);
+      if (TEST_CHECK(read_object(obj->path, content, sizeof(content)))) {
+        TEST_CHECK(strstr(content, "frame=0,19\r\n") != NULL);
+        TEST_CHECK(strstr(content, "ファイル=C:\\test\\c_0012.png\r\n") != NULL);
+      }
+      DeleteFileW(obj->path);
+      TEST_CHECK(gcmz_file_list_get(list, before - 20)->temporary);
+    }
+    gcmz_file_list_destroy(&list);
+  }
+
+  TEST_CASE("below threshold");
+  {
+    list = gcmz_file_list_create(&err);
+    if (!TEST_SUCCEEDED(list != NULL, &err)) {
+      goto cleanup;
+    }
+    TEST_CHECK(add_frames(list, L"C:\\test\\d%d.png", 1, 15, &err));
+    if (TEST_SUCCEEDED(gcmz_sequence_collapse(list, 16, &collapsed, &err), &err)) {
+      TEST_CHECK(collapsed == 0);
+      TEST_CHECK(gcmz_file_list_count(list) == 15);
+    }
+    gcmz_file_list_destroy(&list);
+  }
+
+  TEST_CASE("invalid arguments");
+  {
+    TEST_FAILED_WITH(gcmz_sequence_collapse(NULL, 16, &collapsed, &err),
+                     &err,
+                     ov_error_type_generic,
+                     ov_error_generic_invalid_argument);
+  }
+
+cleanup:
+  if (list) {
+    gcmz_file_list_destroy(&list);
+  }
+  gcmz_temp_remove_directory();
+}
+
+TEST_LIST = {
+    {"collapse", test_collapse},
+    {NULL, NULL},
+};
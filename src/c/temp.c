@@ -2,6 +2,7 @@
 
 #include <ovarray.h>
 #include <ovbase.h>
+#include <ovcyrb64.h>
 #include <ovl/file.h>
 #include <ovl/os.h>
 #include <ovl/path.h>
@@ -9,13 +10,29 @@
 #include <ovnum.h>
 #include <ovprintf.h>
 #include <ovrand.h>
+#include <ovthreads.h>
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
+/**
+ * @brief Temporary file written by gcmz_temp_create_file_with_data
+ */
+struct content_entry {
+  uint64_t hash;
+  uint64_t size;
+  wchar_t *filename; ///< Requested name, part of the key because it decides the name and extension of the file
+  wchar_t *path;
+  size_t refs;
+};
+
 static HANDLE g_temp_dir_handle = INVALID_HANDLE_VALUE;
 static wchar_t const g_folder_prefix[] = L"gcmzdrops";
 
+static struct content_entry *g_content_index = NULL;
+static mtx_t g_content_index_mtx;
+static bool g_content_index_ready = false;
+
 static bool build_temp_directory_path(wchar_t **const dest, DWORD const process_id, struct ov_error *const err) {
   if (!dest) {
     OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
@@ -243,6 +260,14 @@ bool gcmz_temp_create_directory(struct ov_error *const err) {
     goto cleanup;
   }
 
+  if (!g_content_index_ready) {
+    if (mtx_init(&g_content_index_mtx, mtx_plain) != thrd_success) {
+      OV_ERROR_SET_GENERIC(err, ov_error_generic_fail);
+      goto cleanup;
+    }
+    g_content_index_ready = true;
+  }
+
   success = true;
 
 cleanup:
@@ -250,11 +275,31 @@ cleanup:
   return success;
 }
 
+static void content_entry_destroy(struct content_entry *const entry) {
+  if (entry->filename) {
+    OV_ARRAY_DESTROY(&entry->filename);
+  }
+  if (entry->path) {
+    OV_ARRAY_DESTROY(&entry->path);
+  }
+}
+
 void gcmz_temp_remove_directory(void) {
   if (g_temp_dir_handle != INVALID_HANDLE_VALUE) {
     CloseHandle(g_temp_dir_handle);
     g_temp_dir_handle = INVALID_HANDLE_VALUE;
   }
+  if (g_content_index_ready) {
+    size_t const n = OV_ARRAY_LENGTH(g_content_index);
+    for (size_t i = 0; i < n; ++i) {
+      content_entry_destroy(&g_content_index[i]);
+    }
+    if (g_content_index) {
+      OV_ARRAY_DESTROY(&g_content_index);
+    }
+    mtx_destroy(&g_content_index_mtx);
+    g_content_index_ready = false;
+  }
   struct ov_error err = {0};
   if (!temp_remove_directory_by_process_id(GetCurrentProcessId(), &err)) {
     OV_ERROR_REPORT(&err, gettext("failed to remove temporary directory"));
@@ -418,3 +463,191 @@ cleanup:
   }
   return success;
 }
+
+// Same value as hashing the written file in copy.c, the payload is fed in word-sized chunks padded with zeros
+static uint64_t hash_data(void const *const data, size_t const size) {
+  enum {
+    chunk_words = 1024,
+  };
+  uint32_t buf[chunk_words];
+  struct ov_cyrb64 ctx;
+  ov_cyrb64_init(&ctx, 0);
+  uint8_t const *p = (uint8_t const *)data;
+  size_t remaining = size;
+  while (remaining) {
+    size_t const n = remaining < sizeof(buf) ? remaining : sizeof(buf);
+    size_t const words = (n + 3) / 4;
+    memcpy(buf, p, n);
+    memset((uint8_t *)buf + n, 0, words * 4 - n);
+    ov_cyrb64_update(&ctx, buf, words);
+    p += n;
+    remaining -= n;
+  }
+  return ov_cyrb64_final(&ctx);
+}
+
+static bool file_has_size(wchar_t const *const path, uint64_t const size) {
+  WIN32_FILE_ATTRIBUTE_DATA fad;
+  if (!GetFileAttributesExW(path, GetFileExInfoStandard, &fad)) {
+    return false;
+  }
+  return (((uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow) == size;
+}
+
+static bool copy_string(wchar_t **const dest, wchar_t const *const src) {
+  size_t const len = wcslen(src);
+  if (!OV_ARRAY_GROW(dest, len + 1)) {
+    return false;
+  }
+  wcscpy(*dest, src);
+  OV_ARRAY_SET_LENGTH(*dest, len);
+  return true;
+}
+
+/**
+ * @brief Take a reference to an indexed file with the same content
+ *
+ * @return true if a file was found and dest_path was set
+ */
+static bool acquire_indexed_file(uint64_t const hash,
+                                 uint64_t const size,
+                                 wchar_t const *const filename,
+                                 wchar_t **const dest_path) {
+  bool found = false;
+  mtx_lock(&g_content_index_mtx);
+  size_t const n = OV_ARRAY_LENGTH(g_content_index);
+  for (size_t i = 0; i < n; ++i) {
+    struct content_entry *const e = &g_content_index[i];
+    if (e->hash != hash || e->size != size || wcscmp(e->filename, filename) != 0) {
+      continue;
+    }
+    if (!file_has_size(e->path, size)) {
+      // Deleted or rewritten behind our back, forget it
+      content_entry_destroy(e);
+      g_content_index[i] = g_content_index[n - 1];
+      OV_ARRAY_SET_LENGTH(g_content_index, n - 1);
+      break;
+    }
+    if (copy_string(dest_path, e->path)) {
+      ++e->refs;
+      found = true;
+    }
+    break;
+  }
+  mtx_unlock(&g_content_index_mtx);
+  return found;
+}
+
+static void add_indexed_file(uint64_t const hash,
+                             uint64_t const size,
+                             wchar_t const *const filename,
+                             wchar_t const *const path) {
+  struct content_entry e = {
+      .hash = hash,
+      .size = size,
+      .refs = 1,
+  };
+  if (!copy_string(&e.filename, filename) || !copy_string(&e.path, path)) {
+    // An unindexed file is simply never shared
+    content_entry_destroy(&e);
+    return;
+  }
+  mtx_lock(&g_content_index_mtx);
+  size_t const n = OV_ARRAY_LENGTH(g_content_index);
+  if (OV_ARRAY_GROW(&g_content_index, n + 1)) {
+    g_content_index[n] = e;
+    OV_ARRAY_SET_LENGTH(g_content_index, n + 1);
+    e = (struct content_entry){0};
+  }
+  mtx_unlock(&g_content_index_mtx);
+  content_entry_destroy(&e);
+}
+
+bool gcmz_temp_create_file_with_data(wchar_t const *const filename,
+                                     void const *const data,
+                                     size_t const size,
+                                     wchar_t **const dest_path,
+                                     struct ov_error *const err) {
+  if (!data || !size || !dest_path) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  wchar_t const *const name = filename && filename[0] != L'\0' ? filename : L"tmp.bin";
+  uint64_t const hash = hash_data(data, size);
+  wchar_t *path = NULL;
+  HANDLE h = INVALID_HANDLE_VALUE;
+  bool success = false;
+
+  if (g_content_index_ready && acquire_indexed_file(hash, size, name, dest_path)) {
+    return true;
+  }
+
+  if (!gcmz_temp_create_unique_file(name, &path, err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  h = CreateFileW(path, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_TEMPORARY, NULL);
+  if (h == INVALID_HANDLE_VALUE) {
+    OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+    goto cleanup;
+  }
+  {
+    uint8_t const *p = (uint8_t const *)data;
+    size_t remaining = size;
+    while (remaining) {
+      DWORD const chunk = remaining < 0x40000000 ? (DWORD)remaining : 0x40000000;
+      DWORD written = 0;
+      if (!WriteFile(h, p, chunk, &written, NULL) || written != chunk) {
+        OV_ERROR_SET_HRESULT(err, HRESULT_FROM_WIN32(GetLastError()));
+        goto cleanup;
+      }
+      p += chunk;
+      remaining -= chunk;
+    }
+  }
+  CloseHandle(h);
+  h = INVALID_HANDLE_VALUE;
+
+  if (g_content_index_ready) {
+    add_indexed_file(hash, size, name, path);
+  }
+  *dest_path = path;
+  path = NULL;
+  success = true;
+
+cleanup:
+  if (h != INVALID_HANDLE_VALUE) {
+    CloseHandle(h);
+  }
+  if (path) {
+    DeleteFileW(path);
+    OV_ARRAY_DESTROY(&path);
+  }
+  return success;
+}
+
+bool gcmz_temp_release_file(wchar_t const *const path) {
+  if (!path || !g_content_index_ready) {
+    return true;
+  }
+  bool last = true;
+  mtx_lock(&g_content_index_mtx);
+  size_t const n = OV_ARRAY_LENGTH(g_content_index);
+  for (size_t i = 0; i < n; ++i) {
+    struct content_entry *const e = &g_content_index[i];
+    if (wcscmp(e->path, path) != 0) {
+      continue;
+    }
+    if (--e->refs) {
+      last = false;
+    } else {
+      content_entry_destroy(e);
+      g_content_index[i] = g_content_index[n - 1];
+      OV_ARRAY_SET_LENGTH(g_content_index, n - 1);
+    }
+    break;
+  }
+  mtx_unlock(&g_content_index_mtx);
+  return last;
+}
@@ -68,3 +68,31 @@ bool gcmz_temp_build_path(wchar_t **const dest, wchar_t const *const filename, s
  * @return true on success, false on failure
  */
 bool gcmz_temp_create_unique_file(wchar_t const *const filename, wchar_t **const dest_path, struct ov_error *const err);
+
+/**
+ * @brief Create temporary file holding the given data, sharing it with earlier identical payloads
+ *
+ * When this process already wrote the same bytes under the same filename and that file still exists,
+ * its path is returned and its reference count is incremented instead of writing a new file.
+ * Every successful call must be paired with gcmz_temp_release_file.
+ *
+ * @param filename Base filename to create
+ * @param data Content to write
+ * @param size Size of data in bytes
+ * @param dest_path [out] Full path to the file (caller must OV_ARRAY_DESTROY)
+ * @param err [out] Error information
+ * @return true on success, false on failure
+ */
+bool gcmz_temp_create_file_with_data(wchar_t const *const filename,
+                                     void const *const data,
+                                     size_t const size,
+                                     wchar_t **const dest_path,
+                                     struct ov_error *const err);
+
+/**
+ * @brief Drop a reference taken by gcmz_temp_create_file_with_data
+ *
+ * @param path Path returned by gcmz_temp_create_file_with_data
+ * @return true if no reference remains and the file may be deleted, also true for files that are not shared
+ */
+bool gcmz_temp_release_file(wchar_t const *const path);
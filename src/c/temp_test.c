@@ -278,6 +278,106 @@ static void test_gcmz_temp_create_unique_file_dot_filenames(void) {
   }
 }
 
+static void test_gcmz_temp_create_file_with_data_reuse(void) {
+  static char const data1[] = "identical payload";
+  static char const data2[] = "different payload";
+  wchar_t *a = NULL;
+  wchar_t *b = NULL;
+  wchar_t *c = NULL;
+  wchar_t *d = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_temp_create_file_with_data(L"image.png", data1, sizeof(data1), &a, &err), &err) ||
+      !TEST_SUCCEEDED(gcmz_temp_create_file_with_data(L"image.png", data1, sizeof(data1), &b, &err), &err) ||
+      !TEST_SUCCEEDED(gcmz_temp_create_file_with_data(L"image.png", data2, sizeof(data2), &c, &err), &err) ||
+      !TEST_SUCCEEDED(gcmz_temp_create_file_with_data(L"other.png", data1, sizeof(data1), &d, &err), &err)) {
+    goto cleanup;
+  }
+
+  // Same content and name share one file, anything else gets its own
+  TEST_CHECK(wcscmp(a, b) == 0);
+  TEST_CHECK(wcscmp(a, c) != 0);
+  TEST_CHECK(wcscmp(a, d) != 0);
+
+  {
+    char buf[sizeof(data1)] = {0};
+    DWORD read = 0;
+    HANDLE hFile = CreateFileW(a, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (TEST_CHECK(hFile != INVALID_HANDLE_VALUE)) {
+      TEST_CHECK(ReadFile(hFile, buf, sizeof(buf), &read, NULL) && read == sizeof(data1));
+      TEST_CHECK(memcmp(buf, data1, sizeof(data1)) == 0);
+      CloseHandle(hFile);
+    }
+  }
+
+  // The shared file can only be deleted after the last reference is released
+  TEST_CHECK(!gcmz_temp_release_file(a));
+  TEST_CHECK(gcmz_temp_release_file(b));
+  TEST_CHECK(gcmz_temp_release_file(c));
+  TEST_CHECK(gcmz_temp_release_file(d));
+
+  // Unknown files are always deletable
+  TEST_CHECK(gcmz_temp_release_file(a));
+
+cleanup:
+  if (d) {
+    DeleteFileW(d);
+    OV_ARRAY_DESTROY(&d);
+  }
+  if (c) {
+    DeleteFileW(c);
+    OV_ARRAY_DESTROY(&c);
+  }
+  if (b) {
+    OV_ARRAY_DESTROY(&b);
+  }
+  if (a) {
+    DeleteFileW(a);
+    OV_ARRAY_DESTROY(&a);
+  }
+}
+
+static void test_gcmz_temp_create_file_with_data_deleted(void) {
+  static char const data[] = "payload";
+  wchar_t *a = NULL;
+  wchar_t *b = NULL;
+  struct ov_error err = {0};
+
+  if (!TEST_SUCCEEDED(gcmz_temp_create_file_with_data(L"text.txt", data, sizeof(data), &a, &err), &err)) {
+    goto cleanup;
+  }
+  DeleteFileW(a);
+
+  // A file removed behind the index is written again instead of being handed out
+  if (!TEST_SUCCEEDED(gcmz_temp_create_file_with_data(L"text.txt", data, sizeof(data), &b, &err), &err)) {
+    goto cleanup;
+  }
+  TEST_CHECK(GetFileAttributesW(b) != INVALID_FILE_ATTRIBUTES);
+  TEST_CHECK(gcmz_temp_release_file(b));
+
+cleanup:
+  if (b) {
+    DeleteFileW(b);
+    OV_ARRAY_DESTROY(&b);
+  }
+  if (a) {
+    OV_ARRAY_DESTROY(&a);
+  }
+}
+
+static void test_gcmz_temp_create_file_with_data_error_handling(void) {
+  wchar_t *temp_file = NULL;
+  struct ov_error err = {0};
+  TEST_FAILED_WITH(gcmz_temp_create_file_with_data(L"a.bin", NULL, 1, &temp_file, &err),
+                   &err,
+                   ov_error_type_generic,
+                   ov_error_generic_invalid_argument);
+  TEST_FAILED_WITH(gcmz_temp_create_file_with_data(L"a.bin", "x", 0, &temp_file, &err),
+                   &err,
+                   ov_error_type_generic,
+                   ov_error_generic_invalid_argument);
+}
+
 TEST_LIST = {
     {"test_gcmz_temp_create_unique_file_success", test_gcmz_temp_create_unique_file_success},
     {"test_gcmz_temp_create_unique_file_edge_cases", test_gcmz_temp_create_unique_file_edge_cases},
@@ -285,5 +385,8 @@ TEST_LIST = {
     {"test_gcmz_temp_create_unique_file_error_handling", test_gcmz_temp_create_unique_file_error_handling},
     {"test_gcmz_temp_create_unique_file_default_filename", test_gcmz_temp_create_unique_file_default_filename},
     {"test_gcmz_temp_create_unique_file_dot_filenames", test_gcmz_temp_create_unique_file_dot_filenames},
+    {"test_gcmz_temp_create_file_with_data_reuse", test_gcmz_temp_create_file_with_data_reuse},
+    {"test_gcmz_temp_create_file_with_data_deleted", test_gcmz_temp_create_file_with_data_deleted},
+    {"test_gcmz_temp_create_file_with_data_error_handling", test_gcmz_temp_create_file_with_data_error_handling},
     {NULL, NULL},
 };
@@ -0,0 +1,146 @@
+#include "trace.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <string.h>
+
+#include <ovarray.h>
+#include <ovprintf.h>
+
+enum {
+  ring_size = 4096, ///< Must be a power of two
+};
+
+struct slot {
+  LONG64 volatile seq; ///< Sequence number of the event held, 0 while it is being written
+  char const *stage;
+  uint64_t start;
+  uint64_t end;
+  uint32_t gesture;
+  uint32_t thread_id;
+};
+
+static struct slot g_ring[ring_size];
+static LONG64 volatile g_next;
+static LONG volatile g_gesture;
+
+uint32_t gcmz_trace_begin_gesture(void) { return (uint32_t)InterlockedIncrement(&g_gesture); }
+
+uint64_t gcmz_trace_now(void) {
+  LARGE_INTEGER v;
+  QueryPerformanceCounter(&v);
+  return (uint64_t)v.QuadPart;
+}
+
+uint64_t gcmz_trace_elapsed_us(uint64_t const start) {
+  LARGE_INTEGER freq;
+  QueryPerformanceFrequency(&freq);
+  return (gcmz_trace_now() - start) * 1000000 / (uint64_t)freq.QuadPart;
+}
+
+void gcmz_trace_record(char const *const stage, uint64_t const start) {
+  uint64_t const end = gcmz_trace_now();
+  LONG64 const seq = InterlockedIncrement64(&g_next);
+  struct slot *const s = &g_ring[(uint64_t)(seq - 1) & (ring_size - 1)];
+  InterlockedExchange64(&s->seq, 0);
+  s->stage = stage;
+  s->start = start;
+  s->end = end;
+  s->gesture = (uint32_t)InterlockedCompareExchange(&g_gesture, 0, 0);
+  s->thread_id = GetCurrentThreadId();
+  // Publishes the fields above to readers
+  InterlockedExchange64(&s->seq, seq);
+}
+
+void gcmz_trace_clear(void) {
+  for (size_t i = 0; i < ring_size; ++i) {
+    InterlockedExchange64(&g_ring[i].seq, 0);
+  }
+}
+
+static bool append(char **const json, size_t *const len, char const *const str, struct ov_error *const err) {
+  size_t const n = strlen(str);
+  if (!OV_ARRAY_GROW(json, *len + n + 1)) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_out_of_memory);
+    return false;
+  }
+  memcpy(*json + *len, str, n + 1);
+  *len += n;
+  OV_ARRAY_SET_LENGTH(*json, *len);
+  return true;
+}
+
+bool gcmz_trace_export_chrome_json(char **const json, struct ov_error *const err) {
+  if (!json || *json) {
+    OV_ERROR_SET_GENERIC(err, ov_error_generic_invalid_argument);
+    return false;
+  }
+
+  LARGE_INTEGER freq;
+  QueryPerformanceFrequency(&freq);
+  double const us_per_tick = 1000000.0 / (double)freq.QuadPart;
+  DWORD const pid = GetCurrentProcessId();
+  LONG64 const last = InterlockedCompareExchange64(&g_next, 0, 0);
+  LONG64 const first = last > ring_size ? last - ring_size + 1 : 1;
+  char *buf = NULL;
+  size_t len = 0;
+  bool first_event = true;
+  bool result = false;
+
+  if (!append(&buf, &len, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  for (LONG64 seq = first; seq <= last; ++seq) {
+    struct slot *const s = &g_ring[(uint64_t)(seq - 1) & (ring_size - 1)];
+    if (InterlockedCompareExchange64(&s->seq, 0, 0) != seq) {
+      continue;
+    }
+    struct slot const e = {
+        .stage = s->stage,
+        .start = s->start,
+        .end = s->end,
+        .gesture = s->gesture,
+        .thread_id = s->thread_id,
+    };
+    // Skip the event if a writer reused the slot while it was copied
+    if (InterlockedCompareExchange64(&s->seq, 0, 0) != seq) {
+      continue;
+    }
+    char line[256];
+    int const n = ov_snprintf_char(line,
+                                   sizeof(line),
+                                   NULL,
+                                   "%s{\"name\":\"%s\",\"cat\":\"gcmz\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                                   "\"pid\":%lu,\"tid\":%lu,\"args\":{\"gesture\":%lu}}",
+                                   first_event ? "" : ",",
+                                   e.stage,
+                                   (double)e.start * us_per_tick,
+                                   (double)(e.end - e.start) * us_per_tick,
+                                   (unsigned long)pid,
+                                   (unsigned long)e.thread_id,
+                                   (unsigned long)e.gesture);
+    if (n < 0 || (size_t)n >= sizeof(line)) {
+      continue;
+    }
+    if (!append(&buf, &len, line, err)) {
+      OV_ERROR_ADD_TRACE(err);
+      goto cleanup;
+    }
+    first_event = false;
+  }
+  if (!append(&buf, &len, "]}", err)) {
+    OV_ERROR_ADD_TRACE(err);
+    goto cleanup;
+  }
+  *json = buf;
+  buf = NULL;
+  result = true;
+
+cleanup:
+  if (buf) {
+    OV_ARRAY_DESTROY(&buf);
+  }
+  return result;
+}
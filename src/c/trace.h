@@ -0,0 +1,60 @@
+#pragma once
+
+#include <ovbase.h>
+
+/**
+ * @brief Stage-level latency tracing
+ *
+ * Stages are timed with QueryPerformanceCounter and recorded into a fixed-size lock-free ring buffer,
+ * so the latest events are always available at the cost of a few atomic operations per stage.
+ * Every stage is attributed to the gesture that was current when it ended.
+ * All functions are thread-safe.
+ */
+
+/**
+ * @brief Start a new gesture
+ *
+ * Stages recorded afterwards are attributed to it.
+ *
+ * @return Identifier of the new gesture
+ */
+uint32_t gcmz_trace_begin_gesture(void);
+
+/**
+ * @brief Get the current timestamp for the start of a stage
+ *
+ * @return QueryPerformanceCounter value
+ */
+uint64_t gcmz_trace_now(void);
+
+/**
+ * @brief Get the time elapsed since a timestamp
+ *
+ * @param start Value returned by gcmz_trace_now
+ * @return Elapsed time in microseconds
+ */
+uint64_t gcmz_trace_elapsed_us(uint64_t const start);
+
+/**
+ * @brief Record a stage that started at start and ends now
+ *
+ * @param stage Stage name, must be a string literal that needs no JSON escaping
+ * @param start Value returned by gcmz_trace_now when the stage started
+ */
+void gcmz_trace_record(char const *const stage, uint64_t const start);
+
+/**
+ * @brief Discard all recorded stages
+ */
+void gcmz_trace_clear(void);
+
+/**
+ * @brief Export the recorded stages in Chrome trace event format
+ *
+ * The result can be loaded into chrome://tracing or Perfetto.
+ *
+ * @param json [out] Null-terminated JSON, caller must OV_ARRAY_DESTROY
+ * @param err [out] Error information on failure
+ * @return true on success, false on failure
+ */
+NODISCARD bool gcmz_trace_export_chrome_json(char **const json, struct ov_error *const err);
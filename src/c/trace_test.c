@@ -0,0 +1,91 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <ovtest.h>
+
+#include <ovarray.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+static size_t count_occurrences(char const *haystack, char const *const needle) {
+  size_t n = 0;
+  size_t const len = strlen(needle);
+  while ((haystack = strstr(haystack, needle)) != NULL) {
+    ++n;
+    haystack += len;
+  }
+  return n;
+}
+
+static void test_export(void) {
+  struct ov_error err = {0};
+  char *json = NULL;
+
+  gcmz_trace_clear();
+
+  TEST_CASE("empty");
+  {
+    if (TEST_SUCCEEDED(gcmz_trace_export_chrome_json(&json, &err), &err)) {
+      TEST_CHECK(strcmp(json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}") == 0);
+      TEST_MSG("got: %s", json);
+      OV_ARRAY_DESTROY(&json);
+    }
+  }
+
+  TEST_CASE("stages");
+  {
+    uint32_t const gesture = gcmz_trace_begin_gesture();
+    uint64_t const start = gcmz_trace_now();
+    uint64_t const inner = gcmz_trace_now();
+    Sleep(1);
+    gcmz_trace_record("inner", inner);
+    gcmz_trace_record("outer", start);
+
+    if (TEST_SUCCEEDED(gcmz_trace_export_chrome_json(&json, &err), &err)) {
+      char expected[64];
+      snprintf(expected, sizeof(expected), "\"args\":{\"gesture\":%lu}", (unsigned long)gesture);
+      TEST_CHECK(count_occurrences(json, "\"ph\":\"X\"") == 2);
+      TEST_CHECK(count_occurrences(json, "\"name\":\"inner\"") == 1);
+      TEST_CHECK(count_occurrences(json, "\"name\":\"outer\"") == 1);
+      TEST_CHECK(count_occurrences(json, expected) == 2);
+      TEST_CHECK(strstr(json, "\"name\":\"inner\"") < strstr(json, "\"name\":\"outer\""));
+      TEST_CHECK(json[OV_ARRAY_LENGTH(json) - 1] == '}');
+      TEST_MSG("got: %s", json);
+      OV_ARRAY_DESTROY(&json);
+    }
+  }
+
+  TEST_CASE("invalid arguments");
+  {
+    TEST_FAILED_WITH(
+        gcmz_trace_export_chrome_json(NULL, &err), &err, ov_error_type_generic, ov_error_generic_invalid_argument);
+  }
+}
+
+static void test_ring_wraps(void) {
+  struct ov_error err = {0};
+  char *json = NULL;
+
+  gcmz_trace_clear();
+  for (int i = 0; i < 10000; ++i) {
+    gcmz_trace_record(i < 5000 ? "old" : "new", gcmz_trace_now());
+  }
+  if (!TEST_SUCCEEDED(gcmz_trace_export_chrome_json(&json, &err), &err)) {
+    return;
+  }
+  // Only the latest events are kept
+  TEST_CHECK(count_occurrences(json, "\"name\":\"old\"") == 0);
+  size_t const n = count_occurrences(json, "\"name\":\"new\"");
+  TEST_CHECK(n > 0 && n <= 5000);
+  TEST_MSG("new events: %zu", n);
+  OV_ARRAY_DESTROY(&json);
+}
+
+TEST_LIST = {
+    {"export", test_export},
+    {"ring_wraps", test_ring_wraps},
+    {NULL, NULL},
+};
@@ -7,18 +7,45 @@ local M = {}
 -- Local module storage (not accessible from global scope)
 local modules = {}
 
+-- True while hooks are running. Waits inside hooks do not dispatch window messages,
+-- this only guards against a handler that runs a message loop of its own.
+local busy = false
+
+-- Reload requests that arrived while hooks were running, applied once they finish
+local pending_reloads = {}
+
 --- Sort modules by priority (ascending order)
 -- @local
 local function sort_modules(a, b)
   return a.priority < b.priority
 end
 
+--- Call a hook function as a coroutine.
+-- When the hook yields a pending operation from gcmz.run_process or gcmz.copy_file,
+-- it is awaited and the coroutine is resumed with its results.
+-- @param fn function Hook function
+-- @return boolean, any true and the hook result on success, or false and error message on failure
+-- @local
+local function call_hook(fn, ...)
+  local co = coroutine.create(fn)
+  local ret = { coroutine.resume(co, ...) }
+  while ret[1] and coroutine.status(co) == "suspended" do
+    local r = { pcall(gcmz.await, ret[2]) }
+    if not r[1] then
+      return false, r[2]
+    end
+    ret = { coroutine.resume(co, unpack(r, 2, table.maxn(r))) }
+  end
+  return ret[1], ret[2]
+end
+
 --- Register a module to the module list.
 -- @param module_table table The module table (must have name field)
 -- @param source string Source path of the module (file path or module origin, required)
+-- @param modname string|nil Name the module was required with, nil if it was not loaded from the script directory
 -- @return boolean, string true on success, or false and error message on failure
 -- @local
-local function register_module(module_table, source)
+local function register_module(module_table, source, modname)
   -- source is required
   if type(source) ~= "string" or source == "" then
     return false, "handler source path is required"
@@ -41,11 +68,37 @@ local function register_module(module_table, source)
     priority = priority,
     module = module_table,
     source = source,
+    modname = modname,
     active = true,
   })
   return true, nil
 end
 
+--- Load a handler module using require and register it.
+-- Errors are logged, not raised. The caller sorts the module list.
+-- @param modname string Module name
+-- @param modpath string Source path of the module
+-- @local
+local function load_handler(modname, modpath)
+  if type(modname) ~= "string" or modname == "" then
+    debug_print("handler module name is invalid")
+    return
+  end
+  if type(modpath) ~= "string" or modpath == "" then
+    debug_print("handler source path is required: " .. modname)
+    return
+  end
+  local ok, result = pcall(require, modname)
+  if not ok then
+    debug_print("failed to load handler: " .. modname .. ": " .. tostring(result))
+    return
+  end
+  local registered, err = register_module(result, modpath, modname)
+  if not registered then
+    debug_print(err .. ": " .. modname)
+  end
+end
+
 --- Load handler modules from a list of module info.
 -- Called from C side with the list of module info in the script directory.
 -- Loads all modules using require, registers them, and sorts by priority.
@@ -54,28 +107,83 @@ function M.load_handlers(modinfo)
   if type(modinfo) ~= "table" then
     return
   end
+  for _, info in ipairs(modinfo) do
+    load_handler(info.name, info.path)
+  end
+  table.sort(modules, sort_modules)
+end
+
+--- Replace handler modules with freshly loaded ones.
+-- The module and its submodules (modname.*) are removed from package.loaded so that require reads
+-- the files again. Handlers of other modules are left untouched and keep their state.
+-- @param modinfo table Array of { name = "modname", path = "filepath" }, path is nil if the module was deleted
+-- @local
+local function apply_reload(modinfo)
   for _, info in ipairs(modinfo) do
     local modname = info.name
-    local modpath = info.path
-    if type(modname) ~= "string" or modname == "" then
-      debug_print("handler module name is invalid")
-    elseif type(modpath) ~= "string" or modpath == "" then
-      debug_print("handler source path is required: " .. modname)
-    else
-      local ok, result = pcall(require, modname)
-      if not ok then
-        debug_print("failed to load handler: " .. modname .. ": " .. tostring(result))
-      else
-        local registered, err = register_module(result, modpath)
-        if not registered then
-          debug_print(err .. ": " .. modname)
+    if type(modname) == "string" and modname ~= "" then
+      for i = #modules, 1, -1 do
+        if modules[i].modname == modname then
+          table.remove(modules, i)
+        end
+      end
+      local prefix = modname .. "."
+      for key in pairs(package.loaded) do
+        if key == modname or (type(key) == "string" and key:sub(1, #prefix) == prefix) then
+          package.loaded[key] = nil
         end
       end
+      if info.path ~= nil then
+        load_handler(modname, info.path)
+      end
     end
   end
   table.sort(modules, sort_modules)
 end
 
+--- Reload handler modules whose files have changed.
+-- Called from C side when the script directory watcher reports changes.
+-- While hooks are running the reload is deferred until they finish,
+-- so a handler is never replaced in the middle of a drag operation.
+-- @param modinfo table Array of { name = "modname", path = "filepath" }, path is nil if the module was deleted
+function M.reload_handlers(modinfo)
+  if type(modinfo) ~= "table" then
+    return
+  end
+  if busy then
+    table.insert(pending_reloads, modinfo)
+    return
+  end
+  apply_reload(modinfo)
+end
+
+--- Mark hooks as finished and apply deferred reloads.
+-- @local
+local function finish_hooks()
+  busy = false
+  if #pending_reloads == 0 then
+    return
+  end
+  local queued = pending_reloads
+  pending_reloads = {}
+  for _, modinfo in ipairs(queued) do
+    apply_reload(modinfo)
+  end
+end
+
+--- Run hooks with the busy flag set.
+-- finish_hooks runs even when fn raises an error, which is then passed on to the caller.
+-- @param fn function Function that calls the hooks
+-- @local
+local function run_hooks(fn, ...)
+  busy = true
+  local ok, err = pcall(fn, ...)
+  finish_hooks()
+  if not ok then
+    error(err, 0)
+  end
+end
+
 --- Add a handler module from a table.
 -- Checks for name field and registers the module if valid.
 -- @param module_table table The module table returned by the script (must have name field)
@@ -164,38 +272,49 @@ end
 -- @param state table Key state with format { control=bool, shift=bool, alt=bool, ... }
 -- @return table The files table (possibly modified by modules)
 function M.drag_enter(files, state)
-  -- Reset all module active flags to true
-  for _, entry in ipairs(modules) do
-    entry.active = true
+  if busy then
+    debug_print("drag_enter skipped: hooks are still running")
+    return files
   end
+  run_hooks(function()
+    -- Reset all module active flags to true
+    for _, entry in ipairs(modules) do
+      entry.active = true
+    end
 
-  -- Call drag_enter on each module
-  for _, entry in ipairs(modules) do
-    if entry.active and entry.module and entry.module.drag_enter then
-      local ok, result = pcall(entry.module.drag_enter, files, state)
-      if not ok then
-        debug_print("error in " .. entry.name .. ".drag_enter: " .. tostring(result))
-        entry.active = false
-      elseif result == false then
-        entry.active = false
+    -- Call drag_enter on each module
+    for _, entry in ipairs(modules) do
+      if entry.active and entry.module and entry.module.drag_enter then
+        local ok, result = call_hook(entry.module.drag_enter, files, state)
+        if not ok then
+          debug_print("error in " .. entry.name .. ".drag_enter: " .. tostring(result))
+          entry.active = false
+        elseif result == false then
+          entry.active = false
+        end
       end
     end
-  end
-
+  end)
   return files
 end
 
 --- Call drag_leave hook on all active modules in priority order.
 -- If a handler throws an error, it is caught and logged.
 function M.drag_leave()
-  for _, entry in ipairs(modules) do
-    if entry.active and entry.module and entry.module.drag_leave then
-      local ok, err = pcall(entry.module.drag_leave)
-      if not ok then
-        debug_print("error in " .. entry.name .. ".drag_leave: " .. tostring(err))
+  if busy then
+    debug_print("drag_leave skipped: hooks are still running")
+    return
+  end
+  run_hooks(function()
+    for _, entry in ipairs(modules) do
+      if entry.active and entry.module and entry.module.drag_leave then
+        local ok, err = call_hook(entry.module.drag_leave)
+        if not ok then
+          debug_print("error in " .. entry.name .. ".drag_leave: " .. tostring(err))
+        end
       end
     end
-  end
+  end)
 end
 
 --- Call drop hook on all active modules in priority order.
@@ -204,15 +323,20 @@ end
 -- @param state table Key state with format { control=bool, shift=bool, alt=bool, ... }
 -- @return table The files table (possibly modified by modules)
 function M.drop(files, state)
-  for _, entry in ipairs(modules) do
-    if entry.active and entry.module and entry.module.drop then
-      local ok, err = pcall(entry.module.drop, files, state)
-      if not ok then
-        debug_print("error in " .. entry.name .. ".drop: " .. tostring(err))
+  if busy then
+    debug_print("drop skipped: hooks are still running")
+    return files
+  end
+  run_hooks(function()
+    for _, entry in ipairs(modules) do
+      if entry.active and entry.module and entry.module.drop then
+        local ok, err = call_hook(entry.module.drop, files, state)
+        if not ok then
+          debug_print("error in " .. entry.name .. ".drop: " .. tostring(err))
+        end
       end
     end
-  end
-
+  end)
   return files
 end
 